@@ -0,0 +1,133 @@
+#include "simulator.h"
+#include <benchmark/benchmark.h>
+
+namespace {
+
+// Instructions of a real program, so decoders see the usual mix of formats
+const std::vector<uint32_t> &Words() {
+    static const std::vector<uint32_t> words = [] {
+        std::vector<uint32_t> result;
+        auto program = LoadHex(std::string{BENCH_DATA_DIR} + "/loop2.dat");
+        for (uint32_t i = 0; program && i < program->imem.size(); ++i) {
+            result.push_back(static_cast<uint32_t>(program->imem.getInstr(PC{i}).to_ulong()));
+        }
+        return result;
+    }();
+    return words;
+}
+
+std::vector<RISCVInstr> Instructions() {
+    std::vector<RISCVInstr> instrs;
+    for (uint32_t word : Words()) {
+        instrs.emplace_back(std::bitset<32>{word});
+    }
+    return instrs;
+}
+
+void BM_Decode(benchmark::State &state) {
+    const auto &words = Words();
+    size_t i = 0;
+    for (auto _ : state) {
+        RISCVInstr instr{std::bitset<32>{words[i++ % words.size()]}};
+        benchmark::DoNotOptimize(instr);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Decode);
+
+void BM_ControlUnit(benchmark::State &state) {
+    auto instrs = Instructions();
+    ControlUnit cu;
+    size_t i = 0;
+    for (auto _ : state) {
+        cu.setState(instrs[i++ % instrs.size()]);
+        benchmark::DoNotOptimize(cu.flags);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ControlUnit);
+
+void BM_IMM(benchmark::State &state) {
+    auto instrs = Instructions();
+    size_t i = 0;
+    for (auto _ : state) {
+        IMM imm{instrs[i++ % instrs.size()]};
+        benchmark::DoNotOptimize(imm);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IMM);
+
+void BM_ALU(benchmark::State &state) {
+    constexpr ALU::Op ops[] = {ALU::Op::ADD, ALU::Op::SUB, ALU::Op::XOR, ALU::Op::OR, ALU::Op::AND,
+                               ALU::Op::SLL, ALU::Op::SRL, ALU::Op::SRA, ALU::Op::SLT, ALU::Op::SLTU};
+    std::bitset<32> lhs{0x12345678}, rhs{0x9};
+    size_t i = 0;
+    for (auto _ : state) {
+        lhs = ALU::calc(lhs, rhs, ops[i++ % std::size(ops)]);
+        benchmark::DoNotOptimize(lhs);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ALU);
+
+void BM_BranchPredictor(benchmark::State &state) {
+    BranchPredictor bp;
+    uint32_t branches = static_cast<uint32_t>(state.range(0));
+    uint32_t i = 0;
+    for (auto _ : state) {
+        PC pc{i % branches * 7};
+        bool taken = bp.getPrediction(pc);
+        benchmark::DoNotOptimize(bp.getTarget(taken, pc));
+        bp.setPrediction(pc, PC{16}, i % 3 != 0);
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BranchPredictor)->Arg(16)->Arg(4096);
+
+void BM_DMEM(benchmark::State &state) {
+    DMEM dmem;
+    uint32_t footprint = static_cast<uint32_t>(state.range(0));
+    uint32_t addr = 0;
+    for (auto _ : state) {
+        dmem.Store({addr}, {addr});
+        benchmark::DoNotOptimize(dmem.Load({(addr + 64) % footprint}));
+        addr = (addr + 4) % footprint;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DMEM)->Arg(4 << 10)->Arg(4 << 20);
+
+// Whole pipeline on the programs of tests/data, reports simulated instructions per second of the host
+void BM_Run(benchmark::State &state, const std::string &name) {
+    auto program = LoadHex(std::string{BENCH_DATA_DIR} + "/" + name);
+    if (!program) {
+        state.SkipWithError("Can't load program");
+        return;
+    }
+
+    uint64_t instructions = 0, cycles = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Program copy;
+        copy.imem = program->imem;
+        Simulator cpu{std::move(copy)};
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(cpu.Run());
+        instructions += cpu.csr_.Instret();
+        cycles += cpu.write_back_.cycle;
+    }
+    state.counters["KIPS"] = benchmark::Counter(static_cast<double>(instructions) / 1000,
+                                                benchmark::Counter::kIsRate);
+    state.counters["KCPS"] = benchmark::Counter(static_cast<double>(cycles) / 1000, benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(BM_Run, loop1, std::string{"loop1.dat"})->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Run, loop2, std::string{"loop2.dat"})->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Run, loop3, std::string{"loop3.dat"})->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Run, loop4, std::string{"loop4.dat"})->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
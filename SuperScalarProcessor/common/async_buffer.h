@@ -0,0 +1,87 @@
+#ifndef RISCV_SIMULATOR_ASYNC_BUFFER_H
+#define RISCV_SIMULATOR_ASYNC_BUFFER_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ *  Double buffered output of binary records. The simulation thread fills one buffer while a background thread
+ *  hands the previous one to the consumer, which does the formatting and the writes. Only one buffer is consumed
+ *  at a time, so a slow consumer makes the simulation wait instead of growing memory.
+ */
+template<typename Record>
+class AsyncBuffer final {
+public:
+    using Consumer = std::function<void(const std::vector<Record> &)>;
+
+    explicit AsyncBuffer(Consumer consumer, size_t capacity = 1 << 16) :
+            consumer_(std::move(consumer)), capacity_(capacity) {
+        buffer_.reserve(capacity_);
+        pending_.reserve(capacity_);
+        writer_ = std::thread{&AsyncBuffer::WriterLoop, this};
+    }
+
+    // Consumes all pushed records
+    ~AsyncBuffer() {
+        Submit();
+        {
+            std::lock_guard lock{mutex_};
+            done_ = true;
+        }
+        cv_.notify_one();
+        writer_.join();
+    }
+
+    AsyncBuffer(const AsyncBuffer &) = delete;
+    AsyncBuffer &operator=(const AsyncBuffer &) = delete;
+
+    void Push(const Record &record) {
+        buffer_.push_back(record);
+        if (buffer_.size() == capacity_) {
+            Submit();
+        }
+    }
+
+private:
+    void Submit() {
+        std::unique_lock lock{mutex_};
+        cv_.wait(lock, [this] { return !has_pending_; });
+        std::swap(buffer_, pending_);
+        has_pending_ = true;
+        lock.unlock();
+        cv_.notify_one();
+    }
+
+    void WriterLoop() {
+        std::unique_lock lock{mutex_};
+        while (true) {
+            cv_.wait(lock, [this] { return has_pending_ || done_; });
+            if (!has_pending_) {
+                return;
+            }
+
+            lock.unlock();
+            consumer_(pending_);
+            pending_.clear();
+            lock.lock();
+            has_pending_ = false;
+            cv_.notify_one();
+        }
+    }
+
+    Consumer consumer_;
+    size_t capacity_;
+    std::vector<Record> buffer_;
+    std::vector<Record> pending_;
+    bool has_pending_{false};
+    bool done_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread writer_;
+};
+
+#endif // RISCV_SIMULATOR_ASYNC_BUFFER_H
@@ -1,13 +1,30 @@
 #ifndef RISCV_SIMULATOR_LOGGER_H
 #define RISCV_SIMULATOR_LOGGER_H
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
-#include <sstream>
-#include <iomanip>
-#include <map>
-#include <set>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
-class Logger {
+// Most verbose level compiled in, -1 removes all logging from the build
+#ifndef SIM_LOG_LEVEL
+#define SIM_LOG_LEVEL 2
+#endif
+
+/*
+ *  Asynchronous logger. Messages are fixed-size binary records with a format literal and up to four word arguments,
+ *  every thread pushes them to its own lock-free single-producer ring buffer. A background thread drains the rings
+ *  and does all the formatting and output, so a log site costs a record copy on the simulation thread.
+ *  Format placeholders: {} unsigned, {d} signed, {x} hex word, {i} instruction word.
+ */
+class Logger final {
 public:
     enum Stage : uint8_t {
         FETCH,
@@ -18,100 +35,203 @@ public:
     };
 
     enum LogLevel : uint8_t {
-        L0,
-        L1,
-        L2
+        L0,  // architectural state changes
+        L1,  // per stage results
+        L2  // everything fetched
     };
 
-    class Message {
-    public:
-        explicit Message(Stage stage, uint32_t cycle, LogLevel lvl = L0) : stage_(stage), cycle_(cycle), lvl_(lvl) {
-            std::string stage_str;
-            switch (stage) {
-                case FETCH:
-                    stage_str = "F";
-                    break;
-                case DECODE:
-                    stage_str = "D";
-                    break;
-                case EXECUTE:
-                    stage_str = "E";
-                    break;
-                case MEMORY:
-                    stage_str = "M";
-                    break;
-                case WRITE_BACK:
-                    stage_str = "W";
-                    break;
-            }
-            stream_ << std::setprecision(6) << "| " << stage_str << " |";
+    static constexpr size_t max_args = 4;
+
+    struct Record final {
+        uint64_t cycle;
+        const char *format;  // string literal, it outlives the record
+        std::array<uint32_t, max_args> args;
+        Stage stage;
+        LogLevel level;
+    };
+
+    // Disassembler for {i}, without it instruction is printed as hex word
+    using InstrFormatter = std::string (*)(uint32_t);
+
+    static Logger &Get() {
+        static Logger logger;
+        return logger;
+    }
+
+    ~Logger() {
+        Stop();
+    }
+
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    // Messages up to level are written to path until Stop
+    bool Start(const std::string &path, LogLevel level, InstrFormatter instr_formatter = nullptr) {
+        Stop();
+        file_ = std::fopen(path.c_str(), "w");
+        if (file_ == nullptr) {
+            return false;
         }
+        instr_formatter_ = instr_formatter;
+        stop_.store(false, std::memory_order_relaxed);
+        writer_ = std::thread{&Logger::WriterLoop, this};
+        level_.store(level, std::memory_order_release);
+        return true;
+    }
 
-        Stage getStage() {
-            return stage_;
+    // Writes all pushed messages and closes the file, producers must be done by this time
+    void Stop() {
+        if (!writer_.joinable()) {
+            return;
         }
+        level_.store(-1, std::memory_order_release);
+        stop_.store(true, std::memory_order_release);
+        writer_.join();
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    [[nodiscard]] bool isEnabled(LogLevel level) const noexcept {
+        return static_cast<int>(level) <= level_.load(std::memory_order_relaxed);
+    }
 
-        uint32_t getCycle() {
-            return cycle_;
+    template<typename... Args>
+    void Push(Stage stage, LogLevel level, uint64_t cycle, const char *format, Args... args) {
+        static_assert(sizeof...(Args) <= max_args, "Too many log arguments");
+        Record record{cycle, format, {static_cast<uint32_t>(args)...}, stage, level};
+        Ring &ring = LocalRing();
+        // The writer is behind only if it can't keep up with the output, waiting keeps the log complete
+        while (!ring.TryPush(record)) {
+            std::this_thread::yield();
         }
+    }
+
+    [[nodiscard]] uint64_t Written() const noexcept {
+        return written_.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Single producer single consumer ring, the producer is the owning thread and the consumer is the writer
+    class Ring final {
+    public:
+        static constexpr size_t capacity = 1 << 14;
 
-        std::ostream &GetStream() {
-            return stream_;
+        bool TryPush(const Record &record) noexcept {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) == capacity) {
+                return false;
+            }
+            records_[tail & (capacity - 1)] = record;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        template<typename Consumer>
+        size_t Drain(Consumer &&consume) {
+            size_t head = head_.load(std::memory_order_relaxed);
+            size_t tail = tail_.load(std::memory_order_acquire);
+            for (size_t i = head; i != tail; ++i) {
+                consume(records_[i & (capacity - 1)]);
+            }
+            head_.store(tail, std::memory_order_release);
+            return tail - head;
         }
 
     private:
-        Stage stage_;
-        uint32_t cycle_;
-        LogLevel lvl_;
-        std::ostringstream stream_;
+        std::vector<Record> records_ = std::vector<Record>(capacity);
+        alignas(64) std::atomic<size_t> head_{0};
+        alignas(64) std::atomic<size_t> tail_{0};
     };
 
-    // TODO:
-    void Dump() {
-//        std::string mem_str_up;
-//        if (memory_.mem_we_up_) {
-//            mem_str_up = "D2: " + std::to_string(memory_.D2.to_ulong()) +
-//                         " Adr: " + std::to_string(static_cast<int>(memory_.ALU_OUT(Way::UP).to_ulong()));
-//        } else {
-//            mem_str_up = "WB_WE: " + std::to_string(memory_.WB_WE(Way::UP)) +
-//                         " Reg: " + std::to_string(memory_.WB_A(Way::UP).to_ulong()) +
-//                         " Dat: " + std::to_string(memory_.getOutData(Way::UP).to_ulong());
-//        }
-//        std::string wb_str_up = "WB_WE: " + std::to_string(write_back_.WB_WE(Way::UP)) +
-//                                " Reg: " + std::to_string(write_back_.WB_A(Way::UP).to_ulong()) +
-//                                " Dat: " + std::to_string(write_back_.WB_D(Way::UP).to_ulong());
-//
-//        std::string mem_str_down;
-//        if (memory_.mem_we_down_) {
-//            mem_str_down = "D2: " + std::to_string(memory_.D2.to_ulong()) +
-//                           " Adr: " + std::to_string(static_cast<int>(memory_.ALU_OUT(Way::DOWN).to_ulong()));
-//        } else {
-//            mem_str_down = "WB_WE: " + std::to_string(memory_.WB_WE(Way::DOWN)) +
-//                           " Reg: " + std::to_string(memory_.WB_A(Way::DOWN).to_ulong()) +
-//                           " Dat: " + std::to_string(memory_.getOutData(Way::DOWN).to_ulong());
-//        }
-//        std::string wb_str_down = "WB_WE: " + std::to_string(write_back_.WB_WE(Way::DOWN)) +
-//                                  " Reg: " + std::to_string(write_back_.WB_A(Way::DOWN).to_ulong()) +
-//                                  " Dat: " + std::to_string(write_back_.WB_D(Way::DOWN).to_ulong());
-//        std::cout << std::left
-//                  << std::setw(24) << "|F" + std::to_string(fetch_.cycle) + ": " + fetch_.getInstr(Way::UP).ToString()
-//                  << std::setw(24) << "|D" + std::to_string(decode_.cycle) + ": " + decode_.getInstr(Way::UP).ToString()
-//                  << std::setw(24) << "|E" + std::to_string(execute_.cycle) + ": " + execute_.getInstr(Way::UP).ToString()
-//                  << std::setw(24) << "|M" + std::to_string(execute_.cycle) + ": " + mem_str_up + "    "
-//                  << std::setw(24) << "|W" + std::to_string(execute_.cycle) + ": " + wb_str_up << std::endl
-//                  << std::setw(24) << "|F" + std::to_string(fetch_.cycle) + ": " + fetch_.getInstr(Way::DOWN).ToString()
-//                  << std::setw(24) << "|D" + std::to_string(decode_.cycle) + ": " + decode_.getInstr(Way::DOWN).ToString()
-//                  << std::setw(24) << "|E" + std::to_string(execute_.cycle) + ": " + execute_.getInstr(Way::DOWN).ToString()
-//                  << std::setw(24) << "|M" + std::to_string(execute_.cycle) + ": " + mem_str_down + "    "
-//                  << std::setw(24) << "|W" + std::to_string(execute_.cycle) + ": " + wb_str_down << std::endl
-//                  << "========" << std::setw(10) << "a0 = " + std::to_string(decode_.getRegFile().Read(10).to_ulong())
-//                  << std::setw(10) << "a1 = " + std::to_string(decode_.getRegFile().Read(11).to_ulong())
-//                  << std::setw(10) << "a5 = " + std::to_string(decode_.getRegFile().Read(15).to_ulong()) << std::endl;
+    Logger() = default;
+
+    Ring &LocalRing() {
+        // Rings are shared with the logger, so records of exited threads are still written
+        thread_local std::shared_ptr<Ring> ring;
+        if (ring == nullptr) {
+            ring = std::make_shared<Ring>();
+            std::lock_guard lock{rings_mutex_};
+            rings_.push_back(ring);
+        }
+        return *ring;
     }
 
-private:
-    // cycles -> F, D, E, M, WB
-    std::map<uint32_t, std::set<std::string>> out_log_;
+    size_t DrainAll() {
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::lock_guard lock{rings_mutex_};
+            rings = rings_;
+        }
+        size_t count = 0;
+        for (auto &ring : rings) {
+            count += ring->Drain([this](const Record &record) { Write(record); });
+        }
+        written_.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    void WriterLoop() {
+        while (!stop_.load(std::memory_order_acquire)) {
+            if (DrainAll() == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        // Messages pushed after the last check above
+        DrainAll();
+        std::fflush(file_);
+    }
+
+    void Write(const Record &record) {
+        static constexpr const char stage_names[] = {'F', 'D', 'E', 'M', 'W'};
+        std::string line = std::to_string(record.cycle) + " | " + stage_names[record.stage] + " | ";
+
+        size_t arg = 0;
+        for (const char *p = record.format; *p != '\0'; ++p) {
+            const char *end = *p == '{' ? std::strchr(p, '}') : nullptr;
+            char spec = end == nullptr || end - p > 2 ? '\0' : end - p == 1 ? 'u' : p[1];
+            if (std::strchr("udxi", spec) == nullptr || spec == '\0' || arg == max_args) {
+                line += *p;
+                continue;
+            }
+
+            uint32_t value = record.args[arg++];
+            char buf[16];
+            if (spec == 'i' && instr_formatter_ != nullptr) {
+                line += instr_formatter_(value);
+            } else if (spec == 'x' || spec == 'i') {
+                std::snprintf(buf, sizeof(buf), "%08x", value);
+                line += buf;
+            } else if (spec == 'd') {
+                line += std::to_string(static_cast<int32_t>(value));
+            } else {
+                line += std::to_string(value);
+            }
+            p = end;
+        }
+
+        line += '\n';
+        std::fwrite(line.data(), 1, line.size(), file_);
+    }
+
+    std::atomic<int> level_{-1};
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> written_{0};
+    InstrFormatter instr_formatter_{nullptr};
+    FILE *file_{nullptr};
+    std::thread writer_;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
 };
 
+// Disabled levels are removed at compile time, enabled ones cost a relaxed load while the logger is stopped
+#define LOG(level, stage, cycle, format, ...)                                                                 \
+    do {                                                                                                      \
+        if constexpr (static_cast<int>(Logger::level) <= SIM_LOG_LEVEL) {                                     \
+            if (Logger::Get().isEnabled(Logger::level)) {                                                     \
+                Logger::Get().Push(Logger::stage, Logger::level, (cycle), "" format __VA_OPT__(,) __VA_ARGS__); \
+            }                                                                                                 \
+        }                                                                                                     \
+    } while (false)
+
 #endif // RISCV_SIMULATOR_LOGGER_H
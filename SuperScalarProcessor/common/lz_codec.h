@@ -0,0 +1,142 @@
+#ifndef RISCV_SIMULATOR_LZ_CODEC_H
+#define RISCV_SIMULATOR_LZ_CODEC_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/*
+ *  Byte-oriented LZ77 codec in the block format of LZ4: a sequence is a token (literal length in the high nibble,
+ *  match length minus 4 in the low one, 15 continues in the following bytes), the literals, two bytes of match
+ *  offset and the rest of match length. The last sequence has only literals. Compression is greedy with one hash
+ *  table lookup per position, which is what the repetitive columns of traces need.
+ */
+class LZCodec final {
+public:
+    static std::vector<uint8_t> Compress(const uint8_t *data, size_t size) {
+        std::vector<uint8_t> out;
+        out.reserve(size / 2 + 16);
+        std::array<uint32_t, hash_size> last{};  // position + 1 of the last 4 bytes with the hash, 0 if none
+
+        size_t literal = 0;
+        size_t pos = 0;
+        // Match must leave the last bytes as literals, so the decoder never reads past them
+        while (size >= min_match + 1 && pos + min_match < size) {
+            uint32_t hash = Hash(data + pos);
+            size_t candidate = last[hash];
+            last[hash] = static_cast<uint32_t>(pos + 1);
+            if (candidate == 0 || pos - (candidate - 1) > max_offset ||
+                std::memcmp(data + candidate - 1, data + pos, min_match) != 0) {
+                ++pos;
+                continue;
+            }
+
+            size_t match = candidate - 1;
+            size_t length = min_match;
+            while (pos + length < size - 1 && data[match + length] == data[pos + length]) {
+                ++length;
+            }
+            WriteSequence(out, data + literal, pos - literal, pos - match, length);
+            pos += length;
+            literal = pos;
+        }
+        WriteSequence(out, data + literal, size - literal, 0, 0);
+        return out;
+    }
+
+    // Returns false if the data is corrupted or doesn't decompress to exactly size bytes
+    static bool Decompress(const uint8_t *data, size_t size, uint8_t *out, size_t out_size) {
+        const uint8_t *end = data + size;
+        size_t written = 0;
+        while (data < end) {
+            uint8_t token = *data++;
+            size_t literals = token >> 4;
+            if (literals == 15 && !ReadLength(data, end, literals)) {
+                return false;
+            }
+            if (static_cast<size_t>(end - data) < literals || out_size - written < literals) {
+                return false;
+            }
+            std::memcpy(out + written, data, literals);
+            data += literals;
+            written += literals;
+            if (data == end) {
+                break;
+            }
+
+            if (end - data < 2) {
+                return false;
+            }
+            size_t offset = data[0] | (data[1] << 8);
+            data += 2;
+            size_t length = token & 15;
+            if (length == 15 && !ReadLength(data, end, length)) {
+                return false;
+            }
+            length += min_match;
+            if (offset == 0 || offset > written || out_size - written < length) {
+                return false;
+            }
+            // Overlapping match repeats the last offset bytes, so it's copied byte by byte
+            for (size_t i = 0; i < length; ++i, ++written) {
+                out[written] = out[written - offset];
+            }
+        }
+        return written == out_size;
+    }
+
+private:
+    static constexpr const size_t min_match = 4;
+    static constexpr const size_t max_offset = 65535;
+    static constexpr const size_t hash_bits = 14;
+    static constexpr const size_t hash_size = size_t{1} << hash_bits;
+
+    static uint32_t Hash(const uint8_t *data) noexcept {
+        uint32_t word;
+        std::memcpy(&word, data, sizeof(word));
+        return (word * 2654435761u) >> (32 - hash_bits);
+    }
+
+    static void WriteLength(std::vector<uint8_t> &out, size_t length) {
+        for (; length >= 255; length -= 255) {
+            out.push_back(255);
+        }
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    static bool ReadLength(const uint8_t *&data, const uint8_t *end, size_t &length) noexcept {
+        uint8_t byte;
+        do {
+            if (data == end) {
+                return false;
+            }
+            byte = *data++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // Match of length 0 ends the block
+    static void WriteSequence(std::vector<uint8_t> &out, const uint8_t *literals, size_t literal_length,
+                              size_t offset, size_t length) {
+        size_t match_code = length == 0 ? 0 : length - min_match;
+        size_t token = (std::min<size_t>(literal_length, 15) << 4) | std::min<size_t>(match_code, 15);
+        out.push_back(static_cast<uint8_t>(token));
+        if (literal_length >= 15) {
+            WriteLength(out, literal_length - 15);
+        }
+        out.insert(out.end(), literals, literals + literal_length);
+        if (length == 0) {
+            return;
+        }
+        out.push_back(static_cast<uint8_t>(offset));
+        out.push_back(static_cast<uint8_t>(offset >> 8));
+        if (match_code >= 15) {
+            WriteLength(out, match_code - 15);
+        }
+    }
+};
+
+#endif // RISCV_SIMULATOR_LZ_CODEC_H
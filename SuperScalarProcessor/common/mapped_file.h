@@ -0,0 +1,75 @@
+#ifndef COMMON_MAPPED_FILE_H
+#define COMMON_MAPPED_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Private copy-on-write mapping of the whole file: guest can write to mapped pages,
+// the file on disk is never changed.
+class MappedFile final {
+public:
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(data_, size_);
+        }
+    }
+
+    // Returns nullptr if file can't be mapped
+    static std::shared_ptr<MappedFile> Open(const std::string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return nullptr;
+        }
+
+        size_t size = static_cast<size_t>(st.st_size);
+        void *data = nullptr;
+        if (size > 0) {
+            data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                return nullptr;
+            }
+        }
+        close(fd);
+
+        return std::shared_ptr<MappedFile>(new MappedFile(static_cast<uint8_t *>(data), size));
+    }
+
+    // Pages are read in order once, so the kernel reads ahead and can drop the read ones
+    void AdviseSequential() const noexcept {
+        if (data_ != nullptr) {
+            madvise(data_, size_, MADV_SEQUENTIAL);
+        }
+    }
+
+    [[nodiscard]] uint8_t *data() const noexcept {
+        return data_;
+    }
+
+    [[nodiscard]] size_t size() const noexcept {
+        return size_;
+    }
+
+private:
+    MappedFile(uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+    uint8_t *data_{nullptr};
+    size_t size_{0};
+};
+
+#endif // COMMON_MAPPED_FILE_H
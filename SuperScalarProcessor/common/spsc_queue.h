@@ -0,0 +1,111 @@
+#ifndef RISCV_SIMULATOR_SPSC_QUEUE_H
+#define RISCV_SIMULATOR_SPSC_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <vector>
+
+/*
+ *  Bounded lock-free queue of one producer thread and one consumer thread. Head and tail are the only shared
+ *  state, each is written by its own side and cached by the other one, so most operations touch no shared cache
+ *  line. The side that has to wait sleeps on the index of the other one: consumer is woken by every push, producer
+ *  only when the consumer has freed half of the queue, so the sleeping producer costs the consumer nothing.
+ *
+ *  The producer closes the queue after the last item, the consumer cancels it when it stops popping earlier, both
+ *  are marked by the top bit of the index of their side.
+ */
+template<typename T>
+class SPSCQueue final {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SPSCQueue(size_t capacity = 4096) :
+            items_(std::bit_ceil(std::max<size_t>(capacity, 2))), mask_(items_.size() - 1) {}
+
+    SPSCQueue(const SPSCQueue &) = delete;
+    SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+    /*=== producer ===*/
+    // Returns false if the queue is full
+    bool TryPush(const T &item) noexcept {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - (head_cache_ & ~mark) == items_.size()) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - (head_cache_ & ~mark) == items_.size()) {
+                return false;
+            }
+        }
+        items_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        tail_.notify_one();
+        return true;
+    }
+
+    // Waits while the queue is full, returns false if the consumer has cancelled it
+    bool Push(const T &item) noexcept {
+        while (!TryPush(item)) {
+            if ((head_cache_ & mark) != 0) {
+                return false;
+            }
+            head_.wait(head_cache_, std::memory_order_acquire);
+        }
+        return true;
+    }
+
+    // No more items, the consumer still gets the pushed ones
+    void Close() noexcept {
+        tail_.fetch_or(mark, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+    /*=== consumer ===*/
+    // Returns false if the queue is empty
+    bool TryPop(T &item) noexcept {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == (tail_cache_ & ~mark)) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == (tail_cache_ & ~mark)) {
+                return false;
+            }
+        }
+        item = items_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        if (((head + 1) & (mask_ >> 1)) == 0) {
+            head_.notify_one();
+        }
+        return true;
+    }
+
+    // Waits while the queue is empty, returns false when it's empty and closed
+    bool Pop(T &item) noexcept {
+        while (!TryPop(item)) {
+            if ((tail_cache_ & mark) != 0) {
+                return false;
+            }
+            tail_.wait(tail_cache_, std::memory_order_acquire);
+        }
+        return true;
+    }
+
+    // Consumer stops popping, the waiting producer is released
+    void Cancel() noexcept {
+        head_.fetch_or(mark, std::memory_order_release);
+        head_.notify_one();
+    }
+
+    [[nodiscard]] size_t Capacity() const noexcept {
+        return items_.size();
+    }
+
+private:
+    static constexpr const size_t mark = size_t{1} << (sizeof(size_t) * 8 - 1);
+
+    std::vector<T> items_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};  // next item to pop
+    size_t tail_cache_{0};  // consumer's copy of tail_
+    alignas(64) std::atomic<size_t> tail_{0};  // next item to push
+    size_t head_cache_{0};  // producer's copy of head_
+};
+
+#endif // RISCV_SIMULATOR_SPSC_QUEUE_H
@@ -0,0 +1,89 @@
+#ifndef RISCV_SIMULATOR_WORK_STEALING_H
+#define RISCV_SIMULATOR_WORK_STEALING_H
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/*
+ *  Runs independent jobs 0..count-1 on a fixed number of threads. Every worker starts with a contiguous block of
+ *  jobs in its own deque and takes them from the front. A worker that has run out of jobs steals from the back of
+ *  the other deques, so a block of long jobs doesn't leave the other cores idle at the end of the run.
+ */
+class WorkStealingPool final {
+public:
+    // 0 threads means one per hardware thread
+    explicit WorkStealingPool(size_t threads = 0) :
+            threads_(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    // Returns when all jobs are done, the calling thread is one of the workers
+    void Run(size_t count, const std::function<void(size_t)> &job) {
+        std::vector<Queue> queues(std::min(threads_, std::max<size_t>(count, 1)));
+        size_t block = (count + queues.size() - 1) / queues.size();
+        for (size_t i = 0; i < count; ++i) {
+            queues[i / block].jobs.push_back(i);
+        }
+
+        auto worker = [&](size_t self) {
+            while (auto next = Take(queues, self)) {
+                job(*next);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < queues.size(); ++i) {
+            workers.emplace_back(worker, i);
+        }
+        worker(0);
+        for (auto &thread : workers) {
+            thread.join();
+        }
+    }
+
+    [[nodiscard]] size_t Threads() const noexcept {
+        return threads_;
+    }
+
+    // Jobs taken from the deque of another worker over all runs
+    [[nodiscard]] uint64_t Steals() const noexcept {
+        return steals_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Queue final {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+
+    std::optional<size_t> Take(std::vector<Queue> &queues, size_t self) {
+        {
+            std::lock_guard lock{queues[self].mutex};
+            if (!queues[self].jobs.empty()) {
+                size_t job = queues[self].jobs.front();
+                queues[self].jobs.pop_front();
+                return job;
+            }
+        }
+        // Jobs don't create new ones, so a worker that finds every deque empty is done
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue &victim = queues[(self + i) % queues.size()];
+            std::lock_guard lock{victim.mutex};
+            if (!victim.jobs.empty()) {
+                size_t job = victim.jobs.back();
+                victim.jobs.pop_back();
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+        return std::nullopt;
+    }
+
+    size_t threads_;
+    std::atomic<uint64_t> steals_{0};
+};
+
+#endif //RISCV_SIMULATOR_WORK_STEALING_H
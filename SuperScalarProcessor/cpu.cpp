@@ -1,27 +1,409 @@
-#include <fstream>
+#include <bit>
+#include <charconv>
+#include <iomanip>
+#include <optional>
+#include <fcntl.h>
+#include <unistd.h>
 #include "simulator.h"
+#include "interval.h"
+#include "multihart.h"
+#include "steadystate.h"
+#include "tracefile.h"
+#include "logger.h"
+
+namespace {
+
+bool ParseUInt(const std::string &value, uint32_t &out) {
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), out);
+    return ec == std::errc{} && ptr == value.data() + value.size();
+}
+
+// Output options that don't affect the simulation
+struct OutputOptions final {
+    std::string trace;
+    std::string log;
+    std::string commit_log;
+    bool commit_log_disasm{false};  // with the disassembly line of spike -l before every commit line
+    uint32_t log_level{Logger::L2};
+    bool profile{false};
+    bool profile_functions{false};  // fold the profile by ELF symbols
+    bool mix{false};
+    std::string stats;
+    uint32_t stats_interval{10000};
+    StatsRegistry::Period stats_period{StatsRegistry::Period::CYCLES};
+    bool functional_first{false};  // same results, the functional simulator runs on another host thread
+    std::string record;  // binary trace of the functional simulator, without timing
+    std::string replay;  // trace the pipeline replays instead of executing the program
+    bool interval{false};  // cycles estimated by interval analysis instead of the pipeline
+    bool interval_memo{false};  // basic blocks of the interval model are timed once per entry state
+    bool extrapolate{false};  // same results, repeated loop iterations are only executed functionally
+};
+
+// Options are passed as --name=value
+bool ParseOption(const std::string &arg, MultiHart::Config &config, OutputOptions &output) {
+    auto eq = arg.find('=');
+    std::string name = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+    std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    if (SetParameter(config.core, name, value)) {
+        return true;
+    } else if (name == "harts") {
+        return ParseUInt(value, config.harts) && config.harts > 0 && config.harts <= L2Cache::max_harts;
+    } else if (name == "quantum") {
+        uint32_t quantum{0};
+        if (!ParseUInt(value, quantum) || quantum == 0) {
+            return false;
+        }
+        config.quantum = quantum;
+        return true;
+    } else if (name == "deterministic") {
+        config.deterministic = true;
+        return value.empty();
+    } else if (name == "trace") {
+        output.trace = value;
+        return !value.empty();
+    } else if (name == "commit-log") {
+        output.commit_log = value;
+        return !value.empty();
+    } else if (name == "commit-log-disasm") {
+        output.commit_log_disasm = true;
+        return value.empty();
+    } else if (name == "log") {
+        output.log = value;
+        return !value.empty();
+    } else if (name == "profile") {
+        output.profile = true;
+        output.profile_functions = value == "functions";
+        return value.empty() || output.profile_functions;
+    } else if (name == "mix") {
+        output.mix = true;
+        return value.empty();
+    } else if (name == "stats") {
+        output.stats = value;
+        return !value.empty();
+    } else if (name == "stats-interval") {
+        return ParseUInt(value, output.stats_interval) && output.stats_interval > 0;
+    } else if (name == "stats-by") {
+        output.stats_period = value == "instructions" ? StatsRegistry::Period::INSTRUCTIONS
+                                                      : StatsRegistry::Period::CYCLES;
+        return value == "instructions" || value == "cycles";
+    } else if (name == "functional-first") {
+        output.functional_first = true;
+        return value.empty();
+    } else if (name == "interval") {
+        output.interval = true;
+        output.interval_memo = value == "memo";
+        return value.empty() || output.interval_memo;
+    } else if (name == "extrapolate") {
+        output.extrapolate = true;
+        return value.empty();
+    } else if (name == "record") {
+        output.record = value;
+        return !value.empty();
+    } else if (name == "replay") {
+        output.replay = value;
+        return !value.empty();
+    } else if (name == "log-level") {
+        return ParseUInt(value, output.log_level) && output.log_level <= Logger::L2;
+    }
+
+    return false;
+}
+
+// Only executes the program and writes its trace
+int Record(Program &&program, const std::string &path) {
+    auto writer = TraceWriter::Open(path);
+    if (writer == nullptr) {
+        return 1;
+    }
+    FunctionalSimulator functional{std::move(program)};
+    if (RecordTrace(functional, *writer) == PipelineState::ERR) {
+        return 2;
+    }
+
+    std::cout << "Recorded instructions: " << writer->Records() << std::endl;
+    const SyscallUnit &sys = functional.getSyscallUnit();
+    return sys.isExited() ? sys.ExitCode() : 0;
+}
+
+void PrintAtomics(const AtomicUnit &atomic, const std::string &title = "Atomics") {
+    if (atomic.LoadReserved() + atomic.StoreConditional() + atomic.AMOs() == 0) {
+        return;
+    }
+    std::cout << title << ": lr " << atomic.LoadReserved() << ", sc " << atomic.StoreConditional()
+              << " (failed " << atomic.StoreConditionalFailures() << "), amo " << atomic.AMOs()
+              << ", handoffs " << atomic.Handoffs() << ", broken reservations " << atomic.BrokenReservations()
+              << std::endl;
+}
+
+// Same run with blocking misses, runahead saves the difference. The program is loaded again: copies of a loaded one
+// share its mapped data pages, which the measured run has already written. Its guest standard streams are /dev/null:
+// the output was already printed by the measured run
+std::optional<uint64_t> BlockingCycles(const std::string &path, SimConfig config) {
+    auto program = LoadProgram(path);
+    if (!program) {
+        return std::nullopt;
+    }
+    config.runahead = false;
+    Simulator cpu = Simulator{std::move(*program), config};
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd < 0) {
+        return std::nullopt;
+    }
+    for (uint32_t fd = 0; fd < 3; ++fd) {
+        cpu.sys_.setFd(fd, null_fd);
+    }
+    PipelineState state = cpu.Run();
+    close(null_fd);
+    if (state == PipelineState::ERR) {
+        return std::nullopt;
+    }
+    return cpu.write_back_.cycle;
+}
+
+// Estimate of the interval model, it has no pipeline to trace or profile
+int RunInterval(Program &&program, const SimConfig &config, const OutputOptions &output) {
+    if (!output.trace.empty() || !output.commit_log.empty() || !output.log.empty() || !output.stats.empty() ||
+        output.profile || output.mix) {
+        std::cerr << "Trace, logs, statistics and profile are supported only by the pipeline" << std::endl;
+        return 1;
+    }
+
+    IntervalModel model{std::move(program), config, output.interval_memo};
+    if (model.Run() == PipelineState::ERR) {
+        return 2;
+    }
+
+    std::cout << "Total cycles: " << model.Cycles() << " (interval analysis)" << std::endl;
+    model.getCPIStack().Print(std::cout);
+    std::cout << "Mispredictions: " << model.Mispredictions() << std::endl;
+    if (output.interval_memo) {
+        std::cout << "Basic blocks: " << model.Blocks() << ", memoized: " << model.MemoHits() << std::endl;
+    }
+    const SyscallUnit &sys = model.getFunctional().getSyscallUnit();
+    if (sys.Calls() > 0) {
+        std::cout << "System calls: " << sys.Calls() << std::endl;
+    }
+    PrintAtomics(model.getFunctional().getAtomicUnit());
+    if (config.dcache.miss_latency > 0) {
+        const DataCache &dcache = model.getDCache();
+        std::cout << "DCache hits: " << dcache.Hits() << ", misses: " << dcache.Misses() << std::endl;
+    }
+    return sys.isExited() ? sys.ExitCode() : 0;
+}
+
+// Several harts print only their totals, per instruction outputs are for one hart
+int RunHarts(Program &&program, const MultiHart::Config &config, const OutputOptions &output) {
+    if (!output.trace.empty() || !output.commit_log.empty() || !output.log.empty() || !output.stats.empty() ||
+        output.profile || output.mix) {
+        std::cerr << "Trace, logs, statistics and profile are supported only for one hart" << std::endl;
+        return 1;
+    }
+
+    MultiHart harts{std::move(program), config};
+    if (harts.Run() == PipelineState::ERR) {
+        return 2;
+    }
+
+    std::cout << "Total cycles: " << harts.Cycles() << std::endl;
+    std::cout << "Harts: " << harts.Harts() << ", quanta: " << harts.Quanta() << std::endl;
+    for (size_t id = 0; id < harts.Harts(); ++id) {
+        const Simulator &hart = harts.Hart(id);
+        std::cout << "  hart " << id << ": cycles " << hart.write_back_.cycle << ", instructions "
+                  << hart.csr_.Instret() << std::endl;
+    }
+
+    // Coherence of the private caches: the lines to pad or split first
+    for (size_t id = 0; id < harts.Harts(); ++id) {
+        const DataCache &dcache = harts.Hart(id).memory_.getDCache();
+        std::cout << "  hart " << id << " dcache: hits " << dcache.Hits() << ", misses " << dcache.Misses()
+                  << " (coherence " << dcache.CoherenceMisses() << ", false sharing " << dcache.FalseSharingMisses()
+                  << "), invalidations " << dcache.Invalidations() << std::endl;
+    }
+    const L2Cache &l2 = harts.L2();
+    if (l2.getConfig().sets > 0) {
+        std::cout << "L2 hits: " << l2.Hits() << ", misses: " << l2.Misses() << std::endl;
+    }
+    std::cout << "Cache-to-cache transfers: " << l2.Transfers() << ", writebacks: " << l2.Writebacks() << std::endl;
+    auto hot_lines = l2.HotLines(8);
+    if (!hot_lines.empty()) {
+        std::cout << "Hot lines:" << std::endl;
+        auto flags = std::cout.flags();
+        for (const auto &[addr, line] : hot_lines) {
+            std::cout << "  0x" << std::hex << std::setw(8) << std::setfill('0') << addr << std::dec
+                      << std::setfill(' ') << ": invalidations " << line.invalidations << ", coherence misses "
+                      << line.coherence_misses << " (false sharing " << line.false_sharing << "), writers "
+                      << std::popcount(line.writers) << std::endl;
+        }
+        std::cout.flags(flags);
+    }
+
+    // Synchronization of the guest: the words most of the atomic conflicts are on
+    std::vector<const AtomicUnit *> units;
+    for (size_t id = 0; id < harts.Harts(); ++id) {
+        const AtomicUnit &atomic = harts.Hart(id).memory_.getAtomicUnit();
+        PrintAtomics(atomic, "  hart " + std::to_string(id) + " atomics");
+        units.push_back(&atomic);
+    }
+    auto hot_words = AtomicUnit::HotWords(units, 8);
+    if (!hot_words.empty()) {
+        std::cout << "Contended words:" << std::endl;
+        auto flags = std::cout.flags();
+        for (const auto &[addr, word] : hot_words) {
+            std::cout << "  0x" << std::hex << std::setw(8) << std::setfill('0') << addr << std::dec
+                      << std::setfill(' ') << ": atomics " << word.accesses << ", sc failures " << word.sc_failures
+                      << ", handoffs " << word.handoffs << ", broken reservations " << word.broken << std::endl;
+        }
+        std::cout.flags(flags);
+    }
+
+    const Simulator &main_hart = harts.Hart(0);
+    return main_hart.sys_.isExited() ? main_hart.sys_.ExitCode() : 0;
+}
+
+}  // namespace
 
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
+    MultiHart::Config harts;
+    harts.harts = 1;  // more only with --harts
+    SimConfig &config = harts.core;
+    std::string path;
+    OutputOptions output;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg{argv[i]};
+        if (arg.rfind("--", 0) != 0) {
+            path = arg;
+        } else if (!ParseOption(arg, harts, output)) {
+            std::cerr << "Invalid option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (path.empty()) {
         std::cerr << "No file passed to cpu" << std::endl;
         return 1;
     }
 
-    IMEM imem;
-    std::ifstream file((std::string(argv[1])));
-    std::string ins_bits;
-    while (std::getline(file, ins_bits)) {
-        if (!ins_bits.empty()) {
-            imem.pushBackInstr(std::bitset<32>{std::stoul(ins_bits, nullptr, 16)});
+    auto program = LoadProgram(path);
+    if (!program) {
+        return 1;
+    }
+    bool replays = output.functional_first || !output.replay.empty() || output.extrapolate;
+    int modes = static_cast<int>(output.functional_first) + static_cast<int>(!output.replay.empty()) +
+                static_cast<int>(output.interval) + static_cast<int>(output.extrapolate);
+    if (modes > 0 && (harts.harts > 1 || config.runahead || modes > 1)) {
+        // Runahead reads the data memory, which belongs to the functional simulator or isn't there at all
+        std::cerr << "Functional-first, trace-driven, interval and extrapolated simulations run one hart without "
+                     "runahead" << std::endl;
+        return 1;
+    }
+    if (output.extrapolate && (!output.trace.empty() || !output.commit_log.empty() || !output.log.empty() ||
+                               !output.stats.empty() || output.profile || output.mix)) {
+        std::cerr << "Trace, logs, statistics and profile need every cycle, they can't be extrapolated" << std::endl;
+        return 1;
+    }
+    if (!output.record.empty()) {
+        return Record(std::move(*program), output.record);
+    }
+    if (output.interval) {
+        return RunInterval(std::move(*program), config, output);
+    }
+    if (harts.harts > 1) {
+        return RunHarts(std::move(*program), harts, output);
+    }
+
+    SymbolTable symbols = output.profile_functions ? program->symbols : SymbolTable{};
+    std::optional<FunctionalSimulator> functional;
+    if (output.functional_first || output.extrapolate) {
+        functional.emplace(Program{*program});
+    }
+    std::unique_ptr<TraceReader> replay;
+    if (!output.replay.empty() && (replay = TraceReader::Open(output.replay)) == nullptr) {
+        return 1;
+    }
+    if (replays) {
+        program->segments.clear();
+    }
+    Simulator cpu = Simulator{std::move(*program), config};
+    cpu.source_ = replay.get();
+    if (output.profile) {
+        cpu.prof_.Enable(cpu.fetch_.getIMEM());
+    }
+    if (output.mix) {
+        cpu.mix_.Enable();
+    }
+    if (!output.trace.empty() && (cpu.trace_ = PipeTrace::Open(output.trace)) == nullptr) {
+        return 1;
+    }
+    if (!output.commit_log.empty() &&
+        (cpu.commit_log_ = CommitLog::Open(output.commit_log, output.commit_log_disasm)) == nullptr) {
+        return 1;
+    }
+    if (!output.stats.empty()) {
+        cpu.RegisterStats();
+        if (!cpu.stats_.Open(output.stats, output.stats_period, output.stats_interval)) {
+            return 1;
         }
     }
+    if (!output.log.empty() &&
+        !Logger::Get().Start(output.log, static_cast<Logger::LogLevel>(output.log_level),
+                             [](uint32_t instr) { return RISCVInstr{std::bitset<32>{instr}}.ToString(); })) {
+        std::cerr << "Can't create log file: " << output.log << std::endl;
+        return 1;
+    }
 
-    Simulator cpu = Simulator{imem.getRawImem()};
-    if (cpu.Run() == PipelineState::ERR) {
+    std::optional<SteadyStateRunner> runner;
+    if (output.extrapolate) {
+        runner.emplace(cpu, *functional);
+    }
+    PipelineState state = runner ? runner->Run() : functional ? RunFunctionalFirst(cpu, *functional) : cpu.Run();
+    Logger::Get().Stop();
+    cpu.stats_.Close();
+    if (state == PipelineState::ERR) {
         return 2;
     }
 
     std::cout << "Total cycles: " << cpu.write_back_.cycle << std::endl;
+    cpu.cpi_.Print(std::cout);
+    if (runner) {
+        std::cout << "Extrapolated cycles: " << runner->Cycles() << ", iterations: " << runner->Iterations()
+                  << ", steady states: " << runner->Loops() << std::endl;
+    }
+    if (cpu.sys_.Calls() > 0) {
+        std::cout << "System calls: " << cpu.sys_.Calls() << std::endl;
+    }
+
+    // Replayed atomics are executed by the functional simulator
+    PrintAtomics(functional ? functional->getAtomicUnit() : cpu.memory_.getAtomicUnit());
+
+    if (config.dcache.miss_latency > 0) {
+        const DataCache &dcache = cpu.memory_.getDCache();
+        std::cout << "DCache hits: " << dcache.Hits() << ", misses: " << dcache.Misses() << std::endl;
+    }
+    if (const L2Cache *l2 = cpu.memory_.getDCache().getL2(); l2 != nullptr) {
+        std::cout << "L2 hits: " << l2->Hits() << ", misses: " << l2->Misses() << ", writebacks: " << l2->Writebacks()
+                  << std::endl;
+    }
+    if (output.mix) {
+        cpu.mix_.Print(std::cout);
+    }
+    if (output.profile) {
+        cpu.prof_.Print(std::cout, cpu.fetch_.getIMEM(), output.profile_functions ? &symbols : nullptr);
+    }
+    if (cpu.ra_.isEnabled()) {
+        const DataCache &dcache = cpu.memory_.getDCache();
+        std::cout << "Runahead episodes: " << cpu.ra_.Episodes()
+                  << ", instructions: " << cpu.ra_.Instructions()
+                  << ", prefetches: " << cpu.ra_.Prefetches()
+                  << ", useful prefetches: " << dcache.UsefulPrefetches()
+                  << ", late prefetches: " << dcache.LatePrefetches();
+        if (auto cycles = BlockingCycles(path, config); cycles) {
+            // Prefetches may also evict lines, so runahead can lose cycles too
+            std::cout << ", cycles saved: "
+                      << static_cast<int64_t>(*cycles) - static_cast<int64_t>(cpu.write_back_.cycle);
+        }
+        std::cout << std::endl;
+    }
 
-    return 0;
+    return cpu.sys_.isExited() ? cpu.sys_.ExitCode() : 0;
 }
@@ -0,0 +1,12 @@
+#include "simulator.h"
+
+// Converts pipeline trace written by cpu --trace to O3PipeView format for Konata
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: pipeview <trace>" << std::endl;
+        return 1;
+    }
+
+    std::ios::sync_with_stdio(false);
+    return ConvertToO3PipeView(argv[1], std::cout) ? 0 : 1;
+}
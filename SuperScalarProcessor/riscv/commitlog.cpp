@@ -0,0 +1,311 @@
+#include "commitlog.h"
+
+#include "simulator.h"
+
+std::unique_ptr<CommitLog> CommitLog::Open(const std::string &path, bool disasm) {
+    FILE *file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        std::cerr << "Can't create commit log: " << path << std::endl;
+        return nullptr;
+    }
+    return std::unique_ptr<CommitLog>{new CommitLog{file, disasm}};
+}
+
+CommitLog::CommitLog(FILE *file, bool disasm) :
+        file_(file, &std::fclose),
+        records_([file, disasm](const std::vector<Record> &records) {
+            for (const auto &record : records) {
+                std::string lines = Format(record, disasm);
+                std::fwrite(lines.data(), 1, lines.size(), file);
+            }
+        }) {}
+
+namespace {
+
+constexpr std::array<const char *, 32> abi_names = {
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"
+};
+
+std::string Reg(std::bitset<5> reg) {
+    return abi_names[reg.to_ulong()];
+}
+
+// Address operand of atomics, which have no offset
+std::string Base(std::bitset<5> reg) {
+    std::string base = "(";
+    base.append(abi_names[reg.to_ulong()]).push_back(')');
+    return base;
+}
+
+std::string CSRName(uint16_t csr) {
+    switch (csr) {
+        case CSRUnit::CYCLE:
+            return "cycle";
+        case CSRUnit::TIME:
+            return "time";
+        case CSRUnit::INSTRET:
+            return "instret";
+        case CSRUnit::CYCLEH:
+            return "cycleh";
+        case CSRUnit::TIMEH:
+            return "timeh";
+        case CSRUnit::INSTRETH:
+            return "instreth";
+        case CSRUnit::MHARTID:
+            return "mhartid";
+        default:
+            break;
+    }
+    if (csr >= CSRUnit::HPMCOUNTER3 && csr <= CSRUnit::HPMCOUNTER31) {
+        return "hpmcounter" + std::to_string(csr - CSRUnit::CYCLE);
+    }
+    if (csr >= CSRUnit::HPMCOUNTER3H && csr <= CSRUnit::HPMCOUNTER31H) {
+        return "hpmcounter" + std::to_string(csr - CSRUnit::CYCLEH) + "h";
+    }
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "unknown_%03x", csr);
+    return buf;
+}
+
+// Target of branch or jal relative to its pc
+std::string Target(int32_t offset) {
+    return std::string{"pc "} + (offset < 0 ? "- " : "+ ") + std::to_string(offset < 0 ? -offset : offset);
+}
+
+// Disassembly of Spike: ABI register names, its pseudo-instructions and mnemonic padded to 8 characters
+std::string Disassemble(uint32_t word) {
+    RISCVInstr instr{std::bitset<32>{word}};
+    Opcode op = instr.getOpcode();
+    std::string name = OpcodeToString(op);
+    std::vector<std::string> args;
+    auto rd = instr.getRd(), rs1 = instr.getRs1(), rs2 = instr.getRs2();
+    auto imm = [&instr] { return static_cast<int32_t>(IMM{instr}.getImm().to_ulong()); };
+    auto address = [&imm, &rs1] { return std::to_string(imm()) + "(" + Reg(rs1) + ")"; };
+
+    switch (op) {
+        case Opcode::LUI:
+        case Opcode::AUIPC: {
+            char buf[16];
+            std::snprintf(buf, sizeof(buf), "0x%x", word >> 12);
+            args = {Reg(rd), buf};
+            break;
+        }
+        case Opcode::JAL:
+            if (rd.none() || rd == 1) {
+                name = rd.none() ? "j" : "jal";
+                args = {Target(imm())};
+            } else {
+                args = {Reg(rd), Target(imm())};
+            }
+            break;
+        case Opcode::JALR:
+            if (imm() == 0 && rd.none() && rs1 == 1) {
+                name = "ret";
+            } else if (imm() == 0 && (rd.none() || rd == 1)) {
+                name = rd.none() ? "jr" : "jalr";
+                args = {Reg(rs1)};
+            } else {
+                args = {Reg(rd), address()};
+            }
+            break;
+        case Opcode::BEQ:
+        case Opcode::BNE:
+        case Opcode::BLT:
+        case Opcode::BGE:
+            // Comparison with zero
+            if (rs2.none()) {
+                name = op == Opcode::BEQ ? "beqz" : op == Opcode::BNE ? "bnez" : op == Opcode::BLT ? "bltz" : "bgez";
+                args = {Reg(rs1), Target(imm())};
+            } else if (rs1.none() && (op == Opcode::BLT || op == Opcode::BGE)) {
+                name = op == Opcode::BLT ? "bgtz" : "blez";
+                args = {Reg(rs2), Target(imm())};
+            } else {
+                args = {Reg(rs1), Reg(rs2), Target(imm())};
+            }
+            break;
+        case Opcode::BLTU:
+        case Opcode::BGEU:
+            args = {Reg(rs1), Reg(rs2), Target(imm())};
+            break;
+        case Opcode::LB:
+        case Opcode::LH:
+        case Opcode::LW:
+        case Opcode::LBU:
+        case Opcode::LHU:
+            args = {Reg(rd), address()};
+            break;
+        case Opcode::SB:
+        case Opcode::SH:
+        case Opcode::SW:
+            args = {Reg(rs2), address()};
+            break;
+        case Opcode::ADDI:
+            if (rd.none() && rs1.none() && imm() == 0) {
+                name = "nop";
+            } else if (rs1.none()) {
+                name = "li";
+                args = {Reg(rd), std::to_string(imm())};
+            } else if (imm() == 0) {
+                name = "mv";
+                args = {Reg(rd), Reg(rs1)};
+            } else {
+                args = {Reg(rd), Reg(rs1), std::to_string(imm())};
+            }
+            break;
+        case Opcode::XORI:
+        case Opcode::SLTIU:
+            if ((op == Opcode::XORI && imm() == -1) || (op == Opcode::SLTIU && imm() == 1)) {
+                name = op == Opcode::XORI ? "not" : "seqz";
+                args = {Reg(rd), Reg(rs1)};
+            } else {
+                args = {Reg(rd), Reg(rs1), std::to_string(imm())};
+            }
+            break;
+        case Opcode::SLLI:
+        case Opcode::SRLI:
+        case Opcode::SRAI:
+            args = {Reg(rd), Reg(rs1), std::to_string((word >> 20) & 0x3f)};
+            break;
+        case Opcode::SLTI:
+        case Opcode::ORI:
+        case Opcode::ANDI:
+            args = {Reg(rd), Reg(rs1), std::to_string(imm())};
+            break;
+        case Opcode::SUB:
+        case Opcode::SLTU:
+        case Opcode::SLT:
+            if (rs1.none() && op != Opcode::SLT) {
+                name = op == Opcode::SUB ? "neg" : "snez";
+                args = {Reg(rd), Reg(rs2)};
+            } else if (op == Opcode::SLT && (rs1.none() || rs2.none())) {
+                name = rs2.none() ? "sltz" : "sgtz";
+                args = {Reg(rd), Reg(rs2.none() ? rs1 : rs2)};
+            } else {
+                args = {Reg(rd), Reg(rs1), Reg(rs2)};
+            }
+            break;
+        case Opcode::ECALL:
+        case Opcode::EBREAK:
+            break;
+        case Opcode::CSRRW:
+        case Opcode::CSRRS:
+        case Opcode::CSRRC:
+        case Opcode::CSRRWI:
+        case Opcode::CSRRSI:
+        case Opcode::CSRRCI: {
+            bool is_imm = op == Opcode::CSRRWI || op == Opcode::CSRRSI || op == Opcode::CSRRCI;
+            std::string src = is_imm ? std::to_string(rs1.to_ulong()) : Reg(rs1);
+            if (op == Opcode::CSRRS && rs1.none()) {
+                name = "csrr";
+                args = {Reg(rd), CSRName(instr.getCSR())};
+            } else if (rd.none()) {
+                // csrrw -> csrw, csrrsi -> csrsi
+                name = "csr" + name.substr(4);
+                args = {CSRName(instr.getCSR()), src};
+            } else {
+                args = {Reg(rd), CSRName(instr.getCSR()), src};
+            }
+            break;
+        }
+        default:
+            if (instr.isAtomic()) {
+                bool aq = (word >> 26) & 1, rl = (word >> 25) & 1;
+                name += aq && rl ? ".aqrl" : aq ? ".aq" : rl ? ".rl" : "";
+                args = op == Opcode::LR_W ? std::vector<std::string>{Reg(rd), Base(rs1)}
+                                          : std::vector<std::string>{Reg(rd), Reg(rs2), Base(rs1)};
+            } else {
+                args = {Reg(rd), Reg(rs1), Reg(rs2)};
+            }
+            break;
+    }
+
+    if (!args.empty()) {
+        name.append(name.size() < 8 ? 8 - name.size() : 1, ' ');
+        for (size_t i = 0; i < args.size(); ++i) {
+            name += (i == 0 ? "" : ", ") + args[i];
+        }
+    }
+    return name;
+}
+
+uint8_t StoreBytes(DMEM::Width width) {
+    switch (width) {
+        case DMEM::Width::BYTE:
+        case DMEM::Width::BYTE_U:
+            return 1;
+        case DMEM::Width::HALF:
+        case DMEM::Width::HALF_U:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+}  // namespace
+
+void CommitLog::MemoryToWriteBack(const Simulator &cpu) {
+    const Memory &memory = cpu.memory_;
+    for (Way way : {Way::UP, Way::DOWN}) {
+        Slot &slot = write_back_[way == Way::UP ? 0 : 1];
+        slot.valid = memory.getBubble(way) == Bubble::NONE;
+        if (!slot.valid) {
+            continue;
+        }
+
+        const RISCVInstr &instr = memory.getInstr(way);
+        Record &record = slot.record;
+        record.pc = memory.getPC(way).realVal();
+        record.instr = static_cast<uint32_t>(instr.getInstr().to_ulong());
+        record.rd = memory.WB_WE(way) ? static_cast<uint8_t>(memory.WB_A(way).to_ulong()) : 0;
+        record.rd_value = static_cast<uint32_t>(memory.getOutData(way).to_ulong());
+        record.addr = static_cast<uint32_t>(memory.ALU_OUT(way).to_ulong());
+        record.access = memory.WS(way) ? Access::LOAD : memory.MEM_WE(way) ? Access::STORE : Access::NONE;
+        record.store_bytes = StoreBytes(memory.MEM_WIDTH(way));
+        uint64_t mask = (uint64_t{1} << (8 * record.store_bytes)) - 1;
+        record.store_data = static_cast<uint32_t>((way == Way::UP ? memory.D2 : memory.D5).to_ulong() & mask);
+        // Csr value is read at write back
+        if (instr.isCSR()) {
+            record.rd = static_cast<uint8_t>(instr.getRd().to_ulong());
+        }
+    }
+}
+
+void CommitLog::Retire(const Simulator &cpu) {
+    for (Slot &slot : write_back_) {
+        if (!slot.valid) {
+            continue;
+        }
+        if (slot.record.rd != 0 && RISCVInstr{std::bitset<32>{slot.record.instr}}.isCSR()) {
+            slot.record.rd_value = static_cast<uint32_t>(cpu.decode_.getRegFile().Read(slot.record.rd).to_ulong());
+        }
+        records_.Push(slot.record);
+        slot.valid = false;
+    }
+}
+
+std::string CommitLog::Format(const Record &record, bool disasm) {
+    char buf[128];
+    std::string lines;
+    if (disasm) {
+        std::snprintf(buf, sizeof(buf), "core   0: 0x%08x (0x%08x) ", record.pc, record.instr);
+        lines = buf + Disassemble(record.instr) + "\n";
+    }
+
+    std::snprintf(buf, sizeof(buf), "core   0: %u 0x%08x (0x%08x)", privilege, record.pc, record.instr);
+    lines += buf;
+    if (record.rd != 0) {
+        std::snprintf(buf, sizeof(buf), " x%-2u 0x%08x", static_cast<uint32_t>(record.rd), record.rd_value);
+        lines += buf;
+    }
+    if (record.access == Access::LOAD) {
+        std::snprintf(buf, sizeof(buf), " mem 0x%08x", record.addr);
+        lines += buf;
+    } else if (record.access == Access::STORE) {
+        std::snprintf(buf, sizeof(buf), " mem 0x%08x 0x%0*x", record.addr, 2 * record.store_bytes,
+                      record.store_data);
+        lines += buf;
+    }
+    lines += '\n';
+    return lines;
+}
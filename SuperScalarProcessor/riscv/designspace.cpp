@@ -0,0 +1,121 @@
+#include "designspace.h"
+
+#include <bit>
+#include <sstream>
+
+#include "work_stealing.h"
+
+bool DesignSpace::AddParameter(const std::string &name, const std::string &values) {
+    std::vector<std::string> parsed;
+    std::istringstream list{values};
+    std::string value;
+    SimConfig config;
+    while (std::getline(list, value, ',')) {
+        if (!SetParameter(config, name, value)) {
+            std::cerr << "Invalid value of " << name << ": " << value << std::endl;
+            return false;
+        }
+        parsed.push_back(value);
+    }
+    if (parsed.empty()) {
+        std::cerr << "No values of " << name << std::endl;
+        return false;
+    }
+
+    grid_.emplace_back(name, std::move(parsed));
+    return true;
+}
+
+std::vector<DesignPoint> DesignSpace::Points() const {
+    std::vector<DesignPoint> points{DesignPoint{}};
+    for (const auto &[name, values] : grid_) {
+        std::vector<DesignPoint> next;
+        next.reserve(points.size() * values.size());
+        for (const auto &point : points) {
+            for (const auto &value : values) {
+                DesignPoint &added = next.emplace_back(point);
+                SetParameter(added.config, name, value);
+                added.values.push_back(value);
+            }
+        }
+        points = std::move(next);
+    }
+    return points;
+}
+
+std::vector<std::string> DesignSpace::Parameters() const {
+    std::vector<std::string> names;
+    for (const auto &parameter : grid_) {
+        names.push_back(parameter.first);
+    }
+    return names;
+}
+
+std::vector<SweepResult> RunSweep(const std::vector<DesignPoint> &points, const std::vector<std::string> &programs,
+                                  WorkStealingPool &pool, const std::vector<std::string> &traces) {
+    std::vector<std::shared_ptr<const MappedFile>> mapped;
+    for (const auto &trace : traces) {
+        mapped.push_back(MappedFile::Open(trace));
+        if (mapped.back() == nullptr) {
+            std::cerr << "Can't map trace: " << trace << std::endl;
+        }
+    }
+
+    std::vector<SweepResult> results(points.size() * programs.size());
+    pool.Run(results.size(), [&](size_t job) {
+        SweepResult &result = results[job];
+        result.point = job / programs.size();
+        result.program = job % programs.size();
+        // Every job maps its own copy of the program, guest stores go to private pages
+        auto program = LoadProgram(programs[result.program]);
+        if (!program) {
+            return;
+        }
+        std::unique_ptr<TraceReader> replay;
+        if (!mapped.empty()) {
+            // Runahead needs the data the replayed program has in memory
+            if (points[result.point].config.runahead || result.program >= mapped.size() ||
+                mapped[result.program] == nullptr ||
+                (replay = TraceReader::Open(mapped[result.program])) == nullptr) {
+                return;
+            }
+            program->segments.clear();
+        }
+        Simulator cpu = Simulator{std::move(*program), points[result.point].config};
+        cpu.source_ = replay.get();
+        result.ok = cpu.Run() != PipelineState::ERR;
+        result.cycles = cpu.write_back_.cycle;
+        result.instructions = cpu.csr_.Instret();
+    });
+    return results;
+}
+
+uint64_t HardwareCost(const SimConfig &config) {
+    // 32 registers of 32 bits
+    constexpr uint64_t register_file_bits = 32 * 32;
+    const DataCache::Config &dcache = config.dcache;
+    uint64_t index_bits = std::bit_width(dcache.sets) - 1 + std::bit_width(dcache.line_size) - 1;
+    uint64_t line_bits = uint64_t{8} * dcache.line_size + (32 - std::min<uint64_t>(index_bits, 32)) + /* valid */ 1;
+    return BranchPredictor::StorageBits(config.bp) + uint64_t{dcache.sets} * dcache.ways * line_bits +
+           config.issue_width * register_file_bits;
+}
+
+std::vector<size_t> ParetoFront(const std::vector<DesignPoint> &points, const std::vector<uint64_t> &cycles) {
+    std::vector<uint64_t> cost;
+    for (const auto &point : points) {
+        cost.push_back(HardwareCost(point.config));
+    }
+
+    std::vector<size_t> front;
+    for (size_t i = 0; i < points.size(); ++i) {
+        bool dominated = false;
+        for (size_t j = 0; j < points.size() && !dominated; ++j) {
+            dominated = points[j].config.dcache.miss_latency == points[i].config.dcache.miss_latency &&
+                        cycles[j] <= cycles[i] && cost[j] <= cost[i] && (cycles[j] < cycles[i] || cost[j] < cost[i]);
+        }
+        if (!dominated) {
+            front.push_back(i);
+        }
+    }
+    return front;
+}
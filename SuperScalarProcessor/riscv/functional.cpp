@@ -0,0 +1,326 @@
+#include "functional.h"
+#include "simulator.h"
+
+#include <thread>
+
+namespace {
+
+// Registers of the system call convention
+constexpr uint8_t a0 = 10;
+constexpr uint8_t a1 = 11;
+constexpr uint8_t a2 = 12;
+constexpr uint8_t a7 = 17;
+
+DMEM::Width LoadWidth(Opcode op) noexcept {
+    switch (op) {
+        case Opcode::LB:
+            return DMEM::Width::BYTE;
+        case Opcode::LBU:
+            return DMEM::Width::BYTE_U;
+        case Opcode::LH:
+            return DMEM::Width::HALF;
+        case Opcode::LHU:
+            return DMEM::Width::HALF_U;
+        default:
+            return DMEM::Width::WORD;
+    }
+}
+
+DMEM::Width StoreWidth(Opcode op) noexcept {
+    return op == Opcode::SB ? DMEM::Width::BYTE : op == Opcode::SH ? DMEM::Width::HALF : DMEM::Width::WORD;
+}
+
+}  // namespace
+
+FunctionalSimulator::FunctionalSimulator(Program &&program) :
+        imem_(std::move(program.imem)), image_(std::move(program.image)) {
+    pc_ = program.entry.realVal();
+    decoded_.resize(imem_.size());
+    end_.instr = RISCVInstr{std::bitset<32>{/* ebreak */ 0x100073}};
+    end_.valid = true;
+
+    for (const auto &segment : program.segments) {
+        dmem_.Map(segment.vaddr, segment.data, segment.file_size);
+    }
+    regs_[2] = program.stack_pointer;
+    sys_.setBreak(program.program_break);
+}
+
+const FunctionalSimulator::Decoded &FunctionalSimulator::Decode(uint32_t pc) {
+    PC index{pc / 4};
+    if (pc % 4 != 0 || imem_.isEndOfIMEM(index)) {
+        return end_;
+    }
+
+    Decoded &decoded = decoded_[index.val() - imem_.getBase().val()];
+    if (!decoded.valid) {
+        decoded.instr = RISCVInstr{imem_.getInstr(index)};
+        decoded.imm = static_cast<uint32_t>(IMM{decoded.instr}.getImm().to_ulong());
+        decoded.rd = static_cast<uint8_t>(decoded.instr.getRd().to_ulong());
+        decoded.rs1 = static_cast<uint8_t>(decoded.instr.getRs1().to_ulong());
+        decoded.rs2 = static_cast<uint8_t>(decoded.instr.getRs2().to_ulong());
+        decoded.valid = true;
+    }
+    return decoded;
+}
+
+void FunctionalSimulator::Write(uint8_t rd, uint32_t value) noexcept {
+    if (rd != 0) {
+        regs_[rd] = value;
+    }
+}
+
+PipelineState FunctionalSimulator::Step(DynInstr &instr) {
+    const Decoded &decoded = Decode(pc_);
+    Opcode op = decoded.instr.getOpcode();
+    uint32_t rs1 = regs_[decoded.rs1];
+    uint32_t rs2 = regs_[decoded.rs2];
+    uint32_t imm = decoded.imm;
+    instr = DynInstr{pc_, static_cast<uint32_t>(decoded.instr.getInstr().to_ulong()), pc_ + 4, 0, 0};
+
+    // Results of the ALU ops are the ones of the pipeline
+    auto alu = [&](uint32_t lhs, uint32_t rhs, ALU::Op alu_op) {
+        instr.value = static_cast<uint32_t>(ALU::calc(lhs, rhs, alu_op).to_ulong());
+        Write(decoded.rd, instr.value);
+    };
+    auto branch = [&](CMP::Op cmp_op) {
+        if (CMP::calc(rs1, rs2, cmp_op)) {
+            instr.next_pc = pc_ + imm;
+        }
+    };
+
+    switch (op) {
+        case Opcode::LUI:
+            alu(0, imm, ALU::Op::ADD);
+            break;
+        case Opcode::AUIPC:
+            alu(pc_, imm, ALU::Op::ADD);
+            break;
+        case Opcode::JAL:
+            alu(pc_, 4, ALU::Op::ADD);
+            instr.next_pc = pc_ + imm;
+            break;
+        case Opcode::JALR:
+            // Fetch drops both low bits of the target
+            instr.next_pc = (rs1 + imm) & ~3u;
+            alu(pc_, 4, ALU::Op::ADD);
+            break;
+        case Opcode::BEQ:
+            branch(CMP::Op::EQ);
+            break;
+        case Opcode::BNE:
+            branch(CMP::Op::NE);
+            break;
+        case Opcode::BLT:
+            branch(CMP::Op::LT);
+            break;
+        case Opcode::BGE:
+            branch(CMP::Op::GE);
+            break;
+        case Opcode::BLTU:
+            branch(CMP::Op::LTU);
+            break;
+        case Opcode::BGEU:
+            branch(CMP::Op::GEU);
+            break;
+        case Opcode::LB:
+        case Opcode::LH:
+        case Opcode::LW:
+        case Opcode::LBU:
+        case Opcode::LHU:
+            instr.addr = rs1 + imm;
+            instr.value = static_cast<uint32_t>(dmem_.Load(instr.addr, LoadWidth(op)).to_ulong());
+            Write(decoded.rd, instr.value);
+            break;
+        case Opcode::SB:
+        case Opcode::SH:
+        case Opcode::SW:
+            instr.addr = rs1 + imm;
+            instr.value = rs2;
+            atomic_.Store(dmem_, rs2, instr.addr, StoreWidth(op));
+            break;
+        case Opcode::ADDI:
+            alu(rs1, imm, ALU::Op::ADD);
+            break;
+        case Opcode::SLTI:
+            alu(rs1, imm, ALU::Op::SLT);
+            break;
+        case Opcode::SLTIU:
+            alu(rs1, imm, ALU::Op::SLTU);
+            break;
+        case Opcode::XORI:
+            alu(rs1, imm, ALU::Op::XOR);
+            break;
+        case Opcode::ORI:
+            alu(rs1, imm, ALU::Op::OR);
+            break;
+        case Opcode::ANDI:
+            alu(rs1, imm, ALU::Op::AND);
+            break;
+        case Opcode::SLLI:
+            alu(rs1, imm, ALU::Op::SLL);
+            break;
+        case Opcode::SRLI:
+            alu(rs1, imm, ALU::Op::SRL);
+            break;
+        case Opcode::SRAI:
+            alu(rs1, imm, ALU::Op::SRA);
+            break;
+        case Opcode::ADD:
+            alu(rs1, rs2, ALU::Op::ADD);
+            break;
+        case Opcode::SUB:
+            alu(rs1, rs2, ALU::Op::SUB);
+            break;
+        case Opcode::SLL:
+            alu(rs1, rs2, ALU::Op::SLL);
+            break;
+        case Opcode::SLT:
+            alu(rs1, rs2, ALU::Op::SLT);
+            break;
+        case Opcode::SLTU:
+            alu(rs1, rs2, ALU::Op::SLTU);
+            break;
+        case Opcode::XOR:
+            alu(rs1, rs2, ALU::Op::XOR);
+            break;
+        case Opcode::SRL:
+            alu(rs1, rs2, ALU::Op::SRL);
+            break;
+        case Opcode::SRA:
+            alu(rs1, rs2, ALU::Op::SRA);
+            break;
+        case Opcode::OR:
+            alu(rs1, rs2, ALU::Op::OR);
+            break;
+        case Opcode::AND:
+            alu(rs1, rs2, ALU::Op::AND);
+            break;
+        case Opcode::ECALL:
+            if (sys_.Call(dmem_, regs_[a7], {regs_[a0], regs_[a1], regs_[a2]}, instr.value) ==
+                PipelineState::BREAK) {
+                return PipelineState::BREAK;
+            }
+            Write(a0, instr.value);
+            break;
+        case Opcode::EBREAK:
+            return PipelineState::BREAK;
+        case Opcode::CSRRW:
+        case Opcode::CSRRS:
+        case Opcode::CSRRC:
+        case Opcode::CSRRWI:
+        case Opcode::CSRRSI:
+        case Opcode::CSRRCI: {
+            uint16_t addr = decoded.instr.getCSR();
+            auto value = csr_.Read(addr, csr_.Instret());
+            bool is_write = op == Opcode::CSRRW || op == Opcode::CSRRWI || decoded.rs1 != 0;
+            if (!value || is_write) {
+                std::cerr << "Unsupported access to CSR 0x" << std::hex << addr << std::dec << std::endl;
+                return PipelineState::ERR;
+            }
+            instr.value = *value;
+            Write(decoded.rd, instr.value);
+            break;
+        }
+        case Opcode::LR_W:
+        case Opcode::SC_W:
+        case Opcode::AMOSWAP_W:
+        case Opcode::AMOADD_W:
+        case Opcode::AMOXOR_W:
+        case Opcode::AMOAND_W:
+        case Opcode::AMOOR_W:
+        case Opcode::AMOMIN_W:
+        case Opcode::AMOMAX_W:
+        case Opcode::AMOMINU_W:
+        case Opcode::AMOMAXU_W:
+            instr.addr = rs1;
+            instr.value = static_cast<uint32_t>(atomic_.Execute(dmem_, decoded.instr, rs1, rs2).to_ulong());
+            Write(decoded.rd, instr.value);
+            break;
+    }
+
+    csr_.Retire(1);
+    pc_ = instr.next_pc;
+    return PipelineState::OK;
+}
+
+PipelineState FunctionalSimulator::Run() {
+    DynInstr instr;
+    PipelineState state;
+    while ((state = Step(instr)) == PipelineState::OK) {
+    }
+    return state == PipelineState::BREAK ? PipelineState::OK : state;
+}
+
+uint32_t FunctionalSimulator::getPC() const noexcept {
+    return pc_;
+}
+
+uint32_t FunctionalSimulator::Reg(uint8_t idx) const noexcept {
+    return regs_[idx];
+}
+
+uint64_t FunctionalSimulator::Instret() const noexcept {
+    return csr_.Instret();
+}
+
+const DMEM &FunctionalSimulator::getDMEM() const noexcept {
+    return dmem_;
+}
+
+const SyscallUnit &FunctionalSimulator::getSyscallUnit() const noexcept {
+    return sys_;
+}
+
+const AtomicUnit &FunctionalSimulator::getAtomicUnit() const noexcept {
+    return atomic_;
+}
+
+bool SequentialSource::Next(DynInstr &instr) {
+    if (ahead_.empty()) {
+        return Read(instr);
+    }
+    instr = ahead_.front();
+    ahead_.pop_front();
+    return true;
+}
+
+const DynInstr *SequentialSource::Ahead(size_t offset) {
+    while (ahead_.size() <= offset) {
+        DynInstr instr;
+        if (!Read(instr)) {
+            return nullptr;
+        }
+        ahead_.push_back(instr);
+    }
+    return &ahead_[offset];
+}
+
+void SequentialSource::DropAhead() noexcept {
+    ahead_.clear();
+}
+
+PipelineState RunFunctionalFirst(Simulator &timing, FunctionalSimulator &functional, size_t capacity) {
+    QueueSource source{capacity};
+    SPSCQueue<DynInstr> &queue = source.getQueue();
+    PipelineState functional_state = PipelineState::OK;
+    std::thread producer{[&]() {
+        DynInstr instr;
+        PipelineState state;
+        do {
+            state = functional.Step(instr);
+            if (state == PipelineState::ERR || !queue.Push(instr)) {
+                break;
+            }
+        } while (state == PipelineState::OK);
+        functional_state = state;
+        queue.Close();
+    }};
+
+    timing.source_ = &source;
+    PipelineState state = timing.Run();
+    timing.source_ = nullptr;
+    queue.Cancel();
+    producer.join();
+    return functional_state == PipelineState::ERR ? PipelineState::ERR : state;
+}
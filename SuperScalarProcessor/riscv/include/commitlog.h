@@ -0,0 +1,60 @@
+#ifndef SIMULATOR_COMMITLOG_H
+#define SIMULATOR_COMMITLOG_H
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "Basics.h"
+#include "async_buffer.h"
+
+/*
+ *  Commit log in the format of Spike run with --log-commits: for every retired instruction a line with pc,
+ *  instruction word, written register and value, load address or store address and data. With disassembly it is
+ *  preceded by the line Spike prints with -l. Retired instructions are copied as binary records when they leave
+ *  memory stage, formatting and output are done by a background thread.
+ */
+class CommitLog final {
+public:
+    enum class Access : uint8_t { NONE, LOAD, STORE };
+
+    struct Record final {
+        uint32_t pc;  // byte address
+        uint32_t instr;
+        uint32_t rd_value;
+        uint32_t addr;
+        uint32_t store_data;
+        uint8_t rd;  // 0 if no register is written
+        Access access;
+        uint8_t store_bytes;
+    };
+
+    // Privilege level printed in commit lines, programs run bare in machine mode
+    static constexpr const uint32_t privilege = 3;
+
+    // Returns nullptr if the file can't be created
+    static std::unique_ptr<CommitLog> Open(const std::string &path, bool disasm = false);
+
+    // Called after the transmit function has written write back latch
+    void MemoryToWriteBack(const Simulator &cpu);
+    // Called after write back has updated the register file
+    void Retire(const Simulator &cpu);
+
+    // Lines of one retired instruction
+    static std::string Format(const Record &record, bool disasm = false);
+
+private:
+    CommitLog(FILE *file, bool disasm);
+
+    struct Slot final {
+        Record record;
+        bool valid{false};
+    };
+
+    std::array<Slot, 2> write_back_{};  // upper and down instructions in write back
+    std::unique_ptr<FILE, int (*)(FILE *)> file_;
+    AsyncBuffer<Record> records_;
+};
+
+#endif //SIMULATOR_COMMITLOG_H
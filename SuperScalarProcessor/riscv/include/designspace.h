@@ -0,0 +1,57 @@
+#ifndef SIMULATOR_DESIGNSPACE_H
+#define SIMULATOR_DESIGNSPACE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "simulator.h"
+#include "tracefile.h"
+
+/*
+ *  Design space exploration without recompilation. A grid holds the values of microarchitecture parameters by their
+ *  cpu option names, every combination of them is a design point. Sweep simulates each point on each program in
+ *  parallel, then points are ranked by total cycles against a hardware cost.
+ */
+struct DesignPoint final {
+    SimConfig config;
+    std::vector<std::string> values;  // value of every grid parameter in the order of DesignSpace::Parameters
+};
+
+class DesignSpace final {
+public:
+    // Values are separated by commas, returns false if the name or any value is invalid
+    bool AddParameter(const std::string &name, const std::string &values);
+
+    // Cross product of the values, the last added parameter changes fastest
+    [[nodiscard]] std::vector<DesignPoint> Points() const;
+    [[nodiscard]] std::vector<std::string> Parameters() const;
+
+private:
+    std::vector<std::pair<std::string, std::vector<std::string>>> grid_;
+};
+
+struct SweepResult final {
+    size_t point{0};
+    size_t program{0};
+    uint64_t cycles{0};
+    uint64_t instructions{0};
+    bool ok{false};  // program was loaded and finished without error
+};
+
+class WorkStealingPool;
+
+// Simulates every point on every program, results are ordered by point and then by program. With traces, one per
+// program, the pipeline replays the trace of the program instead of executing it, every trace is mapped only once
+std::vector<SweepResult> RunSweep(const std::vector<DesignPoint> &points, const std::vector<std::string> &programs,
+                                  WorkStealingPool &pool, const std::vector<std::string> &traces = {});
+
+// Storage bits of branch predictor and data cache (data, tags and valid bits), every issue way is charged as a copy
+// of the register file
+uint64_t HardwareCost(const SimConfig &config);
+
+// Indices of the points that no other point beats in both cycles and cost. Memory latency isn't a design choice,
+// so only the points of the same latency are compared
+std::vector<size_t> ParetoFront(const std::vector<DesignPoint> &points, const std::vector<uint64_t> &cycles);
+
+#endif //SIMULATOR_DESIGNSPACE_H
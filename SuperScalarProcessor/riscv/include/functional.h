@@ -0,0 +1,129 @@
+#ifndef SIMULATOR_FUNCTIONAL_H
+#define SIMULATOR_FUNCTIONAL_H
+
+#include <array>
+#include <deque>
+#include <vector>
+
+#include "AtomicUnit.h"
+#include "CSRUnit.h"
+#include "SyscallUnit.h"
+#include "instruction.h"
+#include "loader.h"
+#include "spsc_queue.h"
+
+struct Simulator;
+
+// Instruction as retired by the functional simulator, in program order
+struct DynInstr final {
+    uint32_t pc{0};  // byte address
+    uint32_t instr{0};
+    uint32_t next_pc{0};  // differs from pc + 4 after taken branches and jumps
+    uint32_t addr{0};  // of load, store and atomic
+    uint32_t value{0};  // written to rd (loaded, read from csr, returned by ecall) or stored
+};
+
+/*
+ *  Instructions the timing model retires instead of executing them, see Simulator::source_. Execute takes branch
+ *  outcomes, jump targets, addresses and results from the source instead of computing them, memory stage takes the
+ *  loaded data. Only the timing state is simulated: caches, predictor, hazards and latencies. Stores and system
+ *  calls have no effect.
+ */
+class InstrSource {
+public:
+    virtual ~InstrSource() = default;
+    // Next retired instruction, false at the end of the stream
+    virtual bool Next(DynInstr &instr) = 0;
+    // Instruction retired after the next offset ones, they stay in the stream. nullptr after its end
+    virtual const DynInstr *Ahead(size_t offset) = 0;
+};
+
+// Source read one instruction at a time, the ones looked ahead wait in a buffer
+class SequentialSource : public InstrSource {
+public:
+    bool Next(DynInstr &instr) final;
+    const DynInstr *Ahead(size_t offset) final;
+
+protected:
+    // Next instruction of the stream, false at its end
+    virtual bool Read(DynInstr &instr) = 0;
+    // Forgets the instructions looked ahead, e.g. when the stream is sought
+    void DropAhead() noexcept;
+
+private:
+    std::deque<DynInstr> ahead_;
+};
+
+/*
+ *  Functional simulator: executes the program one instruction at a time, without any timing, the same way the
+ *  pipeline retires it. The program ends at ebreak, at exit or when pc leaves the program (the pipeline fetches
+ *  ebreak there). Cycle and time csrs count retired instructions, as there are no cycles.
+ */
+class FunctionalSimulator final {
+public:
+    explicit FunctionalSimulator(Program &&program);
+
+    // Executes the next instruction, returns BREAK if it was the last one and ERR on failure
+    PipelineState Step(DynInstr &instr);
+    // Runs to the end of the program
+    PipelineState Run();
+
+    [[nodiscard]] uint32_t getPC() const noexcept;
+    [[nodiscard]] uint32_t Reg(uint8_t idx) const noexcept;
+    [[nodiscard]] uint64_t Instret() const noexcept;
+    [[nodiscard]] const DMEM &getDMEM() const noexcept;
+    [[nodiscard]] const SyscallUnit &getSyscallUnit() const noexcept;
+    [[nodiscard]] const AtomicUnit &getAtomicUnit() const noexcept;
+
+private:
+    // Instruction decoded once per pc
+    struct Decoded final {
+        RISCVInstr instr;
+        uint32_t imm{0};
+        uint8_t rd{0};
+        uint8_t rs1{0};
+        uint8_t rs2{0};
+        bool valid{false};
+    };
+
+    [[nodiscard]] const Decoded &Decode(uint32_t pc);
+    void Write(uint8_t rd, uint32_t value) noexcept;
+
+    IMEM imem_;
+    std::shared_ptr<MappedFile> image_;
+    std::vector<Decoded> decoded_;
+    Decoded end_;  // ebreak fetched outside of the program
+    std::array<uint32_t, 32> regs_{};
+    uint32_t pc_{0};
+    DMEM dmem_;
+    AtomicUnit atomic_;
+    CSRUnit csr_;
+    SyscallUnit sys_;
+};
+
+// Instructions retired by the functional simulator on another host thread
+class QueueSource final : public SequentialSource {
+public:
+    explicit QueueSource(size_t capacity = 4096) : queue_(capacity) {}
+
+    [[nodiscard]] SPSCQueue<DynInstr> &getQueue() noexcept {
+        return queue_;
+    }
+
+private:
+    bool Read(DynInstr &instr) override {
+        return queue_.Pop(instr);
+    }
+
+    SPSCQueue<DynInstr> queue_;
+};
+
+/*
+ *  Functional-first simulation on two host threads: the functional simulator runs ahead on its own thread and
+ *  passes retired instructions through a lock-free queue to the timing model, which replays them on the calling
+ *  thread. The timing model must be built from the same program, but without its segments: the data memory is the
+ *  one of the functional simulator. Returns the state of the timing model, ERR if it has retired another path.
+ */
+PipelineState RunFunctionalFirst(Simulator &timing, FunctionalSimulator &functional, size_t capacity = 4096);
+
+#endif //SIMULATOR_FUNCTIONAL_H
@@ -21,6 +21,9 @@ public:
     [[nodiscard]] std::bitset<3> getFunct3() const noexcept;
     [[nodiscard]] std::bitset<7> getFunct7() const noexcept;
     [[nodiscard]] std::bitset<32> getInstr() const noexcept;
+    [[nodiscard]] uint16_t getCSR() const noexcept;  // address of control and status register for Zicsr
+    [[nodiscard]] bool isCSR() const noexcept;
+    [[nodiscard]] bool isAtomic() const noexcept;  // RV32A load reserved, store conditional or amo
 
     std::string ToString() const noexcept;
 private:
@@ -29,6 +32,8 @@ private:
     void SelectS();
     void SelectII();
     void SelectR();
+    void SelectSystem();
+    void SelectAtomic();
 
     std::bitset<32> instr_{0};
     Format type_;
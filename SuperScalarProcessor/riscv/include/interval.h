@@ -0,0 +1,145 @@
+#ifndef SIMULATOR_INTERVAL_H
+#define SIMULATOR_INTERVAL_H
+
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "CPIStack.h"
+#include "ContolUnit.h"
+#include "simulator.h"
+
+/*
+ *  Interval analysis: approximate timing without the pipeline. The functional simulator executes the program, its
+ *  retired instructions are grouped into the pairs decode would issue and between miss events the pairs flow at
+ *  the dispatch width, one pair a cycle. Every miss event adds the bubble the pipeline would have:
+ *    - misprediction of the branch predictor (and every jalr) squashes fetch and decode,
+ *    - load whose result the next pair reads stalls it for a cycle,
+ *    - dependency inside the pair, serializing instruction or predicted taken branch in the upper way issue the
+ *      pair alone,
+ *    - load miss and atomic freeze the pipeline for their latency.
+ *  Slots are charged to a CPIStack the way write back charges them, so the estimate has the stack of the detailed
+ *  model. Only one hart without runahead is modelled.
+ *  Pairing of a basic block depends only on its instructions and the state it's entered with, so its slots are
+ *  memoized by the block and that state if requested. Hot loops enter their blocks in the same few states and later
+ *  executions only run functionally, the result is the same as without the memo. Cache misses and atomics are charged
+ *  per access, they don't change the pairing. Functional execution and the accesses take most of the time, so the
+ *  memo saves about a tenth of it and is off by default. Only this model is memoized, the pipeline carries more state
+ *  between blocks than their entry state, see SteadyStateRunner for the loops of the pipeline.
+ */
+class IntervalModel final {
+public:
+    // Penalties of the events in cycles
+    static constexpr const uint32_t redirect_penalty = 2;  // squashed fetch and decode
+    static constexpr const uint32_t load_use_penalty = 1;
+    static constexpr const uint32_t serialize_penalty = 2;  // younger instructions wait for the write back
+
+    static constexpr const uint32_t max_block = 32;  // longer straight line code is memoized in parts
+
+    explicit IntervalModel(Program &&program, const SimConfig &config = {}, bool memoize = false);
+
+    PipelineState Run();
+
+    [[nodiscard]] uint64_t Cycles() const noexcept;
+    [[nodiscard]] uint64_t Instret() const noexcept;
+    [[nodiscard]] uint64_t Mispredictions() const noexcept;
+    [[nodiscard]] uint64_t Blocks() const noexcept;
+    [[nodiscard]] uint64_t MemoHits() const noexcept;
+    [[nodiscard]] const CPIStack &getCPIStack() const noexcept;
+    [[nodiscard]] const DataCache &getDCache() const noexcept;
+    [[nodiscard]] const BranchPredictor &getBranchPredictor() const noexcept;
+    [[nodiscard]] const FunctionalSimulator &getFunctional() const noexcept;
+
+private:
+    // What timing needs to know about the instruction, decoded once per pc
+    struct Decoded final {
+        Decoded() = default;
+        explicit Decoded(const RISCVInstr &instr);
+
+        ControlUnit::Flags flags;
+        uint32_t imm{0};
+        uint8_t rd{0};
+        uint8_t rs1{0};
+        uint8_t rs2{0};
+        bool valid{false};
+    };
+
+    // Retired instruction waiting for its issue pair
+    struct Slot final {
+        DynInstr instr;
+        const Decoded *decoded{nullptr};
+        bool mispredicted{false};
+        bool predicted_taken{false};
+    };
+
+    // Everything the pairing of a block reads besides its instructions: the instruction of the previous block
+    // waiting for its pair, loads in flight, split of the previous pair and the outcome of the ending branch
+    struct BlockState final {
+        static constexpr const uint8_t pending = 1;
+        static constexpr const uint8_t pending_mispredicted = 2;
+        static constexpr const uint8_t pending_predicted_taken = 4;
+        static constexpr const uint8_t split = 8;
+        static constexpr const uint8_t mispredicted = 16;
+        static constexpr const uint8_t predicted_taken = 32;
+
+        bool operator==(const BlockState &other) const = default;
+
+        uint32_t pending_pc{0};
+        std::array<uint8_t, 2> load_rd{};
+        uint8_t flags{0};
+    };
+
+    // Slots of the block entered in the state and the state it leaves
+    struct BlockCost final {
+        BlockState entry;
+        std::array<uint32_t, static_cast<uint8_t>(Bubble::COUNT)> slots{};
+        uint32_t mispredictions{0};
+        std::array<uint8_t, 2> load_rd{};
+        bool split{false};
+        bool pending{false};  // last instruction of the block waits for the next one
+    };
+
+    // Fetch reads the word after the upper instruction even if it isn't on the path, so it's decoded by pc
+    [[nodiscard]] const Decoded &Decode(uint32_t pc);
+    // Predicts and resolves control flow of the instruction in program order
+    Slot Resolve(const DynInstr &instr);
+    // Reason the instruction can't be issued together with the upper one, NONE if it can
+    [[nodiscard]] Bubble SplitCause(const Slot &up, const Slot &down) const noexcept;
+    // Charges the stall of the decode pair with the upper instruction on loads of the previous pair
+    void WaitForLoads(const Slot &up);
+    // Issues the pair (down is nullptr if the upper instruction goes alone) and charges its slots and penalties
+    void Issue(const Slot &up, const Slot *down, Bubble empty);
+    void Access(const Slot &slot);
+    // Pairs the instruction with the waiting one
+    void Pair(const Slot &slot);
+    // Executes instructions up to the end of the basic block, resolves and accesses memory in program order
+    PipelineState ExecuteBlock();
+    // Pairs the executed block or replays its memoized slots
+    void TimeBlock();
+
+    IMEM imem_;  // copy of the one the functional simulator executes
+    FunctionalSimulator functional_;
+    BranchPredictor bp_;
+    DataCache dcache_;
+    uint32_t issue_width_;
+    uint32_t atomic_latency_;
+
+    std::vector<Decoded> decoded_;
+    Decoded end_;  // ebreak fetched outside of the program, its register fields count too
+
+    CPIStack cpi_;
+    uint64_t mispredictions_{0};
+    // Loads of the previous pair, the next one waits for them
+    std::array<uint8_t, 2> load_rd_{};
+    bool split_{false};  // previous pair was split, its down instruction is the upper one of the next pair
+    std::optional<Slot> pending_;  // retired instruction without its pair yet
+
+    bool memoize_;
+    std::vector<Slot> block_;
+    std::unordered_map<uint64_t, BlockCost> memo_;  // block pc and hash of the entry state
+    uint64_t blocks_{0};
+    uint64_t memo_hits_{0};
+};
+
+#endif //SIMULATOR_INTERVAL_H
@@ -0,0 +1,61 @@
+#ifndef SIMULATOR_LOADER_H
+#define SIMULATOR_LOADER_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Basics.h"
+#include "mapped_file.h"
+
+struct Symbol final {
+    uint32_t addr{0};
+    uint32_t size{0};
+    std::string name;
+};
+
+// Function symbols of the program sorted by address
+class SymbolTable final {
+public:
+    void Add(Symbol symbol);
+    void Sort();
+
+    // Symbol that contains addr or nullptr
+    [[nodiscard]] const Symbol *Lookup(uint32_t addr) const noexcept;
+    [[nodiscard]] const std::vector<Symbol> &getSymbols() const noexcept;
+
+private:
+    std::vector<Symbol> symbols_;
+};
+
+// Loadable segment of the program, data points to the mapped image
+struct Segment final {
+    uint32_t vaddr{0};
+    uint8_t *data{nullptr};
+    uint32_t file_size{0};
+    uint32_t mem_size{0};
+};
+
+struct Program final {
+    IMEM imem;
+    PC entry{0};
+    uint32_t stack_pointer{0};
+    uint32_t program_break{0};  // end of loaded segments, start of the heap
+    std::vector<Segment> segments;
+    SymbolTable symbols;
+    std::shared_ptr<MappedFile> image;  // keeps zero-copy imem and segments alive
+};
+
+// Default top of the stack for programs that come with their own memory layout
+constexpr const uint32_t stack_top = 0x7ffffff0;
+
+// Text file with one instruction in hex format per line, loaded from address 0
+std::optional<Program> LoadHex(const std::string &path);
+// Raw little-endian instruction words loaded from address 0, the file is used as IMEM without copying
+std::optional<Program> LoadBin(const std::string &path);
+// ELF32 RISC-V executable, PT_LOAD segments are mapped without copying
+std::optional<Program> LoadELF(const std::string &path);
+// Chooses format by the file content, raw binaries are recognized by .bin extension
+std::optional<Program> LoadProgram(const std::string &path);
+
+#endif //SIMULATOR_LOADER_H
@@ -0,0 +1,54 @@
+#ifndef SIMULATOR_MULTIHART_H
+#define SIMULATOR_MULTIHART_H
+
+#include <memory>
+#include <vector>
+
+#include "simulator.h"
+
+/*
+ *  Several harts run the same program with one guest memory, each hart is a Simulator with its own pipeline,
+ *  caches and registers and runs on its own host thread. Harts synchronize every quantum of cycles: no hart starts
+ *  the next quantum before all of them have finished the current one, so their clocks differ by at most a quantum.
+ *  Within a quantum harts run in parallel and the order of their accesses to shared memory depends on the host.
+ *  In deterministic mode harts take turns in the order of their ids inside every quantum, the result is the same
+ *  on every run at the cost of parallelism.
+ *
+ *  Load reservations of lr.w and sc.w are shared by all harts, see AtomicUnit. Private data caches of the harts
+ *  are kept coherent by the directory of the shared L2, see L2Cache, which limits harts to 64.
+ *
+ *  Hart starts with its id in a0 (as the id is also readable from mhartid) and the stack below the ones of the
+ *  previous harts. System calls are emulated per hart, so only one of them should manage the heap.
+ */
+class MultiHart final {
+public:
+    struct Config final {
+        uint32_t harts{2};
+        uint64_t quantum{1000};  // cycles
+        bool deterministic{false};
+        uint32_t stack_size{0x100000};  // distance between the stack tops of neighbour harts
+        SimConfig core;
+    };
+
+    explicit MultiHart(Program &&program, const Config &config);
+
+    // Runs until every hart has ended its program, returns ERR as soon as any of them fails
+    PipelineState Run();
+
+    [[nodiscard]] size_t Harts() const noexcept;
+    [[nodiscard]] Simulator &Hart(size_t id) noexcept;
+    [[nodiscard]] const Simulator &Hart(size_t id) const noexcept;
+    // Cycles of the slowest hart
+    [[nodiscard]] uint64_t Cycles() const noexcept;
+    // Synchronizations of all harts at the quantum boundary
+    [[nodiscard]] uint64_t Quanta() const noexcept;
+    [[nodiscard]] const L2Cache &L2() const noexcept;
+
+private:
+    Config config_;
+    std::vector<std::unique_ptr<Simulator>> harts_;
+    std::shared_ptr<L2Cache> l2_;
+    uint64_t quanta_{0};
+};
+
+#endif //SIMULATOR_MULTIHART_H
@@ -0,0 +1,55 @@
+#ifndef SIMULATOR_OBSERVER_H
+#define SIMULATOR_OBSERVER_H
+
+#include "Basics.h"
+
+/*
+ *  Compile-time instrumentation policy of Simulator::Run. The pipeline calls the hooks of its observer type after
+ *  the stage that produced the event; every call is under if constexpr (Observer::enabled), so with NullObserver
+ *  (the one of Simulator::Run()) the compiler removes the hooks with their arguments and the loop is the same as
+ *  without instrumentation.
+ *
+ *  Custom observers derive from PipelineObserver and hide the hooks they need:
+ *
+ *      struct LoadCounter final : PipelineObserver {
+ *          void MemoryAccess(const Simulator &, Way, uint32_t, bool is_store) { loads += !is_store; }
+ *          uint64_t loads{0};
+ *      };
+ *      LoadCounter counter;
+ *      cpu.Run(counter);
+ */
+
+struct NullObserver final {
+    static constexpr const bool enabled = false;
+};
+
+struct PipelineObserver {
+    static constexpr const bool enabled = true;
+
+    // Instruction is sent from fetch to decode, it may turn out to be on the wrong path
+    void Fetch(const Simulator &, Way, const PC &, const RISCVInstr &) {}
+    // Instruction leaves decode for execute
+    void Issue(const Simulator &, Way, const PC &, const RISCVInstr &) {}
+    // Way is held in decode by a hazard: load-use, dependency on the upper instruction, serialization or single issue
+    void Stall(const Simulator &, Way, Bubble) {}
+    // Valid instruction is executed, alu_out is its result or address
+    void Execute(const Simulator &, Way, const PC &, std::bitset<32> /* alu_out */) {}
+    // Execute stage redirected fetch, younger instructions are squashed
+    void Flush(const Simulator &) {}
+    void MemoryAccess(const Simulator &, Way, uint32_t /* addr */, bool /* is_store */) {}
+    void Retire(const Simulator &, Way, const PC &, const RISCVInstr &) {}
+
+    // Latches of the next stage are written by the transmit function, bubbles included
+    void FetchToDecode(const Simulator &) {}
+    void DecodeToExecute(const Simulator &) {}
+    void ExecuteToMemory(const Simulator &) {}
+    void MemoryToWriteBack(const Simulator &) {}
+    // Write back has finished its pair, bubbles included
+    void WriteBack(const Simulator &) {}
+    // Memory stage has frozen the pipeline for extra cycles by load misses and atomics
+    void Freeze(const Simulator &, uint32_t /* cycles */) {}
+    // End of the cycle
+    void Cycle(const Simulator &) {}
+};
+
+#endif //SIMULATOR_OBSERVER_H
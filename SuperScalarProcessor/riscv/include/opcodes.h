@@ -7,6 +7,8 @@
 // See official doc for formats at 130 p. in
 // https://github.com/riscv/riscv-isa-manual/releases/download/Ratified-IMAFDQC/riscv-spec-20191213.pdf
 // or https://github.com/riscv/riscv-opcodes/blob/master/opcodes-rv32i
+// Zicsr opcodes are in https://github.com/riscv/riscv-opcodes/blob/master/extensions/rv_zicsr
+// and RV32A ones are in https://github.com/riscv/riscv-opcodes/blob/master/extensions/rv_a
 
 enum class Opcode : uint8_t {
     LUI,
@@ -47,7 +49,24 @@ enum class Opcode : uint8_t {
     OR,
     AND,
     ECALL,
-    EBREAK
+    EBREAK,
+    CSRRW,
+    CSRRS,
+    CSRRC,
+    CSRRWI,
+    CSRRSI,
+    CSRRCI,
+    LR_W,
+    SC_W,
+    AMOSWAP_W,
+    AMOADD_W,
+    AMOXOR_W,
+    AMOAND_W,
+    AMOOR_W,
+    AMOMIN_W,
+    AMOMAX_W,
+    AMOMINU_W,
+    AMOMAXU_W
 };
 
 std::string OpcodeToString(Opcode op);
@@ -0,0 +1,94 @@
+#ifndef SIMULATOR_PIPETRACE_H
+#define SIMULATOR_PIPETRACE_H
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "Basics.h"
+#include "async_buffer.h"
+
+/*
+ *  Pipeline trace: the cycle every dynamic instruction enters fetch, decode, execute, memory and write back, its
+ *  retirement or flush. Instructions are numbered in fetch order, the trace keeps a copy of these numbers for every
+ *  pipeline latch and follows the transmits of the simulator through its output observer, so stages don't carry
+ *  them.
+ *  Records are written in binary form by a background thread, pipeview tool converts them to O3PipeView text that
+ *  Konata and gem5 o3-pipeview.py understand.
+ */
+class PipeTrace final {
+public:
+    enum class Event : uint8_t { FETCH, DECODE, EXECUTE, MEMORY, WRITE_BACK, RETIRE, FLUSH };
+
+    struct Record final {
+        uint64_t seq;
+        uint64_t cycle : 56;
+        uint64_t event : 8;
+        uint32_t pc;  // byte address, fetch records only
+        uint32_t instr;  // fetch records only
+    };
+    static_assert(sizeof(Record) == 24);
+
+    static constexpr const char magic[8] = {'R', 'V', 'P', 'T', 'R', 'A', 'C', '1'};
+
+    // Returns nullptr if the file can't be created
+    static std::unique_ptr<PipeTrace> Open(const std::string &path);
+
+    PipeTrace(const PipeTrace &) = delete;
+    PipeTrace &operator=(const PipeTrace &) = delete;
+
+    void Tick(uint64_t cycles = 1) noexcept {
+        now_ += cycles;
+    }
+
+    // Called after the transmit functions have written the latches
+    void FetchToDecode(const Simulator &cpu);
+    void DecodeToExecute(const Simulator &cpu);
+    void ExecuteToMemory(const Simulator &cpu);
+    void MemoryToWriteBack(const Simulator &cpu);
+    void Retire();
+
+    [[nodiscard]] uint64_t Instructions() const noexcept;
+
+private:
+    struct Slot final {
+        uint64_t seq{0};
+        bool valid{false};
+    };
+    struct Latch final {
+        Slot up;
+        Slot down;
+
+        Slot &operator[](Way way) noexcept {
+            return way == Way::UP ? up : down;
+        }
+    };
+
+    explicit PipeTrace(FILE *file);
+
+    Slot Fetched(const PC &pc, const RISCVInstr &instr, uint64_t fetch_cycle);
+    void Emit(uint64_t seq, uint64_t cycle, Event event, uint32_t pc = 0, uint32_t instr = 0);
+    void Flush(Slot &slot);
+
+    uint64_t now_{0};
+    uint64_t next_seq_{0};
+    uint64_t fetch_start_{0};  // first cycle fetch works on the current pair
+    uint64_t prev_fetch_start_{0};
+    bool refetch_up_{false};  // upper instruction was fetched as down one of the previous pair
+    uint32_t dropped_pc_{0};
+
+    Latch decode_{};
+    Latch execute_{};
+    Latch memory_{};
+    Latch write_back_{};
+
+    // Closed after the records are written
+    std::unique_ptr<FILE, int (*)(FILE *)> file_;
+    AsyncBuffer<Record> records_;
+};
+
+// Converts binary trace to O3PipeView format, instructions are printed in fetch order
+bool ConvertToO3PipeView(const std::string &path, std::ostream &out);
+
+#endif //SIMULATOR_PIPETRACE_H
@@ -12,21 +12,61 @@
 
 #include "ContolUnit.h"
 #include "HazardUnit.h"
+#include "DataCache.h"
+#include "RunaheadUnit.h"
+#include "SyscallUnit.h"
+#include "CSRUnit.h"
+#include "CPIStack.h"
+#include "InstrMix.h"
+#include "Profiler.h"
+#include "StatsRegistry.h"
 
 #include "instruction.h"
 #include "opcodes.h"
+#include "loader.h"
+#include "pipetrace.h"
+#include "commitlog.h"
+#include "observer.h"
+#include "functional.h"
+#include "macros.h"
+
+// Microarchitecture parameters that can be changed without recompilation
+struct SimConfig final {
+    BranchPredictor::Config bp;
+    uint32_t issue_width{2};  // 1 or 2
+    DataCache::Config dcache;
+    bool runahead{false};
+    uint32_t atomic_latency{0};  // extra cycles of every lr, sc and amo
+    L2Cache::Config l2;
+};
+
+// Sets the parameter by its option name (bp, bp-key-size, issue-width, dcache-sets, dcache-ways, dcache-line,
+// dcache-miss-latency, dcache-mshrs, runahead, atomic-latency, l2-sets, l2-ways, l2-latency), returns false if the
+// name or the value is invalid
+bool SetParameter(SimConfig &config, const std::string &name, const std::string &value);
 
 struct Simulator final {
-    explicit Simulator(uint32_t instr_count);
-    explicit Simulator(std::vector<std::bitset<32>> &&imem);
+    explicit Simulator(uint32_t instr_count, const SimConfig &config = {});
+    explicit Simulator(std::vector<std::bitset<32>> &&imem, const SimConfig &config = {});
+    explicit Simulator(Program &&program, const SimConfig &config = {});
 
+    // Writes the requested outputs (trace_, commit_log_, prof_, mix_, stats_) through OutputObserver
     PipelineState Run();
+    // Runs until write back reaches the cycle, returns STALL if the program hasn't ended by then. The next call
+    // continues from the same cycle
+    PipelineState RunUntil(uint64_t cycle);
+    // Same pipeline with the hooks of observer only, see observer.h
+    template<typename Observer>
+    PipelineState Run(Observer &observer, uint64_t cycle_limit = UINT64_MAX);
 
     void FDtransmitData();  // Fetch-Decode data transmition
     void DEtransmitData();  // Decode-Execute data transmition
     void EMtransmitData();  // Execute-Memory data transmition
     void MWBtransmitData();  // Memory-WriteBack data transmition
 
+    // Registers counters of all units in stats_, the simulator must not be moved after that
+    void RegisterStats();
+
     Fetch fetch_;
     Decode decode_;
     Execute execute_;
@@ -34,6 +74,148 @@ struct Simulator final {
     WriteBack write_back_;
 
     HazardUnit hu_;
+    RunaheadUnit ra_;
+    SyscallUnit sys_;
+    CSRUnit csr_;
+    CPIStack cpi_;
+    InstrMix mix_;  // counts nothing unless enabled
+    Profiler prof_;
+    StatsRegistry stats_;  // interval time series, disabled unless opened
+    std::unique_ptr<PipeTrace> trace_;  // nullptr unless pipeline trace is requested
+    std::unique_ptr<CommitLog> commit_log_;  // nullptr unless commit log is requested
+    InstrSource *source_{nullptr};  // instructions to replay instead of executing them, see RunFunctionalFirst
+
+    std::shared_ptr<MappedFile> image_;  // backing storage of mapped program segments
+
+private:
+    // Hooks read latches the stage has just written, they are called only if the stage has done its work and
+    // the transmit function wasn't skipped
+    template<typename Observer>
+    void ObserveWriteBack(Observer &observer) const;
+    template<typename Observer>
+    void ObserveMemory(Observer &observer) const;
+    template<typename Observer>
+    void ObserveExecute(Observer &observer) const;
+    template<typename Observer>
+    void ObserveDecode(Observer &observer) const;
+    template<typename Observer>
+    void ObserveFetch(Observer &observer) const;
 };
 
+template<typename Observer>
+PipelineState Simulator::Run(Observer &observer, uint64_t cycle_limit) {
+    PipelineState state;
+    while (true) {
+        ASSERT_STATE(hu_.exception_state)
+        ASSERT_STATE(write_back_.Run(*this))
+        if constexpr (Observer::enabled) {
+            if (state == PipelineState::OK) {
+                ObserveWriteBack(observer);
+            }
+        }
+        ASSERT_STATE(memory_.Run(*this))
+        if constexpr (Observer::enabled) {
+            if (state == PipelineState::OK) {
+                ObserveMemory(observer);
+            }
+        }
+        ASSERT_STATE(execute_.Run(*this))
+        if constexpr (Observer::enabled) {
+            if (state == PipelineState::OK) {
+                ObserveExecute(observer);
+            }
+        }
+        ASSERT_STATE(decode_.Run(*this))
+        if constexpr (Observer::enabled) {
+            if (state == PipelineState::OK) {
+                ObserveDecode(observer);
+            }
+        }
+        ASSERT_STATE(fetch_.Run(*this))
+        if constexpr (Observer::enabled) {
+            if (state == PipelineState::OK) {
+                ObserveFetch(observer);
+            }
+            observer.Cycle(*this);
+        }
+        if (write_back_.cycle >= cycle_limit) {
+            return PipelineState::STALL;
+        }
+    }
+}
+
+template<typename Observer>
+void Simulator::ObserveWriteBack(Observer &observer) const {
+    for (Way way : {Way::UP, Way::DOWN}) {
+        if (write_back_.getBubble(way) == Bubble::NONE) {
+            observer.Retire(*this, way, write_back_.getPC(way), write_back_.getInstr(way));
+        }
+    }
+    observer.WriteBack(*this);
+}
+
+template<typename Observer>
+void Simulator::ObserveMemory(Observer &observer) const {
+    if (!write_back_.is_set) {
+        return;
+    }
+    if (memory_.FreezeCycles() > 0) {
+        observer.Freeze(*this, memory_.FreezeCycles());
+    }
+    observer.MemoryToWriteBack(*this);
+    for (Way way : {Way::UP, Way::DOWN}) {
+        if (memory_.getBubble(way) == Bubble::NONE && (memory_.WS(way) || memory_.MEM_WE(way))) {
+            observer.MemoryAccess(*this, way, static_cast<uint32_t>(memory_.ALU_OUT(way).to_ulong()),
+                                  memory_.MEM_WE(way));
+        }
+    }
+}
+
+template<typename Observer>
+void Simulator::ObserveExecute(Observer &observer) const {
+    if (!memory_.is_set) {
+        return;
+    }
+    observer.ExecuteToMemory(*this);
+    for (Way way : {Way::UP, Way::DOWN}) {
+        if (execute_.getWE_GEN(way).isValid()) {
+            observer.Execute(*this, way, memory_.getPC(way), execute_.ALU_OUT(way));
+        }
+    }
+    if (execute_.PC_R()) {
+        observer.Flush(*this);
+    }
+}
+
+template<typename Observer>
+void Simulator::ObserveDecode(Observer &observer) const {
+    if (!execute_.is_set) {
+        return;
+    }
+    observer.DecodeToExecute(*this);
+    for (Way way : {Way::UP, Way::DOWN}) {
+        Bubble bubble = execute_.getBubble(way);
+        if (execute_.V_EX(way)) {
+            observer.Issue(*this, way, way == Way::UP ? execute_.PC_EX_Up() : execute_.PC_EX_Down(),
+                           execute_.getInstr(way));
+        } else if (bubble == Bubble::LOAD_USE || bubble == Bubble::DEPENDENCY || bubble == Bubble::SERIALIZE ||
+                   bubble == Bubble::ISSUE_WIDTH) {
+            observer.Stall(*this, way, bubble);
+        }
+    }
+}
+
+template<typename Observer>
+void Simulator::ObserveFetch(Observer &observer) const {
+    // Upper way isn't sent again after split issue
+    if (!fetch_.is_set) {
+        return;
+    }
+    observer.FetchToDecode(*this);
+    if (hu_.pl_state != PipelineState::STALL_DOWN) {
+        observer.Fetch(*this, Way::UP, decode_.getPC_Up(), decode_.getInstr(Way::UP));
+    }
+    observer.Fetch(*this, Way::DOWN, decode_.getPC_Down(), decode_.getInstr(Way::DOWN));
+}
+
 #endif //SIMULATOR_SIMULATOR_H
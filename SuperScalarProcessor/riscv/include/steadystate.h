@@ -0,0 +1,117 @@
+#ifndef SIMULATOR_STEADYSTATE_H
+#define SIMULATOR_STEADYSTATE_H
+
+#include <array>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "ContolUnit.h"
+#include "simulator.h"
+
+/*
+ *  Steady-state extrapolation of loops. The pipeline replays the instructions of the functional simulator, as in
+ *  functional-first simulation but on the same host thread, and its timing state is saved every time a backward
+ *  branch or jump leaves execute: the latches without their data values, the hazard unit and the changes of the
+ *  branch predictor. When the state repeats at the same branch, the next iterations repeat every cycle since then
+ *  as long as they take the same path, a loop may repeat itself only after several iterations. Then only the
+ *  functional simulator executes the following periods and the counters advance by the deltas of the last one,
+ *  the data cache is still accessed by every instruction and its misses and atomics freeze the pipeline as usual.
+ *  The pipeline continues from the same state, its register file and the addresses and results in the latches are
+ *  rebuilt from the retired instructions, execute takes the rest from the runner as a source of replayed ones.
+ *  Total cycles and the CPI stack are the same as without extrapolation.
+ *  Iterations with system calls or csr accesses are always simulated. Only one hart without runahead is supported,
+ *  the skipped cycles can't be traced, logged or profiled.
+ */
+class SteadyStateRunner final : public InstrSource {
+public:
+    static constexpr const uint32_t max_period = 1024;  // instructions of the longest period detected
+    static constexpr const uint32_t max_snapshots = 4;  // iterations of the longest period
+    // Instructions after the skipped iterations that must be on the path too, more than the pipeline holds
+    static constexpr const uint32_t lookahead = 16;
+
+    // Timing model must be built from the same program without its segments, see RunFunctionalFirst
+    SteadyStateRunner(Simulator &timing, FunctionalSimulator &functional);
+
+    // Returns the state of the timing model, ERR if it has retired another path
+    PipelineState Run();
+    bool Next(DynInstr &instr) override;
+    const DynInstr *Ahead(size_t offset) override;
+
+    [[nodiscard]] uint64_t Loops() const noexcept;  // steady states extrapolated
+    [[nodiscard]] uint64_t Iterations() const noexcept;
+    [[nodiscard]] uint64_t Cycles() const noexcept;  // skipped by extrapolation
+
+private:
+    // What the runner needs to know about the instruction, decoded once per pc
+    struct Decoded final {
+        Decoded() = default;
+        explicit Decoded(const RISCVInstr &instr);
+
+        ControlUnit::Flags flags;
+        uint32_t imm{0};
+        uint8_t rd{0};
+        uint8_t rs1{0};
+        uint8_t rs2{0};
+        bool valid{false};
+    };
+
+    // Instruction retired by the functional simulator and the old value of the register it may write
+    struct Record final {
+        DynInstr instr;
+        uint32_t prev{0};
+        uint8_t reg{0};
+    };
+
+    // Pipeline at the end of the cycle a backward branch has left execute
+    struct Snapshot final {
+        uint32_t pc{0};  // of the branch
+        std::vector<uint64_t> timing;
+        std::array<uint64_t, 5> cycles{};  // of the stages from fetch to write back
+        std::array<uint64_t, static_cast<uint8_t>(Bubble::COUNT)> slots{};
+        std::array<uint64_t, static_cast<uint8_t>(CSRUnit::Event::COUNT)> events{};
+        uint64_t instret{0};
+        uint64_t retired{0};  // instructions retired by the pipeline and skipped
+    };
+
+    [[nodiscard]] const Decoded &Decode(uint32_t pc);
+    // Instruction the pipeline retires after the offset others, executes the functional simulator up to it.
+    // nullptr after the end of the program
+    const Record *Peek(size_t offset);
+    // Moves the next instruction to the retired ones
+    void Retire();
+    // Pc of the backward branch or jump that has left execute in the last cycle
+    [[nodiscard]] std::optional<uint32_t> BackwardBranch();
+    void Save(Snapshot &snapshot, uint32_t pc) const;
+    // Forgets the saved states, e.g. when the path since them has a serializing instruction
+    void Reset();
+    // Checks the state after the cycle and extrapolates the loop if it has repeated
+    void Observe();
+    // Instructions in the latches are the ones the functional simulator retires next
+    [[nodiscard]] bool isInFlightOnPath();
+    // Skips the periods that follow the path of the last one, returns false if there are none
+    bool Extrapolate(const Snapshot &from, const Snapshot &to);
+    // Writes the data values of the instructions in flight and the register file before them
+    void Restore();
+
+    Simulator &timing_;
+    FunctionalSimulator &functional_;
+    PipelineState functional_state_{PipelineState::OK};
+
+    std::vector<Decoded> decoded_;
+    Decoded end_;  // ebreak fetched outside of the program
+
+    std::deque<Record> window_;  // executed by the functional simulator, not retired by the pipeline yet
+    std::array<Record, 2> retired_{};  // the last two retired ones, older first
+    uint64_t retired_count_{0};
+
+    std::deque<Snapshot> snapshots_;  // the last ones, oldest first
+    std::vector<uint32_t> path_;  // pcs of the instructions retired since the oldest snapshot
+    Snapshot current_;
+
+    uint64_t loops_{0};
+    uint64_t iterations_{0};
+    uint64_t cycles_{0};
+};
+
+#endif //SIMULATOR_STEADYSTATE_H
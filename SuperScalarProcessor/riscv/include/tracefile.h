@@ -0,0 +1,152 @@
+#ifndef SIMULATOR_TRACEFILE_H
+#define SIMULATOR_TRACEFILE_H
+
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "async_buffer.h"
+#include "functional.h"
+#include "mapped_file.h"
+
+/*
+ *  Binary trace of retired instructions in program order. Records are cut into blocks of block_size instructions,
+ *  a block is stored by columns: a dictionary of its instruction words and their indices, pc and next pc as
+ *  deltas to the expected ones (both are almost always 0), addresses of memory accesses as deltas to the previous
+ *  one and the values. Columns are varint coded and the block is compressed by LZCodec. Index of the blocks at the
+ *  end of the file lets readers decompress only the blocks of the range they need.
+ *
+ *  Records are copied by the simulation thread, a background thread encodes, compresses and writes the blocks.
+ */
+class TraceWriter final {
+public:
+    struct Header final {
+        char magic[8];
+        uint32_t version;
+        uint32_t block_size;  // records of every block but the last one
+    };
+
+    struct BlockHeader final {
+        uint32_t records;
+        uint32_t first_pc;
+        uint32_t raw_size;
+        uint32_t stored_size;  // equal to raw_size if the block didn't compress
+    };
+
+    struct IndexEntry final {
+        uint64_t first_record;
+        uint64_t offset;  // of the block header
+    };
+
+    struct Footer final {
+        uint64_t index_offset;
+        uint64_t records;
+        uint64_t blocks;
+        char magic[8];
+    };
+
+    static constexpr const char magic[8] = {'R', 'V', 'D', 'T', 'R', 'A', 'C', 'E'};
+    static constexpr const uint32_t version = 2;
+    static constexpr const uint32_t default_block_size = 4096;
+    static constexpr const uint32_t max_block_size = 1 << 20;
+
+    // Returns nullptr if the file can't be created, block size is clamped to max_block_size
+    static std::unique_ptr<TraceWriter> Open(const std::string &path, uint32_t block_size = default_block_size);
+
+    // Closes the trace if Close wasn't called
+    ~TraceWriter();
+
+    void Write(const DynInstr &instr);
+    // Writes the last block and the index, returns false if the trace couldn't be written. Nothing can be written
+    // after it
+    bool Close();
+
+    [[nodiscard]] uint64_t Records() const noexcept;  // written so far
+
+private:
+    TraceWriter(FILE *file, uint32_t block_size);
+
+    // Encodes and writes the collected records, called by the background thread
+    void WriteBlock();
+    // Nothing is written after the first failed write
+    void Put(const void *data, size_t size);
+
+    std::unique_ptr<FILE, int (*)(FILE *)> file_;
+    uint32_t block_size_;
+    uint64_t count_{0};
+
+    // Owned by the background thread
+    std::vector<DynInstr> block_;
+    std::vector<IndexEntry> index_;
+    uint64_t offset_{sizeof(Header)};
+    uint64_t written_{0};
+    bool failed_{false};
+    std::optional<AsyncBuffer<DynInstr>> records_;  // its thread uses the members above
+};
+
+// Runs the functional simulator to the end of the program and writes every instruction, the last one included.
+// Closes the trace, returns ERR if it couldn't be written
+PipelineState RecordTrace(FunctionalSimulator &functional, TraceWriter &writer);
+
+/*
+ *  Recorded trace streamed from a mapped file, for the timing model to replay instead of executing, see
+ *  InstrSource. Binary traces are written by TraceWriter, blocks are decompressed one at a time when they are
+ *  reached or sought. Trace whose writer was killed has no index, its complete blocks are found by walking them.
+ *  Commit logs in the format of Spike run with -l --log-commits (and of --commit-log) are read as they are: next pc
+ *  is the pc of the next commit line, value is the one written to rd or stored. Disassembly lines and unknown
+ *  fields are skipped. Commit logs don't have the results of system calls, they are replayed as 0.
+ *
+ *  The file is only read, so one mapping serves readers of any number of timing models running at once.
+ */
+class TraceReader final : public SequentialSource {
+public:
+    enum class Format : uint8_t { BINARY, COMMIT_LOG };
+
+    // Returns nullptr if the file can't be mapped or is a binary trace of another version or a corrupted header
+    static std::unique_ptr<TraceReader> Open(const std::string &path);
+    static std::unique_ptr<TraceReader> Open(std::shared_ptr<const MappedFile> file);
+
+    // Next record is the one with the given index, only binary traces can be sought. Returns false if the trace
+    // is shorter or the block is corrupted
+    bool Seek(uint64_t record);
+
+    [[nodiscard]] Format getFormat() const noexcept;
+    [[nodiscard]] uint64_t Records() const noexcept;  // read so far, the ones looked ahead included
+    [[nodiscard]] uint64_t Size() const noexcept;  // records of binary trace
+    [[nodiscard]] size_t Blocks() const noexcept;
+
+private:
+    TraceReader(std::shared_ptr<const MappedFile> file, Format format);
+
+    bool Read(DynInstr &instr) override;
+    // Index from the footer or from walking the blocks, false if the file isn't a trace
+    bool LoadIndex();
+    // Header must describe a block the writer could have written, so a corrupted one can't make the reader allocate
+    // or decompress more than a block of block_size_ records takes
+    [[nodiscard]] bool isValid(const TraceWriter::BlockHeader &header) const noexcept;
+    bool DecodeBlock(size_t block);
+    // Next commit line of the log, false at the end of the file
+    bool ParseCommit(DynInstr &instr);
+
+    std::shared_ptr<const MappedFile> file_;
+    Format format_;
+    uint64_t records_{0};
+
+    // Binary trace
+    uint32_t block_size_{0};
+    std::vector<TraceWriter::IndexEntry> index_;
+    uint64_t size_{0};
+    std::vector<uint8_t> raw_;  // decompressed block
+    std::vector<DynInstr> block_;
+    size_t block_pos_{0};
+    size_t next_block_{0};
+
+    // Commit log
+    const char *pos_;
+    const char *end_;
+    DynInstr pending_;  // commit line read ahead for the next pc of the previous one
+    bool has_pending_{false};
+};
+
+#endif //SIMULATOR_TRACEFILE_H
@@ -43,11 +43,14 @@ RISCVInstr::RISCVInstr(const std::bitset<32> i) : instr_(i) {
             type_ = Format::R;
             SelectR();
             break;
-        case 0b1110011: {
+        case 0b1110011:
             type_ = Format::I;
-            op_ = instr_[20] ? Opcode::EBREAK : Opcode::ECALL;
+            SelectSystem();
+            break;
+        case 0b0101111:
+            type_ = Format::R;
+            SelectAtomic();
             break;
-        }
         default:
             std::cerr << "Invalid instruction: " << instr_.to_string() << "\n";
             return;
@@ -176,6 +179,84 @@ void RISCVInstr::SelectII() {
     }
 }
 
+void RISCVInstr::SelectSystem() {
+    funct3_ = sub_range<14, 12>(instr_);
+    switch (funct3_.to_ulong()) {
+        case 0b000:
+            op_ = instr_[20] ? Opcode::EBREAK : Opcode::ECALL;
+            break;
+        case 0b001:
+            op_ = Opcode::CSRRW;
+            break;
+        case 0b010:
+            op_ = Opcode::CSRRS;
+            break;
+        case 0b011:
+            op_ = Opcode::CSRRC;
+            break;
+        case 0b101:
+            op_ = Opcode::CSRRWI;
+            break;
+        case 0b110:
+            op_ = Opcode::CSRRSI;
+            break;
+        case 0b111:
+            op_ = Opcode::CSRRCI;
+            break;
+        default:
+            std::cerr << "Invalid instruction: " << instr_.to_string() << "\n";
+            return;
+    }
+}
+
+void RISCVInstr::SelectAtomic() {
+    funct3_ = sub_range<14, 12>(instr_);
+    funct7_ = sub_range<31, 25>(instr_);
+    if (funct3_.to_ulong() != 0b010) {
+        std::cerr << "Invalid instruction: " << instr_.to_string() << "\n";
+        return;
+    }
+    // Upper 5 bits of funct7, aq and rl bits are ignored by in-order pipeline
+    switch (sub_range<31, 27>(instr_).to_ulong()) {
+        case 0b00010:
+            op_ = Opcode::LR_W;
+            break;
+        case 0b00011:
+            op_ = Opcode::SC_W;
+            break;
+        case 0b00001:
+            op_ = Opcode::AMOSWAP_W;
+            break;
+        case 0b00000:
+            op_ = Opcode::AMOADD_W;
+            break;
+        case 0b00100:
+            op_ = Opcode::AMOXOR_W;
+            break;
+        case 0b01100:
+            op_ = Opcode::AMOAND_W;
+            break;
+        case 0b01000:
+            op_ = Opcode::AMOOR_W;
+            break;
+        case 0b10000:
+            op_ = Opcode::AMOMIN_W;
+            break;
+        case 0b10100:
+            op_ = Opcode::AMOMAX_W;
+            break;
+        case 0b11000:
+            op_ = Opcode::AMOMINU_W;
+            break;
+        case 0b11100:
+            op_ = Opcode::AMOMAXU_W;
+            break;
+        default:
+            std::cerr << "Invalid instruction: " << instr_.to_string() << "\n";
+            return;
+    }
+}
+
 void RISCVInstr::SelectR() {
     funct3_ = sub_range<14, 12>(instr_);
     funct7_ = sub_range<31, 25>(instr_);
@@ -261,12 +342,33 @@ std::bitset<32> RISCVInstr::getInstr() const noexcept {
     return instr_;
 }
 
+uint16_t RISCVInstr::getCSR() const noexcept {
+    return static_cast<uint16_t>(sub_range<31, 20>(instr_).to_ulong());
+}
+
+bool RISCVInstr::isCSR() const noexcept {
+    return op_ == Opcode::CSRRW || op_ == Opcode::CSRRS || op_ == Opcode::CSRRC ||
+           op_ == Opcode::CSRRWI || op_ == Opcode::CSRRSI || op_ == Opcode::CSRRCI;
+}
+
+bool RISCVInstr::isAtomic() const noexcept {
+    return op_ >= Opcode::LR_W && op_ <= Opcode::AMOMAXU_W;
+}
+
 std::string RISCVInstr::ToString() const noexcept {
     std::stringstream res;
     res << std::left << std::setw(3) << OpcodeToString(op_) << " ";
     IMM imm{*this, op_ == Opcode::JALR};
     switch (type_) {
         case Format::R: {
+            if (isAtomic()) {
+                res << "x" << getRd().to_ulong() << ", ";
+                if (op_ != Opcode::LR_W) {
+                    res << "x" << getRs2().to_ulong() << ", ";
+                }
+                res << "(x" << getRs1().to_ulong() << ")";
+                break;
+            }
             res << "x" << getRd().to_ulong() << ", "
                 << "x" << getRs1().to_ulong() << ", "
                 << "x" << getRs2().to_ulong();
@@ -274,6 +376,12 @@ std::string RISCVInstr::ToString() const noexcept {
         }
         case Format::I: {
             res << "x" << getRd().to_ulong() << ", ";
+            if (isCSR()) {
+                bool is_imm = funct3_[2];
+                res << "0x" << std::hex << getCSR() << std::dec << ", " << (is_imm ? "" : "x")
+                    << getRs1().to_ulong();
+                break;
+            }
             bool is_load = op_ == Opcode::LB || op_ == Opcode::LBU ||
                            op_ == Opcode::LH || op_ == Opcode::LHU || op_ == Opcode::LW;
             is_load ? res  << static_cast<int>(imm.getImm().to_ulong()) << "(x"
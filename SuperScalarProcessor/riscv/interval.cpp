@@ -0,0 +1,293 @@
+#include "interval.h"
+
+IntervalModel::IntervalModel(Program &&program, const SimConfig &config, bool memoize) :
+        imem_(program.imem), functional_(std::move(program)), bp_(config.bp), dcache_(config.dcache),
+        issue_width_(config.issue_width), atomic_latency_(config.atomic_latency), memoize_(memoize) {
+    if (config.l2.sets > 0) {
+        dcache_.setL2(std::make_shared<L2Cache>(config.l2, config.dcache), 0);
+    }
+    decoded_.resize(imem_.size());
+    end_ = Decoded{RISCVInstr{std::bitset<32>{/* ebreak */ 0x100073}}};
+}
+
+IntervalModel::Decoded::Decoded(const RISCVInstr &instr) :
+        imm(static_cast<uint32_t>(IMM{instr}.getImm().to_ulong())),
+        rd(static_cast<uint8_t>(instr.getRd().to_ulong())),
+        rs1(static_cast<uint8_t>(instr.getRs1().to_ulong())),
+        rs2(static_cast<uint8_t>(instr.getRs2().to_ulong())),
+        valid(true) {
+    ControlUnit cu;
+    cu.setState(instr);
+    flags = cu.flags;
+}
+
+const IntervalModel::Decoded &IntervalModel::Decode(uint32_t pc) {
+    PC index{pc / 4};
+    if (pc % 4 != 0 || imem_.isEndOfIMEM(index)) {
+        return end_;
+    }
+
+    Decoded &decoded = decoded_[index.val() - imem_.getBase().val()];
+    if (!decoded.valid) {
+        decoded = Decoded{RISCVInstr{imem_.getInstr(index)}};
+    }
+    return decoded;
+}
+
+IntervalModel::Slot IntervalModel::Resolve(const DynInstr &instr) {
+    Slot slot{instr, &Decode(instr.pc)};
+    const ControlUnit::Flags &flags = slot.decoded->flags;
+    bool is_control = flags.BRANCH_COND || flags.JMP || flags.JALR;
+    // Tag and key of the tables are the whole pc and only branches and jal are stored, any other instruction is
+    // predicted not taken
+    PC pc{instr.pc / 4};
+    slot.predicted_taken = (flags.BRANCH_COND || flags.JMP) && bp_.getPrediction(pc);
+
+    // Branch to the next instruction is taken too, so the comparison is repeated. Branches don't write registers,
+    // the functional simulator still has their operands
+    bool is_taken = flags.JMP || flags.JALR ||
+                    (flags.BRANCH_COND && CMP::calc(functional_.Reg(slot.decoded->rs1),
+                                                    functional_.Reg(slot.decoded->rs2), flags.CMP_OP));
+    if (flags.BRANCH_COND || flags.JMP) {
+        bp_.setPrediction(pc, PC{slot.decoded->imm}, is_taken);
+    }
+    // Jalr target is never predicted, as in execute
+    slot.mispredicted = flags.JALR || (is_control && is_taken != slot.predicted_taken);
+    return slot;
+}
+
+Bubble IntervalModel::SplitCause(const Slot &up, const Slot &down) const noexcept {
+    if (up.mispredicted) {
+        return Bubble::REDIRECT;
+    }
+    // Fetch leaves the down way empty after predicted taken branch, unless the branch was the down one and is
+    // shifted up after the split: then the fetched instruction is its target
+    if (up.predicted_taken && !split_) {
+        return Bubble::FRONTEND;
+    }
+
+    const ControlUnit::Flags &flags_up = up.decoded->flags;
+    const ControlUnit::Flags &flags_down = down.decoded->flags;
+    if (flags_up.ECALL || flags_up.EBREAK || flags_up.CSR || flags_down.EBREAK || flags_down.CSR ||
+        flags_down.ATOMIC) {
+        return Bubble::SERIALIZE;
+    }
+    // Register fields are compared even if the format has none, as in decode
+    if (flags_up.WB_WE && (up.decoded->rd == down.decoded->rs1 || up.decoded->rd == down.decoded->rs2)) {
+        return Bubble::DEPENDENCY;
+    }
+    return issue_width_ < 2 ? Bubble::ISSUE_WIDTH : Bubble::NONE;
+}
+
+void IntervalModel::WaitForLoads(const Slot &up) {
+    // Decode pair waits for the loads of the previous one in execute. After a split the pair is the shifted
+    // instruction and the fetched one, only the shifted one is checked
+    const Decoded &fetched_down = Decode(up.instr.pc + 4);
+    bool is_conflict = false;
+    for (uint8_t rd : load_rd_) {
+        is_conflict |= rd != 0 && (rd == up.decoded->rs1 || rd == up.decoded->rs2 ||
+                                   (!split_ && (rd == fetched_down.rs1 || rd == fetched_down.rs2)));
+    }
+    if (is_conflict) {
+        cpi_.Account(Bubble::LOAD_USE, CPIStack::issue_width * load_use_penalty);
+    }
+}
+
+void IntervalModel::Issue(const Slot &up, const Slot *down, Bubble empty) {
+    WaitForLoads(up);
+    // Younger instructions read the result of system call or csr access from the register file
+    if (up.decoded->flags.ECALL || up.decoded->flags.CSR || (down != nullptr && down->decoded->flags.ECALL)) {
+        cpi_.Account(Bubble::SERIALIZE, CPIStack::issue_width * serialize_penalty);
+    }
+
+    cpi_.Account(Bubble::NONE, down != nullptr ? 2 : 1);
+    if (down == nullptr) {
+        cpi_.Account(empty);
+    }
+
+    const Slot &last = down != nullptr ? *down : up;
+    if (last.mispredicted) {
+        ++mispredictions_;
+        cpi_.Account(Bubble::REDIRECT, CPIStack::issue_width * redirect_penalty);
+    }
+    // Redirect squashes decode, nothing waits for the loads then
+    load_rd_[0] = up.decoded->flags.WS && !last.mispredicted ? up.decoded->rd : 0;
+    load_rd_[1] = down != nullptr && down->decoded->flags.WS && !last.mispredicted ? down->decoded->rd : 0;
+    split_ = empty == Bubble::DEPENDENCY || empty == Bubble::SERIALIZE || empty == Bubble::ISSUE_WIDTH;
+}
+
+void IntervalModel::Access(const Slot &slot) {
+    const ControlUnit::Flags &flags = slot.decoded->flags;
+    if (flags.MEM_WE) {
+        dcache_.Access(slot.instr.addr, true);
+    }
+    if (flags.WS) {
+        // Blocking cache and atomics freeze the whole pipeline
+        if (!dcache_.Access(slot.instr.addr, flags.ATOMIC)) {
+            cpi_.Account(Bubble::DCACHE_MISS, CPIStack::issue_width * dcache_.MissLatency());
+        }
+        if (flags.ATOMIC) {
+            cpi_.Account(Bubble::ATOMIC, CPIStack::issue_width * atomic_latency_);
+        }
+    }
+}
+
+void IntervalModel::Pair(const Slot &slot) {
+    if (!pending_) {
+        pending_ = slot;
+        return;
+    }
+    Bubble cause = SplitCause(*pending_, slot);
+    if (cause == Bubble::NONE) {
+        Issue(*pending_, &slot, Bubble::NONE);
+        pending_.reset();
+    } else {
+        Issue(*pending_, nullptr, cause);
+        pending_ = slot;
+    }
+}
+
+PipelineState IntervalModel::ExecuteBlock() {
+    block_.clear();
+    PipelineState state{PipelineState::OK};
+    while (state == PipelineState::OK && block_.size() < max_block) {
+        DynInstr instr;
+        state = functional_.Step(instr);
+        if (state == PipelineState::ERR) {
+            return state;
+        }
+
+        const Slot &slot = block_.emplace_back(Resolve(instr));
+        // Memory is accessed in program order as in the memory stage, only the pairing is memoized
+        Access(slot);
+        const ControlUnit::Flags &flags = slot.decoded->flags;
+        if (flags.BRANCH_COND || flags.JMP || flags.JALR) {
+            break;
+        }
+    }
+    return state;
+}
+
+void IntervalModel::TimeBlock() {
+    ++blocks_;
+    BlockState entry{0, load_rd_, static_cast<uint8_t>(split_ ? BlockState::split : 0)};
+    if (pending_) {
+        entry.pending_pc = pending_->instr.pc;
+        entry.flags |= BlockState::pending;
+        entry.flags |= pending_->mispredicted ? BlockState::pending_mispredicted : 0;
+        entry.flags |= pending_->predicted_taken ? BlockState::pending_predicted_taken : 0;
+    }
+    // Only the last instruction of the block may be a branch
+    entry.flags |= block_.back().mispredicted ? BlockState::mispredicted : 0;
+    entry.flags |= block_.back().predicted_taken ? BlockState::predicted_taken : 0;
+
+    // Different states of the same hash replace each other
+    uint32_t hash = entry.pending_pc * 0x9e3779b1U ^
+                    (entry.load_rd[0] | static_cast<uint32_t>(entry.load_rd[1]) << 5U |
+                     static_cast<uint32_t>(entry.flags) << 10U);
+    uint64_t key = static_cast<uint64_t>(block_.front().instr.pc) << 32U | hash;
+    if (memoize_) {
+        auto it = memo_.find(key);
+        if (it != memo_.end() && it->second.entry == entry) {
+            const BlockCost &cost = it->second;
+            for (uint8_t bubble = 0; bubble < static_cast<uint8_t>(Bubble::COUNT); ++bubble) {
+                cpi_.Account(static_cast<Bubble>(bubble), cost.slots[bubble]);
+            }
+            mispredictions_ += cost.mispredictions;
+            load_rd_ = cost.load_rd;
+            split_ = cost.split;
+            pending_.reset();
+            if (cost.pending) {
+                pending_ = block_.back();
+            }
+            ++memo_hits_;
+            return;
+        }
+    }
+
+    std::array<uint64_t, static_cast<uint8_t>(Bubble::COUNT)> slots{};
+    for (uint8_t bubble = 0; bubble < static_cast<uint8_t>(Bubble::COUNT); ++bubble) {
+        slots[bubble] = cpi_.Slots(static_cast<Bubble>(bubble));
+    }
+    uint64_t mispredictions = mispredictions_;
+    for (const Slot &slot : block_) {
+        Pair(slot);
+    }
+    if (!memoize_) {
+        return;
+    }
+
+    BlockCost cost{entry};
+    for (uint8_t bubble = 0; bubble < static_cast<uint8_t>(Bubble::COUNT); ++bubble) {
+        cost.slots[bubble] = static_cast<uint32_t>(cpi_.Slots(static_cast<Bubble>(bubble)) - slots[bubble]);
+    }
+    cost.mispredictions = static_cast<uint32_t>(mispredictions_ - mispredictions);
+    cost.load_rd = load_rd_;
+    cost.split = split_;
+    cost.pending = pending_.has_value();
+    memo_.insert_or_assign(key, cost);
+}
+
+PipelineState IntervalModel::Run() {
+    PipelineState state{PipelineState::OK};
+    while (state == PipelineState::OK) {
+        state = ExecuteBlock();
+        if (state == PipelineState::ERR) {
+            return state;
+        }
+        if (state == PipelineState::OK) {
+            TimeBlock();
+            continue;
+        }
+
+        // Program ends when ebreak or exit reaches write back, it isn't retired, but it may wait in decode like
+        // any other
+        Slot last = block_.back();
+        block_.pop_back();
+        for (const Slot &slot : block_) {
+            Pair(slot);
+        }
+        if (pending_) {
+            Issue(*pending_, nullptr, Bubble::SERIALIZE);
+            pending_.reset();
+        }
+        WaitForLoads(last);
+    }
+    return PipelineState::OK;
+}
+
+uint64_t IntervalModel::Cycles() const noexcept {
+    return cpi_.TotalSlots() / CPIStack::issue_width;
+}
+
+uint64_t IntervalModel::Instret() const noexcept {
+    return functional_.Instret();
+}
+
+uint64_t IntervalModel::Mispredictions() const noexcept {
+    return mispredictions_;
+}
+
+uint64_t IntervalModel::Blocks() const noexcept {
+    return blocks_;
+}
+
+uint64_t IntervalModel::MemoHits() const noexcept {
+    return memo_hits_;
+}
+
+const CPIStack &IntervalModel::getCPIStack() const noexcept {
+    return cpi_;
+}
+
+const DataCache &IntervalModel::getDCache() const noexcept {
+    return dcache_;
+}
+
+const BranchPredictor &IntervalModel::getBranchPredictor() const noexcept {
+    return bp_;
+}
+
+const FunctionalSimulator &IntervalModel::getFunctional() const noexcept {
+    return functional_;
+}
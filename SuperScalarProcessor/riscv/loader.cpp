@@ -0,0 +1,257 @@
+#include "loader.h"
+
+#include <array>
+#include <cstring>
+#include <elf.h>
+
+#ifndef EM_RISCV
+#define EM_RISCV 243
+#endif
+
+void SymbolTable::Add(Symbol symbol) {
+    symbols_.push_back(std::move(symbol));
+}
+
+void SymbolTable::Sort() {
+    std::sort(symbols_.begin(), symbols_.end(),
+              [](const Symbol &lhs, const Symbol &rhs) { return lhs.addr < rhs.addr; });
+}
+
+const Symbol *SymbolTable::Lookup(uint32_t addr) const noexcept {
+    auto it = std::upper_bound(symbols_.begin(), symbols_.end(), addr,
+                               [](uint32_t addr, const Symbol &symbol) { return addr < symbol.addr; });
+    if (it == symbols_.begin()) {
+        return nullptr;
+    }
+
+    --it;
+    // Symbols without size (e.g. from hand written assembly) span up to the next one
+    bool inside = it->size == 0 ? std::next(it) == symbols_.end() || addr < std::next(it)->addr :
+                                  addr - it->addr < it->size;
+    return inside ? &*it : nullptr;
+}
+
+const std::vector<Symbol> &SymbolTable::getSymbols() const noexcept {
+    return symbols_;
+}
+
+namespace {
+
+template<typename T>
+bool ReadStruct(const MappedFile &image, size_t offset, T &out) {
+    if (offset > image.size() || image.size() - offset < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&out, image.data() + offset, sizeof(T));
+    return true;
+}
+
+bool InFile(const MappedFile &image, size_t offset, size_t size) {
+    return offset <= image.size() && image.size() - offset >= size;
+}
+
+void LoadSymbols(const MappedFile &image, const Elf32_Ehdr &ehdr, SymbolTable &symbols) {
+    for (uint32_t i = 0; i < ehdr.e_shnum; ++i) {
+        Elf32_Shdr symtab;
+        if (!ReadStruct(image, ehdr.e_shoff + i * ehdr.e_shentsize, symtab) || symtab.sh_type != SHT_SYMTAB) {
+            continue;
+        }
+
+        Elf32_Shdr strtab;
+        if (!ReadStruct(image, ehdr.e_shoff + symtab.sh_link * ehdr.e_shentsize, strtab) ||
+            !InFile(image, strtab.sh_offset, strtab.sh_size)) {
+            continue;
+        }
+        const char *names = reinterpret_cast<const char *>(image.data() + strtab.sh_offset);
+
+        for (uint32_t offset = 0; offset + sizeof(Elf32_Sym) <= symtab.sh_size; offset += sizeof(Elf32_Sym)) {
+            Elf32_Sym sym;
+            if (!ReadStruct(image, symtab.sh_offset + offset, sym)) {
+                break;
+            }
+            if (ELF32_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_shndx == SHN_UNDEF || sym.st_name >= strtab.sh_size) {
+                continue;
+            }
+            symbols.Add(Symbol{sym.st_value, sym.st_size, std::string{names + sym.st_name,
+                                                                      strnlen(names + sym.st_name,
+                                                                              strtab.sh_size - sym.st_name)}});
+        }
+    }
+    symbols.Sort();
+}
+
+constexpr std::array<int8_t, 256> HexDigits() {
+    std::array<int8_t, 256> digits{};
+    for (auto &digit : digits) {
+        digit = -1;
+    }
+    for (int i = 0; i < 10; ++i) {
+        digits['0' + i] = static_cast<int8_t>(i);
+    }
+    for (int i = 0; i < 6; ++i) {
+        digits['a' + i] = static_cast<int8_t>(10 + i);
+        digits['A' + i] = static_cast<int8_t>(10 + i);
+    }
+    return digits;
+}
+
+constexpr std::array<int8_t, 256> hex_digits = HexDigits();
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+std::optional<Program> LoadHexImage(const MappedFile &image, const std::string &path) {
+    const char *begin = reinterpret_cast<const char *>(image.data());
+    const char *end = begin + image.size();
+
+    // One instruction per line, so the number of lines is a tight upper bound
+    std::vector<uint32_t> words;
+    words.reserve(std::count(begin, end, '\n') + 1);
+
+    for (const char *p = begin; p != end;) {
+        if (IsSpace(*p)) {
+            ++p;
+            continue;
+        }
+
+        if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+            p += 2;
+        }
+        uint32_t word = 0;
+        const char *digits_begin = p;
+        for (; p != end && hex_digits[static_cast<uint8_t>(*p)] >= 0; ++p) {
+            word = (word << 4) | static_cast<uint32_t>(hex_digits[static_cast<uint8_t>(*p)]);
+        }
+        if (p == digits_begin || p - digits_begin > 8 || (p != end && !IsSpace(*p))) {
+            std::cerr << "Invalid instruction at line " << std::count(begin, p, '\n') + 1
+                      << " of " << path << std::endl;
+            return std::nullopt;
+        }
+        words.push_back(word);
+    }
+
+    Program program;
+    program.imem = IMEM{std::move(words)};
+    return program;
+}
+
+std::optional<Program> LoadBinImage(std::shared_ptr<MappedFile> image, const std::string &path) {
+    if (image->size() % 4 != 0) {
+        std::cerr << "Size of raw binary is not a multiple of instruction size: " << path << std::endl;
+        return std::nullopt;
+    }
+
+    Program program;
+    program.imem = IMEM{reinterpret_cast<const uint32_t *>(image->data()), static_cast<uint32_t>(image->size() / 4),
+                        PC{0}, image};
+    program.image = std::move(image);
+    return program;
+}
+
+std::optional<Program> LoadELFImage(std::shared_ptr<MappedFile> image, const std::string &path) {
+    Elf32_Ehdr ehdr;
+    if (!ReadStruct(*image, 0, ehdr) || std::memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr.e_ident[EI_CLASS] != ELFCLASS32 || ehdr.e_ident[EI_DATA] != ELFDATA2LSB) {
+        std::cerr << "Not an ELF32 little-endian file: " << path << std::endl;
+        return std::nullopt;
+    }
+    if (ehdr.e_machine != EM_RISCV || ehdr.e_type != ET_EXEC) {
+        std::cerr << "Not a RISC-V executable: " << path << std::endl;
+        return std::nullopt;
+    }
+
+    Program program;
+    program.entry = PC{ehdr.e_entry / 4};
+    program.stack_pointer = stack_top;
+
+    for (uint32_t i = 0; i < ehdr.e_phnum; ++i) {
+        Elf32_Phdr phdr;
+        if (!ReadStruct(*image, ehdr.e_phoff + i * ehdr.e_phentsize, phdr)) {
+            std::cerr << "Broken program header in " << path << std::endl;
+            return std::nullopt;
+        }
+        if (phdr.p_type != PT_LOAD) {
+            continue;
+        }
+        if (!InFile(*image, phdr.p_offset, phdr.p_filesz) || phdr.p_filesz > phdr.p_memsz) {
+            std::cerr << "Broken segment in " << path << std::endl;
+            return std::nullopt;
+        }
+
+        uint8_t *data = image->data() + phdr.p_offset;
+        program.segments.push_back(Segment{phdr.p_vaddr, data, phdr.p_filesz, phdr.p_memsz});
+        program.program_break = std::max(program.program_break, phdr.p_vaddr + phdr.p_memsz);
+
+        bool has_entry = ehdr.e_entry >= phdr.p_vaddr && ehdr.e_entry - phdr.p_vaddr < phdr.p_filesz;
+        if ((phdr.p_flags & PF_X) && has_entry) {
+            if (phdr.p_vaddr % 4 != 0) {
+                std::cerr << "Misaligned text segment in " << path << std::endl;
+                return std::nullopt;
+            }
+            if (phdr.p_offset % alignof(uint32_t) == 0) {
+                program.imem = IMEM{reinterpret_cast<const uint32_t *>(data), phdr.p_filesz / 4,
+                                    PC{phdr.p_vaddr / 4}, image};
+            } else {
+                auto words = std::make_shared<std::vector<uint32_t>>(phdr.p_filesz / 4);
+                std::memcpy(words->data(), data, words->size() * 4);
+                program.imem = IMEM{words->data(), static_cast<uint32_t>(words->size()), PC{phdr.p_vaddr / 4}, words};
+            }
+        }
+    }
+
+    if (program.imem.size() == 0) {
+        std::cerr << "No executable segment with entry point in " << path << std::endl;
+        return std::nullopt;
+    }
+
+    program.program_break = (program.program_break + DMEM::page_size - 1) / DMEM::page_size * DMEM::page_size;
+    LoadSymbols(*image, ehdr, program.symbols);
+    program.image = std::move(image);
+    return program;
+}
+
+std::shared_ptr<MappedFile> OpenImage(const std::string &path) {
+    auto image = MappedFile::Open(path);
+    if (image == nullptr) {
+        std::cerr << "Can't open file: " << path << std::endl;
+    }
+    return image;
+}
+
+bool HasExtension(const std::string &path, const std::string &extension) {
+    return path.size() >= extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+}  // namespace
+
+std::optional<Program> LoadHex(const std::string &path) {
+    auto image = OpenImage(path);
+    return image != nullptr ? LoadHexImage(*image, path) : std::nullopt;
+}
+
+std::optional<Program> LoadBin(const std::string &path) {
+    auto image = OpenImage(path);
+    return image != nullptr ? LoadBinImage(std::move(image), path) : std::nullopt;
+}
+
+std::optional<Program> LoadELF(const std::string &path) {
+    auto image = OpenImage(path);
+    return image != nullptr ? LoadELFImage(std::move(image), path) : std::nullopt;
+}
+
+std::optional<Program> LoadProgram(const std::string &path) {
+    auto image = OpenImage(path);
+    if (image == nullptr) {
+        return std::nullopt;
+    }
+
+    if (image->size() >= SELFMAG && std::memcmp(image->data(), ELFMAG, SELFMAG) == 0) {
+        return LoadELFImage(std::move(image), path);
+    }
+    if (HasExtension(path, ".bin")) {
+        return LoadBinImage(std::move(image), path);
+    }
+    return LoadHexImage(*image, path);
+}
@@ -0,0 +1,112 @@
+#include "multihart.h"
+
+#include <atomic>
+#include <barrier>
+#include <thread>
+
+MultiHart::MultiHart(Program &&program, const Config &config) : config_(config) {
+    config_.harts = std::clamp(config_.harts, 1u, L2Cache::max_harts);
+    config_.quantum = std::max<uint64_t>(config_.quantum, 1);
+    // Segments are mapped once into the memory of hart 0, the others share it
+    std::vector<Program> copies(config_.harts - 1, program);
+    harts_.push_back(std::make_unique<Simulator>(std::move(program), config_.core));
+    for (auto &copy : copies) {
+        copy.segments.clear();
+        harts_.push_back(std::make_unique<Simulator>(std::move(copy), config_.core));
+        harts_.back()->memory_.setDMEM(harts_.front()->memory_.getSharedDMEM());
+    }
+
+    uint32_t stack_pointer = static_cast<uint32_t>(harts_.front()->decode_.getRegFile().Read(2).to_ulong());
+    auto reservations = std::make_shared<ReservationTable>(config_.harts);
+    l2_ = std::make_shared<L2Cache>(config_.core.l2, config_.core.dcache, config_.harts);
+    for (uint32_t id = 0; id < harts_.size(); ++id) {
+        Simulator &hart = *harts_[id];
+        hart.memory_.getAtomicUnit().setReservations(reservations, id);
+        hart.memory_.getDCache().setL2(l2_, id);
+        hart.csr_.setHartId(id);
+        hart.decode_.writeToRF({/* a0 */ 10}, {id}, true);
+        hart.decode_.writeToRF({/* sp */ 2}, {stack_pointer - id * config_.stack_size}, true);
+    }
+}
+
+PipelineState MultiHart::Run() {
+    // STALL is a hart that hasn't ended its program yet
+    std::vector<PipelineState> states(harts_.size(), PipelineState::STALL);
+    std::atomic<bool> failed{false};
+    std::atomic<size_t> turn{0};  // hart allowed to run in deterministic mode
+    bool finished = false;
+    uint64_t limit = 0;
+    quanta_ = 0;
+
+    // Runs on the last hart to arrive, before the others are released into the next quantum
+    auto next_quantum = [&]() noexcept {
+        ++quanta_;
+        finished = failed || std::none_of(states.begin(), states.end(),
+                                          [](PipelineState state) { return state == PipelineState::STALL; });
+        limit += config_.quantum;
+        turn = 0;
+    };
+    std::barrier sync{static_cast<std::ptrdiff_t>(harts_.size()), next_quantum};
+
+    auto run_hart = [&](size_t id) {
+        sync.arrive_and_wait();
+        while (!finished) {
+            if (config_.deterministic) {
+                for (size_t current = turn.load(); current != id; current = turn.load()) {
+                    turn.wait(current);
+                }
+            }
+            if (states[id] == PipelineState::STALL && !failed) {
+                states[id] = harts_[id]->RunUntil(limit);
+                if (states[id] == PipelineState::ERR) {
+                    failed = true;
+                }
+            }
+            if (config_.deterministic) {
+                turn = id + 1;
+                turn.notify_all();
+            }
+            sync.arrive_and_wait();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t id = 1; id < harts_.size(); ++id) {
+        threads.emplace_back(run_hart, id);
+    }
+    run_hart(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    // The first synchronization only starts the run
+    --quanta_;
+    return failed ? PipelineState::ERR : PipelineState::OK;
+}
+
+size_t MultiHart::Harts() const noexcept {
+    return harts_.size();
+}
+
+Simulator &MultiHart::Hart(size_t id) noexcept {
+    return *harts_[id];
+}
+
+const Simulator &MultiHart::Hart(size_t id) const noexcept {
+    return *harts_[id];
+}
+
+uint64_t MultiHart::Cycles() const noexcept {
+    uint64_t cycles = 0;
+    for (const auto &hart : harts_) {
+        cycles = std::max(cycles, hart->write_back_.cycle);
+    }
+    return cycles;
+}
+
+uint64_t MultiHart::Quanta() const noexcept {
+    return quanta_;
+}
+
+const L2Cache &MultiHart::L2() const noexcept {
+    return *l2_;
+}
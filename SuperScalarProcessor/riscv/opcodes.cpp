@@ -80,6 +80,40 @@ std::string OpcodeToString(Opcode op) {
             return "ecall";
         case Opcode::EBREAK:
             return "ebreak";
+        case Opcode::CSRRW:
+            return "csrrw";
+        case Opcode::CSRRS:
+            return "csrrs";
+        case Opcode::CSRRC:
+            return "csrrc";
+        case Opcode::CSRRWI:
+            return "csrrwi";
+        case Opcode::CSRRSI:
+            return "csrrsi";
+        case Opcode::CSRRCI:
+            return "csrrci";
+        case Opcode::LR_W:
+            return "lr.w";
+        case Opcode::SC_W:
+            return "sc.w";
+        case Opcode::AMOSWAP_W:
+            return "amoswap.w";
+        case Opcode::AMOADD_W:
+            return "amoadd.w";
+        case Opcode::AMOXOR_W:
+            return "amoxor.w";
+        case Opcode::AMOAND_W:
+            return "amoand.w";
+        case Opcode::AMOOR_W:
+            return "amoor.w";
+        case Opcode::AMOMIN_W:
+            return "amomin.w";
+        case Opcode::AMOMAX_W:
+            return "amomax.w";
+        case Opcode::AMOMINU_W:
+            return "amominu.w";
+        case Opcode::AMOMAXU_W:
+            return "amomaxu.w";
         default:
             return "unknown";
     }
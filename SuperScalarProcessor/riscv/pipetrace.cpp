@@ -0,0 +1,214 @@
+#include "pipetrace.h"
+
+#include <cstring>
+#include <iomanip>
+#include <map>
+
+#include "simulator.h"
+
+std::unique_ptr<PipeTrace> PipeTrace::Open(const std::string &path) {
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "Can't create trace file: " << path << std::endl;
+        return nullptr;
+    }
+    std::fwrite(magic, sizeof(magic), 1, file);
+    return std::unique_ptr<PipeTrace>{new PipeTrace{file}};
+}
+
+PipeTrace::PipeTrace(FILE *file) :
+        file_(file, &std::fclose),
+        records_([file](const std::vector<Record> &records) {
+            std::fwrite(records.data(), sizeof(Record), records.size(), file);
+        }) {}
+
+void PipeTrace::FetchToDecode(const Simulator &cpu) {
+    const Decode &decode = cpu.decode_;
+    bool is_stall_down = cpu.hu_.pl_state == PipelineState::STALL_DOWN;
+    // Pair fetched after stall down starts with the dropped down instruction that was already fetched once
+    PC pc_up = is_stall_down ? decode.getPC_Down() : decode.getPC_Up();
+    uint64_t up_start = refetch_up_ && pc_up.val() == dropped_pc_ ? prev_fetch_start_ : fetch_start_;
+    if (!is_stall_down) {
+        decode_[Way::UP] = Fetched(decode.getPC_Up(), decode.getInstr(Way::UP), up_start);
+        decode_[Way::DOWN] = Fetched(decode.getPC_Down(), decode.getInstr(Way::DOWN), fetch_start_);
+        refetch_up_ = false;
+    } else {
+        // Decode has shifted its down instruction, upper one of fetch comes as the down one
+        decode_[Way::UP] = decode_[Way::DOWN];
+        decode_[Way::DOWN] = Fetched(decode.getPC_Down(), decode.getInstr(Way::DOWN), up_start);
+        refetch_up_ = true;
+        dropped_pc_ = (decode.getPC_Down() + 4).val();
+    }
+    prev_fetch_start_ = fetch_start_;
+    fetch_start_ = now_ + 1;
+}
+
+void PipeTrace::DecodeToExecute(const Simulator &cpu) {
+    for (Way way : {Way::UP, Way::DOWN}) {
+        Slot &slot = decode_[way];
+        Bubble bubble = cpu.decode_.getBubble(way);
+        if (cpu.decode_.V_DE(way) && slot.valid) {
+            Emit(slot.seq, now_ + 1, Event::EXECUTE);
+            execute_[way] = slot;
+            slot.valid = false;
+            continue;
+        }
+
+        execute_[way] = Slot{};
+        // Stalled instructions stay in decode, wrong path ones leave the pipeline
+        if (bubble == Bubble::REDIRECT || bubble == Bubble::FRONTEND) {
+            Flush(slot);
+        }
+    }
+}
+
+void PipeTrace::ExecuteToMemory(const Simulator &cpu) {
+    for (Way way : {Way::UP, Way::DOWN}) {
+        Slot &slot = execute_[way];
+        if (slot.valid && cpu.execute_.getWE_GEN(way).isValid()) {
+            Emit(slot.seq, now_ + 1, Event::MEMORY);
+            memory_[way] = slot;
+        } else {
+            // Down instruction squashed by the upper jump
+            Flush(slot);
+            memory_[way] = Slot{};
+        }
+        slot.valid = false;
+    }
+}
+
+void PipeTrace::MemoryToWriteBack(const Simulator &) {
+    for (Way way : {Way::UP, Way::DOWN}) {
+        write_back_[way] = memory_[way];
+        if (memory_[way].valid) {
+            Emit(memory_[way].seq, now_ + 1, Event::WRITE_BACK);
+        }
+        memory_[way].valid = false;
+    }
+}
+
+void PipeTrace::Retire() {
+    for (Way way : {Way::UP, Way::DOWN}) {
+        if (write_back_[way].valid) {
+            Emit(write_back_[way].seq, now_ + 1, Event::RETIRE);
+        }
+        write_back_[way].valid = false;
+    }
+}
+
+uint64_t PipeTrace::Instructions() const noexcept {
+    return next_seq_;
+}
+
+PipeTrace::Slot PipeTrace::Fetched(const PC &pc, const RISCVInstr &instr, uint64_t fetch_cycle) {
+    Slot slot{next_seq_++, true};
+    Emit(slot.seq, fetch_cycle, Event::FETCH, pc.realVal(), static_cast<uint32_t>(instr.getInstr().to_ulong()));
+    Emit(slot.seq, now_ + 1, Event::DECODE);
+    return slot;
+}
+
+void PipeTrace::Emit(uint64_t seq, uint64_t cycle, Event event, uint32_t pc, uint32_t instr) {
+    records_.Push(Record{seq, cycle, static_cast<uint8_t>(event), pc, instr});
+}
+
+void PipeTrace::Flush(Slot &slot) {
+    if (slot.valid) {
+        Emit(slot.seq, now_ + 1, Event::FLUSH);
+    }
+    slot.valid = false;
+}
+
+namespace {
+
+struct TracedInstr final {
+    uint32_t pc{0};
+    uint32_t instr{0};
+    std::array<uint64_t, 5> stages{};  // fetch, decode, execute, memory and write back cycles
+    uint64_t retire{0};
+    bool done{false};
+    bool flushed{false};
+};
+
+// Ticks are picoseconds in gem5, one cycle is printed as 1000 ticks
+constexpr const uint64_t ticks_per_cycle = 1000;
+
+void PrintO3(std::ostream &out, uint64_t seq, const TracedInstr &traced) {
+    auto tick = [&traced](PipeTrace::Event event) {
+        uint64_t cycle = traced.stages[static_cast<uint8_t>(event)];
+        return cycle == 0 && event != PipeTrace::Event::FETCH ? 0 : (cycle + 1) * ticks_per_cycle;
+    };
+    out << "O3PipeView:fetch:" << tick(PipeTrace::Event::FETCH) << ":0x" << std::hex << std::setw(8)
+        << std::setfill('0') << traced.pc << std::dec << ":0:" << seq << ":"
+        << RISCVInstr{std::bitset<32>{traced.instr}}.ToString() << "\n";
+    out << "O3PipeView:decode:" << tick(PipeTrace::Event::DECODE) << "\n";
+    // No renaming and dispatch in order pipeline, instruction leaves decode to execute
+    out << "O3PipeView:rename:" << tick(PipeTrace::Event::DECODE) << "\n";
+    out << "O3PipeView:dispatch:" << tick(PipeTrace::Event::DECODE) << "\n";
+    out << "O3PipeView:issue:" << tick(PipeTrace::Event::EXECUTE) << "\n";
+    out << "O3PipeView:complete:" << tick(PipeTrace::Event::MEMORY) << "\n";
+    out << "O3PipeView:retire:" << (traced.flushed ? 0 : (traced.retire + 1) * ticks_per_cycle) << ":store:0\n";
+}
+
+}  // namespace
+
+bool ConvertToO3PipeView(const std::string &path, std::ostream &out) {
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        std::cerr << "Can't open trace file: " << path << std::endl;
+        return false;
+    }
+
+    char header[sizeof(PipeTrace::magic)];
+    if (std::fread(header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header, PipeTrace::magic, sizeof(header)) != 0) {
+        std::cerr << "Not a pipeline trace: " << path << std::endl;
+        std::fclose(file);
+        return false;
+    }
+
+    // Instructions are printed as soon as all the older ones are done, so only in-flight ones are kept
+    std::map<uint64_t, TracedInstr> in_flight;
+    uint64_t next_print = 0;
+    std::vector<PipeTrace::Record> records(4096);
+    size_t count;
+    while ((count = std::fread(records.data(), sizeof(PipeTrace::Record), records.size(), file)) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+            const PipeTrace::Record &record = records[i];
+            TracedInstr &traced = in_flight[record.seq];
+            auto event = static_cast<PipeTrace::Event>(record.event);
+            switch (event) {
+                case PipeTrace::Event::FETCH:
+                    traced.pc = record.pc;
+                    traced.instr = record.instr;
+                    [[fallthrough]];
+                case PipeTrace::Event::DECODE:
+                case PipeTrace::Event::EXECUTE:
+                case PipeTrace::Event::MEMORY:
+                case PipeTrace::Event::WRITE_BACK:
+                    traced.stages[static_cast<uint8_t>(event)] = record.cycle;
+                    break;
+                case PipeTrace::Event::RETIRE:
+                    traced.retire = record.cycle;
+                    traced.done = true;
+                    break;
+                case PipeTrace::Event::FLUSH:
+                    traced.flushed = true;
+                    traced.done = true;
+                    break;
+            }
+        }
+
+        for (auto it = in_flight.begin(); it != in_flight.end() && it->first == next_print && it->second.done;
+             it = in_flight.erase(it), ++next_print) {
+            PrintO3(out, it->first, it->second);
+        }
+    }
+    std::fclose(file);
+
+    // Instructions in flight when the program stopped are printed as flushed
+    for (auto &[seq, traced] : in_flight) {
+        traced.flushed = traced.flushed || !traced.done;
+        PrintO3(out, seq, traced);
+    }
+    return true;
+}
@@ -1,33 +1,201 @@
+#include <charconv>
 #include <iomanip>
 #include "simulator.h"
-#include "macros.h"
 
-Simulator::Simulator(uint32_t instr_count) {
+namespace {
+
+bool ParseUInt(const std::string &value, uint32_t &out) {
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), out);
+    return ec == std::errc{} && ptr == value.data() + value.size();
+}
+
+}  // namespace
+
+bool SetParameter(SimConfig &config, const std::string &name, const std::string &value) {
+    uint32_t number{0};
+    if (name == "bp") {
+        for (auto type : {BranchPredictor::Type::NOT_TAKEN, BranchPredictor::Type::TWO_BIT}) {
+            if (value == BranchPredictor::Name(type)) {
+                config.bp.type = type;
+                return true;
+            }
+        }
+        return false;
+    } else if (name == "bp-key-size") {
+        if (!ParseUInt(value, number) || number > UINT8_MAX) {
+            return false;
+        }
+        config.bp.key_size = static_cast<uint8_t>(number);
+        return BranchPredictor::isSupported({BranchPredictor::Type::TWO_BIT, config.bp.key_size});
+    } else if (name == "issue-width") {
+        return ParseUInt(value, config.issue_width) && (config.issue_width == 1 || config.issue_width == 2);
+    } else if (name == "dcache-sets") {
+        return ParseUInt(value, config.dcache.sets) && config.dcache.sets > 0;
+    } else if (name == "dcache-ways") {
+        return ParseUInt(value, config.dcache.ways) && config.dcache.ways > 0;
+    } else if (name == "dcache-line") {
+        return ParseUInt(value, config.dcache.line_size) && config.dcache.line_size > 0;
+    } else if (name == "dcache-miss-latency") {
+        return ParseUInt(value, config.dcache.miss_latency);
+    } else if (name == "dcache-mshrs") {
+        return ParseUInt(value, config.dcache.mshrs) && config.dcache.mshrs > 0;
+    } else if (name == "runahead") {
+        config.runahead = value.empty() || value == "1";
+        return value.empty() || value == "0" || value == "1";
+    } else if (name == "atomic-latency") {
+        return ParseUInt(value, config.atomic_latency);
+    } else if (name == "l2-sets") {
+        return ParseUInt(value, config.l2.sets);
+    } else if (name == "l2-ways") {
+        return ParseUInt(value, config.l2.ways) && config.l2.ways > 0;
+    } else if (name == "l2-latency") {
+        return ParseUInt(value, config.l2.latency);
+    }
+
+    return false;
+}
+
+Simulator::Simulator(uint32_t instr_count, const SimConfig &config) {
     fetch_ = Fetch{instr_count};
     decode_ = Decode{};
     execute_ = Execute{};
-    memory_ = Memory{};
+    memory_ = Memory{config.dcache, config.atomic_latency, config.l2};
     write_back_ = WriteBack{};
+    hu_ = HazardUnit{config.bp, config.issue_width};
+    ra_.setEnabled(config.runahead);
 }
 
-Simulator::Simulator(std::vector<std::bitset<32>> &&imem) {
+Simulator::Simulator(std::vector<std::bitset<32>> &&imem, const SimConfig &config) {
     fetch_ = Fetch{std::move(imem)};
     decode_ = Decode{};
     execute_ = Execute{};
-    memory_ = Memory{};
+    memory_ = Memory{config.dcache, config.atomic_latency, config.l2};
+    write_back_ = WriteBack{};
+    hu_ = HazardUnit{config.bp, config.issue_width};
+    ra_.setEnabled(config.runahead);
+}
+
+Simulator::Simulator(Program &&program, const SimConfig &config) {
+    fetch_ = Fetch{std::move(program.imem)};
+    fetch_.setPC(program.entry);
+    decode_ = Decode{};
+    execute_ = Execute{};
+    memory_ = Memory{config.dcache, config.atomic_latency, config.l2};
     write_back_ = WriteBack{};
+    hu_ = HazardUnit{config.bp, config.issue_width};
+    ra_.setEnabled(config.runahead);
+
+    // Only file part of the segment is mapped, the rest is zero as any untouched memory
+    for (const auto &segment : program.segments) {
+        memory_.mapToDMEM(segment.vaddr, segment.data, segment.file_size);
+    }
+    if (program.stack_pointer != 0) {
+        decode_.writeToRF({/* sp */ 2}, {program.stack_pointer}, true);
+    }
+    sys_.setBreak(program.program_break);
+    image_ = std::move(program.image);
 }
 
+namespace {
+
+// Requested outputs of Simulator::Run: pipeline trace, commit log, profile, instruction mix and statistics
+class OutputObserver final : public PipelineObserver {
+public:
+    explicit OutputObserver(Simulator &cpu) : cpu_(cpu) {}
+
+    void Retire(const Simulator &, Way, const PC &, const RISCVInstr &instr) {
+        if (cpu_.mix_.isEnabled()) {
+            cpu_.mix_.Retire(instr);
+        }
+    }
+
+    void FetchToDecode(const Simulator &) {
+        if (cpu_.trace_) {
+            cpu_.trace_->FetchToDecode(cpu_);
+        }
+    }
+
+    void DecodeToExecute(const Simulator &) {
+        if (cpu_.trace_) {
+            cpu_.trace_->DecodeToExecute(cpu_);
+        }
+    }
+
+    void ExecuteToMemory(const Simulator &) {
+        if (cpu_.trace_) {
+            cpu_.trace_->ExecuteToMemory(cpu_);
+        }
+        if (cpu_.mix_.isEnabled()) {
+            cpu_.mix_.Issue(cpu_.execute_.getWE_GEN(Way::UP), cpu_.execute_.getWE_GEN(Way::DOWN));
+        }
+    }
+
+    void MemoryToWriteBack(const Simulator &) {
+        if (cpu_.trace_) {
+            cpu_.trace_->MemoryToWriteBack(cpu_);
+        }
+        if (cpu_.commit_log_) {
+            cpu_.commit_log_->MemoryToWriteBack(cpu_);
+        }
+    }
+
+    void WriteBack(const Simulator &) {
+        if (cpu_.trace_) {
+            cpu_.trace_->Retire();
+        }
+        if (cpu_.commit_log_) {
+            cpu_.commit_log_->Retire(cpu_);
+        }
+        if (cpu_.prof_.isEnabled()) {
+            const ::WriteBack &write_back = cpu_.write_back_;
+            cpu_.prof_.Cycle(write_back.getPC(Way::UP), write_back.getBubble(Way::UP), write_back.getPC(Way::DOWN),
+                             write_back.getBubble(Way::DOWN));
+        }
+    }
+
+    void Freeze(const Simulator &, uint32_t cycles) {
+        if (cpu_.trace_) {
+            cpu_.trace_->Tick(cycles);
+        }
+        if (cpu_.prof_.isEnabled()) {
+            cpu_.prof_.Freeze(cycles);
+        }
+    }
+
+    void Cycle(const Simulator &) {
+        if (cpu_.trace_) {
+            cpu_.trace_->Tick();
+        }
+        if (cpu_.stats_.isEnabled()) {
+            cpu_.stats_.Sample();
+        }
+    }
+
+private:
+    Simulator &cpu_;
+};
+
+}  // namespace
+
 PipelineState Simulator::Run() {
-    PipelineState state;
-    while (true) {
-        ASSERT_STATE(hu_.exception_state)
-        ASSERT_STATE(write_back_.Run(*this))
-        ASSERT_STATE(memory_.Run(*this))
-        ASSERT_STATE(execute_.Run(*this))
-        ASSERT_STATE(decode_.Run(*this))
-        ASSERT_STATE(fetch_.Run(*this))
+    return RunUntil(UINT64_MAX);
+}
+
+PipelineState Simulator::RunUntil(uint64_t cycle) {
+    // Outputs are checked once per run, without them the loop has no instrumentation at all
+    if (trace_ || commit_log_ || prof_.isEnabled() || mix_.isEnabled() || stats_.isEnabled()) {
+        OutputObserver observer{*this};
+        return Run(observer, cycle);
     }
+    NullObserver observer;
+    return Run(observer, cycle);
+}
+
+void Simulator::RegisterStats() {
+    stats_.setClock(write_back_.cycle, csr_.Instret());
+    fetch_.RegisterStats(stats_);
+    hu_.RegisterStats(stats_);
+    memory_.RegisterStats(stats_);
 }
 
 void Simulator::FDtransmitData() {
@@ -36,8 +204,12 @@ void Simulator::FDtransmitData() {
         decode_.setInstr(fetch_.getInstr(Way::UP), Way::UP);
         decode_.setPC_Up(fetch_.getPC_Up());
         decode_.setPC_R_F(fetch_.PC_R());
+        decode_.setPredictedTaken(fetch_.isPredictedTaken(Way::UP), Way::UP);
     }
     decode_.setInstr(fetch_.getInstr(Way::DOWN), Way::DOWN);
+    decode_.setPC_Down(fetch_.getPC_Down());
+    decode_.setPredictedTaken(fetch_.isPredictedTaken(Way::DOWN), Way::DOWN);
+    decode_.setV_F_Down(fetch_.V_F_Down());
     fetch_.applyPC();
     decode_.is_set = true;
 }
@@ -45,13 +217,16 @@ void Simulator::FDtransmitData() {
 void Simulator::DEtransmitData() {
     CYCLE_CONTROL(decode_.cycle, execute_.cycle)
     execute_.setV_EX(decode_.V_DE(Way::UP), decode_.V_DE(Way::DOWN));
+    execute_.setBubble(decode_.getBubble(Way::UP), decode_.getBubble(Way::DOWN));
     execute_.setD1_D2(decode_.getRD1(), decode_.getRD2());
     execute_.setD4_D5(decode_.getRD4(), decode_.getRD5());
     execute_.setInstr(decode_.getInstr(Way::UP), Way::UP);
     execute_.setInstr(decode_.getInstr(Way::DOWN), Way::DOWN);
     execute_.setPC_EX(decode_.getPC_Up());
+    execute_.setPC_EX_Down(decode_.getPC_Down());
     execute_.setControl_EX(decode_.getCUState(Way::UP), Way::UP);
     execute_.setControl_EX(decode_.getCUState(Way::DOWN), Way::DOWN);
+    execute_.setPredictedTaken(decode_.isPredictedTaken(Way::UP), decode_.isPredictedTaken(Way::DOWN));
     execute_.is_set = true;
 }
 
@@ -64,6 +239,9 @@ void Simulator::EMtransmitData() {
     memory_.setD5(execute_.RS5V());
     memory_.setALU_OUT(execute_.ALU_OUT(Way::UP), execute_.ALU_OUT(Way::DOWN));
     memory_.setWB_A(execute_.WB_A(Way::UP), execute_.WB_A(Way::DOWN));
+    memory_.setPC(execute_.PC_EX_Up(), execute_.PC_EX_Down());
+    memory_.setInstr(execute_.getInstr(Way::UP), Way::UP);
+    memory_.setInstr(execute_.getInstr(Way::DOWN), Way::DOWN);
     memory_.is_set = true;
 }
 
@@ -71,6 +249,12 @@ void Simulator::MWBtransmitData() {
     CYCLE_CONTROL(memory_.cycle, write_back_.cycle)
     write_back_.setWB_WE(memory_.WB_WE(Way::UP), memory_.WB_WE(Way::DOWN));
     write_back_.setEBREAK(memory_.EBREAK());
+    write_back_.setECALL(memory_.ECALL());
+    write_back_.setCSR(memory_.CSR());
+    write_back_.setInstr(memory_.getInstr(Way::UP), Way::UP);
+    write_back_.setInstr(memory_.getInstr(Way::DOWN), Way::DOWN);
+    write_back_.setBubble(memory_.getBubble(Way::UP), memory_.getBubble(Way::DOWN));
+    write_back_.setPC(memory_.getPC(Way::UP), memory_.getPC(Way::DOWN));
     write_back_.setWB_D(memory_.getOutData(Way::UP), memory_.getOutData(Way::DOWN));
     write_back_.setWB_A(memory_.WB_A(Way::UP), memory_.WB_A(Way::DOWN));
     write_back_.is_set = true;
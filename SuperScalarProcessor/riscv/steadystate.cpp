@@ -0,0 +1,355 @@
+#include "steadystate.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint8_t a0 = 10;  // ecall writes its result there, not to rd
+
+// Freeze moves write back ahead of memory stage and memory stage skips its transmit when it's exactly one cycle
+// ahead. Further ahead it never catches up, the difference doesn't matter anymore
+constexpr int64_t write_back_ahead = -8;
+
+}  // namespace
+
+SteadyStateRunner::SteadyStateRunner(Simulator &timing, FunctionalSimulator &functional) :
+        timing_(timing), functional_(functional) {
+    decoded_.resize(timing_.fetch_.getIMEM().size());
+    end_ = Decoded{RISCVInstr{std::bitset<32>{/* ebreak */ 0x100073}}};
+}
+
+SteadyStateRunner::Decoded::Decoded(const RISCVInstr &instr) :
+        imm(static_cast<uint32_t>(IMM{instr}.getImm().to_ulong())),
+        rd(static_cast<uint8_t>(instr.getRd().to_ulong())),
+        rs1(static_cast<uint8_t>(instr.getRs1().to_ulong())),
+        rs2(static_cast<uint8_t>(instr.getRs2().to_ulong())),
+        valid(true) {
+    ControlUnit cu;
+    cu.setState(instr);
+    flags = cu.flags;
+}
+
+const SteadyStateRunner::Decoded &SteadyStateRunner::Decode(uint32_t pc) {
+    const IMEM &imem = timing_.fetch_.getIMEM();
+    PC index{pc / 4};
+    if (pc % 4 != 0 || imem.isEndOfIMEM(index)) {
+        return end_;
+    }
+
+    Decoded &decoded = decoded_[index.val() - imem.getBase().val()];
+    if (!decoded.valid) {
+        decoded = Decoded{RISCVInstr{imem.getInstr(index)}};
+    }
+    return decoded;
+}
+
+const SteadyStateRunner::Record *SteadyStateRunner::Peek(size_t offset) {
+    while (window_.size() <= offset && functional_state_ == PipelineState::OK) {
+        const Decoded &decoded = Decode(functional_.getPC());
+        uint8_t reg = decoded.flags.ECALL ? a0 : decoded.rd;
+        Record record{{}, functional_.Reg(reg), reg};
+        functional_state_ = functional_.Step(record.instr);
+        if (functional_state_ == PipelineState::ERR) {
+            break;
+        }
+        window_.push_back(record);
+    }
+    return offset < window_.size() ? &window_[offset] : nullptr;
+}
+
+void SteadyStateRunner::Retire() {
+    ++retired_count_;
+    retired_[0] = retired_[1];
+    retired_[1] = window_.front();
+    window_.pop_front();
+}
+
+bool SteadyStateRunner::Next(DynInstr &instr) {
+    const Record *record = Peek(0);
+    if (record == nullptr) {
+        return false;
+    }
+
+    instr = record->instr;
+    if (!snapshots_.empty()) {
+        const ControlUnit::Flags &flags = Decode(instr.pc).flags;
+        if (path_.size() == max_period || flags.ECALL || flags.CSR || flags.EBREAK) {
+            Reset();
+        } else {
+            path_.push_back(instr.pc);
+        }
+    }
+    Retire();
+    return true;
+}
+
+const DynInstr *SteadyStateRunner::Ahead(size_t offset) {
+    const Record *record = Peek(offset);
+    return record != nullptr ? &record->instr : nullptr;
+}
+
+std::optional<uint32_t> SteadyStateRunner::BackwardBranch() {
+    const Memory &memory = timing_.memory_;
+    if (!memory.is_set) {
+        return std::nullopt;
+    }
+    for (Way way : {Way::UP, Way::DOWN}) {
+        uint32_t pc = memory.getPC(way).realVal();
+        const Decoded &decoded = Decode(pc);
+        if (memory.getBubble(way) == Bubble::NONE && (decoded.flags.BRANCH_COND || decoded.flags.JMP) &&
+            static_cast<int32_t>(decoded.imm) <= 0) {
+            return pc;
+        }
+    }
+    return std::nullopt;
+}
+
+void SteadyStateRunner::Save(Snapshot &snapshot, uint32_t pc) const {
+    snapshot.pc = pc;
+    snapshot.timing.clear();
+    timing_.fetch_.SaveTiming(snapshot.timing);
+    timing_.decode_.SaveTiming(snapshot.timing);
+    timing_.execute_.SaveTiming(snapshot.timing);
+    timing_.memory_.SaveTiming(snapshot.timing);
+    timing_.write_back_.SaveTiming(snapshot.timing);
+    timing_.hu_.SaveTiming(snapshot.timing);
+
+    // Each stage transmits once it's ahead of the next one
+    snapshot.cycles = {timing_.fetch_.cycle, timing_.decode_.cycle, timing_.execute_.cycle, timing_.memory_.cycle,
+                       timing_.write_back_.cycle};
+    for (size_t stage = 0; stage + 2 < snapshot.cycles.size(); ++stage) {
+        snapshot.timing.push_back(snapshot.cycles[stage] - snapshot.cycles[stage + 1]);
+    }
+    auto write_back = static_cast<int64_t>(snapshot.cycles[3] - snapshot.cycles[4]);
+    snapshot.timing.push_back(static_cast<uint64_t>(std::max(write_back, write_back_ahead)));
+
+    for (uint8_t bubble = 0; bubble < static_cast<uint8_t>(Bubble::COUNT); ++bubble) {
+        snapshot.slots[bubble] = timing_.cpi_.Slots(static_cast<Bubble>(bubble));
+    }
+    for (uint8_t event = 0; event < static_cast<uint8_t>(CSRUnit::Event::COUNT); ++event) {
+        snapshot.events[event] = timing_.csr_.Events(static_cast<CSRUnit::Event>(event));
+    }
+    snapshot.instret = timing_.csr_.Instret();
+    snapshot.retired = retired_count_;
+}
+
+bool SteadyStateRunner::isInFlightOnPath() {
+    // Results of the last retired instructions wait for write back
+    const WriteBack &write_back = timing_.write_back_;
+    size_t retired = retired_.size();
+    if (write_back.is_set) {
+        for (Way way : {Way::DOWN, Way::UP}) {
+            if (write_back.getBubble(way) == Bubble::NONE &&
+                (retired == 0 || retired_[--retired].instr.pc != write_back.getPC(way).realVal())) {
+                return false;
+            }
+        }
+    }
+
+    const Memory &memory = timing_.memory_;
+    size_t offset = 0;
+    if (memory.is_set) {
+        for (Way way : {Way::UP, Way::DOWN}) {
+            if (memory.getBubble(way) != Bubble::NONE) {
+                continue;
+            }
+            const Record *record = Peek(offset++);
+            if (record == nullptr || record->instr.pc != memory.getPC(way).realVal()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void SteadyStateRunner::Reset() {
+    snapshots_.clear();
+    path_.clear();
+}
+
+void SteadyStateRunner::Observe() {
+    std::optional<uint32_t> pc = BackwardBranch();
+    if (!pc) {
+        return;
+    }
+
+    // The shortest period is tried, the same state may repeat several times in the longer ones
+    Save(current_, *pc);
+    for (auto it = snapshots_.rbegin(); it != snapshots_.rend(); ++it) {
+        if (it->pc != current_.pc || it->timing != current_.timing) {
+            continue;
+        }
+        if (isInFlightOnPath() && Extrapolate(*it, current_)) {
+            // Counters have moved, the state is the same
+            Reset();
+            Save(current_, *pc);
+        }
+        break;
+    }
+
+    if (snapshots_.size() == max_snapshots) {
+        snapshots_.pop_front();
+        path_.erase(path_.begin(), path_.begin() + static_cast<ptrdiff_t>(snapshots_.front().retired -
+                                                                          (current_.retired - path_.size())));
+    }
+    snapshots_.push_back(std::move(current_));
+}
+
+bool SteadyStateRunner::Extrapolate(const Snapshot &from, const Snapshot &to) {
+    const auto period = static_cast<size_t>(to.retired - from.retired);
+    const uint32_t *path = path_.data() + (path_.size() - period);
+    Memory &memory = timing_.memory_;
+    DataCache &dcache = memory.getDCache();
+    uint32_t atomic_latency = memory.getAtomicUnit().Latency();
+    bool can_freeze = dcache.getConfig().miss_latency > 0 || dcache.getL2() != nullptr || atomic_latency > 0;
+    auto write_back = static_cast<int64_t>(memory.cycle - timing_.write_back_.cycle);
+    if (period == 0 || (can_freeze && write_back > write_back_ahead)) {
+        return false;
+    }
+
+    // Instructions in flight at the end of the skipped periods must be on the path too
+    auto is_on_path = [&]() {
+        for (size_t offset = 0; offset < period + lookahead; ++offset) {
+            const Record *record = Peek(offset);
+            if (record == nullptr || record->instr.pc != path[offset % period]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    uint64_t periods = 0;
+    uint64_t freeze_cycles = 0;
+    uint64_t atomic_cycles = 0;
+    while (is_on_path()) {
+        // Memory is accessed in program order as in the memory stage
+        for (size_t i = 0; i < period; ++i) {
+            const DynInstr &instr = window_.front().instr;
+            const ControlUnit::Flags &flags = Decode(instr.pc).flags;
+            if (flags.MEM_WE) {
+                dcache.Access(instr.addr, true);
+            }
+            if (flags.WS) {
+                if (!dcache.Access(instr.addr, flags.ATOMIC)) {
+                    timing_.csr_.Count(CSRUnit::Event::DCACHE_MISS);
+                    freeze_cycles += dcache.MissLatency();
+                }
+                atomic_cycles += flags.ATOMIC ? atomic_latency : 0;
+            }
+            Retire();
+        }
+        ++periods;
+    }
+    if (periods == 0) {
+        return false;
+    }
+
+    // Freezes of the last period are replaced by the ones of the skipped accesses
+    uint64_t start = timing_.write_back_.cycle;
+    std::array<Stage *, 5> stages{&timing_.fetch_, &timing_.decode_, &timing_.execute_, &timing_.memory_,
+                                  &timing_.write_back_};
+    for (size_t stage = 0; stage < stages.size(); ++stage) {
+        stages[stage]->cycle += periods * (to.cycles[stage] - from.cycles[stage]);
+    }
+    uint64_t period_freeze = (to.slots[static_cast<uint8_t>(Bubble::DCACHE_MISS)] -
+                              from.slots[static_cast<uint8_t>(Bubble::DCACHE_MISS)] +
+                              to.slots[static_cast<uint8_t>(Bubble::ATOMIC)] -
+                              from.slots[static_cast<uint8_t>(Bubble::ATOMIC)]) / CPIStack::issue_width;
+    timing_.write_back_.cycle += freeze_cycles + atomic_cycles - periods * period_freeze;
+
+    for (uint8_t bubble = 0; bubble < static_cast<uint8_t>(Bubble::COUNT); ++bubble) {
+        if (bubble != static_cast<uint8_t>(Bubble::DCACHE_MISS) && bubble != static_cast<uint8_t>(Bubble::ATOMIC)) {
+            timing_.cpi_.Account(static_cast<Bubble>(bubble), periods * (to.slots[bubble] - from.slots[bubble]));
+        }
+    }
+    timing_.cpi_.Account(Bubble::DCACHE_MISS, CPIStack::issue_width * freeze_cycles);
+    timing_.cpi_.Account(Bubble::ATOMIC, CPIStack::issue_width * atomic_cycles);
+    for (uint8_t event = 0; event < static_cast<uint8_t>(CSRUnit::Event::COUNT); ++event) {
+        if (event != static_cast<uint8_t>(CSRUnit::Event::DCACHE_MISS)) {
+            timing_.csr_.Count(static_cast<CSRUnit::Event>(event),
+                               periods * (to.events[event] - from.events[event]));
+        }
+    }
+    timing_.csr_.Retire(periods * (to.instret - from.instret));
+
+    ++loops_;
+    iterations_ += periods * static_cast<uint64_t>(std::count(path, path + period, to.pc));
+    cycles_ += timing_.write_back_.cycle - start;
+    Restore();
+    return true;
+}
+
+void SteadyStateRunner::Restore() {
+    // Registers before the instructions the functional simulator has executed ahead and the ones in write back
+    std::array<uint32_t, 32> regs{};
+    for (uint8_t idx = 0; idx < regs.size(); ++idx) {
+        regs[idx] = functional_.Reg(idx);
+    }
+    auto undo = [&regs](const Record &record) {
+        regs[record.reg] = record.prev;
+    };
+    for (auto it = window_.rbegin(); it != window_.rend(); ++it) {
+        undo(*it);
+    }
+
+    WriteBack &write_back = timing_.write_back_;
+    std::array<const Record *, 2> results{};
+    if (write_back.is_set) {
+        size_t retired = retired_.size();
+        for (Way way : {Way::DOWN, Way::UP}) {
+            if (write_back.getBubble(way) == Bubble::NONE) {
+                results[way == Way::UP ? 0 : 1] = &retired_[--retired];
+                undo(retired_[retired]);
+            }
+        }
+    }
+    for (uint8_t idx = 1; idx < regs.size(); ++idx) {
+        timing_.decode_.writeToRF(std::bitset<5>{idx}, std::bitset<32>{regs[idx]}, true);
+    }
+
+    // Results waiting for write back, then addresses of memory accesses and results of the others
+    std::array<std::bitset<32>, 2> wb_d{write_back.WB_D(Way::UP), write_back.WB_D(Way::DOWN)};
+    for (size_t way = 0; way < results.size(); ++way) {
+        if (results[way] != nullptr) {
+            wb_d[way] = results[way]->instr.value;
+        }
+    }
+    write_back.setWB_D(wb_d[0], wb_d[1]);
+
+    Memory &memory = timing_.memory_;
+    if (memory.is_set) {
+        std::array<std::bitset<32>, 2> alu_out{memory.ALU_OUT(Way::UP), memory.ALU_OUT(Way::DOWN)};
+        size_t offset = 0;
+        for (Way way : {Way::UP, Way::DOWN}) {
+            if (memory.getBubble(way) != Bubble::NONE) {
+                continue;
+            }
+            const Record &record = window_[offset++];
+            const Decoded &decoded = Decode(record.instr.pc);
+            bool is_access = decoded.flags.WS || decoded.flags.MEM_WE;
+            alu_out[way == Way::UP ? 0 : 1] = is_access ? record.instr.addr : record.instr.value;
+        }
+        memory.setALU_OUT(alu_out[0], alu_out[1]);
+    }
+}
+
+PipelineState SteadyStateRunner::Run() {
+    timing_.source_ = this;
+    PipelineState state;
+    while ((state = timing_.RunUntil(timing_.write_back_.cycle + 1)) == PipelineState::STALL) {
+        Observe();
+    }
+    timing_.source_ = nullptr;
+    return functional_state_ == PipelineState::ERR ? PipelineState::ERR : state;
+}
+
+uint64_t SteadyStateRunner::Loops() const noexcept {
+    return loops_;
+}
+
+uint64_t SteadyStateRunner::Iterations() const noexcept {
+    return iterations_;
+}
+
+uint64_t SteadyStateRunner::Cycles() const noexcept {
+    return cycles_;
+}
@@ -0,0 +1,497 @@
+#include "tracefile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+
+#include "lz_codec.h"
+
+std::unique_ptr<TraceWriter> TraceWriter::Open(const std::string &path, uint32_t block_size) {
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "Can't create trace: " << path << std::endl;
+        return nullptr;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.block_size = std::clamp(block_size, 1u, max_block_size);
+    std::unique_ptr<TraceWriter> writer{new TraceWriter{file, header.block_size}};
+    writer->Put(&header, sizeof(header));
+    return writer;
+}
+
+TraceWriter::TraceWriter(FILE *file, uint32_t block_size) : file_(file, &std::fclose), block_size_(block_size) {
+    block_.reserve(block_size_);
+    records_.emplace([this](const std::vector<DynInstr> &records) {
+        for (const auto &record : records) {
+            block_.push_back(record);
+            if (block_.size() == block_size_) {
+                WriteBlock();
+            }
+        }
+    });
+}
+
+TraceWriter::~TraceWriter() {
+    if (file_ != nullptr) {
+        Close();
+    }
+}
+
+bool TraceWriter::Close() {
+    // Background thread has written all the full blocks when it's joined
+    records_.reset();
+    if (!block_.empty()) {
+        WriteBlock();
+    }
+
+    Footer footer{offset_, written_, index_.size(), {}};
+    std::memcpy(footer.magic, magic, sizeof(magic));
+    Put(index_.data(), sizeof(IndexEntry) * index_.size());
+    Put(&footer, sizeof(footer));
+    failed_ = std::fflush(file_.get()) != 0 || failed_;
+    failed_ = std::fclose(file_.release()) != 0 || failed_;
+    if (failed_) {
+        std::cerr << "Failed to write the trace" << std::endl;
+    }
+    return !failed_;
+}
+
+void TraceWriter::Put(const void *data, size_t size) {
+    if (!failed_ && size > 0) {
+        failed_ = std::fwrite(data, 1, size, file_.get()) != size;
+    }
+}
+
+void TraceWriter::Write(const DynInstr &instr) {
+    records_->Push(instr);
+    ++count_;
+}
+
+uint64_t TraceWriter::Records() const noexcept {
+    return count_;
+}
+
+PipelineState RecordTrace(FunctionalSimulator &functional, TraceWriter &writer) {
+    DynInstr instr;
+    PipelineState state;
+    while ((state = functional.Step(instr)) != PipelineState::ERR) {
+        writer.Write(instr);
+        if (state == PipelineState::BREAK) {
+            return writer.Close() ? PipelineState::OK : PipelineState::ERR;
+        }
+    }
+    return state;
+}
+
+namespace {
+
+void PutVarint(std::vector<uint8_t> &out, uint32_t value) {
+    for (; value >= 0x80; value >>= 7) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool GetVarint(const uint8_t *&pos, const uint8_t *end, uint32_t &value) noexcept {
+    value = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7) {
+        if (pos == end) {
+            return false;
+        }
+        uint8_t byte = *pos++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Small negative deltas are small numbers too
+uint32_t ZigZag(uint32_t delta) noexcept {
+    return (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+}
+
+uint32_t UnZigZag(uint32_t value) noexcept {
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+// Loads, stores and atomics have an address
+bool HasAddress(uint32_t instr) noexcept {
+    uint32_t opcode = instr & 0x7f;
+    return opcode == 0x03 || opcode == 0x23 || opcode == 0x2f;
+}
+
+}  // namespace
+
+void TraceWriter::WriteBlock() {
+    std::vector<uint8_t> raw;
+    raw.reserve(block_.size() * 6);
+
+    std::unordered_map<uint32_t, uint32_t> codes;
+    std::vector<uint32_t> words;
+    for (const auto &record : block_) {
+        if (codes.emplace(record.instr, static_cast<uint32_t>(words.size())).second) {
+            words.push_back(record.instr);
+        }
+    }
+    PutVarint(raw, static_cast<uint32_t>(words.size()));
+    for (uint32_t word : words) {
+        PutVarint(raw, word);
+    }
+
+    for (const auto &record : block_) {
+        PutVarint(raw, codes[record.instr]);
+    }
+    uint32_t expected_pc = block_.front().pc;
+    for (const auto &record : block_) {
+        PutVarint(raw, ZigZag(record.pc - expected_pc));
+        PutVarint(raw, ZigZag(record.next_pc - record.pc - 4));
+        expected_pc = record.next_pc;
+    }
+    uint32_t last_addr = 0;
+    for (const auto &record : block_) {
+        if (HasAddress(record.instr)) {
+            PutVarint(raw, ZigZag(record.addr - last_addr));
+            last_addr = record.addr;
+        }
+    }
+    for (const auto &record : block_) {
+        PutVarint(raw, ZigZag(record.value));
+    }
+
+    std::vector<uint8_t> compressed = LZCodec::Compress(raw.data(), raw.size());
+    bool stored_raw = compressed.size() >= raw.size();
+    const std::vector<uint8_t> &stored = stored_raw ? raw : compressed;
+    BlockHeader header{static_cast<uint32_t>(block_.size()), block_.front().pc, static_cast<uint32_t>(raw.size()),
+                       static_cast<uint32_t>(stored.size())};
+    Put(&header, sizeof(header));
+    Put(stored.data(), stored.size());
+
+    index_.push_back({written_, offset_});
+    offset_ += sizeof(header) + stored.size();
+    written_ += block_.size();
+    block_.clear();
+}
+
+namespace {
+
+const char *SkipSpaces(const char *pos, const char *end) noexcept {
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) {
+        ++pos;
+    }
+    return pos;
+}
+
+// Spike prints registers of RV64 in 64 bits, only the low word is kept
+bool ParseHex(const char *&pos, const char *end, uint32_t &value) noexcept {
+    if (end - pos < 2 || pos[0] != '0' || pos[1] != 'x') {
+        return false;
+    }
+    uint64_t parsed{0};
+    auto [ptr, ec] = std::from_chars(pos + 2, end, parsed, 16);
+    if (ec != std::errc{}) {
+        return false;
+    }
+    pos = ptr;
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+}  // namespace
+
+std::unique_ptr<TraceReader> TraceReader::Open(const std::string &path) {
+    auto file = MappedFile::Open(path);
+    if (file == nullptr) {
+        std::cerr << "Can't map trace: " << path << std::endl;
+        return nullptr;
+    }
+    file->AdviseSequential();
+    return Open(std::move(file));
+}
+
+std::unique_ptr<TraceReader> TraceReader::Open(std::shared_ptr<const MappedFile> file) {
+    TraceWriter::Header header{};
+    if (file->size() < sizeof(header) || std::memcmp(file->data(), TraceWriter::magic, sizeof(header.magic)) != 0) {
+        return std::unique_ptr<TraceReader>{new TraceReader{std::move(file), Format::COMMIT_LOG}};
+    }
+
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.version != TraceWriter::version) {
+        std::cerr << "Unsupported trace version " << header.version << std::endl;
+        return nullptr;
+    }
+    if (header.block_size == 0 || header.block_size > TraceWriter::max_block_size) {
+        std::cerr << "Corrupted trace header" << std::endl;
+        return nullptr;
+    }
+    std::unique_ptr<TraceReader> reader{new TraceReader{std::move(file), Format::BINARY}};
+    reader->block_size_ = header.block_size;
+    if (!reader->LoadIndex()) {
+        std::cerr << "Corrupted trace index" << std::endl;
+        return nullptr;
+    }
+    return reader;
+}
+
+TraceReader::TraceReader(std::shared_ptr<const MappedFile> file, Format format) :
+        file_(std::move(file)), format_(format), pos_(reinterpret_cast<const char *>(file_->data())),
+        end_(reinterpret_cast<const char *>(file_->data()) + file_->size()) {
+    if (format_ == Format::COMMIT_LOG) {
+        has_pending_ = ParseCommit(pending_);
+    }
+}
+
+bool TraceReader::LoadIndex() {
+    const uint8_t *data = file_->data();
+    size_t size = file_->size();
+    TraceWriter::Footer footer{};
+    if (size >= sizeof(TraceWriter::Header) + sizeof(footer)) {
+        std::memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+    }
+    bool has_footer = std::memcmp(footer.magic, TraceWriter::magic, sizeof(footer.magic)) == 0 &&
+                      footer.index_offset <= size - sizeof(footer) &&
+                      footer.blocks <= size / sizeof(TraceWriter::IndexEntry) &&
+                      (size - sizeof(footer) - footer.index_offset) == footer.blocks * sizeof(TraceWriter::IndexEntry);
+    if (has_footer) {
+        index_.resize(footer.blocks);
+        std::memcpy(index_.data(), data + footer.index_offset, footer.blocks * sizeof(TraceWriter::IndexEntry));
+        size_ = footer.records;
+        return std::all_of(index_.begin(), index_.end(), [&](const auto &entry) {
+            return entry.first_record < size_ && entry.offset + sizeof(TraceWriter::BlockHeader) <= size;
+        });
+    }
+
+    // Writer was killed, only its complete blocks are there
+    uint64_t offset = sizeof(TraceWriter::Header);
+    TraceWriter::BlockHeader header{};
+    while (offset + sizeof(header) <= size) {
+        std::memcpy(&header, data + offset, sizeof(header));
+        if (!isValid(header) || header.stored_size > size - offset - sizeof(header)) {
+            break;
+        }
+        index_.push_back({size_, offset});
+        size_ += header.records;
+        offset += sizeof(header) + header.stored_size;
+    }
+    return true;
+}
+
+bool TraceReader::isValid(const TraceWriter::BlockHeader &header) const noexcept {
+    // Each record has at least one byte in four columns: instruction, pc, next pc and value. At most it has a word
+    // of the dictionary and all the six columns, five bytes each. Compressed block is smaller than the raw one
+    constexpr uint64_t min_record_size = 4;
+    constexpr uint64_t max_record_size = 30;
+    constexpr uint64_t max_varint_size = 5;
+    uint64_t records = header.records;
+    return records > 0 && records <= block_size_ && header.stored_size <= header.raw_size &&
+           header.raw_size >= 1 + min_record_size * records &&
+           header.raw_size <= max_varint_size + max_record_size * records;
+}
+
+bool TraceReader::DecodeBlock(size_t block) {
+    TraceWriter::BlockHeader header{};
+    const uint8_t *data = file_->data() + index_[block].offset;
+    std::memcpy(&header, data, sizeof(header));
+    data += sizeof(header);
+    if (!isValid(header) || index_[block].offset + sizeof(header) + header.stored_size > file_->size()) {
+        return false;
+    }
+    if (header.stored_size == header.raw_size) {
+        raw_.assign(data, data + header.raw_size);
+    } else {
+        raw_.resize(header.raw_size);
+        if (!LZCodec::Decompress(data, header.stored_size, raw_.data(), raw_.size())) {
+            return false;
+        }
+    }
+
+    // Columns follow each other, each of them has a value per record
+    const uint8_t *pos = raw_.data();
+    const uint8_t *end = pos + raw_.size();
+    uint32_t words{0};
+    if (!GetVarint(pos, end, words) || words > header.records) {
+        return false;
+    }
+    std::vector<uint32_t> dictionary(words);
+    for (uint32_t &word : dictionary) {
+        if (!GetVarint(pos, end, word)) {
+            return false;
+        }
+    }
+
+    block_.resize(header.records);
+    uint32_t value{0};
+    for (DynInstr &record : block_) {
+        if (!GetVarint(pos, end, value) || value >= words) {
+            return false;
+        }
+        record = DynInstr{0, dictionary[value], 0, 0, 0};
+    }
+    uint32_t expected_pc = header.first_pc;
+    for (DynInstr &record : block_) {
+        uint32_t next{0};
+        if (!GetVarint(pos, end, value) || !GetVarint(pos, end, next)) {
+            return false;
+        }
+        record.pc = expected_pc + UnZigZag(value);
+        record.next_pc = record.pc + 4 + UnZigZag(next);
+        expected_pc = record.next_pc;
+    }
+    uint32_t last_addr = 0;
+    for (DynInstr &record : block_) {
+        if (HasAddress(record.instr)) {
+            if (!GetVarint(pos, end, value)) {
+                return false;
+            }
+            record.addr = last_addr + UnZigZag(value);
+            last_addr = record.addr;
+        }
+    }
+    for (DynInstr &record : block_) {
+        if (!GetVarint(pos, end, value)) {
+            return false;
+        }
+        record.value = UnZigZag(value);
+    }
+    return pos == end;
+}
+
+bool TraceReader::Read(DynInstr &instr) {
+    if (format_ == Format::BINARY) {
+        while (block_pos_ == block_.size()) {
+            if (next_block_ == index_.size()) {
+                return false;
+            }
+            block_pos_ = 0;
+            if (!DecodeBlock(next_block_++)) {
+                std::cerr << "Corrupted trace block " << next_block_ - 1 << std::endl;
+                block_.clear();
+                next_block_ = index_.size();
+                return false;
+            }
+        }
+        instr = block_[block_pos_++];
+        ++records_;
+        return true;
+    }
+
+    if (!has_pending_) {
+        return false;
+    }
+    instr = pending_;
+    has_pending_ = ParseCommit(pending_);
+    if (has_pending_) {
+        instr.next_pc = pending_.pc;
+    }
+    ++records_;
+    return true;
+}
+
+bool TraceReader::ParseCommit(DynInstr &instr) {
+    while (pos_ < end_) {
+        const char *pos = pos_;
+        const auto *line_end = static_cast<const char *>(std::memchr(pos_, '\n', end_ - pos_));
+        const char *end = line_end != nullptr ? line_end : end_;
+        pos_ = line_end != nullptr ? line_end + 1 : end_;
+
+        // core   0: 3 0x00000000 (0xfe010113) x2  0xffffffe0
+        const auto *colon = static_cast<const char *>(std::memchr(pos, ':', end - pos));
+        if (end - pos < 4 || std::memcmp(pos, "core", 4) != 0 || colon == nullptr) {
+            continue;
+        }
+        pos = SkipSpaces(colon + 1, end);
+        uint32_t privilege{0};
+        auto [ptr, ec] = std::from_chars(pos, end, privilege);
+        // Disassembly line has pc right after the core
+        if (ec != std::errc{} || ptr == end || *ptr != ' ') {
+            continue;
+        }
+
+        pos = SkipSpaces(ptr, end);
+        uint32_t pc{0};
+        uint32_t word{0};
+        if (!ParseHex(pos, end, pc)) {
+            continue;
+        }
+        pos = SkipSpaces(pos, end);
+        if (pos == end || *pos++ != '(' || !ParseHex(pos, end, word) || pos == end || *pos++ != ')') {
+            continue;
+        }
+
+        instr = DynInstr{pc, word, pc + 4, 0, 0};
+        bool written = false;
+        uint32_t store_data{0};
+        while ((pos = SkipSpaces(pos, end)) < end) {
+            const char *name = pos;
+            while (pos < end && *pos != ' ') {
+                ++pos;
+            }
+            std::string_view field{name, static_cast<size_t>(pos - name)};
+            pos = SkipSpaces(pos, end);
+            uint32_t value{0};
+            if (field == "mem") {
+                // Load address, or store address and data
+                ParseHex(pos, end, instr.addr);
+                pos = SkipSpaces(pos, end);
+                ParseHex(pos, end, store_data);
+            } else if (ParseHex(pos, end, value) && field.size() > 1 && field[0] == 'x') {
+                instr.value = value;
+                written = true;
+            }
+        }
+        // Atomics both load and store, rd gets the loaded value
+        if (!written) {
+            instr.value = store_data;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool TraceReader::Seek(uint64_t record) {
+    if (format_ != Format::BINARY || record > size_) {
+        return false;
+    }
+    DropAhead();
+    block_.clear();
+    block_pos_ = 0;
+    next_block_ = index_.size();
+    if (record == size_) {
+        return true;
+    }
+
+    auto it = std::upper_bound(index_.begin(), index_.end(), record,
+                               [](uint64_t value, const auto &entry) { return value < entry.first_record; });
+    size_t block = static_cast<size_t>(it - index_.begin()) - 1;
+    if (!DecodeBlock(block)) {
+        std::cerr << "Corrupted trace block " << block << std::endl;
+        block_.clear();
+        return false;
+    }
+    block_pos_ = static_cast<size_t>(record - index_[block].first_record);
+    next_block_ = block + 1;
+    return true;
+}
+
+TraceReader::Format TraceReader::getFormat() const noexcept {
+    return format_;
+}
+
+uint64_t TraceReader::Records() const noexcept {
+    return records_;
+}
+
+uint64_t TraceReader::Size() const noexcept {
+    return size_;
+}
+
+size_t TraceReader::Blocks() const noexcept {
+    return index_.size();
+}
@@ -1,5 +1,6 @@
 #include "Decode.h"
 #include "simulator.h"
+#include "logger.h"
 
 PipelineState Decode::Run(Simulator &cpu) {
     if (!is_set) {
@@ -12,17 +13,33 @@ PipelineState Decode::Run(Simulator &cpu) {
     D2 = reg_file_.Read(instrUp_.getRs2());
 
     v_de_up_ = !(pc_f_ || pc_r_ || cpu.hu_.pl_state == PipelineState::STALL);
+    bubble_up_ = BubbleCause(cpu);
 
     cu_down_.setState(instrDown_);
+    // Ebreak, ecall and csr access are issued alone, so nothing after them reaches memory stage.
+    // Atomics are performed only by the upper way
+    bool is_serializing = v_de_up_ && (cu_up_.flags.ECALL || cu_up_.flags.EBREAK || cu_up_.flags.CSR ||
+                                       cu_down_.flags.EBREAK || cu_down_.flags.CSR || cu_down_.flags.ATOMIC);
     cpu.hu_.CheckWaysDataDepends(instrUp_.getRd(), cu_up_.flags.WB_WE && v_de_up_,
-                                 instrDown_.getRs1(), instrDown_.getRs2(), cu_down_.flags.EBREAK);
+                                 instrDown_.getRs1(), instrDown_.getRs2(), !v_f_down_, is_serializing, v_de_up_);
     bool is_stall_down = cpu.hu_.pl_state == PipelineState::STALL_DOWN;
+    if (is_stall_down) {
+        cpu.csr_.Count(CSRUnit::Event::SPLIT_ISSUE);
+    }
 
     // For down instruction
     D4 = reg_file_.Read(instrDown_.getRs1());
     D5 = reg_file_.Read(instrDown_.getRs2());
 
-    v_de_down_ = !(pc_f_ || pc_r_ || cpu.hu_.pl_state == PipelineState::STALL || is_stall_down || cu_down_.flags.EBREAK);
+    v_de_down_ = !(pc_f_ || pc_r_ || cpu.hu_.pl_state == PipelineState::STALL || is_stall_down ||
+                   cu_down_.flags.EBREAK || !v_f_down_);
+    bubble_down_ = bubble_up_;
+    if (bubble_down_ == Bubble::NONE && !v_de_down_) {
+        bubble_down_ = is_stall_down ? cpu.hu_.SplitCause() : !v_f_down_ ? Bubble::FRONTEND : Bubble::SERIALIZE;
+    }
+
+    LOG(L1, DECODE, cpu.fetch_.cycle, "{i} v={} | {i} v={}", instrUp_.getInstr().to_ulong(), v_de_up_,
+        instrDown_.getInstr().to_ulong(), v_de_down_);
 
     cpu.DEtransmitData();
 
@@ -40,7 +57,20 @@ void Decode::ShiftData() {
     D1 = D4;
     D2 = D5;
     v_de_up_ = true;
-    pc_up_ += 4;
+    bubble_up_ = Bubble::NONE;
+    pc_up_ = pc_down_;
+    pred_up_ = pred_down_;
+}
+
+Bubble Decode::BubbleCause(const Simulator &cpu) const noexcept {
+    if (pc_f_ || pc_r_) {
+        return Bubble::REDIRECT;
+    }
+    return cpu.hu_.pl_state == PipelineState::STALL ? cpu.hu_.StallCause() : Bubble::NONE;
+}
+
+Bubble Decode::getBubble(Way way) const noexcept {
+    return way == Way::UP ? bubble_up_ : bubble_down_;
 }
 
 ControlUnit::Flags Decode::getCUState(Way way) const noexcept {
@@ -83,6 +113,14 @@ PC Decode::getPC_Up() const noexcept {
     return pc_up_;
 }
 
+PC Decode::getPC_Down() const noexcept {
+    return pc_down_;
+}
+
+bool Decode::isPredictedTaken(Way way) const noexcept {
+    return way == Way::UP ? pred_up_ : pred_down_;
+}
+
 RISCVInstr Decode::getInstr(Way way) const noexcept {
     return way == Way::UP ? instrUp_ : instrDown_;
 }
@@ -103,6 +141,22 @@ void Decode::setPC_Up(const PC &pc) {
     pc_up_ = pc;
 }
 
+void Decode::setPC_Down(const PC &pc) {
+    pc_down_ = pc;
+}
+
+void Decode::setPredictedTaken(bool pred, Way way) {
+    if (way == Way::UP) {
+        pred_up_ = pred;
+    } else {
+        pred_down_ = pred;
+    }
+}
+
+void Decode::setV_F_Down(bool v_f_down) {
+    v_f_down_ = v_f_down;
+}
+
 void Decode::setPC_R_F(bool pc_f) {
     pc_f_ = pc_f;
 }
@@ -111,6 +165,13 @@ void Decode::setPC_R(bool pc_r) {
     pc_r_ = pc_r;
 }
 
+void Decode::SaveTiming(std::vector<uint64_t> &state) const {
+    state.insert(state.end(), {is_set, pc_f_, pc_r_, v_f_down_, instrUp_.getInstr().to_ulong(),
+                               instrDown_.getInstr().to_ulong(), v_de_up_, v_de_down_,
+                               static_cast<uint64_t>(bubble_up_), static_cast<uint64_t>(bubble_down_), pc_up_.val(),
+                               pc_down_.val(), pred_up_, pred_down_});
+}
+
 const RegisterFile &Decode::getRegFile() const noexcept {
     return reg_file_;
 }
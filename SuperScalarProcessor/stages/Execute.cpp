@@ -1,5 +1,6 @@
 #include "Execute.h"
 #include "simulator.h"
+#include "logger.h"
 
 PipelineState Execute::Run(Simulator &cpu) {
     if (!is_set) {
@@ -7,24 +8,21 @@ PipelineState Execute::Run(Simulator &cpu) {
     }
 
     wb_a_up_ = instrUp_.getRd();
-    // Can't write to x0 reg
-    if ((CONTROL_EX_Up_.JMP || CONTROL_EX_Up_.JALR) && wb_a_up_ == 0) {
+    // Can't write to x0 reg, e.g. j or amoadd.w with discarded result
+    if (wb_a_up_ == 0) {
         CONTROL_EX_Up_.WB_WE = false;
     }
 
     wb_a_down_ = instrDown_.getRd();
     // Can't write to x0 reg
-    if ((CONTROL_EX_Down_.JMP || CONTROL_EX_Down_.JALR) && wb_a_down_ == 0) {
+    if (wb_a_down_ == 0) {
         CONTROL_EX_Down_.WB_WE = false;
     }
 
-    we_gen_up_ = WE_GEN{CONTROL_EX_Up_.MEM_WE, CONTROL_EX_Up_.WB_WE, CONTROL_EX_Up_.EBREAK, v_ex_up_};
-    we_gen_down_ = WE_GEN{CONTROL_EX_Down_.MEM_WE, CONTROL_EX_Down_.WB_WE, CONTROL_EX_Down_.EBREAK, v_ex_down_};
-
-    immUp_ = IMM{instrUp_, CONTROL_EX_Up_.JALR};
-    immDown_ = IMM{instrDown_, CONTROL_EX_Down_.JALR};
-    PC_DISP_Up_ = PC{immUp_.getImm()};
-    PC_DISP_Down_ = PC{immDown_.getImm()};
+    we_gen_up_ = WE_GEN{CONTROL_EX_Up_.MEM_WE, CONTROL_EX_Up_.WB_WE, CONTROL_EX_Up_.EBREAK,
+                        CONTROL_EX_Up_.ECALL, CONTROL_EX_Up_.CSR, v_ex_up_, bubble_up_};
+    we_gen_down_ = WE_GEN{CONTROL_EX_Down_.MEM_WE, CONTROL_EX_Down_.WB_WE, CONTROL_EX_Down_.EBREAK,
+                          CONTROL_EX_Down_.ECALL, CONTROL_EX_Down_.CSR, v_ex_down_, bubble_down_};
 
     cpu.hu_.setA1_A2_EX(instrUp_.getRs1(), instrUp_.getRs2());
     auto RS1V = ChooseRS(cpu.hu_.HU_RS1(), cpu);
@@ -32,82 +30,136 @@ PipelineState Execute::Run(Simulator &cpu) {
     cpu.hu_.setA4_A5_EX(instrDown_.getRs1(), instrDown_.getRs2());
     auto RS4V = ChooseRS(cpu.hu_.HU_RS4(), cpu);
     auto RS5V = ChooseRS(cpu.hu_.HU_RS5(), cpu);
-    cpu.fetch_.setD1(RS1V);
-    cpu.fetch_.setD4(RS4V);
     rs2v_ = RS2V;
     rs5v_ = RS5V;
 
-    std::bitset<32> alu_src1 = ChooseALU_SRC1(RS1V);
-    std::bitset<32> alu_src2 = ChooseALU_SRC2(RS2V);
-    alu_out_up_ = ALU::calc(alu_src1, alu_src2, CONTROL_EX_Up_.ALU_OP);
-
-    std::bitset<32> alu_src4 = ChooseALU_SRC4(RS4V);
-    std::bitset<32> alu_src5 = ChooseALU_SRC5(RS5V);
-    alu_out_down_ = ALU::calc(alu_src4, alu_src5, CONTROL_EX_Down_.ALU_OP);
-
-    bool compUp = CMP::calc(RS1V, RS2V, CONTROL_EX_Up_.CMP_OP);
-    bool compDown = CMP::calc(RS4V, RS5V, CONTROL_EX_Down_.CMP_OP);
-
-    PC_R_ = ((compUp && CONTROL_EX_Up_.BRANCH_COND) || CONTROL_EX_Up_.JMP || CONTROL_EX_Up_.JALR) && v_ex_up_;
-
-    ProcessPrediction(cpu, Way::UP, compUp, compDown);
-
-    if (PC_R_) {
-        we_gen_down_.Invalidate();
-        v_ex_down_ = false;
-        cpu.fetch_.setPC_EX(PC_EX_Up_);
-        cpu.fetch_.setPC_DISP(PC_DISP_Up_);
-        cpu.fetch_.setJALR(CONTROL_EX_Up_.JALR, Way::UP);
-    } else if (!restoreUp_) {
-        PC_R_ = ((compDown && CONTROL_EX_Down_.BRANCH_COND) || CONTROL_EX_Down_.JMP || CONTROL_EX_Down_.JALR) && v_ex_down_;
-        cpu.fetch_.setPC_EX(PC_EX_Up_ + 4);
-        cpu.fetch_.setPC_DISP(PC_DISP_Down_);
-        cpu.fetch_.setJALR(CONTROL_EX_Up_.JALR, Way::DOWN);
+    PC_R_ = false;
+    if (cpu.source_ != nullptr) {
+        PipelineState state = Replay(cpu);
+        if (state != PipelineState::OK) {
+            return state;
+        }
+    } else {
+        immUp_ = IMM{instrUp_, CONTROL_EX_Up_.JALR};
+        immDown_ = IMM{instrDown_, CONTROL_EX_Down_.JALR};
+        PC_DISP_Up_ = PC{immUp_.getImm()};
+        PC_DISP_Down_ = PC{immDown_.getImm()};
+        cpu.fetch_.setD1(JALRTarget(RS1V, instrUp_));
+        cpu.fetch_.setD4(JALRTarget(RS4V, instrDown_));
+
+        std::bitset<32> alu_src1 = ChooseALU_SRC1(RS1V);
+        std::bitset<32> alu_src2 = ChooseALU_SRC2(RS2V);
+        alu_out_up_ = ALU::calc(alu_src1, alu_src2, CONTROL_EX_Up_.ALU_OP);
+
+        std::bitset<32> alu_src4 = ChooseALU_SRC4(RS4V);
+        std::bitset<32> alu_src5 = ChooseALU_SRC5(RS5V);
+        alu_out_down_ = ALU::calc(alu_src4, alu_src5, CONTROL_EX_Down_.ALU_OP);
+
+        bool compUp = CMP::calc(RS1V, RS2V, CONTROL_EX_Up_.CMP_OP);
+        bool compDown = CMP::calc(RS4V, RS5V, CONTROL_EX_Down_.CMP_OP);
+
+        if (ResolveControl(cpu, Way::UP, compUp)) {
+            // Down instruction is on the wrong path
+            we_gen_down_.Invalidate(Bubble::REDIRECT);
+            v_ex_down_ = false;
+        } else {
+            ResolveControl(cpu, Way::DOWN, compDown);
+        }
     }
 
     cpu.hu_.setHU_PC_REDIECT(PC_R_);
-
-    ProcessPrediction(cpu, Way::DOWN, compUp, compDown);
-
     cpu.decode_.setPC_R(PC_R_);
     cpu.fetch_.setPC_R(PC_R_);
 
     cpu.hu_.CheckForStall(cpu);
 
+    LOG(L1, EXECUTE, cpu.fetch_.cycle, "alu {x} v={} | alu {x} v={}", alu_out_up_.to_ulong(), we_gen_up_.isValid(),
+        alu_out_down_.to_ulong(), we_gen_down_.isValid());
+
     cpu.EMtransmitData();
 
     is_set = false;
     return PipelineState::OK;
 }
 
-void Execute::ProcessPrediction(Simulator &cpu, Way way, bool compUp, bool compDown) noexcept {
-    bool is_control_instr = way == Way::UP ? v_ex_up_ && (CONTROL_EX_Up_.BRANCH_COND || CONTROL_EX_Up_.JMP) :
-                                             v_ex_down_ && (CONTROL_EX_Down_.BRANCH_COND || CONTROL_EX_Down_.JMP);
+PipelineState Execute::Replay(Simulator &cpu) {
+    // Memory stage has retired its instructions earlier in the cycle, the ones here are the next in program order
+    size_t offset = 0;
+    for (Way way : {Way::UP, Way::DOWN}) {
+        if (!(way == Way::UP ? we_gen_up_ : we_gen_down_).isValid()) {
+            continue;
+        }
+        // Instructions past the end of the stream end the run when they reach memory stage
+        const DynInstr *instr = cpu.source_->Ahead(offset++);
+        if (instr == nullptr) {
+            break;
+        }
+        uint32_t pc = (way == Way::UP ? PC_EX_Up_ : PC_EX_Down_).realVal();
+        if (instr->pc != pc) {
+            std::cerr << "Replayed instructions diverge from the pipeline at pc 0x" << std::hex << pc
+                      << ", expected 0x" << instr->pc << std::dec << std::endl;
+            return PipelineState::ERR;
+        }
 
-    if (is_control_instr) {
-        bool is_taken;
-        if (way == Way::UP) {
-            is_taken = cpu.hu_.getPredicton(PC_EX_Up_);
-            restoreUp_ = is_taken && !PC_R_;
-        } else {
-            is_taken = cpu.hu_.getPredicton(PC_EX_Up_ + 4);
-            restoreDown_ = is_taken && !PC_R_;
+        const auto &flags = way == Way::UP ? CONTROL_EX_Up_ : CONTROL_EX_Down_;
+        const RISCVInstr &instr_ex = way == Way::UP ? instrUp_ : instrDown_;
+        // Branch to the next instruction trains the predictor as not taken, the path is the same
+        bool is_taken = instr->next_pc != pc + 4;
+        (way == Way::UP ? alu_out_up_ : alu_out_down_) = flags.WS || flags.MEM_WE ? instr->addr : instr->value;
+        // Predictor keeps the target of not taken branch too
+        (way == Way::UP ? PC_DISP_Up_ : PC_DISP_Down_) =
+                is_taken || !flags.BRANCH_COND ? PC{instr->next_pc - pc} : PC{IMM{instr_ex}.getImm()};
+        if (flags.JALR && way == Way::UP) {
+            cpu.fetch_.setD1(instr->next_pc);
+        } else if (flags.JALR) {
+            cpu.fetch_.setD4(instr->next_pc);
         }
 
-        if (is_taken && PC_R_) {
-            PC_R_ = false;
+        if (ResolveControl(cpu, way, is_taken)) {
+            if (way == Way::UP) {
+                we_gen_down_.Invalidate(Bubble::REDIRECT);
+                v_ex_down_ = false;
+            }
+            break;
         }
     }
+    return PipelineState::OK;
+}
 
-    if (CONTROL_EX_Up_.BRANCH_COND && v_ex_up_ && way == Way::UP) {
-        cpu.hu_.setBranchPrediction(PC_EX_Up_, PC_DISP_Up_, compUp);
-    } else if (CONTROL_EX_Up_.JMP && v_ex_up_ && way == Way::UP) {
-        cpu.hu_.setBranchPrediction(PC_EX_Up_, PC_DISP_Up_, true);
-    } else if (CONTROL_EX_Down_.BRANCH_COND && v_ex_down_ && way == Way::DOWN) {
-        cpu.hu_.setBranchPrediction(PC_EX_Up_ + 4, PC_DISP_Down_, compDown);
-    } else if (CONTROL_EX_Down_.JMP && v_ex_down_ && way == Way::DOWN) {
-        cpu.hu_.setBranchPrediction(PC_EX_Up_ + 4, PC_DISP_Down_, true);
+bool Execute::ResolveControl(Simulator &cpu, Way way, bool comp) noexcept {
+    const auto &flags = way == Way::UP ? CONTROL_EX_Up_ : CONTROL_EX_Down_;
+    bool valid = way == Way::UP ? v_ex_up_ : v_ex_down_;
+    bool predicted = way == Way::UP ? pred_up_ : pred_down_;
+    bool is_control_instr = flags.BRANCH_COND || flags.JMP || flags.JALR;
+    if (!valid || (!is_control_instr && !predicted)) {
+        return false;
     }
+
+    PC pc = way == Way::UP ? PC_EX_Up_ : PC_EX_Down_;
+    PC pc_disp = PC_DISP(way);
+    bool is_taken = (comp && flags.BRANCH_COND) || flags.JMP || flags.JALR;
+    if (flags.BRANCH_COND || flags.JMP) {
+        cpu.hu_.setBranchPrediction(pc, pc_disp, is_taken);
+    }
+
+    // Jalr target is never predicted, other instructions redirect only on misprediction
+    if (!flags.JALR && is_taken == predicted) {
+        return false;
+    }
+
+    PC_R_ = true;
+    cpu.csr_.Count(CSRUnit::Event::MISPREDICT);
+    cpu.fetch_.setPC_EX(pc);
+    cpu.fetch_.setPC_DISP(is_taken ? pc_disp : PC{4});
+    cpu.fetch_.setJALR(flags.JALR && way == Way::UP, Way::UP);
+    cpu.fetch_.setJALR(flags.JALR && way == Way::DOWN, Way::DOWN);
+    return true;
+}
+
+std::bitset<32> Execute::JALRTarget(std::bitset<32> RSV, const RISCVInstr &instr) {
+    std::bitset<32> target = ALU::calc(RSV, IMM{instr}.getImm(), ALU::Op::ADD);
+    target[0] = false;
+    return target;
 }
 
 std::bitset<32> Execute::ChooseRS(const HazardUnit::HU_RS &hu_rs, Simulator &cpu) const {
@@ -151,10 +203,8 @@ std::bitset<32> Execute::ChooseALU_SRC4(std::bitset<32> RS4V) {
     switch (CONTROL_EX_Down_.ALU_SRC1) {
         case 0:
             return RS4V;
-        case 1: {
-            auto pc = PC_EX_Up_ + 4;
-            return std::bitset<32>{pc.realVal()};  // PC for jal, jalr and auipc
-        }
+        case 1:
+            return std::bitset<32>{PC_EX_Down_.realVal()};  // PC for jal, jalr and auipc
         case 2:
             return {};  // 0 for lui
         default:
@@ -171,6 +221,8 @@ std::bitset<32> Execute::ChooseALU_SRC2(std::bitset<32> RS2V) {
             return immUp_.getImm();
         case 2:
             return std::bitset<32>{4};  // PC + 4 for jal
+        case 3:
+            return {};  // 0 for atomics, the address is rs1
         default:
             std::cerr << "Unknown operand for ALU\n";
             return {};
@@ -185,6 +237,8 @@ std::bitset<32> Execute::ChooseALU_SRC5(std::bitset<32> RS5V) {
             return immDown_.getImm();
         case 2:
             return std::bitset<32>{4};  // PC + 4 for jal
+        case 3:
+            return {};  // 0 for atomics, the address is rs1
         default:
             std::cerr << "Unknown operand for ALU\n";
             return {};
@@ -195,6 +249,14 @@ WE_GEN Execute::getWE_GEN(Way way) const noexcept {
     return way == Way::UP ? we_gen_up_ : we_gen_down_;
 }
 
+bool Execute::V_EX(Way way) const noexcept {
+    return way == Way::UP ? v_ex_up_ : v_ex_down_;
+}
+
+Bubble Execute::getBubble(Way way) const noexcept {
+    return way == Way::UP ? bubble_up_ : bubble_down_;
+}
+
 std::bitset<32> Execute::ALU_OUT(Way way) const noexcept {
     return way == Way::UP ? alu_out_up_ : alu_out_down_;
 }
@@ -223,6 +285,10 @@ PC Execute::PC_EX_Up() const noexcept {
     return PC_EX_Up_;
 }
 
+PC Execute::PC_EX_Down() const noexcept {
+    return PC_EX_Down_;
+}
+
 PC Execute::PC_DISP(Way way) const noexcept {
     return way == Way::UP ? PC_DISP_Up_ : PC_DISP_Down_;
 }
@@ -270,6 +336,10 @@ void Execute::setPC_EX(const PC &pc) {
     PC_EX_Up_ = pc;
 }
 
+void Execute::setPC_EX_Down(const PC &pc) {
+    PC_EX_Down_ = pc;
+}
+
 void Execute::setControl_EX(const ControlUnit::Flags &flags, Way way) {
     if (way == Way::UP) {
         CONTROL_EX_Up_ = flags;
@@ -278,10 +348,31 @@ void Execute::setControl_EX(const ControlUnit::Flags &flags, Way way) {
     }
 }
 
-bool Execute::isRestore(Way way) const noexcept {
-    return way == Way::UP ? restoreUp_ : restoreDown_;
+void Execute::setBubble(Bubble bubble_up, Bubble bubble_down) {
+    bubble_up_ = bubble_up;
+    bubble_down_ = bubble_down;
+}
+
+void Execute::setPredictedTaken(bool pred_up, bool pred_down) {
+    pred_up_ = pred_up;
+    pred_down_ = pred_down;
+}
+
+bool Execute::ECALL() const noexcept {
+    return (CONTROL_EX_Up_.ECALL && v_ex_up_) || (CONTROL_EX_Down_.ECALL && v_ex_down_);
+}
+
+bool Execute::CSR() const noexcept {
+    return CONTROL_EX_Up_.CSR && v_ex_up_;
 }
 
 RISCVInstr Execute::getInstr(Way way) const noexcept {
     return way == Way::UP ? instrUp_ : instrDown_;
 }
+
+void Execute::SaveTiming(std::vector<uint64_t> &state) const {
+    state.insert(state.end(), {is_set, instrUp_.getInstr().to_ulong(), instrDown_.getInstr().to_ulong(),
+                               PC_EX_Up_.val(), PC_EX_Down_.val(), v_ex_up_, v_ex_down_,
+                               static_cast<uint64_t>(bubble_up_), static_cast<uint64_t>(bubble_down_), pred_up_,
+                               pred_down_, PC_R_});
+}
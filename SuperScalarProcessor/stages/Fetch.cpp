@@ -1,5 +1,6 @@
 #include "Fetch.h"
 #include "simulator.h"
+#include "logger.h"
 #include "instruction.h"
 
 PipelineState Fetch::Run(Simulator &cpu) {
@@ -18,24 +19,33 @@ PipelineState Fetch::Run(Simulator &cpu) {
     }
     instrUp_ = RISCVInstr(inputUp);
     instrDown_ = RISCVInstr(inputDown);
+    pc_down_ = pc_up_ + 4;
 
-    uint8_t pc_increment = cpu.hu_.pl_state == PipelineState::STALL_DOWN ? 4 : 8;
+    LOG(L2, FETCH, cycle, "{x}: {i} | {i}", pc_up_.realVal(), instrUp_.getInstr().to_ulong(),
+        instrDown_.getInstr().to_ulong());
+
+    bool is_stall_down = cpu.hu_.pl_state == PipelineState::STALL_DOWN;
+    // While stall down only upper instruction is sent to decode (as the down one)
+    bool prediction_up = cpu.hu_.getPredicton(pc_up_);
+    bool prediction_down = !prediction_up && !is_stall_down && cpu.hu_.getPredicton(pc_up_ + 4);
+    pred_up_ = prediction_up;
+    pred_down_ = prediction_down;
+    // Instruction after predicted taken branch is not on the path
+    v_f_down_ = !prediction_up || is_stall_down;
+
+    uint8_t pc_increment = is_stall_down ? 4 : 8;
     if (cpu.hu_.PC_EN()) {
-        bool prediction_up = cpu.hu_.getPredicton(pc_up_);
-        bool prediction_down = cpu.hu_.getPredicton(pc_up_ + 4);
-        if (cpu.execute_.isRestore(Way::UP)) {
-            pc_up_next_ = pc_ex_;  //  + 4 is already in execute stage
-        } else if (cpu.execute_.isRestore(Way::DOWN)) {
-            pc_up_next_ = pc_ex_ + 4;
+        if (pc_r_) {
+            ++redirects_;
+            // Redirect from execute has priority over predictions for younger instructions
+            uint32_t reg_pc = jalrUp_ ? d1_.to_ulong() : d4_.to_ulong();
+            pc_up_next_ = (jalrUp_ || jalrDown_) ? PC{reg_pc / 4} : pc_ex_ + pc_disp_;
         } else if (prediction_up) {
             pc_up_next_ = cpu.hu_.getTarget(prediction_up, pc_up_);
         } else if (prediction_down) {
             pc_up_next_ = cpu.hu_.getTarget(prediction_down, pc_up_ + 4);
-        } else if (!pc_r_) {
-            pc_up_next_ += pc_increment;
         } else {
-            uint32_t reg_pc = jalrUp_ ? d1_.to_ulong() : d4_.to_ulong();
-            pc_up_next_ = ((jalrUp_ || jalrDown_) ? PC{reg_pc / 4 - 1} : pc_ex_) + pc_disp_;
+            pc_up_next_ += pc_increment;
         }
     }
 
@@ -46,11 +56,14 @@ PipelineState Fetch::Run(Simulator &cpu) {
         return PipelineState::STALL;
     }
 
-    if (cpu.hu_.pl_state == PipelineState::STALL_DOWN) {
+    if (is_stall_down) {
         // Shift Data
         instrDown_ = instrUp_;
+        pc_down_ = pc_up_;
+        pred_down_ = pred_up_;
     }
 
+    fetched_ += is_stall_down ? 1 : 2;
     cpu.FDtransmitData();
 
     return PipelineState::OK;
@@ -64,14 +77,30 @@ PC Fetch::getPC_Up() const noexcept {
     return pc_up_;
 }
 
+PC Fetch::getPC_Down() const noexcept {
+    return pc_down_;
+}
+
 PC Fetch::getNextPC_Up() const noexcept {
     return pc_up_next_;
 }
 
+bool Fetch::isPredictedTaken(Way way) const noexcept {
+    return way == Way::UP ? pred_up_ : pred_down_;
+}
+
+bool Fetch::V_F_Down() const noexcept {
+    return v_f_down_;
+}
+
 bool Fetch::PC_R() const noexcept {
     return pc_r_;
 }
 
+const IMEM &Fetch::getIMEM() const noexcept {
+    return imem_;
+}
+
 void Fetch::setPC_R(bool pc_r) noexcept {
     pc_r_ = pc_r;
 }
@@ -105,6 +134,21 @@ void Fetch::setIMEM(IMEM &&imem) noexcept {
     is_set = true;
 }
 
+void Fetch::setPC(const PC &pc) noexcept {
+    pc_up_ = pc_up_next_ = pc;
+}
+
 void Fetch::applyPC() noexcept {
     pc_up_ = pc_up_next_;
 }
+
+void Fetch::RegisterStats(StatsRegistry &stats) const {
+    stats.Register("fetch.instructions", fetched_);
+    stats.Register("fetch.redirects", redirects_);
+}
+
+void Fetch::SaveTiming(std::vector<uint64_t> &state) const {
+    state.insert(state.end(), {is_set, pc_r_, jalrUp_, jalrDown_, pc_ex_.val(), pc_disp_.val(),
+                               instrUp_.getInstr().to_ulong(), instrDown_.getInstr().to_ulong(), pc_up_next_.val(),
+                               pc_down_.val(), pred_up_, pred_down_, v_f_down_, pc_up_.val()});
+}
@@ -1,22 +1,72 @@
 #include "Memory.h"
 #include "simulator.h"
+#include "logger.h"
+
+Memory::Memory(const DataCache::Config &dcache_config, uint32_t atomic_latency, const L2Cache::Config &l2_config) :
+        dcache_(dcache_config), atomic_(atomic_latency) {
+    if (l2_config.sets > 0) {
+        dcache_.setL2(std::make_shared<L2Cache>(l2_config, dcache_config), 0);
+    }
+}
 
 PipelineState Memory::Run(Simulator &cpu) {
+    last_freeze_ = 0;
     if (!is_set) {
         return PipelineState::STALL;
     }
 
+    // Replayed instructions have the loaded, atomic, csr and system call results, data memory isn't accessed
+    DynInstr replay_up, replay_down;
+    if (cpu.source_ != nullptr) {
+        PipelineState state = Replay(cpu, Way::UP, replay_up);
+        if (state == PipelineState::OK) {
+            state = Replay(cpu, Way::DOWN, replay_down);
+        }
+        if (state != PipelineState::OK) {
+            return state;
+        }
+    }
+
+    uint32_t freeze_cycles = 0;
+    uint32_t atomic_cycles = 0;
     ebreak_ = we_gen_up_.EBREAK();
+    ecall_ = we_gen_up_.ECALL() || we_gen_down_.ECALL();
+    csr_ = we_gen_up_.CSR();
     wb_we_up_ = we_gen_up_.WB_WE();
     mem_we_up_ = we_gen_up_.MEM_WE();
     if (mem_we_up_) {
-        dmem_.Store(D2, alu_out_up_, lwidth_up_);
+        // Stores retire through write buffer and never block the pipeline
+        dcache_.Access(alu_out_up_.to_ulong(), true, cpu.write_back_.cycle);
+        ++stores_;
+        if (cpu.source_ == nullptr) {
+            atomic_.Store(*dmem_, D2, alu_out_up_, lwidth_up_);
+        }
+        LOG(L1, MEMORY, cpu.fetch_.cycle, "store {x} -> [{x}]", D2.to_ulong(), alu_out_up_.to_ulong());
     }
 
     if (ws_up_) {
-        out_data_up_ = dmem_.Load(alu_out_up_, lwidth_up_);
+        // Atomic writes the line too, so it has to own it
+        if (!dcache_.Access(alu_out_up_.to_ulong(), instr_up_.isAtomic(), cpu.write_back_.cycle)) {
+            cpu.csr_.Count(CSRUnit::Event::DCACHE_MISS);
+            freeze_cycles += ServeLoadMiss(cpu, Way::UP, cpu.write_back_.cycle);
+        }
+        // Atomics are issued only in upper way
+        if (instr_up_.isAtomic()) {
+            out_data_up_ = cpu.source_ != nullptr ? std::bitset<32>{replay_up.value}
+                                                  : atomic_.Execute(*dmem_, instr_up_, alu_out_up_.to_ulong(), D2);
+            atomic_cycles += atomic_.Latency();
+            LOG(L1, MEMORY, cpu.fetch_.cycle, "atomic {x} [{x}] -> {x}", D2.to_ulong(), alu_out_up_.to_ulong(),
+                out_data_up_.to_ulong());
+        } else {
+            ++loads_;
+            out_data_up_ = cpu.source_ != nullptr ? std::bitset<32>{replay_up.value}
+                                                  : dmem_->Load(alu_out_up_, lwidth_up_);
+            LOG(L1, MEMORY, cpu.fetch_.cycle, "load [{x}] -> {x}", alu_out_up_.to_ulong(), out_data_up_.to_ulong());
+        }
     } else {
-        out_data_up_ = alu_out_up_;
+        // Csr access and ecall pass their replayed result to write back
+        out_data_up_ = cpu.source_ != nullptr && (csr_ || we_gen_up_.ECALL()) ? std::bitset<32>{replay_up.value}
+                                                                              : alu_out_up_;
     }
     cpu.hu_.setHU_MEM_RD_M(wb_a_up_, wb_we_up_, Way::UP);
     cpu.hu_.setBP_MEM(alu_out_up_, Way::UP);
@@ -25,23 +75,80 @@ PipelineState Memory::Run(Simulator &cpu) {
     wb_we_down_ = we_gen_down_.WB_WE();
     mem_we_down_ = we_gen_down_.MEM_WE();
     if (mem_we_down_) {
-        dmem_.Store(D5, alu_out_down_, lwidth_down_);
+        dcache_.Access(alu_out_down_.to_ulong(), true, cpu.write_back_.cycle + freeze_cycles);
+        ++stores_;
+        if (cpu.source_ == nullptr) {
+            atomic_.Store(*dmem_, D5, alu_out_down_, lwidth_down_);
+        }
+        LOG(L1, MEMORY, cpu.fetch_.cycle, "store {x} -> [{x}]", D5.to_ulong(), alu_out_down_.to_ulong());
     }
 
     if (ws_down_) {
-        out_data_down_ = dmem_.Load(alu_out_down_, lwidth_down_);
+        ++loads_;
+        // Down load is served after the miss of upper one
+        uint64_t now = cpu.write_back_.cycle + freeze_cycles;
+        if (!dcache_.Access(alu_out_down_.to_ulong(), false, now)) {
+            cpu.csr_.Count(CSRUnit::Event::DCACHE_MISS);
+            freeze_cycles += ServeLoadMiss(cpu, Way::DOWN, now);
+        }
+        out_data_down_ = cpu.source_ != nullptr ? std::bitset<32>{replay_down.value}
+                                                : dmem_->Load(alu_out_down_, lwidth_down_);
+        LOG(L1, MEMORY, cpu.fetch_.cycle, "load [{x}] -> {x}", alu_out_down_.to_ulong(), out_data_down_.to_ulong());
     } else {
-        out_data_down_ = alu_out_down_;
+        out_data_down_ = cpu.source_ != nullptr && we_gen_down_.ECALL() ? std::bitset<32>{replay_down.value}
+                                                                       : alu_out_down_;
     }
     cpu.hu_.setHU_MEM_RD_M(wb_a_down_, wb_we_down_, Way::DOWN);
     cpu.hu_.setBP_MEM(alu_out_down_, Way::DOWN);
 
+    // Blocking cache: the whole pipeline is frozen while the miss is served, same for atomic
+    cpu.cpi_.Account(Bubble::DCACHE_MISS, CPIStack::issue_width * freeze_cycles);
+    cpu.cpi_.Account(Bubble::ATOMIC, CPIStack::issue_width * atomic_cycles);
+    freeze_cycles += atomic_cycles;
+    cpu.write_back_.cycle += freeze_cycles;
+    freeze_cycles_ += freeze_cycles;
+    last_freeze_ = freeze_cycles;
+
     cpu.MWBtransmitData();
 
     is_set = false;
     return PipelineState::OK;
 }
 
+PipelineState Memory::Replay(Simulator &cpu, Way way, DynInstr &instr) {
+    const WE_GEN &we_gen = way == Way::UP ? we_gen_up_ : we_gen_down_;
+    if (!we_gen.isValid()) {
+        return PipelineState::OK;
+    }
+
+    // Execute has checked the path, a truncated trace ends the run and the instructions in flight are not retired
+    return cpu.source_->Next(instr) ? PipelineState::OK : PipelineState::BREAK;
+}
+
+uint32_t Memory::ServeLoadMiss(Simulator &cpu, Way way, uint64_t now) {
+    uint32_t latency = dcache_.MissLatency();
+    if (latency == 0 || !cpu.ra_.isEnabled()) {
+        return latency;
+    }
+
+    // Down instruction is the next one after upper in program order
+    RunaheadUnit::Checkpoint checkpoint{cpu.decode_.getRegFile(), {}, pc_down_};
+    if (way == Way::DOWN) {
+        // Older upper instruction is in the same bundle and hasn't written its result yet
+        if (wb_we_up_ && wb_a_up_.any()) {
+            checkpoint.reg_file.Write(wb_a_up_, out_data_up_);
+        }
+        checkpoint.pc += 4;
+    }
+    std::bitset<5> rd = way == Way::UP ? wb_a_up_ : wb_a_down_;
+    if (rd.any()) {
+        checkpoint.inv.set(rd.to_ulong());
+    }
+
+    cpu.ra_.Run(cpu, checkpoint, now, latency);
+    return latency;
+}
+
 std::bitset<32> Memory::ALU_OUT(Way way) const noexcept {
     return way == Way::UP ? alu_out_up_ : alu_out_down_;
 }
@@ -50,10 +157,46 @@ bool Memory::WB_WE(Way way) const noexcept {
     return way == Way::UP ? wb_we_up_ : wb_we_down_;
 }
 
+bool Memory::MEM_WE(Way way) const noexcept {
+    return way == Way::UP ? mem_we_up_ : mem_we_down_;
+}
+
+bool Memory::WS(Way way) const noexcept {
+    return way == Way::UP ? ws_up_ : ws_down_;
+}
+
+DMEM::Width Memory::MEM_WIDTH(Way way) const noexcept {
+    return way == Way::UP ? lwidth_up_ : lwidth_down_;
+}
+
 bool Memory::EBREAK() const noexcept {
     return ebreak_;
 }
 
+bool Memory::ECALL() const noexcept {
+    return ecall_;
+}
+
+bool Memory::CSR() const noexcept {
+    return csr_;
+}
+
+Bubble Memory::getBubble(Way way) const noexcept {
+    return way == Way::UP ? we_gen_up_.getBubble() : we_gen_down_.getBubble();
+}
+
+PC Memory::getPC(Way way) const noexcept {
+    return way == Way::UP ? pc_up_ : pc_down_;
+}
+
+const RISCVInstr &Memory::getInstr(Way way) const noexcept {
+    return way == Way::UP ? instr_up_ : instr_down_;
+}
+
+void Memory::setInstr(const RISCVInstr &instr, Way way) {
+    (way == Way::UP ? instr_up_ : instr_down_) = instr;
+}
+
 std::bitset<5> Memory::WB_A(Way way) const noexcept {
     return way == Way::UP ? wb_a_up_ : wb_a_down_;
 }
@@ -62,6 +205,10 @@ std::bitset<32> Memory::getOutData(Way way) const noexcept {
     return way == Way::UP ? out_data_up_ : out_data_down_;
 }
 
+uint32_t Memory::FreezeCycles() const noexcept {
+    return last_freeze_;
+}
+
 void Memory::setWE_GEN(const WE_GEN &we_gen_up, const WE_GEN &we_gen_down) {
     we_gen_up_ = we_gen_up;
     we_gen_down_ = we_gen_down;
@@ -95,10 +242,67 @@ void Memory::setWB_A(std::bitset<5> wb_a_up, std::bitset<5> wb_a_down) {
     wb_a_down_ = wb_a_down;
 }
 
+void Memory::setPC(const PC &pc_up, const PC &pc_down) {
+    pc_up_ = pc_up;
+    pc_down_ = pc_down;
+}
+
+const DMEM &Memory::getDMEM() const noexcept {
+    return *dmem_;
+}
+
+DMEM &Memory::getDMEM() noexcept {
+    return *dmem_;
+}
+
+const std::shared_ptr<DMEM> &Memory::getSharedDMEM() const noexcept {
+    return dmem_;
+}
+
+void Memory::setDMEM(std::shared_ptr<DMEM> dmem) {
+    dmem_ = std::move(dmem);
+}
+
+DataCache &Memory::getDCache() noexcept {
+    return dcache_;
+}
+
+const AtomicUnit &Memory::getAtomicUnit() const noexcept {
+    return atomic_;
+}
+
+AtomicUnit &Memory::getAtomicUnit() noexcept {
+    return atomic_;
+}
+
+void Memory::mapToDMEM(uint32_t addr, uint8_t *data, uint32_t size) {
+    dmem_->Map(addr, data, size);
+}
+
 void Memory::storeToDMEM(std::bitset<32> WD, std::bitset<32> A, DMEM::Width w_type) {
-    dmem_.Store(WD, A, w_type);
+    dmem_->Store(WD, A, w_type);
 }
 
 std::bitset<32> Memory::loadFromDMEM(std::bitset<32> A, DMEM::Width w_type) {
-    return dmem_.Load(A, w_type);
+    return dmem_->Load(A, w_type);
+}
+
+void Memory::RegisterStats(StatsRegistry &stats) const {
+    stats.Register("memory.loads", loads_);
+    stats.Register("memory.stores", stores_);
+    stats.Register("memory.freeze_cycles", freeze_cycles_);
+    dcache_.RegisterStats(stats);
+    atomic_.RegisterStats(stats);
+}
+
+void Memory::SaveTiming(std::vector<uint64_t> &state) const {
+    for (const WE_GEN &we_gen : {we_gen_up_, we_gen_down_}) {
+        state.insert(state.end(), {we_gen.MEM_WE(), we_gen.WB_WE(), we_gen.EBREAK(), we_gen.ECALL(), we_gen.CSR(),
+                                   we_gen.isValid(), static_cast<uint64_t>(we_gen.getBubble())});
+    }
+    state.insert(state.end(), {is_set, ws_up_, ws_down_, static_cast<uint64_t>(lwidth_up_),
+                               static_cast<uint64_t>(lwidth_down_), wb_a_up_.to_ulong(), wb_a_down_.to_ulong(),
+                               instr_up_.getInstr().to_ulong(), instr_down_.getInstr().to_ulong(), pc_up_.val(),
+                               pc_down_.val(), mem_we_up_, mem_we_down_, wb_we_up_, wb_we_down_, ebreak_, ecall_,
+                               csr_});
 }
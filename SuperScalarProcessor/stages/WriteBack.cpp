@@ -1,5 +1,6 @@
 #include "WriteBack.h"
 #include "simulator.h"
+#include "logger.h"
 
 PipelineState WriteBack::Run(Simulator &cpu) {
     if (!is_set) {
@@ -10,15 +11,42 @@ PipelineState WriteBack::Run(Simulator &cpu) {
         return PipelineState::BREAK;
     }
 
+    // Csr access is issued alone in upper way, counters it reads don't include itself
+    if (csr_ && cpu.source_ != nullptr) {
+        cpu.decode_.writeToRF(instr_up_.getRd(), wb_d_up_, instr_up_.getRd().any());
+    } else if (csr_ && cpu.csr_.Run(cpu, instr_up_) == PipelineState::ERR) {
+        return PipelineState::ERR;
+    }
+
     cpu.hu_.setHU_MEM_RD_WB(wb_a_up_, wb_we_up_, Way::UP);
     cpu.hu_.setBP_WB(wb_d_up_, Way::UP);
     cpu.decode_.writeToRF(wb_a_up_, wb_d_up_, wb_we_up_);
+    if (wb_we_up_ && wb_a_up_.any()) {
+        LOG(L0, WRITE_BACK, cpu.fetch_.cycle, "x{} <- {x}", wb_a_up_.to_ulong(), wb_d_up_.to_ulong());
+    }
 
     // Same for down way
     cpu.hu_.setHU_MEM_RD_WB(wb_a_down_, wb_we_down_, Way::DOWN);
     cpu.hu_.setBP_WB(wb_d_down_, Way::DOWN);
     cpu.decode_.writeToRF(wb_a_down_, wb_d_down_, wb_we_down_);
+    if (wb_we_down_ && wb_a_down_.any()) {
+        LOG(L0, WRITE_BACK, cpu.fetch_.cycle, "x{} <- {x}", wb_a_down_.to_ulong(), wb_d_down_.to_ulong());
+    }
 
+    // Ecall is the youngest instruction in the bundle, so it sees results of the upper one
+    if (ecall_) {
+        bool is_down = instr_down_.getOpcode() == Opcode::ECALL && bubble_down_ == Bubble::NONE;
+        auto result = static_cast<uint32_t>((is_down ? wb_d_down_ : wb_d_up_).to_ulong());
+        PipelineState state = cpu.source_ != nullptr ? cpu.sys_.Replay(cpu, result) : cpu.sys_.Run(cpu);
+        if (state == PipelineState::BREAK) {
+            return PipelineState::BREAK;
+        }
+    }
+
+    cpu.csr_.Retire(static_cast<uint32_t>(bubble_up_ == Bubble::NONE) +
+                    static_cast<uint32_t>(bubble_down_ == Bubble::NONE));
+    cpu.cpi_.Account(bubble_up_);
+    cpu.cpi_.Account(bubble_down_);
     ++cycle;
     is_set = false;
     return PipelineState::OK;
@@ -54,3 +82,52 @@ void WriteBack::setWB_WE(bool wb_we_up, bool wb_we_down) {
 void WriteBack::setEBREAK(bool eb) {
     ebreak_ = eb;
 }
+
+bool WriteBack::ECALL() const noexcept {
+    return is_set && ecall_;
+}
+
+void WriteBack::setECALL(bool ecall) {
+    ecall_ = ecall;
+}
+
+bool WriteBack::CSR() const noexcept {
+    return is_set && csr_;
+}
+
+void WriteBack::setCSR(bool csr) {
+    csr_ = csr;
+}
+
+void WriteBack::setInstr(const RISCVInstr &instr, Way way) {
+    (way == Way::UP ? instr_up_ : instr_down_) = instr;
+}
+
+Bubble WriteBack::getBubble(Way way) const noexcept {
+    return way == Way::UP ? bubble_up_ : bubble_down_;
+}
+
+PC WriteBack::getPC(Way way) const noexcept {
+    return way == Way::UP ? pc_up_ : pc_down_;
+}
+
+const RISCVInstr &WriteBack::getInstr(Way way) const noexcept {
+    return way == Way::UP ? instr_up_ : instr_down_;
+}
+
+void WriteBack::setBubble(Bubble bubble_up, Bubble bubble_down) {
+    bubble_up_ = bubble_up;
+    bubble_down_ = bubble_down;
+}
+
+void WriteBack::setPC(const PC &pc_up, const PC &pc_down) {
+    pc_up_ = pc_up;
+    pc_down_ = pc_down;
+}
+
+void WriteBack::SaveTiming(std::vector<uint64_t> &state) const {
+    state.insert(state.end(), {is_set, wb_we_up_, wb_we_down_, ebreak_, ecall_, csr_, instr_up_.getInstr().to_ulong(),
+                               instr_down_.getInstr().to_ulong(), static_cast<uint64_t>(bubble_up_),
+                               static_cast<uint64_t>(bubble_down_), pc_up_.val(), pc_down_.val(),
+                               wb_a_up_.to_ulong(), wb_a_down_.to_ulong()});
+}
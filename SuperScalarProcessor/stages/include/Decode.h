@@ -20,20 +20,31 @@ public:
     [[nodiscard]] std::bitset<5> getA5() const noexcept;
     [[nodiscard]] RISCVInstr getInstr(Way way) const noexcept;
     [[nodiscard]] PC getPC_Up() const noexcept;
+    [[nodiscard]] PC getPC_Down() const noexcept;
     [[nodiscard]] bool V_DE(Way way) const noexcept;  //  Is valid state for instruction
+    [[nodiscard]] Bubble getBubble(Way way) const noexcept;  // why the way is not valid
+    [[nodiscard]] bool isPredictedTaken(Way way) const noexcept;
 
     void setInstr(const RISCVInstr &instr, Way way);
     void setPC_Up(const PC &pc);
+    void setPC_Down(const PC &pc);
+    void setPredictedTaken(bool pred, Way way);
+    void setV_F_Down(bool v_f_down);
     void setPC_R_F(bool pc_f);
     void setPC_R(bool pc_r);
     void writeToRF(std::bitset<5> A, std::bitset<32> D, bool wb_we);  //  A is A3 or A6 and D is D3 or D6
 
+    // Appends the state that decides the timing of the next cycles: everything but the data values
+    void SaveTiming(std::vector<uint64_t> &state) const;
+
     // for tests
     [[nodiscard]] const RegisterFile& getRegFile() const noexcept;
 
     bool is_set{false};
 private:
     void ShiftData();
+    // Reason of invalid state common for both ways
+    [[nodiscard]] Bubble BubbleCause(const Simulator &cpu) const noexcept;
 
     /*=== units ===*/
     ControlUnit cu_up_;
@@ -44,6 +55,7 @@ private:
     /*=== inputs ===*/
     bool pc_f_{false};
     bool pc_r_{false};
+    bool v_f_down_{true};
     RISCVInstr instrUp_;
     RISCVInstr instrDown_;
     /*==============*/
@@ -57,12 +69,17 @@ private:
     std::bitset<32> D5;
     bool v_de_up_{true};
     bool v_de_down_{true};
+    Bubble bubble_up_{Bubble::NONE};
+    Bubble bubble_down_{Bubble::NONE};
     // cu_up_ and cu_down_ flags state
     // instrUp_ and instrDown_
     /*===============*/
 
     /*=== fallthrough ===*/
     PC pc_up_{0};
+    PC pc_down_{0};  // not always pc_up_ + 4, e.g. down is taken from predicted target
+    bool pred_up_{false};  // branch predictor decision made in fetch
+    bool pred_down_{false};
     /*===================*/
 };
 
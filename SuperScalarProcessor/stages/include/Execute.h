@@ -11,26 +11,36 @@ public:
 
     [[nodiscard]] RISCVInstr getInstr(Way way) const noexcept;
     [[nodiscard]] WE_GEN getWE_GEN(Way way) const noexcept;
+    [[nodiscard]] bool V_EX(Way way) const noexcept;
+    [[nodiscard]] Bubble getBubble(Way way) const noexcept;  // why the way is not valid
     [[nodiscard]] std::bitset<32> ALU_OUT(Way way) const noexcept;
     [[nodiscard]] std::bitset<32> D1() const noexcept;
     [[nodiscard]] std::bitset<32> D4() const noexcept;
     [[nodiscard]] std::bitset<32> RS2V() const noexcept;
     [[nodiscard]] std::bitset<32> RS5V() const noexcept;
-    [[nodiscard]] bool isRestore(Way way) const noexcept;
     [[nodiscard]] bool PC_R() const noexcept;
     [[nodiscard]] PC PC_EX_Up() const noexcept;
+    [[nodiscard]] PC PC_EX_Down() const noexcept;
     [[nodiscard]] PC PC_DISP(Way way) const noexcept;
     [[nodiscard]] bool JALR(Way way) const noexcept;
+    [[nodiscard]] bool ECALL() const noexcept;  // valid ecall in any way
+    [[nodiscard]] bool CSR() const noexcept;  // valid csr access, it is always issued in upper way
     [[nodiscard]] bool WS(Way way) const noexcept;
     [[nodiscard]] DMEM::Width MEM_WIDTH(Way way) const noexcept;
     [[nodiscard]] std::bitset<5> WB_A(Way way) const noexcept;
 
     void setPC_EX(const PC &pc);
+    void setPC_EX_Down(const PC &pc);
     void setD1_D2(std::bitset<32> d1, std::bitset<32> d2);
     void setD4_D5(std::bitset<32> d4, std::bitset<32> d5);
     void setInstr(const RISCVInstr &instr, Way way);
     void setV_EX(bool v_ex_up, bool v_ex_down);
+    void setBubble(Bubble bubble_up, Bubble bubble_down);
     void setControl_EX(const ControlUnit::Flags &flags, Way way);
+    void setPredictedTaken(bool pred_up, bool pred_down);
+
+    // Appends the state that decides the timing of the next cycles: everything but the data values
+    void SaveTiming(std::vector<uint64_t> &state) const;
 
     bool is_set{false};
 private:
@@ -41,7 +51,12 @@ private:
     [[nodiscard]] std::bitset<32> ChooseALU_SRC4(std::bitset<32> RS4V);
     [[nodiscard]] std::bitset<32> ChooseALU_SRC5(std::bitset<32> RS5V);
 
-    void ProcessPrediction(Simulator &cpu, Way way, bool compUp, bool compDown) noexcept;
+    [[nodiscard]] static std::bitset<32> JALRTarget(std::bitset<32> RSV, const RISCVInstr &instr);
+
+    // Takes outcomes, targets and results of the valid ways from Simulator::source_, ERR if it has another path
+    PipelineState Replay(Simulator &cpu);
+    // Updates predictor and redirects fetch if the way is mispredicted, returns true on redirect
+    bool ResolveControl(Simulator &cpu, Way way, bool comp) noexcept;
 
     /*=== units ===*/
     //  static ALU1 and ALU2
@@ -60,6 +75,10 @@ private:
     PC PC_EX_Up_;
     bool v_ex_up_{true};
     bool v_ex_down_{true};
+    Bubble bubble_up_{Bubble::NONE};
+    Bubble bubble_down_{Bubble::NONE};
+    bool pred_up_{false};
+    bool pred_down_{false};
     /*==============*/
 
     /*=== outputs ===*/
@@ -68,8 +87,6 @@ private:
     PC PC_DISP_Up_;
     PC PC_DISP_Down_;
     bool PC_R_{false};
-    bool restoreUp_{false};
-    bool restoreDown_{false};
     WE_GEN we_gen_up_;
     WE_GEN we_gen_down_;
     /*===============*/
@@ -81,6 +98,7 @@ private:
     std::bitset<5> wb_a_down_;
     std::bitset<32> rs2v_;
     std::bitset<32> rs5v_;
+    PC PC_EX_Down_;
     /*===================*/
 };
 
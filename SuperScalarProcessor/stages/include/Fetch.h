@@ -9,13 +9,18 @@ public:
     explicit Fetch() : is_set(false), imem_(IMEM{0}) {}
     explicit Fetch(uint32_t instr_count) : is_set(false), imem_(IMEM{instr_count}) {}
     explicit Fetch(std::vector<std::bitset<32>> &&imem) : is_set(true), imem_(std::move(imem)) {}
+    explicit Fetch(IMEM &&imem) : is_set(true), imem_(std::move(imem)) {}
 
     PipelineState Run(Simulator &cpu) override;
 
     [[nodiscard]] RISCVInstr getInstr(Way way) const noexcept;
     [[nodiscard]] PC getPC_Up() const noexcept;
+    [[nodiscard]] PC getPC_Down() const noexcept;
     [[nodiscard]] PC getNextPC_Up() const noexcept;
     [[nodiscard]] bool PC_R() const noexcept;
+    [[nodiscard]] bool isPredictedTaken(Way way) const noexcept;
+    [[nodiscard]] bool V_F_Down() const noexcept;  // down instruction is on the predicted path
+    [[nodiscard]] const IMEM &getIMEM() const noexcept;
 
     void setPC_R(bool pc_r) noexcept;
     void setJALR(bool jalr, Way way) noexcept;
@@ -24,8 +29,13 @@ public:
     void setPC_EX(PC pc_ex) noexcept;
     void setPC_DISP(PC pc_disp) noexcept;
     void setIMEM(IMEM &&imem) noexcept;
+    void setPC(const PC &pc) noexcept;  // start fetching from pc
     void applyPC() noexcept;
 
+    void RegisterStats(StatsRegistry &stats) const;
+    // Appends the state that decides the timing of the next cycles: everything but the data values
+    void SaveTiming(std::vector<uint64_t> &state) const;
+
     bool is_set{false};
 private:
     /*=== units ===*/
@@ -36,8 +46,8 @@ private:
     bool pc_r_{false};
     bool jalrUp_{false};
     bool jalrDown_{false};
-    std::bitset<32> d1_;
-    std::bitset<32> d4_;
+    std::bitset<32> d1_;  // jalr target of upper instruction
+    std::bitset<32> d4_;  // jalr target of down instruction
     PC pc_ex_;
     PC pc_disp_;
     /*==============*/
@@ -46,12 +56,19 @@ private:
     RISCVInstr instrUp_;
     RISCVInstr instrDown_;
     PC pc_up_next_{0};
+    PC pc_down_{0};
+    bool pred_up_{false};
+    bool pred_down_{false};
+    bool v_f_down_{true};
     // pc_r
     /*===============*/
 
     /*=== fallthrough ===*/
     PC pc_up_{0};
     /*===================*/
+
+    uint64_t fetched_{0};  // instructions sent to decode
+    uint64_t redirects_{0};
 };
 
 #endif //SIMULATOR_FETCH_H
@@ -2,16 +2,40 @@
 #define SIMULATOR_MEMORY_H
 
 #include "Basics.h"
+#include "DataCache.h"
+#include "L2Cache.h"
+#include "AtomicUnit.h"
+
+struct DynInstr;
 
 class Memory final : public Stage {
 public:
+    explicit Memory() = default;
+    // With L2 sets the data cache gets L2 of its own, harts share one instead, see MultiHart
+    explicit Memory(const DataCache::Config &dcache_config, uint32_t atomic_latency = 0,
+                    const L2Cache::Config &l2_config = {});
     PipelineState Run(Simulator &cpu) override;
 
     [[nodiscard]] std::bitset<32> ALU_OUT(Way way) const noexcept;
     [[nodiscard]] bool WB_WE(Way way) const noexcept;
+    [[nodiscard]] bool MEM_WE(Way way) const noexcept;
+    [[nodiscard]] bool WS(Way way) const noexcept;
+    [[nodiscard]] DMEM::Width MEM_WIDTH(Way way) const noexcept;
     [[nodiscard]] bool EBREAK() const noexcept;
+    [[nodiscard]] bool ECALL() const noexcept;
+    [[nodiscard]] bool CSR() const noexcept;
+    [[nodiscard]] Bubble getBubble(Way way) const noexcept;
+    [[nodiscard]] PC getPC(Way way) const noexcept;
+    [[nodiscard]] const RISCVInstr &getInstr(Way way) const noexcept;
     [[nodiscard]] std::bitset<5> WB_A(Way way) const noexcept;
     [[nodiscard]] std::bitset<32> getOutData(Way way) const noexcept;
+    [[nodiscard]] uint32_t FreezeCycles() const noexcept;  // extra cycles of the last run
+    [[nodiscard]] const DMEM &getDMEM() const noexcept;
+    [[nodiscard]] DMEM &getDMEM() noexcept;
+    [[nodiscard]] const std::shared_ptr<DMEM> &getSharedDMEM() const noexcept;
+    [[nodiscard]] DataCache &getDCache() noexcept;
+    [[nodiscard]] const AtomicUnit &getAtomicUnit() const noexcept;
+    [[nodiscard]] AtomicUnit &getAtomicUnit() noexcept;
 
     void setWE_GEN(const WE_GEN &we_gen_up, const WE_GEN &we_gen_down);
     void setD2(std::bitset<32> d2);
@@ -20,6 +44,17 @@ public:
     void setLWidth(DMEM::Width lwidth_up, DMEM::Width lwidth_down);
     void setALU_OUT(std::bitset<32> alu_out_up, std::bitset<32> alu_out_down);
     void setWB_A(std::bitset<5> wb_a_up, std::bitset<5> wb_a_down);
+    void setPC(const PC &pc_up, const PC &pc_down);
+    void setInstr(const RISCVInstr &instr, Way way);
+
+    // Guest memory shared with other harts
+    void setDMEM(std::shared_ptr<DMEM> dmem);
+    // Backs guest memory with host buffer, see DMEM::Map
+    void mapToDMEM(uint32_t addr, uint8_t *data, uint32_t size);
+
+    void RegisterStats(StatsRegistry &stats) const;
+    // Appends the state that decides the timing of the next cycles: everything but the data values
+    void SaveTiming(std::vector<uint64_t> &state) const;
 
     // For testing
     void storeToDMEM(std::bitset<32> WD, std::bitset<32> A, DMEM::Width w_type = DMEM::Width::WORD);
@@ -31,8 +66,15 @@ public:
     bool mem_we_down_{false};
     std::bitset<32> D5;
 private:
+    // Retires the next replayed instruction if the way is valid, BREAK at the end of the replayed instructions
+    PipelineState Replay(Simulator &cpu, Way way, DynInstr &instr);
+    // Serves dcache miss of the load in given way which starts at cycle `now`, returns cycles of the pipeline freeze
+    uint32_t ServeLoadMiss(Simulator &cpu, Way way, uint64_t now);
+
     /*=== units ===*/
-    DMEM dmem_;
+    std::shared_ptr<DMEM> dmem_{std::make_shared<DMEM>()};  // own one unless harts share memory
+    DataCache dcache_;
+    AtomicUnit atomic_;
     /*=============*/
 
     /*=== inputs ===*/
@@ -59,7 +101,18 @@ private:
     std::bitset<5> wb_a_up_;
     std::bitset<5> wb_a_down_;
     bool ebreak_;
+    bool ecall_{false};
+    bool csr_{false};
+    RISCVInstr instr_up_;
+    RISCVInstr instr_down_;
+    PC pc_up_;
+    PC pc_down_;
     /*===================*/
+
+    uint64_t loads_{0};
+    uint64_t stores_{0};
+    uint64_t freeze_cycles_{0};  // pipeline frozen by load misses and atomics
+    uint32_t last_freeze_{0};
 };
 
 #endif //SIMULATOR_MEMORY_H
@@ -11,17 +11,38 @@ public:
     [[nodiscard]] bool WB_WE(Way way) const noexcept;
     [[nodiscard]] std::bitset<5> WB_A(Way way) const noexcept;
     [[nodiscard]] std::bitset<32> WB_D(Way way) const noexcept;
+    [[nodiscard]] bool ECALL() const noexcept;  // system call is waiting for write back
+    [[nodiscard]] bool CSR() const noexcept;  // csr access is waiting for write back
+    [[nodiscard]] Bubble getBubble(Way way) const noexcept;
+    [[nodiscard]] PC getPC(Way way) const noexcept;
+    [[nodiscard]] const RISCVInstr &getInstr(Way way) const noexcept;
 
     void setWB_A(std::bitset<5> wb_a_up, std::bitset<5> wb_a_down);
     void setWB_D(std::bitset<32> wb_d_up, std::bitset<32> wb_d_down);
     void setWB_WE(bool wb_we_up, bool wb_we_down);
     void setEBREAK(bool eb);
+    void setECALL(bool ecall);
+    void setCSR(bool csr);
+    void setInstr(const RISCVInstr &instr, Way way);
+    void setBubble(Bubble bubble_up, Bubble bubble_down);
+    void setPC(const PC &pc_up, const PC &pc_down);
+
+    // Appends the state that decides the timing of the next cycles: everything but the data values
+    void SaveTiming(std::vector<uint64_t> &state) const;
 
     bool is_set{false};
 private:
     bool wb_we_up_{false};
     bool wb_we_down_{false};
     bool ebreak_{false};
+    bool ecall_{false};
+    bool csr_{false};
+    RISCVInstr instr_up_;
+    RISCVInstr instr_down_;
+    Bubble bubble_up_{Bubble::NONE};
+    Bubble bubble_down_{Bubble::NONE};
+    PC pc_up_;
+    PC pc_down_;
     std::bitset<32> wb_d_up_;
     std::bitset<32> wb_d_down_;
     std::bitset<5> wb_a_up_;
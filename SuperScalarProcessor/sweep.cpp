@@ -0,0 +1,126 @@
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "designspace.h"
+#include "work_stealing.h"
+
+namespace {
+
+void WriteTable(std::ostream &out, const DesignSpace &space, const std::vector<DesignPoint> &points,
+                const std::vector<std::string> &programs, const std::vector<SweepResult> &results,
+                const std::vector<bool> &pareto) {
+    out << "point";
+    for (const auto &name : space.Parameters()) {
+        out << "," << name;
+    }
+    out << ",cost,program,cycles,instructions,ipc,pareto\n";
+
+    out << std::fixed << std::setprecision(3);
+    for (const auto &result : results) {
+        out << result.point;
+        for (const auto &value : points[result.point].values) {
+            out << "," << value;
+        }
+        out << "," << HardwareCost(points[result.point].config) << "," << programs[result.program] << ",";
+        if (result.ok) {
+            out << result.cycles << "," << result.instructions << ","
+                << static_cast<double>(result.instructions) / static_cast<double>(std::max<uint64_t>(result.cycles, 1));
+        } else {
+            out << "error,,";
+        }
+        out << "," << pareto[result.point] << "\n";
+    }
+}
+
+}  // namespace
+
+// Simulates the cross product of parameter values on a set of programs, see README
+int main(int argc, char *argv[]) {
+    DesignSpace space;
+    std::vector<std::string> programs;
+    std::string out_path = "sweep.csv";
+    size_t threads = 0;
+    std::vector<std::string> traces;  // one per program
+    for (int i = 1; i < argc; ++i) {
+        std::string arg{argv[i]};
+        if (arg.rfind("--", 0) != 0) {
+            programs.push_back(arg);
+            continue;
+        }
+
+        auto eq = arg.find('=');
+        std::string name = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (name == "threads") {
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), threads);
+            if (ec != std::errc{} || ptr != value.data() + value.size()) {
+                std::cerr << "Invalid option: " << arg << std::endl;
+                return 1;
+            }
+        } else if (name == "out") {
+            out_path = value;
+        } else if (name == "replay") {
+            std::istringstream list{value};
+            for (std::string trace; std::getline(list, trace, ',');) {
+                traces.push_back(trace);
+            }
+        } else if (!space.AddParameter(name, value)) {
+            std::cerr << "Invalid option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (programs.empty() || (!traces.empty() && traces.size() != programs.size())) {
+        std::cerr << "Usage: sweep [--threads=N] [--out=file.csv] [--replay=trace,...] [--<parameter>=v1,v2,...] "
+                     "<program>..." << std::endl;
+        return 1;
+    }
+
+    std::ofstream out{out_path};
+    if (!out) {
+        std::cerr << "Can't create results file: " << out_path << std::endl;
+        return 1;
+    }
+
+    auto points = space.Points();
+    WorkStealingPool pool{threads};
+    auto start = std::chrono::steady_clock::now();
+    auto results = RunSweep(points, programs, pool, traces);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Point fails if any program fails, it can't be on the front then
+    std::vector<uint64_t> cycles(points.size(), 0);
+    for (const auto &result : results) {
+        cycles[result.point] = result.ok && cycles[result.point] != UINT64_MAX ? cycles[result.point] + result.cycles
+                                                                               : UINT64_MAX;
+    }
+    std::vector<bool> pareto(points.size(), false);
+    for (size_t point : ParetoFront(points, cycles)) {
+        pareto[point] = cycles[point] != UINT64_MAX;
+    }
+    WriteTable(out, space, points, programs, results, pareto);
+
+    std::cout << points.size() << " points x " << programs.size() << " programs on " << pool.Threads()
+              << " threads in " << std::fixed << std::setprecision(2) << seconds << " s, " << pool.Steals()
+              << " jobs stolen" << std::endl;
+    std::cout << "Pareto front of total cycles against cost:" << std::endl;
+    std::cout << "  point         cost        cycles  parameters" << std::endl;
+    for (size_t point = 0; point < points.size(); ++point) {
+        if (!pareto[point]) {
+            continue;
+        }
+        std::cout << "  " << std::setw(5) << point << "  " << std::setw(11) << HardwareCost(points[point].config)
+                  << "  " << std::setw(12) << cycles[point] << " ";
+        auto names = space.Parameters();
+        for (size_t i = 0; i < names.size(); ++i) {
+            std::cout << " " << names[i] << "=" << points[point].values[i];
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "Results: " << out_path << std::endl;
+
+    return std::all_of(results.begin(), results.end(), [](const auto &result) { return result.ok; }) ? 0 : 2;
+}
@@ -189,6 +189,32 @@ TEST(BaseInstructionsTest, SRA) {
     ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s0 */ 8}), std::bitset<32>{/* -4 */ 0xfffffffc});
 }
 
+TEST(BaseInstructionsTest, ShiftAmount) {
+    /*
+        sll s0, a0, t2
+        srl s1, a1, t2
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00751433,
+        0x0075d4b3
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    /*=== Register file setup ===*/
+    // a0 = 20
+    // a1 = -100
+    // t2 = 37, only its low 5 bits are the shift amount
+    cpu.decode_.writeToRF({10}, {20}, true);
+    cpu.decode_.writeToRF({11}, {0xffffff9c}, true);
+    cpu.decode_.writeToRF({7}, {37}, true);
+    /*===========================*/
+
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s0 */ 8}), std::bitset<32>{/* 640 */ 0x00000280});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s1 */ 9}), std::bitset<32>{/* 134217724 */ 0x07fffffc});
+}
+
 TEST(BaseInstructionsTest, SLT) {
     /*
         slt s0, a0, t2
@@ -479,6 +505,7 @@ TEST(BaseInstructionsTest, SH) {
 
     ASSERT_NE(cpu.Run(), PipelineState::ERR);
     ASSERT_EQ(cpu.memory_.loadFromDMEM({8}, DMEM::Width::HALF_U), std::bitset<32>{/* 945 */ 0x000003b1});
+    ASSERT_EQ(cpu.memory_.loadFromDMEM({8}), std::bitset<32>{/* 945 */ 0x000003b1});
 }
 
 TEST(BaseInstructionsTest, SB) {
@@ -499,6 +526,7 @@ TEST(BaseInstructionsTest, SB) {
 
     ASSERT_NE(cpu.Run(), PipelineState::ERR);
     ASSERT_EQ(cpu.memory_.loadFromDMEM({8}, DMEM::Width::BYTE_U), std::bitset<32>{/* 177 */ 0x000000b1});
+    ASSERT_EQ(cpu.memory_.loadFromDMEM({8}), std::bitset<32>{/* 177 */ 0x000000b1});
 }
 
 /*====================================================================*/
@@ -536,6 +564,175 @@ TEST(BaseInstructionsTest, AUIPC) {
     ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a1 */ 11}), std::bitset<32>{/* 172036 */ 0x0002a004});
 }
 
+/*====================================================================*/
+/*================== RV32 Zicsr instructions tests ===================*/
+/*====================================================================*/
+
+TEST(BaseInstructionsTest, RDCYCLE_RDINSTRET) {
+    /*
+        rdcycle s0
+        rdinstret s1
+        addi t0, zero, 1
+        addi t0, t0, 1
+        addi t0, t0, 1
+        rdinstret s2
+        rdcycle s3
+        rdcycleh s4
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0xc0002473,
+        0xc02024f3,
+        0x00100293,
+        0x00128293,
+        0x00128293,
+        0xc0202973,
+        0xc00029f3,
+        0xc8002a73
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* t0 */ 5}), std::bitset<32>{/* 3 */ 0x00000003});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s1 */ 9}), std::bitset<32>{/* 1 */ 0x00000001});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s2 */ 18}), std::bitset<32>{/* 5 */ 0x00000005});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s4 */ 20}), std::bitset<32>{/* 0 */ 0x00000000});
+    ASSERT_LT(cpu.decode_.getRegFile().Read({/* s0 */ 8}).to_ulong(),
+              cpu.decode_.getRegFile().Read({/* s3 */ 19}).to_ulong());
+    ASSERT_LT(cpu.decode_.getRegFile().Read({/* s3 */ 19}).to_ulong(), cpu.write_back_.cycle);
+    ASSERT_EQ(cpu.csr_.Instret(), 8);
+}
+
+TEST(BaseInstructionsTest, HPMCOUNTER) {
+    /*
+        li t0, 0
+        li t2, 3
+        loop:
+        addi t0, t0, 1
+        blt t0, t2, loop
+        csrr a0, hpmcounter3
+        csrr a1, hpmcounter31
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00000293,
+        0x00300393,
+        0x00128293,
+        0xfe72cee3,
+        0xc0302573,
+        0xc1f025f3
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    // Loop branch is mispredicted at least on the first iteration
+    ASSERT_GT(cpu.decode_.getRegFile().Read({/* a0 */ 10}).to_ulong(), 0);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a0 */ 10}).to_ulong(),
+              cpu.csr_.Events(CSRUnit::Event::MISPREDICT));
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a1 */ 11}), std::bitset<32>{/* 0 */ 0x00000000});
+}
+
+TEST(BaseInstructionsTest, CSRReadOnly) {
+    /*
+        li t0, 5
+        csrw cycle, t0
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00500293,
+        0xc0029073
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    ASSERT_EQ(cpu.Run(), PipelineState::ERR);
+}
+
+/*====================================================================*/
+/*=================== RV32A atomic instructions tests ================*/
+/*====================================================================*/
+
+TEST(BaseInstructionsTest, AMO) {
+    /*
+        li t0, 0x100
+        li t1, 5
+        sw t1, 0(t0)
+        li t2, -3
+        amoadd.w a0, t2, (t0)
+        addi a1, a0, 1
+        amomin.w a2, t2, (t0)
+        amomaxu.w a3, t1, (t0)
+        amoswap.w a4, t1, (t0)
+        amoor.w a5, t2, (t0)
+        lw a6, 0(t0)
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x10000293,
+        0x00500313,
+        0x0062a023,
+        0xffd00393,
+        0x0072a52f,
+        0x00150593,
+        0x8072a62f,
+        0xe062a6af,
+        0x0862a72f,
+        0x4072a7af,
+        0x0002a803
+    };
+
+    SimConfig config;
+    config.atomic_latency = 3;
+    Simulator cpu = Simulator{std::move(imem), config};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    // Rd gets the old value, memory the result of operation
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{/* 5 */ 0x00000005});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a1 */ 11}), std::bitset<32>{/* 6 */ 0x00000006});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a2 */ 12}), std::bitset<32>{/* 2 */ 0x00000002});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a3 */ 13}), std::bitset<32>{/* -3 */ 0xfffffffd});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a4 */ 14}), std::bitset<32>{/* -3 */ 0xfffffffd});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a5 */ 15}), std::bitset<32>{/* 5 */ 0x00000005});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a6 */ 16}), std::bitset<32>{/* -3 */ 0xfffffffd});
+    ASSERT_EQ(cpu.memory_.getAtomicUnit().AMOs(), 5);
+    ASSERT_EQ(cpu.cpi_.Slots(Bubble::ATOMIC), CPIStack::issue_width * 5 * 3);
+}
+
+TEST(BaseInstructionsTest, LR_SC) {
+    /*
+        li t0, 0x100
+        li t1, 7
+        lr.w a0, (t0)
+        sc.w a1, t1, (t0)
+        sc.w a2, t1, (t0)
+        lr.w a3, (t0)
+        addi t1, a3, 1
+        sc.w a4, t1, (t0)
+        lw a5, 0(t0)
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x10000293,
+        0x00700313,
+        0x1002a52f,
+        0x1862a5af,
+        0x1862a62f,
+        0x1002a6af,
+        0x00168313,
+        0x1862a72f,
+        0x0002a783
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    // Store conditional succeeds once after every load reserved
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{/* 0 */ 0x00000000});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a1 */ 11}), std::bitset<32>{/* 0 */ 0x00000000});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a2 */ 12}), std::bitset<32>{/* 1 */ 0x00000001});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a3 */ 13}), std::bitset<32>{/* 7 */ 0x00000007});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a4 */ 14}), std::bitset<32>{/* 0 */ 0x00000000});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a5 */ 15}), std::bitset<32>{/* 8 */ 0x00000008});
+    ASSERT_EQ(cpu.memory_.getAtomicUnit().StoreConditionalFailures(), 1);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -192,6 +192,33 @@ TEST(BlocksTest, Jalr) {
     ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a1 */ 11}), std::bitset<32>{/* 10 */ 0x0000000a});
 }
 
+TEST(BlocksTest, JalrOffset) {
+    /*
+        li t0, 5
+        auipc t1, 0
+        jalr ra, 12(t1)
+        li t0, 100
+        li t1, 200
+        addi a0, t0, 1
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00500293,
+        0x00000317,
+        0x00c300e7,
+        0x06400293,
+        0x0c800313,
+        0x00128513
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* ra */ 1}), std::bitset<32>{/* 12 */ 0x0000000c});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* t0 */ 5}), std::bitset<32>{/* 5 */ 0x00000005});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* t1 */ 6}), std::bitset<32>{/* 200 */ 0x000000c8});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{/* 6 */ 0x00000006});
+}
+
 TEST(BlocksTest, Loop1) {
     /*
         li t0, 0
@@ -218,6 +245,58 @@ TEST(BlocksTest, Loop1) {
 }
 
 
+TEST(BlocksTest, Loop2) {
+    /*
+        li t0, 0
+        li t2, 3
+        li a1, 0
+        loop:
+        addi t0, t0, 1
+        addi a1, a1, 100
+        blt t0, t2, loop
+        mv a0, t0
+        addi a1, a1, -200
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00000293,
+        0x00300393,
+        0x00000593,
+        0x00128293,
+        0x06458593,
+        0xfe72cce3,
+        0x00028513,
+        0xf3858593
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* t0 */ 5}), std::bitset<32>{/* 3 */ 0x00000003});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{/* 3 */ 0x00000003});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a1 */ 11}), std::bitset<32>{/* 100 */ 0x00000064});
+}
+
+TEST(BlocksTest, EbreakDown) {
+    /*
+        li a0, 1
+        ebreak
+        li a0, 2
+        li a1, 3
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00100513,
+        0x00100073,
+        0x00200513,
+        0x00300593
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{/* 1 */ 0x00000001});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a1 */ 11}), std::bitset<32>{/* 0 */ 0x00000000});
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
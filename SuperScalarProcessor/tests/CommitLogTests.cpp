@@ -0,0 +1,131 @@
+#include "simulator.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> ReadLines(const std::string &path) {
+    std::ifstream in{path};
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+}  // namespace
+
+TEST(CommitLogTests, SpikeFormat) {
+    /*
+        li t0, 0x123
+        sw t0, 8(zero)
+        sb t0, 12(zero)
+        lw t1, 8(zero)
+        rdinstret t2
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x12300293,
+        0x00502423,
+        0x00500623,
+        0x00802303,
+        0xc02023f3
+    };
+
+    std::string path = testing::TempDir() + "commit_log_tests.log";
+    {
+        Simulator cpu = Simulator{std::move(imem)};
+        cpu.commit_log_ = CommitLog::Open(path);
+        ASSERT_NE(cpu.commit_log_, nullptr);
+        ASSERT_NE(cpu.Run(), PipelineState::ERR);
+        // Log is completed when the simulator is destroyed
+    }
+
+    // Only commit lines by default
+    std::vector<std::string> commits = ReadLines(path);
+    std::remove(path.c_str());
+
+    std::vector<std::string> expected = {
+        "core   0: 3 0x00000000 (0x12300293) x5  0x00000123",
+        "core   0: 3 0x00000004 (0x00502423) mem 0x00000008 0x00000123",
+        "core   0: 3 0x00000008 (0x00500623) mem 0x0000000c 0x23",
+        "core   0: 3 0x0000000c (0x00802303) x6  0x00000123 mem 0x00000008",
+        // Four instructions are retired before the counter is read
+        "core   0: 3 0x00000010 (0xc02023f3) x7  0x00000004"
+    };
+    ASSERT_EQ(commits, expected);
+}
+
+TEST(CommitLogTests, Disassembly) {
+    CommitLog::Record record{0x80, 0x00a00393, 10, 0, 0, 7, CommitLog::Access::NONE, 4};
+    ASSERT_EQ(CommitLog::Format(record), "core   0: 3 0x00000080 (0x00a00393) x7  0x0000000a\n");
+    ASSERT_EQ(CommitLog::Format(record, true), "core   0: 0x00000080 (0x00a00393) li      t2, 10\n"
+                                               "core   0: 3 0x00000080 (0x00a00393) x7  0x0000000a\n");
+
+    // amoadd.w.aq a0, a1, (a2)
+    CommitLog::Record amo{0x84, 0x04b6252f, 1, 0x100, 0, 10, CommitLog::Access::LOAD, 4};
+    ASSERT_EQ(CommitLog::Format(amo, true), "core   0: 0x00000084 (0x04b6252f) amoadd.w.aq a0, a1, (a2)\n"
+                                            "core   0: 3 0x00000084 (0x04b6252f) x10 0x00000001 mem 0x00000100\n");
+}
+
+TEST(CommitLogTests, SpikeDisassembly) {
+    /*
+        li t0, 2
+        lui a0, 0x12
+        mv a1, t0
+        sw a0, 8(zero)
+        lw t1, 8(zero)
+        srai t2, t1, 3
+        neg a2, t2
+    loop:
+        addi t0, t0, -1
+        bnez t0, loop
+        jal ra, skip
+        sb a0, 12(zero)
+    skip:
+        csrr a3, instret
+        beqz zero, end
+        li a4, 1
+    end:
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00200293,
+        0x00012537,
+        0x00028593,
+        0x00a02423,
+        0x00802303,
+        0x40335393,
+        0x40700633,
+        0xfff28293,
+        0xfe029ee3,
+        0x008000ef,
+        0x00a00623,
+        0xc02026f3,
+        0x00000463,
+        0x00100713
+    };
+
+    std::string path = testing::TempDir() + "commit_log_tests_disasm.log";
+    {
+        Simulator cpu = Simulator{std::move(imem)};
+        cpu.commit_log_ = CommitLog::Open(path, true);
+        ASSERT_NE(cpu.commit_log_, nullptr);
+        ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    }
+
+    // Output of spike -l --log-commits for the same program
+    std::vector<std::string> log = ReadLines(path);
+    std::remove(path.c_str());
+    ASSERT_EQ(log, ReadLines((std::filesystem::path{TEST_DATA_DIR} / "spike_commits.log").string()));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,143 @@
+#include "designspace.h"
+#include "work_stealing.h"
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+namespace {
+
+const std::filesystem::path data_dir{TEST_DATA_DIR};
+
+std::vector<std::string> LoopPrograms() {
+    return {(data_dir / "loop2.dat").string(), (data_dir / "loop3.dat").string(),
+            (data_dir / "stride.dat").string()};
+}
+
+std::unique_ptr<Simulator> Simulate(const std::string &name, const SimConfig &config) {
+    auto program = LoadProgram((data_dir / name).string());
+    if (!program) {
+        return nullptr;
+    }
+    auto cpu = std::make_unique<Simulator>(std::move(*program), config);
+    cpu->mix_.Enable();
+    return cpu->Run() == PipelineState::ERR ? nullptr : std::move(cpu);
+}
+
+}  // namespace
+
+TEST(DesignSpaceTests, CrossProduct) {
+    DesignSpace space;
+    ASSERT_TRUE(space.AddParameter("bp", "not-taken,two-bit"));
+    ASSERT_TRUE(space.AddParameter("bp-key-size", "4,10"));
+    ASSERT_TRUE(space.AddParameter("dcache-sets", "16,32,64"));
+    ASSERT_FALSE(space.AddParameter("bp-key-size", "5"));
+    ASSERT_FALSE(space.AddParameter("issue-width", "3"));
+    ASSERT_FALSE(space.AddParameter("fetch-width", "2"));
+
+    auto points = space.Points();
+    ASSERT_EQ(points.size(), 12);
+    ASSERT_EQ(space.Parameters(), (std::vector<std::string>{"bp", "bp-key-size", "dcache-sets"}));
+    // Last parameter changes fastest
+    ASSERT_EQ(points[0].values, (std::vector<std::string>{"not-taken", "4", "16"}));
+    ASSERT_EQ(points[1].config.dcache.sets, 32);
+    ASSERT_EQ(points[11].config.bp.type, BranchPredictor::Type::TWO_BIT);
+    ASSERT_EQ(points[11].config.bp.key_size, 10);
+    ASSERT_EQ(points[11].config.dcache.sets, 64);
+}
+
+TEST(DesignSpaceTests, WorkStealing) {
+    WorkStealingPool pool{4};
+    std::vector<std::atomic<int>> runs(37);
+    // First block is slow, its jobs are taken by the other workers
+    pool.Run(runs.size(), [&](size_t job) {
+        if (job < 10) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        ++runs[job];
+    });
+    for (const auto &count : runs) {
+        ASSERT_EQ(count, 1);
+    }
+    ASSERT_GT(pool.Steals(), 0);
+
+    pool.Run(0, [](size_t) { FAIL(); });
+}
+
+TEST(DesignSpaceTests, SweepMatchesSingleRuns) {
+    DesignSpace space;
+    ASSERT_TRUE(space.AddParameter("bp", "not-taken,two-bit"));
+    ASSERT_TRUE(space.AddParameter("issue-width", "1,2"));
+    ASSERT_TRUE(space.AddParameter("dcache-miss-latency", "0,20"));
+    auto points = space.Points();
+    auto programs = LoopPrograms();
+
+    WorkStealingPool pool{3};
+    auto results = RunSweep(points, programs, pool);
+    ASSERT_EQ(results.size(), points.size() * programs.size());
+    for (const auto &result : results) {
+        ASSERT_TRUE(result.ok);
+        auto program = LoadProgram(programs[result.program]);
+        ASSERT_TRUE(program);
+        Simulator cpu = Simulator{std::move(*program), points[result.point].config};
+        ASSERT_NE(cpu.Run(), PipelineState::ERR);
+        ASSERT_EQ(result.cycles, cpu.write_back_.cycle);
+        ASSERT_EQ(result.instructions, cpu.csr_.Instret());
+    }
+
+    // Point 6 is the default configuration, programs are in the order of LoopPrograms()
+    size_t base = (points.size() - 2) * programs.size();
+    ASSERT_EQ(results[base].cycles, 345);
+    ASSERT_EQ(results[base + 1].cycles, 157);
+    ASSERT_EQ(results[base + 2].cycles, 2056);
+    for (size_t program = 0; program < programs.size(); ++program) {
+        // Single issue and static prediction are never faster
+        ASSERT_GE(results[program].cycles, results[base + program].cycles);
+        ASSERT_EQ(results[program].instructions, results[base + program].instructions);
+    }
+}
+
+TEST(DesignSpaceTests, PredictorConfigs) {
+    SimConfig config;
+    config.bp.type = BranchPredictor::Type::NOT_TAKEN;
+    auto not_taken = Simulate("loop2.dat", config);
+    auto two_bit = Simulate("loop2.dat", SimConfig{});
+    ASSERT_TRUE(not_taken && two_bit);
+    ASSERT_EQ(not_taken->csr_.Instret(), two_bit->csr_.Instret());
+    ASSERT_GT(not_taken->cpi_.Slots(Bubble::REDIRECT), two_bit->cpi_.Slots(Bubble::REDIRECT));
+
+    // Every key size keeps the result, only timing changes
+    for (uint8_t key_size : BranchPredictor::key_sizes) {
+        config.bp = {BranchPredictor::Type::TWO_BIT, key_size};
+        auto cpu = Simulate("loop2.dat", config);
+        ASSERT_TRUE(cpu);
+        ASSERT_EQ(cpu->csr_.Instret(), two_bit->csr_.Instret());
+        ASSERT_EQ(cpu->decode_.getRegFile().Read(10), two_bit->decode_.getRegFile().Read(10));
+        ASSERT_EQ(cpu->hu_.getBranchPredictor().getConfig().key_size, key_size);
+    }
+
+    config = SimConfig{};
+    config.issue_width = 1;
+    auto single = Simulate("loop2.dat", config);
+    ASSERT_TRUE(single);
+    ASSERT_GT(single->cpi_.Slots(Bubble::ISSUE_WIDTH), 0);
+    ASSERT_EQ(single->mix_.IssueCycles(2), 0);
+    ASSERT_GT(single->write_back_.cycle, two_bit->write_back_.cycle);
+}
+
+TEST(DesignSpaceTests, ParetoFront) {
+    DesignSpace space;
+    ASSERT_TRUE(space.AddParameter("dcache-miss-latency", "0,100"));
+    ASSERT_TRUE(space.AddParameter("dcache-sets", "16,32,64"));
+    auto points = space.Points();
+    ASSERT_LT(HardwareCost(points[0].config), HardwareCost(points[1].config));
+    ASSERT_LT(HardwareCost(points[1].config), HardwareCost(points[2].config));
+
+    // Latency 0: the middle point is slower than the bigger one. Latency 100 is compared only within itself
+    std::vector<uint64_t> cycles{1000, 1200, 900, 5000, 4000, 4000};
+    ASSERT_EQ(ParetoFront(points, cycles), (std::vector<size_t>{0, 2, 3, 4}));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
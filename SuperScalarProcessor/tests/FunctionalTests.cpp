@@ -0,0 +1,184 @@
+#include "simulator.h"
+#include "TestPrograms.h"
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <thread>
+
+namespace {
+
+// Timing model of the functional-first simulation, its data memory is the one of the functional simulator
+Program WithoutSegments(Program program) {
+    program.segments.clear();
+    return program;
+}
+
+}  // namespace
+
+TEST(FunctionalTests, QueueKeepsOrder) {
+    SPSCQueue<uint32_t> queue{5};
+    ASSERT_EQ(queue.Capacity(), 8);
+
+    constexpr uint32_t count = 100000;
+    std::thread producer{[&]() {
+        for (uint32_t i = 0; i < count; ++i) {
+            queue.Push(i);
+        }
+        queue.Close();
+    }};
+
+    uint32_t item{0};
+    uint32_t expected{0};
+    while (queue.Pop(item)) {
+        ASSERT_EQ(item, expected++);
+    }
+    producer.join();
+    ASSERT_EQ(expected, count);
+}
+
+TEST(FunctionalTests, QueueCancel) {
+    SPSCQueue<uint32_t> queue{2};
+    ASSERT_TRUE(queue.TryPush(1));
+    ASSERT_TRUE(queue.TryPush(2));
+    ASSERT_FALSE(queue.TryPush(3));
+
+    // Producer waiting on the full queue is released when the consumer stops
+    bool pushed{true};
+    std::thread producer{[&]() { pushed = queue.Push(3); }};
+    queue.Cancel();
+    producer.join();
+    ASSERT_FALSE(pushed);
+
+    uint32_t item{0};
+    ASSERT_TRUE(queue.TryPop(item));
+    ASSERT_EQ(item, 1);
+}
+
+TEST(FunctionalTests, SourceLookahead) {
+    QueueSource source{4};
+    for (uint32_t pc = 0; pc < 12; pc += 4) {
+        ASSERT_TRUE(source.getQueue().TryPush(DynInstr{pc, 0, pc + 4}));
+    }
+    source.getQueue().Close();
+
+    // Instructions looked ahead stay in the stream
+    ASSERT_EQ(source.Ahead(1)->pc, 4);
+    DynInstr instr;
+    ASSERT_TRUE(source.Next(instr));
+    ASSERT_EQ(instr.pc, 0);
+    ASSERT_EQ(source.Ahead(1)->pc, 8);
+    ASSERT_EQ(source.Ahead(2), nullptr);
+    ASSERT_TRUE(source.Next(instr));
+    ASSERT_TRUE(source.Next(instr));
+    ASSERT_EQ(instr.pc, 8);
+    ASSERT_FALSE(source.Next(instr));
+}
+
+TEST(FunctionalTests, MatchesPipeline) {
+    for (const auto &path : Programs()) {
+        auto program = LoadProgram(path);
+        ASSERT_TRUE(program.has_value()) << path;
+        FunctionalSimulator functional{Program{*program}};
+        Simulator cpu{std::move(*program)};
+        ASSERT_EQ(functional.Run(), PipelineState::OK) << path;
+        ASSERT_NE(cpu.Run(), PipelineState::ERR) << path;
+
+        ASSERT_EQ(functional.Instret(), cpu.csr_.Instret()) << path;
+        for (uint8_t idx = 0; idx < 32; ++idx) {
+            ASSERT_EQ(functional.Reg(idx), cpu.decode_.getRegFile().Read(idx).to_ulong()) << path << " x" << +idx;
+        }
+    }
+}
+
+TEST(FunctionalTests, FunctionalFirstTiming) {
+    for (const auto &path : Programs()) {
+        auto program = LoadProgram(path);
+        ASSERT_TRUE(program.has_value()) << path;
+        Simulator reference{Program{*program}};
+        ASSERT_NE(reference.Run(), PipelineState::ERR) << path;
+
+        // Tiny queue makes both threads wait for each other all the time
+        FunctionalSimulator functional{Program{*program}};
+        Simulator cpu{WithoutSegments(std::move(*program))};
+        ASSERT_NE(RunFunctionalFirst(cpu, functional, 2), PipelineState::ERR) << path;
+
+        ASSERT_EQ(cpu.write_back_.cycle, reference.write_back_.cycle) << path;
+        ASSERT_EQ(cpu.csr_.Instret(), reference.csr_.Instret()) << path;
+        for (uint8_t bubble = 0; bubble < static_cast<uint8_t>(Bubble::COUNT); ++bubble) {
+            ASSERT_EQ(cpu.cpi_.Slots(Bubble{bubble}), reference.cpi_.Slots(Bubble{bubble})) << path;
+        }
+        // Outcomes and addresses come from the functional simulator, the pipeline doesn't compute them
+        ASSERT_EQ(cpu.csr_.Events(CSRUnit::Event::MISPREDICT), reference.csr_.Events(CSRUnit::Event::MISPREDICT))
+                << path;
+        ASSERT_EQ(cpu.hu_.getBranchPredictor().Changes(), reference.hu_.getBranchPredictor().Changes()) << path;
+        ASSERT_EQ(cpu.memory_.getDCache().Misses(), reference.memory_.getDCache().Misses()) << path;
+        for (uint8_t idx = 0; idx < 32; ++idx) {
+            ASSERT_EQ(cpu.decode_.getRegFile().Read(idx), reference.decode_.getRegFile().Read(idx)) << path;
+        }
+    }
+}
+
+TEST(FunctionalTests, AtomicsAndExit) {
+    /*
+        li t0, 0x100
+        li t1, 5
+        sw t1, 0(t0)
+        li t2, -3
+        amoadd.w a0, t2, (t0)
+        addi a1, a0, 1
+        amomin.w a2, t2, (t0)
+        amomaxu.w a3, t1, (t0)
+        amoswap.w a4, t1, (t0)
+        amoor.w a5, t2, (t0)
+        lw a6, 0(t0)
+        li a0, 7
+        li a7, 93
+        ecall
+        li s1, 1
+        ebreak
+    */
+    std::vector<std::bitset<32>> imem = {
+        0x10000293,
+        0x00500313,
+        0x0062a023,
+        0xffd00393,
+        0x0072a52f,
+        0x00150593,
+        0x8072a62f,
+        0xe062a6af,
+        0x0862a72f,
+        0x4072a7af,
+        0x0002a803,
+        0x00700513,
+        0x05d00893,
+        0x00000073,
+        0x00100493,
+        0x00100073
+    };
+
+    Simulator reference{MakeProgram(std::vector<std::bitset<32>>{imem})};
+    ASSERT_NE(reference.Run(), PipelineState::ERR);
+
+    FunctionalSimulator functional{MakeProgram(std::vector<std::bitset<32>>{imem})};
+    Simulator cpu{MakeProgram(std::move(imem))};
+    ASSERT_NE(RunFunctionalFirst(cpu, functional), PipelineState::ERR);
+
+    ASSERT_EQ(cpu.write_back_.cycle, reference.write_back_.cycle);
+    ASSERT_TRUE(cpu.sys_.isExited());
+    ASSERT_EQ(cpu.sys_.ExitCode(), 7);
+    ASSERT_EQ(cpu.sys_.Calls(), 1);
+    ASSERT_EQ(functional.getAtomicUnit().AMOs(), 5);
+    const uint32_t results[] = {7, 6, 2, 0xfffffffd, 0xfffffffd, 5, 0xfffffffd};
+    for (uint8_t idx = 0; idx < 7; ++idx) {
+        ASSERT_EQ(cpu.decode_.getRegFile().Read(10 + idx).to_ulong(), results[idx]) << "a" << +idx;
+        ASSERT_EQ(functional.Reg(10 + idx), results[idx]) << "a" << +idx;
+    }
+    // Nothing after exit is executed
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s1 */ 9}).to_ulong(), 0);
+    ASSERT_EQ(functional.Reg(/* s1 */ 9), 0);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -71,6 +71,28 @@ TEST(HazardUnitTests, LoadHazard) {
     ASSERT_EQ(cpu.decode_.getRegFile().Read({/* t2 */ 7}), std::bitset<32>{/* 6 */ 0x00000006});
 }
 
+TEST(HazardUnitTests, YoungerBypassDown) {
+    /*
+        li t0, 1
+        li t0, 2
+        add a1, zero, t0
+        add a0, zero, t0
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00100293,
+        0x00200293,
+        0x005005b3,
+        0x00500533
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    // Both instructions of the pair in memory stage write t0, the down one is younger
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a1 */ 11}), std::bitset<32>{/* 2 */ 0x00000002});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{/* 2 */ 0x00000002});
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
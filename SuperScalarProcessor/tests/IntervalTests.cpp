@@ -0,0 +1,147 @@
+#include "interval.h"
+#include "TestPrograms.h"
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+
+namespace {
+
+// Estimate and cycles of the pipeline, the estimate must be within per_mille of them
+void ExpectClose(const std::string &path, const SimConfig &config, uint64_t per_mille) {
+    auto program = LoadProgram(path);
+    ASSERT_TRUE(program.has_value()) << path;
+    Simulator cpu{Program{*program}, config};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR) << path;
+    IntervalModel model{std::move(*program), config};
+    ASSERT_EQ(model.Run(), PipelineState::OK) << path;
+
+    ASSERT_EQ(model.Instret(), cpu.csr_.Instret()) << path;
+    uint64_t error = static_cast<uint64_t>(std::llabs(static_cast<int64_t>(model.Cycles()) -
+                                                      static_cast<int64_t>(cpu.write_back_.cycle)));
+    ASSERT_LE(error * 1000, cpu.write_back_.cycle * per_mille) << path << ": " << model.Cycles() << " instead of "
+                                                            << cpu.write_back_.cycle;
+    ASSERT_EQ(model.getCPIStack().Slots(Bubble::NONE), cpu.cpi_.Slots(Bubble::NONE)) << path;
+    ASSERT_EQ(model.getDCache().Misses(), cpu.memory_.getDCache().Misses()) << path;
+}
+
+}  // namespace
+
+TEST(IntervalTests, MatchesPipeline) {
+    for (const auto &path : Programs()) {
+        ExpectClose(path, SimConfig{}, 0);
+    }
+}
+
+TEST(IntervalTests, MissEvents) {
+    SimConfig static_bp;
+    static_bp.bp.type = BranchPredictor::Type::NOT_TAKEN;
+    SimConfig small_bp;
+    small_bp.bp.key_size = 4;
+    SimConfig slow_memory;
+    slow_memory.dcache.sets = 4;
+    slow_memory.dcache.miss_latency = 30;
+    slow_memory.l2.sets = 16;
+    slow_memory.l2.latency = 5;
+    for (const auto &config : {static_bp, small_bp, slow_memory}) {
+        for (const auto &path : Programs()) {
+            ExpectClose(path, config, 0);
+        }
+    }
+}
+
+TEST(IntervalTests, SingleIssueBound) {
+    // Load-use stalls the pipeline checks only after a write-back bypass are missed, sort.dat has one per outer
+    // iteration: 19033 cycles instead of 19096
+    SimConfig single;
+    single.issue_width = 1;
+    for (const auto &path : Programs()) {
+        ExpectClose(path, single, 4);
+    }
+    SimConfig slow_single = single;
+    slow_single.dcache.sets = 4;
+    slow_single.dcache.miss_latency = 30;
+    for (const auto &path : Programs()) {
+        ExpectClose(path, slow_single, 4);
+    }
+}
+
+TEST(IntervalTests, SerializingAndExit) {
+    /*
+        li t0, 0x100
+        li t1, 5
+        amoadd.w a0, t1, (t0)
+        csrr a1, instret
+        lw a2, 0(t0)
+        beq a2, a2, next
+    next:
+        li a0, 7
+        li a7, 93
+        ecall
+        li s1, 1
+        ebreak
+    */
+    std::vector<std::bitset<32>> imem = {
+        0x10000293,
+        0x00500313,
+        0x0062a52f,
+        0xc02025f3,
+        0x0002a603,
+        0x00c60263,
+        0x00700513,
+        0x05d00893,
+        0x00000073,
+        0x00100493,
+        0x00100073
+    };
+    SimConfig config;
+    config.atomic_latency = 3;
+    Simulator cpu{MakeProgram(std::vector<std::bitset<32>>{imem}), config};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    IntervalModel model{MakeProgram(std::move(imem)), config};
+    ASSERT_EQ(model.Run(), PipelineState::OK);
+
+    ASSERT_EQ(model.Cycles(), cpu.write_back_.cycle);
+    for (uint8_t bubble = 0; bubble < static_cast<uint8_t>(Bubble::COUNT); ++bubble) {
+        ASSERT_EQ(model.getCPIStack().Slots(Bubble{bubble}), cpu.cpi_.Slots(Bubble{bubble})) << +bubble;
+    }
+    // Branch to the next instruction is taken and mispredicted the first time
+    ASSERT_EQ(model.Mispredictions(), 1);
+    ASSERT_TRUE(model.getFunctional().getSyscallUnit().isExited());
+    ASSERT_EQ(model.getFunctional().getSyscallUnit().ExitCode(), 7);
+    ASSERT_EQ(model.getFunctional().Reg(/* s1 */ 9), 0);
+}
+
+TEST(IntervalTests, MemoizedBlocks) {
+    SimConfig slow_memory;
+    slow_memory.dcache.sets = 4;
+    slow_memory.dcache.miss_latency = 30;
+    SimConfig single;
+    single.issue_width = 1;
+    for (const auto &config : {SimConfig{}, slow_memory, single}) {
+        for (const auto &path : Programs()) {
+            auto program = LoadProgram(path);
+            ASSERT_TRUE(program.has_value()) << path;
+            IntervalModel full{Program{*program}, config};
+            ASSERT_EQ(full.Run(), PipelineState::OK) << path;
+            IntervalModel memoized{std::move(*program), config, true};
+            ASSERT_EQ(memoized.Run(), PipelineState::OK) << path;
+
+            // Every program has a loop entering its blocks in the same states
+            ASSERT_EQ(full.MemoHits(), 0) << path;
+            ASSERT_GT(memoized.MemoHits(), 0) << path;
+            ASSERT_EQ(memoized.Cycles(), full.Cycles()) << path;
+            for (uint8_t bubble = 0; bubble < static_cast<uint8_t>(Bubble::COUNT); ++bubble) {
+                ASSERT_EQ(memoized.getCPIStack().Slots(Bubble{bubble}), full.getCPIStack().Slots(Bubble{bubble}))
+                        << path << " " << +bubble;
+            }
+            ASSERT_EQ(memoized.Mispredictions(), full.Mispredictions()) << path;
+            ASSERT_EQ(memoized.getDCache().Misses(), full.getDCache().Misses()) << path;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,214 @@
+#include "simulator.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+
+#ifndef EM_RISCV
+#define EM_RISCV 243
+#endif
+
+namespace {
+
+constexpr uint32_t text_addr = 0x1000;
+constexpr uint32_t data_addr = 0x2000;
+
+/*
+    _start:
+    lui t2, 2
+    lw a0, 0(t2)
+    lw a1, 4(t2)
+    add a2, a0, a1
+    sw a2, 8(t2)
+    ebreak
+*/
+const std::vector<uint32_t> text = {
+    0x000023b7,
+    0x0003a503,
+    0x0043a583,
+    0x00b50633,
+    0x00c3a423,
+    0x00100073
+};
+const std::vector<uint32_t> data = {40, 2, 0};
+
+template<typename T>
+void Append(std::string &image, const T &value) {
+    image.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+// Minimal executable: ehdr, two program headers, .text, .data, .symtab, .strtab and section headers
+std::string BuildELF() {
+    const char strtab[] = "\0_start";
+    const uint32_t text_offset = sizeof(Elf32_Ehdr) + 2 * sizeof(Elf32_Phdr);
+    const uint32_t data_offset = text_offset + text.size() * 4;
+    const uint32_t symtab_offset = data_offset + data.size() * 4;
+    const uint32_t strtab_offset = symtab_offset + 2 * sizeof(Elf32_Sym);
+    const uint32_t shdr_offset = strtab_offset + sizeof(strtab);
+
+    Elf32_Ehdr ehdr{};
+    std::memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_EXEC;
+    ehdr.e_machine = EM_RISCV;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_entry = text_addr;
+    ehdr.e_phoff = sizeof(Elf32_Ehdr);
+    ehdr.e_shoff = shdr_offset;
+    ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+    ehdr.e_phentsize = sizeof(Elf32_Phdr);
+    ehdr.e_phnum = 2;
+    ehdr.e_shentsize = sizeof(Elf32_Shdr);
+    ehdr.e_shnum = 3;
+
+    Elf32_Phdr text_phdr{PT_LOAD, text_offset, text_addr, text_addr,
+                         static_cast<uint32_t>(text.size() * 4), static_cast<uint32_t>(text.size() * 4),
+                         PF_R | PF_X, 4};
+    // bss goes after the data
+    Elf32_Phdr data_phdr{PT_LOAD, data_offset, data_addr, data_addr,
+                         static_cast<uint32_t>(data.size() * 4), 0x100, PF_R | PF_W, 4};
+
+    Elf32_Sym null_sym{};
+    Elf32_Sym start_sym{1, text_addr, static_cast<uint32_t>(text.size() * 4),
+                        ELF32_ST_INFO(STB_GLOBAL, STT_FUNC), 0, 1};
+
+    Elf32_Shdr null_shdr{};
+    Elf32_Shdr symtab_shdr{0, SHT_SYMTAB, 0, 0, symtab_offset, 2 * sizeof(Elf32_Sym), 2, 1, 4, sizeof(Elf32_Sym)};
+    Elf32_Shdr strtab_shdr{0, SHT_STRTAB, 0, 0, strtab_offset, sizeof(strtab), 0, 0, 1, 0};
+
+    std::string image;
+    Append(image, ehdr);
+    Append(image, text_phdr);
+    Append(image, data_phdr);
+    for (uint32_t word : text) {
+        Append(image, word);
+    }
+    for (uint32_t word : data) {
+        Append(image, word);
+    }
+    Append(image, null_sym);
+    Append(image, start_sym);
+    image.append(strtab, sizeof(strtab));
+    Append(image, null_shdr);
+    Append(image, symtab_shdr);
+    Append(image, strtab_shdr);
+    return image;
+}
+
+std::string WriteTemp(const std::string &name, const std::string &content) {
+    std::string path = testing::TempDir() + name;
+    std::ofstream file(path, std::ios::binary);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    return path;
+}
+
+}  // namespace
+
+TEST(LoaderTests, DMEMByteAddressable) {
+    DMEM dmem;
+    dmem.Store({0x11223344}, {0x102});
+    ASSERT_EQ(dmem.Load({0x102}, DMEM::Width::BYTE_U), std::bitset<32>{0x44});
+    ASSERT_EQ(dmem.Load({0x105}, DMEM::Width::BYTE_U), std::bitset<32>{0x11});
+    ASSERT_EQ(dmem.Load({0x104}, DMEM::Width::HALF_U), std::bitset<32>{0x1122});
+    ASSERT_EQ(dmem.Load({0x100}, DMEM::Width::WORD), std::bitset<32>{0x33440000});
+
+    // Access crossing the page boundary
+    dmem.Store({0xdeadbeef}, {DMEM::page_size - 2});
+    ASSERT_EQ(dmem.Load({DMEM::page_size - 2}), std::bitset<32>{0xdeadbeef});
+    ASSERT_EQ(dmem.Load({DMEM::page_size}, DMEM::Width::HALF), std::bitset<32>{0xffffdead});
+}
+
+TEST(LoaderTests, DMEMMapWithoutCopy) {
+    std::vector<uint8_t> buffer(DMEM::page_size + 8, 0);
+    buffer[0] = 0x7f;
+    DMEM dmem;
+    dmem.Map(0x4000, buffer.data(), static_cast<uint32_t>(buffer.size()));
+
+    // Whole page is backed by the buffer itself, the tail is copied
+    buffer[1] = 0x42;
+    ASSERT_EQ(dmem.Load({0x4000}, DMEM::Width::HALF_U), std::bitset<32>{0x427f});
+    buffer[DMEM::page_size] = 0x42;
+    ASSERT_EQ(dmem.Load({0x4000 + DMEM::page_size}, DMEM::Width::BYTE_U), std::bitset<32>{0});
+}
+
+TEST(LoaderTests, LoadELF) {
+    auto path = WriteTemp("loader_tests.elf", BuildELF());
+    auto program = LoadProgram(path);
+    ASSERT_TRUE(program.has_value());
+
+    ASSERT_EQ(program->entry.realVal(), text_addr);
+    ASSERT_EQ(program->stack_pointer, stack_top);
+    ASSERT_EQ(program->imem.getBase().realVal(), text_addr);
+    ASSERT_EQ(program->imem.size(), text.size());
+    ASSERT_EQ(program->segments.size(), 2);
+
+    const Symbol *symbol = program->symbols.Lookup(text_addr + 8);
+    ASSERT_NE(symbol, nullptr);
+    ASSERT_EQ(symbol->name, "_start");
+    ASSERT_EQ(program->symbols.Lookup(data_addr), nullptr);
+
+    Simulator cpu = Simulator{std::move(*program)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* sp */ 2}), std::bitset<32>{stack_top});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a2 */ 12}), std::bitset<32>{42});
+    ASSERT_EQ(cpu.memory_.loadFromDMEM({data_addr + 8}), std::bitset<32>{42});
+    std::remove(path.c_str());
+}
+
+TEST(LoaderTests, RejectsNonRISCV) {
+    auto image = BuildELF();
+    image[offsetof(Elf32_Ehdr, e_machine)] = EM_386;
+    auto path = WriteTemp("loader_tests_x86.elf", image);
+    ASSERT_FALSE(LoadProgram(path).has_value());
+    std::remove(path.c_str());
+}
+
+TEST(LoaderTests, LoadHex) {
+    auto path = WriteTemp("loader_tests.dat", "00100093\n00208113\n\n00100073\n");
+    auto program = LoadProgram(path);
+    ASSERT_TRUE(program.has_value());
+    ASSERT_EQ(program->imem.size(), 3);
+    ASSERT_EQ(program->entry.realVal(), 0);
+
+    Simulator cpu = Simulator{std::move(*program)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* ra */ 1}), std::bitset<32>{1});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* sp */ 2}), std::bitset<32>{3});
+    std::remove(path.c_str());
+}
+
+TEST(LoaderTests, LoadHexRejectsGarbage) {
+    auto path = WriteTemp("loader_tests_bad.dat", "0x00100093\n0x0020811z\n");
+    ASSERT_FALSE(LoadProgram(path).has_value());
+    std::remove(path.c_str());
+}
+
+TEST(LoaderTests, LoadBin) {
+    std::string image;
+    for (uint32_t word : {0x00100093u, 0x00208113u, 0x00100073u}) {
+        Append(image, word);
+    }
+    auto path = WriteTemp("loader_tests.bin", image);
+    auto program = LoadProgram(path);
+    ASSERT_TRUE(program.has_value());
+    ASSERT_EQ(program->imem.size(), 3);
+    ASSERT_NE(program->image, nullptr);
+
+    Simulator cpu = Simulator{std::move(*program)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* sp */ 2}), std::bitset<32>{3});
+    std::remove(path.c_str());
+
+    auto truncated = WriteTemp("loader_tests_truncated.bin", image.substr(0, 10));
+    ASSERT_FALSE(LoadProgram(truncated).has_value());
+    std::remove(truncated.c_str());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+#include "simulator.h"
+#include "logger.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+std::vector<std::string> ReadLines(const std::string &path) {
+    std::ifstream in{path};
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+}  // namespace
+
+// Messages of the levels removed at compile time are never written
+#define SKIP_IF_COMPILED_OUT()                          \
+    if (SIM_LOG_LEVEL < static_cast<int>(Logger::L2)) { \
+        GTEST_SKIP();                                   \
+    }
+
+TEST(LoggerTests, Format) {
+    SKIP_IF_COMPILED_OUT()
+    std::string path = testing::TempDir() + "logger_tests_format.txt";
+    ASSERT_TRUE(Logger::Get().Start(path, Logger::L1));
+    LOG(L0, MEMORY, 7, "store {x} -> [{}] {d}", 0xbeef, 16, -1);
+    // Above the runtime level
+    LOG(L2, FETCH, 8, "fetch {i}", 0x00100073);
+    LOG(L1, FETCH, 9, "fetch {i} {z}", 0x00100073);
+    Logger::Get().Stop();
+
+    auto lines = ReadLines(path);
+    std::remove(path.c_str());
+    ASSERT_EQ(lines.size(), 2);
+    ASSERT_EQ(lines[0], "7 | M | store 0000beef -> [16] -1");
+    ASSERT_EQ(lines[1], "9 | F | fetch 00100073 {z}");
+}
+
+TEST(LoggerTests, ManyThreads) {
+    SKIP_IF_COMPILED_OUT()
+    std::string path = testing::TempDir() + "logger_tests_threads.txt";
+    ASSERT_TRUE(Logger::Get().Start(path, Logger::L2));
+    uint64_t written = Logger::Get().Written();
+
+    // More messages than a ring holds, producers wait for the writer
+    constexpr uint32_t threads = 4, messages = 50000;
+    std::vector<std::thread> producers;
+    for (uint32_t t = 0; t < threads; ++t) {
+        producers.emplace_back([t] {
+            for (uint32_t i = 0; i < messages; ++i) {
+                LOG(L2, EXECUTE, i, "thread {} message {}", t, i);
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    Logger::Get().Stop();
+
+    auto lines = ReadLines(path);
+    std::remove(path.c_str());
+    ASSERT_EQ(lines.size(), threads * messages);
+    ASSERT_EQ(Logger::Get().Written() - written, threads * messages);
+}
+
+TEST(LoggerTests, WriteBack) {
+    SKIP_IF_COMPILED_OUT()
+    /*
+        li t0, 0
+        li t2, 10
+        loop_head:
+        bge t0, t2, loop_end
+        addi t0, t0, 1
+        j loop_head
+        loop_end:
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00000293,
+        0x00a00393,
+        0x0072d663,
+        0x00128293,
+        0xff9ff06f
+    };
+
+    std::string path = testing::TempDir() + "logger_tests_write_back.txt";
+    ASSERT_TRUE(Logger::Get().Start(path, Logger::L0));
+    Simulator cpu = Simulator{std::move(imem)};
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    Logger::Get().Stop();
+
+    auto lines = ReadLines(path);
+    std::remove(path.c_str());
+    // Every register write of the program: two li and ten increments
+    ASSERT_EQ(lines.size(), 12);
+    ASSERT_NE(lines.back().find("| W | x5 <- 0000000a"), std::string::npos);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,284 @@
+#include "simulator.h"
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+
+#ifndef EM_RISCV
+#define EM_RISCV 243
+#endif
+
+namespace {
+
+/*
+    li t0, 0
+    li t1, 64
+    li t2, 0
+    li a0, 0
+    loop:
+    lw t3, 0(t2)
+    add a0, a0, t3
+    addi t2, t2, 64
+    addi t0, t0, 1
+    blt t0, t1, loop
+*/
+std::vector<std::bitset<32>> StrideLoop() {
+    return {
+        0x00000293,
+        0x04000313,
+        0x00000393,
+        0x00000513,
+        0x0003ae03,
+        0x01c50533,
+        0x04038393,
+        0x00128293,
+        0xfe62c8e3
+    };
+}
+
+void SetupStrideData(Simulator &cpu) {
+    for (uint32_t i = 0; i < 64; ++i) {
+        cpu.memory_.storeToDMEM({i + 1}, {i * 64});
+    }
+}
+
+/*
+    _start:
+    lui t2, 0x20
+    li a0, 0
+    loop:
+    lw t0, 0(t2)
+    addi t0, t0, 1
+    sw t0, 0(t2)
+    addi a0, a0, 1
+    li t1, 50
+    blt t0, t1, loop
+    ebreak
+*/
+// Executable whose loop counts the word at 0x20000 up to 50, the word is in a whole page of .data that is mapped
+// from the file
+std::string WriteDataLoopELF() {
+    const std::vector<uint32_t> text = {
+        0x000203b7,
+        0x00000513,
+        0x0003a283,
+        0x00128293,
+        0x0053a023,
+        0x00150513,
+        0x03200313,
+        0xfe62c6e3,
+        0x00100073
+    };
+    constexpr uint32_t text_addr = 0x10000;
+    constexpr uint32_t data_addr = 0x20000;
+    const uint32_t text_offset = sizeof(Elf32_Ehdr) + 2 * sizeof(Elf32_Phdr);
+    const uint32_t data_offset = text_offset + static_cast<uint32_t>(text.size() * 4);
+
+    Elf32_Ehdr ehdr{};
+    std::memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_EXEC;
+    ehdr.e_machine = EM_RISCV;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_entry = text_addr;
+    ehdr.e_phoff = sizeof(Elf32_Ehdr);
+    ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+    ehdr.e_phentsize = sizeof(Elf32_Phdr);
+    ehdr.e_phnum = 2;
+    Elf32_Phdr text_phdr{PT_LOAD, text_offset, text_addr, text_addr, static_cast<uint32_t>(text.size() * 4),
+                         static_cast<uint32_t>(text.size() * 4), PF_R | PF_X, 4};
+    Elf32_Phdr data_phdr{PT_LOAD, data_offset, data_addr, data_addr, DMEM::page_size, DMEM::page_size,
+                         PF_R | PF_W, 4};
+
+    std::string path = testing::TempDir() + "memory_hierarchy_tests.elf";
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&ehdr), sizeof(ehdr));
+    file.write(reinterpret_cast<const char *>(&text_phdr), sizeof(text_phdr));
+    file.write(reinterpret_cast<const char *>(&data_phdr), sizeof(data_phdr));
+    file.write(reinterpret_cast<const char *>(text.data()), static_cast<std::streamsize>(text.size() * 4));
+    std::string data(DMEM::page_size, '\0');
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return path;
+}
+
+}  // namespace
+
+TEST(MemoryHierarchyTests, DataCacheHitAfterMiss) {
+    DataCache dcache{DataCache::Config{4, 2, 32, 10}};
+    ASSERT_FALSE(dcache.Access(0x100));
+    ASSERT_TRUE(dcache.Access(0x100));
+    ASSERT_TRUE(dcache.Access(0x11c));  // same line
+    ASSERT_FALSE(dcache.Access(0x120));  // next line
+    ASSERT_EQ(dcache.Hits(), 2);
+    ASSERT_EQ(dcache.Misses(), 2);
+}
+
+TEST(MemoryHierarchyTests, DataCacheLRU) {
+    // One set with two ways: lines with addresses 0x0, 0x20 and 0x40 conflict
+    DataCache dcache{DataCache::Config{1, 2, 32, 10}};
+    dcache.Access(0x0);
+    dcache.Access(0x20);
+    dcache.Access(0x0);
+    dcache.Access(0x40);  // evicts 0x20
+    ASSERT_TRUE(dcache.Probe(0x0));
+    ASSERT_FALSE(dcache.Probe(0x20));
+    ASSERT_TRUE(dcache.Probe(0x40));
+}
+
+TEST(MemoryHierarchyTests, DataCachePrefetch) {
+    // Two MSHRs, fills take 10 cycles
+    DataCache dcache{DataCache::Config{4, 2, 32, 10, 2}};
+    ASSERT_TRUE(dcache.Prefetch(0x200, 0));
+    ASSERT_FALSE(dcache.Prefetch(0x200, 1));
+    ASSERT_TRUE(dcache.Prefetch(0x300, 1));
+    ASSERT_FALSE(dcache.Prefetch(0x400, 2));  // both MSHRs are busy
+    ASSERT_FALSE(dcache.Ready(0x200, 9));
+    ASSERT_TRUE(dcache.Ready(0x200, 10));
+    ASSERT_TRUE(dcache.Access(0x204, false, 10));
+    ASSERT_TRUE(dcache.Access(0x208, false, 10));
+    ASSERT_FALSE(dcache.Access(0x304, false, 8));  // fill of the line ends in 3 cycles
+    ASSERT_EQ(dcache.MissLatency(), 3);
+    ASSERT_TRUE(dcache.Prefetch(0x400, 11));
+    ASSERT_EQ(dcache.Prefetches(), 3);
+    ASSERT_EQ(dcache.UsefulPrefetches(), 1);
+    ASSERT_EQ(dcache.LatePrefetches(), 1);
+}
+
+TEST(MemoryHierarchyTests, CoherenceMESI) {
+    // No L2 sets: misses go to memory unless another cache holds the line Modified
+    DataCache::Config config{4, 2, 32, 50};
+    auto l2 = std::make_shared<L2Cache>(L2Cache::Config{0, 8, 10}, config, 2);
+    DataCache a{config};
+    DataCache b{config};
+    a.setL2(l2, 0);
+    b.setL2(l2, 1);
+
+    ASSERT_FALSE(a.Access(0x100));  // Exclusive
+    ASSERT_EQ(a.MissLatency(), 50);
+    ASSERT_FALSE(b.Access(0x104));  // both Shared
+    ASSERT_TRUE(a.Access(0x100, true));  // upgrade to Modified invalidates b
+    ASSERT_EQ(a.Invalidations(), 1);
+    ASSERT_FALSE(b.Access(0x104));  // a wrote another word of the line
+    ASSERT_EQ(b.MissLatency(), 10);
+    ASSERT_TRUE(b.Access(0x100, true));
+    ASSERT_FALSE(a.Access(0x100));  // b wrote this very word
+
+    ASSERT_EQ(a.CoherenceMisses(), 1);
+    ASSERT_EQ(a.FalseSharingMisses(), 0);
+    ASSERT_EQ(b.CoherenceMisses(), 1);
+    ASSERT_EQ(b.FalseSharingMisses(), 1);
+    ASSERT_EQ(l2->Transfers(), 2);
+    ASSERT_EQ(l2->Writebacks(), 2);
+
+    auto lines = l2->HotLines(8);
+    ASSERT_EQ(lines.size(), 1);
+    ASSERT_EQ(lines[0].first, 0x100);
+    ASSERT_EQ(lines[0].second.invalidations, 2);
+    ASSERT_EQ(lines[0].second.coherence_misses, 2);
+    ASSERT_EQ(lines[0].second.false_sharing, 1);
+    ASSERT_EQ(lines[0].second.writers, 0b11);
+}
+
+TEST(MemoryHierarchyTests, L2WritebackAndHit) {
+    // Private cache of one line in front of L2
+    DataCache::Config config{1, 1, 32, 50};
+    DataCache dcache{config};
+    dcache.setL2(std::make_shared<L2Cache>(L2Cache::Config{16, 2, 10}, config), 0);
+
+    ASSERT_FALSE(dcache.Access(0x0, true));
+    ASSERT_EQ(dcache.MissLatency(), 50);
+    ASSERT_FALSE(dcache.Access(0x20));  // writes back Modified 0x0
+    ASSERT_FALSE(dcache.Access(0x0));
+    ASSERT_EQ(dcache.MissLatency(), 10);
+
+    const L2Cache &l2 = *dcache.getL2();
+    ASSERT_EQ(l2.Hits(), 1);
+    ASSERT_EQ(l2.Misses(), 2);
+    ASSERT_EQ(l2.Writebacks(), 1);
+    ASSERT_EQ(dcache.CoherenceMisses(), 0);
+}
+
+TEST(MemoryHierarchyTests, BlockingMissLatency) {
+    Simulator ideal = Simulator{StrideLoop()};
+    SetupStrideData(ideal);
+    ASSERT_NE(ideal.Run(), PipelineState::ERR);
+
+    SimConfig config;
+    config.dcache.miss_latency = 50;
+    Simulator cpu = Simulator{StrideLoop(), config};
+    SetupStrideData(cpu);
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{/* 2080 */ 0x00000820});
+    auto misses = cpu.memory_.getDCache().Misses();
+    ASSERT_GE(misses, 64);
+    ASSERT_EQ(cpu.write_back_.cycle, ideal.write_back_.cycle + misses * 50);
+    ASSERT_EQ(cpu.cpi_.Slots(Bubble::DCACHE_MISS), CPIStack::issue_width * misses * 50);
+    ASSERT_EQ(cpu.cpi_.TotalSlots(), CPIStack::issue_width * cpu.write_back_.cycle);
+}
+
+TEST(MemoryHierarchyTests, Runahead) {
+    SimConfig config;
+    config.dcache.miss_latency = 50;
+    Simulator blocking = Simulator{StrideLoop(), config};
+    SetupStrideData(blocking);
+    ASSERT_NE(blocking.Run(), PipelineState::ERR);
+
+    config.runahead = true;
+    Simulator cpu = Simulator{StrideLoop(), config};
+    SetupStrideData(cpu);
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+
+    // Runahead must not change architectural state
+    for (uint8_t reg = 0; reg < 32; ++reg) {
+        ASSERT_EQ(cpu.decode_.getRegFile().Read({reg}), blocking.decode_.getRegFile().Read({reg}));
+    }
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{/* 2080 */ 0x00000820});
+    const DataCache &dcache = cpu.memory_.getDCache();
+    ASSERT_GT(cpu.ra_.Prefetches(), 0);
+    // Blocking miss holds one of the MSHRs until the end of its episode, prefetches of the episode complete later
+    ASSERT_LE(cpu.ra_.Prefetches(), cpu.ra_.Episodes() * (config.dcache.mshrs - 1));
+    ASSERT_LE(dcache.UsefulPrefetches() + dcache.LatePrefetches(), cpu.ra_.Prefetches());
+    ASSERT_LT(cpu.write_back_.cycle, blocking.write_back_.cycle);
+    ASSERT_LE(blocking.write_back_.cycle - cpu.write_back_.cycle, dcache.UsefulPrefetches() * 50);
+
+    // Fewer MSHRs bound the prefetches
+    config.dcache.mshrs = 2;
+    Simulator bounded = Simulator{StrideLoop(), config};
+    SetupStrideData(bounded);
+    ASSERT_NE(bounded.Run(), PipelineState::ERR);
+    ASSERT_EQ(bounded.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{/* 2080 */ 0x00000820});
+    ASSERT_LE(bounded.ra_.Prefetches(), bounded.ra_.Episodes());
+    ASSERT_GT(bounded.write_back_.cycle, cpu.write_back_.cycle);
+
+    // Blocking run the savings are measured against loads the program again, as cpu does: copies of a loaded
+    // program share its data pages, which the runahead run has already counted up
+    config = SimConfig{};
+    config.dcache.miss_latency = 20;
+    config.runahead = true;
+    std::string path = WriteDataLoopELF();
+    auto program = LoadProgram(path);
+    ASSERT_TRUE(program.has_value());
+    Simulator elf_cpu = Simulator{std::move(*program), config};
+    ASSERT_NE(elf_cpu.Run(), PipelineState::ERR);
+    ASSERT_EQ(elf_cpu.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{50});
+    ASSERT_EQ(elf_cpu.memory_.loadFromDMEM({0x20000}), std::bitset<32>{50});
+
+    config.runahead = false;
+    program = LoadProgram(path);
+    ASSERT_TRUE(program.has_value());
+    Simulator elf_blocking = Simulator{std::move(*program), config};
+    ASSERT_EQ(elf_blocking.memory_.loadFromDMEM({0x20000}), std::bitset<32>{0});
+    ASSERT_NE(elf_blocking.Run(), PipelineState::ERR);
+    ASSERT_EQ(elf_blocking.decode_.getRegFile().Read({/* a0 */ 10}), std::bitset<32>{50});
+    // Single line misses once, there is nothing to prefetch
+    ASSERT_EQ(elf_blocking.write_back_.cycle, elf_cpu.write_back_.cycle);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,331 @@
+#include "multihart.h"
+#include "TestPrograms.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+uint32_t Load(MultiHart &harts, uint32_t addr) {
+    return static_cast<uint32_t>(harts.Hart(0).memory_.loadFromDMEM({addr}).to_ulong());
+}
+
+}  // namespace
+
+TEST(MultiHartTests, SharedMemory) {
+    /*
+        csrr t0, mhartid
+        slli t1, t0, 6
+        addi t2, t1, 64
+        li t3, 0
+        loop:
+        bge t1, t2, done
+        add t3, t3, t1
+        addi t1, t1, 1
+        j loop
+        done:
+        slli t4, t0, 2
+        sw t3, 0x100(t4)
+        ebreak
+    */
+    std::vector<std::bitset<32>> imem = {
+        0xf14022f3,
+        0x00629313,
+        0x04030393,
+        0x00000e13,
+        0x00735863,
+        0x006e0e33,
+        0x00130313,
+        0xff5ff06f,
+        0x00229e93,
+        0x11cea023,
+        0x00100073
+    };
+
+    MultiHart::Config config;
+    config.harts = 4;
+    config.quantum = 50;
+    MultiHart harts{MakeProgram(std::move(imem)), config};
+    ASSERT_EQ(harts.Run(), PipelineState::OK);
+
+    // Every hart sums its own 64 numbers and all sums are in the memory of hart 0
+    for (uint32_t id = 0; id < 4; ++id) {
+        ASSERT_EQ(Load(harts, 0x100 + 4 * id), 4096 * id + 2016);
+        ASSERT_EQ(harts.Hart(id).decode_.getRegFile().Read(10), id);
+        ASSERT_EQ(harts.Hart(id).csr_.Instret(), harts.Hart(0).csr_.Instret());
+    }
+    ASSERT_EQ(harts.Cycles(), harts.Hart(0).write_back_.cycle);
+    ASSERT_GE(harts.Quanta(), harts.Cycles() / config.quantum);
+}
+
+TEST(MultiHartTests, MessagePassing) {
+    /*
+        bnez a0, consumer
+        li t0, 42
+        sw t0, 0x300(x0)
+        li t1, 1
+        sw t1, 0x304(x0)
+        ebreak
+        consumer:
+        lw t1, 0x304(x0)
+        beqz t1, consumer
+        lw t0, 0x300(x0)
+        addi t0, t0, 1
+        sw t0, 0x308(x0)
+        ebreak
+    */
+    std::vector<std::bitset<32>> imem = {
+        0x00051c63,
+        0x02a00293,
+        0x30502023,
+        0x00100313,
+        0x30602223,
+        0x00100073,
+        0x30402303,
+        0xfe030ee3,
+        0x30002283,
+        0x00128293,
+        0x30502423,
+        0x00100073
+    };
+
+    // Consumer spins until the producer's stores become visible
+    for (bool deterministic : {false, true}) {
+        MultiHart::Config config;
+        config.quantum = 3;
+        config.deterministic = deterministic;
+        MultiHart harts{MakeProgram(std::vector<std::bitset<32>>{imem}), config};
+        ASSERT_EQ(harts.Run(), PipelineState::OK);
+        ASSERT_EQ(Load(harts, 0x308), 43);
+        ASSERT_GT(harts.Hart(1).csr_.Instret(), harts.Hart(0).csr_.Instret());
+    }
+}
+
+TEST(MultiHartTests, Deterministic) {
+    /*
+        li t0, 200
+        loop:
+        lw t1, 0x200(x0)
+        addi t1, t1, 1
+        sw t1, 0x200(x0)
+        addi t0, t0, -1
+        bnez t0, loop
+        ebreak
+    */
+    std::vector<std::bitset<32>> imem = {
+        0x0c800293,
+        0x20002303,
+        0x00130313,
+        0x20602023,
+        0xfff28293,
+        0xfe0298e3,
+        0x00100073
+    };
+
+    // Racy increments interleave the same way on every run
+    auto run = [&](uint64_t quantum) {
+        MultiHart::Config config;
+        config.harts = 3;
+        config.quantum = quantum;
+        config.deterministic = true;
+        MultiHart harts{MakeProgram(std::vector<std::bitset<32>>{imem}), config};
+        EXPECT_EQ(harts.Run(), PipelineState::OK);
+        return std::make_pair(Load(harts, 0x200), harts.Cycles());
+    };
+    auto first = run(7);
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(run(7), first);
+    }
+    ASSERT_LT(first.first, 600);
+
+    // Harts don't overlap when the quantum is longer than the program
+    ASSERT_EQ(run(100000).first, 600);
+}
+
+TEST(MultiHartTests, Atomics) {
+    /*
+        li a1, 0x200
+        li a2, 0x204
+        li t0, 100
+        li t2, 1
+        loop:
+        amoadd.w zero, t2, (a1)
+        retry:
+        lr.w t1, (a2)
+        addi t1, t1, 1
+        sc.w t3, t1, (a2)
+        bnez t3, retry
+        addi t0, t0, -1
+        bnez t0, loop
+        ebreak
+    */
+    std::vector<std::bitset<32>> imem = {
+        0x20000593,
+        0x20400613,
+        0x06400293,
+        0x00100393,
+        0x0075a02f,
+        0x1006232f,
+        0x00130313,
+        0x18662e2f,
+        0xfe0e1ae3,
+        0xfff28293,
+        0xfe0294e3,
+        0x00100073
+    };
+
+    // Unlike the racy increments no update is lost, however the harts interleave
+    for (bool deterministic : {false, true}) {
+        MultiHart::Config config;
+        config.harts = 4;
+        config.quantum = 3;
+        config.deterministic = deterministic;
+        config.core.atomic_latency = 2;
+        MultiHart harts{MakeProgram(std::vector<std::bitset<32>>{imem}), config};
+        ASSERT_EQ(harts.Run(), PipelineState::OK);
+        ASSERT_EQ(Load(harts, 0x200), 400);
+        ASSERT_EQ(Load(harts, 0x204), 400);
+
+        std::vector<const AtomicUnit *> units;
+        uint64_t sc = 0, sc_failures = 0;
+        for (uint32_t id = 0; id < 4; ++id) {
+            const AtomicUnit &atomic = harts.Hart(id).memory_.getAtomicUnit();
+            ASSERT_EQ(atomic.AMOs(), 100);
+            ASSERT_EQ(atomic.StoreConditional() - atomic.StoreConditionalFailures(), 100);
+            sc += atomic.StoreConditional();
+            sc_failures += atomic.StoreConditionalFailures();
+            units.push_back(&atomic);
+        }
+
+        // Only the two words are accessed atomically and every failed sc is counted on them
+        auto words = AtomicUnit::HotWords(units, 8);
+        ASSERT_EQ(words.size(), 2);
+        uint64_t accesses = 0, failures = 0;
+        for (const auto &[addr, word] : words) {
+            ASSERT_TRUE(addr == 0x200 || addr == 0x204);
+            accesses += word.accesses;
+            failures += word.sc_failures;
+        }
+        ASSERT_EQ(accesses, 400 + 2 * sc);
+        ASSERT_EQ(failures, sc_failures);
+        if (deterministic) {
+            // Harts take turns every 3 cycles, so the words keep migrating
+            ASSERT_GT(words.front().second.handoffs, 0);
+        }
+    }
+}
+
+TEST(MultiHartTests, ReservationBrokenByStore) {
+    /*
+        bnez a0, other
+        li t0, 0x300
+        lr.w t1, (t0)
+        li t2, 20
+        wait:
+        addi t2, t2, -1
+        bnez t2, wait
+        sc.w a1, t1, (t0)
+        ebreak
+        other:
+        li t2, 10
+        delay:
+        addi t2, t2, -1
+        bnez t2, delay
+        li t1, 5
+        sw t1, 0x300(x0)
+        ebreak
+    */
+    std::vector<std::bitset<32>> imem = {
+        0x02051063,
+        0x30000293,
+        0x1002a32f,
+        0x01400393,
+        0xfff38393,
+        0xfe039ee3,
+        0x1862a5af,
+        0x00100073,
+        0x00a00393,
+        0xfff38393,
+        0xfe039ee3,
+        0x00500313,
+        0x30602023,
+        0x00100073
+    };
+
+    // Hart 1 stores to the word between lr and sc of hart 0, alone hart 0 succeeds
+    for (uint32_t count : {2u, 1u}) {
+        MultiHart::Config config;
+        config.harts = count;
+        config.quantum = 5;
+        config.deterministic = true;
+        MultiHart harts{MakeProgram(std::vector<std::bitset<32>>{imem}), config};
+        ASSERT_EQ(harts.Run(), PipelineState::OK);
+        ASSERT_EQ(harts.Hart(0).decode_.getRegFile().Read({/* a1 */ 11}), count - 1);
+        ASSERT_EQ(Load(harts, 0x300), count == 2 ? 5 : 0);
+        ASSERT_EQ(harts.Hart(0).memory_.getAtomicUnit().StoreConditionalFailures(), count - 1);
+        if (count == 2) {
+            ASSERT_EQ(harts.Hart(1).memory_.getAtomicUnit().BrokenReservations(), 1);
+        }
+    }
+}
+
+TEST(MultiHartTests, FalseSharing) {
+    /*
+        csrr t0, mhartid
+        slli t1, t0, 2  # counters of the harts are adjacent words
+        li t2, 100
+        loop:
+        lw t3, 0x100(t1)
+        addi t3, t3, 1
+        sw t3, 0x100(t1)
+        addi t2, t2, -1
+        bnez t2, loop
+        ebreak
+    */
+    std::vector<std::bitset<32>> imem = {
+        0xf14022f3,
+        0x00229313,
+        0x06400393,
+        0x10032e03,
+        0x001e0e13,
+        0x11c32023,
+        0xfff38393,
+        0xfe0398e3,
+        0x00100073
+    };
+
+    MultiHart::Config config;
+    config.harts = 4;
+    config.quantum = 5;
+    config.deterministic = true;
+    config.core.dcache.miss_latency = 50;
+    config.core.l2 = L2Cache::Config{64, 8, 10};
+
+    MultiHart packed{MakeProgram(std::vector<std::bitset<32>>{imem}), config};
+    ASSERT_EQ(packed.Run(), PipelineState::OK);
+    // Every hart has its own counter, so every coherence miss is a false sharing one
+    auto lines = packed.L2().HotLines(8);
+    ASSERT_EQ(lines.size(), 1);
+    ASSERT_EQ(lines[0].first, 0x100);
+    ASSERT_GT(lines[0].second.coherence_misses, 100);
+    ASSERT_EQ(lines[0].second.false_sharing, lines[0].second.coherence_misses);
+    ASSERT_EQ(lines[0].second.writers, 0b1111);
+    for (uint32_t id = 0; id < 4; ++id) {
+        ASSERT_EQ(Load(packed, 0x100 + 4 * id), 100);
+        ASSERT_GT(packed.Hart(id).memory_.getDCache().Invalidations(), 0);
+    }
+
+    // Counters padded to lines of their own: slli t1, t0, 6
+    imem[1] = 0x00629313;
+    MultiHart padded{MakeProgram(std::move(imem)), config};
+    ASSERT_EQ(padded.Run(), PipelineState::OK);
+    ASSERT_TRUE(padded.L2().HotLines(8).empty());
+    ASSERT_EQ(padded.L2().Total().coherence_misses, 0);
+    for (uint32_t id = 0; id < 4; ++id) {
+        ASSERT_EQ(Load(padded, 0x100 + 64 * id), 100);
+    }
+    ASSERT_LT(padded.Cycles(), packed.Cycles());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,98 @@
+#include "simulator.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+struct CountingObserver final : PipelineObserver {
+    void Fetch(const Simulator &, Way, const PC &, const RISCVInstr &) {
+        ++fetched;
+    }
+    void Issue(const Simulator &, Way, const PC &, const RISCVInstr &) {
+        ++issued;
+    }
+    void Stall(const Simulator &, Way way, Bubble bubble) {
+        // Load-use stall holds the whole pair
+        stalls += way == Way::UP && bubble == Bubble::LOAD_USE;
+    }
+    void Execute(const Simulator &, Way, const PC &, std::bitset<32>) {
+        ++executed;
+    }
+    void Flush(const Simulator &) {
+        ++flushes;
+    }
+    void MemoryAccess(const Simulator &, Way, uint32_t addr, bool is_store) {
+        (is_store ? stores : loads) += 1;
+        last_addr = addr;
+    }
+    void Retire(const Simulator &, Way, const PC &pc, const RISCVInstr &) {
+        ++retired;
+        // In order pipeline retires in program order, the loop only goes back with blt
+        in_order = in_order && (retired == 1 || pc.val() > last_pc || pc.val() == 2);
+        last_pc = pc.val();
+    }
+
+    uint64_t fetched{0};
+    uint64_t issued{0};
+    uint64_t stalls{0};
+    uint64_t executed{0};
+    uint64_t flushes{0};
+    uint64_t loads{0};
+    uint64_t stores{0};
+    uint64_t retired{0};
+    uint32_t last_addr{0};
+    uint32_t last_pc{0};
+    bool in_order{true};
+};
+
+}  // namespace
+
+TEST(ObserverTests, Hooks) {
+    /*
+        li t0, 0
+        li t2, 4
+        loop:
+        sw t0, 64(zero)
+        lw t1, 64(zero)
+        add t3, t1, t0
+        addi t0, t0, 1
+        blt t0, t2, loop
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00000293,
+        0x00400393,
+        0x04502023,
+        0x04002303,
+        0x00530e33,
+        0x00128293,
+        0xfe72c8e3
+    };
+    std::vector<std::bitset<32>> copy = imem;
+
+    Simulator cpu = Simulator{std::move(imem)};
+    CountingObserver observer;
+    ASSERT_NE(cpu.Run(observer), PipelineState::ERR);
+
+    ASSERT_EQ(observer.retired, cpu.csr_.Instret());
+    ASSERT_TRUE(observer.in_order);
+    ASSERT_EQ(observer.loads, 4);
+    ASSERT_EQ(observer.stores, 4);
+    ASSERT_EQ(observer.last_addr, 64);
+    // Add waits for the load in every iteration
+    ASSERT_EQ(observer.stalls, cpu.csr_.Events(CSRUnit::Event::LOAD_USE_STALL));
+    ASSERT_GT(observer.stalls, 0);
+    ASSERT_EQ(observer.flushes, cpu.csr_.Events(CSRUnit::Event::MISPREDICT));
+    ASSERT_GE(observer.fetched, observer.issued);
+    ASSERT_GE(observer.issued, observer.executed);
+    ASSERT_GE(observer.executed, observer.retired);
+
+    // Observer doesn't change timing
+    Simulator plain = Simulator{std::move(copy)};
+    ASSERT_NE(plain.Run(), PipelineState::ERR);
+    ASSERT_EQ(plain.write_back_.cycle, cpu.write_back_.cycle);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
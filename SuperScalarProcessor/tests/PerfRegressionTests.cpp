@@ -0,0 +1,156 @@
+#include "simulator.h"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+/*
+ *  Timing regression harness. Every program of tests/data (bench/ has the larger ones) is run with the default
+ *  configuration and its total cycles and retired instructions are compared with golden.txt, so any change of
+ *  the timing model shows up here. Intended changes are accepted by rerunning with PERF_UPDATE_GOLDEN=1.
+ *  Simulation speed is compared with the best one seen in this build directory.
+ */
+
+namespace {
+
+struct Result final {
+    uint64_t cycles{0};
+    uint64_t instructions{0};
+};
+
+struct Measured final {
+    uint64_t instructions{0};
+    double seconds{0};
+};
+
+const std::filesystem::path data_dir{PERF_DATA_DIR};
+const std::filesystem::path golden_path = data_dir / "golden.txt";
+
+// Program paths relative to data_dir in the stable order
+std::vector<std::string> Programs() {
+    std::vector<std::string> programs;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(data_dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".dat") {
+            programs.push_back(entry.path().lexically_relative(data_dir).generic_string());
+        }
+    }
+    std::sort(programs.begin(), programs.end());
+    return programs;
+}
+
+std::map<std::string, Result> ReadGolden() {
+    std::map<std::string, Result> golden;
+    std::ifstream in{golden_path};
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields{line};
+        std::string name;
+        Result result;
+        if (fields >> name >> result.cycles >> result.instructions) {
+            golden[name] = result;
+        }
+    }
+    return golden;
+}
+
+void WriteGolden(const std::map<std::string, Result> &results) {
+    std::ofstream out{golden_path};
+    out << "# program cycles instructions, regenerate with PERF_UPDATE_GOLDEN=1 ctest -R perf_regression\n";
+    for (const auto &[name, result] : results) {
+        out << name << " " << result.cycles << " " << result.instructions << "\n";
+    }
+}
+
+std::optional<Result> Simulate(const std::string &name, Measured &measured) {
+    auto program = LoadProgram((data_dir / name).string());
+    if (!program) {
+        return std::nullopt;
+    }
+
+    Simulator cpu = Simulator{std::move(*program)};
+    auto start = std::chrono::steady_clock::now();
+    PipelineState state = cpu.Run();
+    auto end = std::chrono::steady_clock::now();
+    if (state == PipelineState::ERR) {
+        return std::nullopt;
+    }
+
+    measured.instructions += cpu.csr_.Instret();
+    measured.seconds += std::chrono::duration<double>(end - start).count();
+    return Result{cpu.write_back_.cycle, cpu.csr_.Instret()};
+}
+
+double Kips(const Measured &measured) {
+    return static_cast<double>(measured.instructions) / std::max(measured.seconds, 1e-9) / 1000.0;
+}
+
+// Filled by the golden test, so the speed test doesn't run the programs once again
+Measured suite;
+
+}  // namespace
+
+TEST(PerfRegressionTests, Golden) {
+    bool update = std::getenv("PERF_UPDATE_GOLDEN") != nullptr;
+    auto golden = ReadGolden();
+    std::map<std::string, Result> results;
+    suite = Measured{};
+    for (const auto &name : Programs()) {
+        auto result = Simulate(name, suite);
+        ASSERT_TRUE(result) << name << " failed to run";
+        results[name] = *result;
+        if (update) {
+            continue;
+        }
+
+        auto it = golden.find(name);
+        EXPECT_NE(it, golden.end()) << name << " has no golden result, run with PERF_UPDATE_GOLDEN=1";
+        if (it == golden.end()) {
+            continue;
+        }
+        EXPECT_EQ(result->cycles, it->second.cycles) << "TIMING CHANGED: total cycles of " << name;
+        EXPECT_EQ(result->instructions, it->second.instructions) << "RETIRED INSTRUCTIONS CHANGED: " << name;
+    }
+
+    if (update) {
+        WriteGolden(results);
+        std::cout << "Golden results written to " << golden_path << std::endl;
+    }
+}
+
+TEST(PerfRegressionTests, Speed) {
+    if (suite.instructions == 0) {
+        for (const auto &name : Programs()) {
+            ASSERT_TRUE(Simulate(name, suite)) << name << " failed to run";
+        }
+    }
+
+    double kips = Kips(suite);
+    double tolerance = 0.5;
+    if (const char *value = std::getenv("PERF_SPEED_TOLERANCE")) {
+        tolerance = std::strtod(value, nullptr);
+    }
+
+    double baseline = 0;
+    std::ifstream{PERF_SPEED_BASELINE} >> baseline;
+    std::cout << "Simulation speed: " << kips << " KIPS, best in this build: " << baseline << " KIPS" << std::endl;
+    RecordProperty("kips", std::to_string(kips));
+    EXPECT_GE(kips, baseline * (1.0 - tolerance))
+        << "SIMULATOR SPEED DROPPED more than " << tolerance * 100 << "% below the best one in this build, "
+        << "remove " << PERF_SPEED_BASELINE << " if the slowdown is intended";
+
+    if (kips > baseline) {
+        std::ofstream{PERF_SPEED_BASELINE} << kips << "\n";
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+#include "simulator.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <sstream>
+
+TEST(PipeTraceTests, RetiredAndFlushed) {
+    /*
+        li t0, 0
+        li t2, 10
+        loop_head:
+        bge t0, t2, loop_end
+        addi t0, t0, 1
+        j loop_head
+        loop_end:
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00000293,
+        0x00a00393,
+        0x0072d663,
+        0x00128293,
+        0xff9ff06f
+    };
+
+    std::string path = testing::TempDir() + "pipe_trace_tests.bin";
+    uint64_t instret = 0;
+    {
+        Simulator cpu = Simulator{std::move(imem)};
+        cpu.trace_ = PipeTrace::Open(path);
+        ASSERT_NE(cpu.trace_, nullptr);
+        ASSERT_NE(cpu.Run(), PipelineState::ERR);
+        instret = cpu.csr_.Instret();
+        // Trace is completed when the simulator is destroyed
+    }
+
+    std::ostringstream out;
+    ASSERT_TRUE(ConvertToO3PipeView(path, out));
+    std::remove(path.c_str());
+
+    std::istringstream in{out.str()};
+    std::string line;
+    uint64_t seq = 0, retired = 0, flushed = 0, last_retire = 0, fetch = 0;
+    while (std::getline(in, line)) {
+        if (line.rfind("O3PipeView:fetch:", 0) == 0) {
+            // Instructions come in fetch order and keep their numbers
+            ASSERT_NE(line.find(":0:" + std::to_string(seq++) + ":"), std::string::npos) << line;
+            fetch = std::stoull(line.substr(17));
+        } else if (line.rfind("O3PipeView:retire:", 0) == 0) {
+            uint64_t retire = std::stoull(line.substr(18));
+            if (retire == 0) {
+                ++flushed;
+                continue;
+            }
+            // In order pipeline retires in program order, at least 5 stages after fetch
+            ASSERT_GE(retire, last_retire);
+            ASSERT_GE(retire, fetch + 5 * 1000);
+            last_retire = retire;
+            ++retired;
+        }
+    }
+
+    ASSERT_EQ(retired, instret);
+    // Jumps back to the loop head discard the instructions fetched after them
+    ASSERT_GT(flushed, 0);
+}
+
+TEST(PipeTraceTests, NotATrace) {
+    std::string path = testing::TempDir() + "pipe_trace_tests.txt";
+    FILE *file = std::fopen(path.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    std::fputs("00000293\n", file);
+    std::fclose(file);
+
+    std::ostringstream out;
+    ASSERT_FALSE(ConvertToO3PipeView(path, out));
+    std::remove(path.c_str());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+#include "steadystate.h"
+#include "TestPrograms.h"
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+namespace {
+
+// Extrapolated run must end in the state of the full one, returns the iterations it has skipped
+uint64_t ExpectSame(const std::string &path, const SimConfig &config) {
+    auto program = LoadProgram(path);
+    EXPECT_TRUE(program.has_value()) << path;
+    if (!program) {
+        return 0;
+    }
+    Simulator reference{Program{*program}, config};
+    EXPECT_NE(reference.Run(), PipelineState::ERR) << path;
+
+    FunctionalSimulator functional{Program{*program}};
+    program->segments.clear();
+    Simulator cpu{std::move(*program), config};
+    SteadyStateRunner runner{cpu, functional};
+    EXPECT_NE(runner.Run(), PipelineState::ERR) << path;
+
+    EXPECT_EQ(cpu.write_back_.cycle, reference.write_back_.cycle) << path;
+    EXPECT_EQ(cpu.csr_.Instret(), reference.csr_.Instret()) << path;
+    for (uint8_t bubble = 0; bubble < static_cast<uint8_t>(Bubble::COUNT); ++bubble) {
+        EXPECT_EQ(cpu.cpi_.Slots(Bubble{bubble}), reference.cpi_.Slots(Bubble{bubble})) << path << " " << +bubble;
+    }
+    for (uint8_t event = 0; event < static_cast<uint8_t>(CSRUnit::Event::COUNT); ++event) {
+        EXPECT_EQ(cpu.csr_.Events(CSRUnit::Event{event}), reference.csr_.Events(CSRUnit::Event{event})) << path;
+    }
+    for (uint8_t idx = 0; idx < 32; ++idx) {
+        EXPECT_EQ(cpu.decode_.getRegFile().Read(idx), reference.decode_.getRegFile().Read(idx)) << path;
+    }
+    EXPECT_EQ(cpu.memory_.getDCache().Misses(), reference.memory_.getDCache().Misses()) << path;
+    EXPECT_LE(runner.Cycles(), cpu.write_back_.cycle) << path;
+    return runner.Iterations();
+}
+
+}  // namespace
+
+TEST(SteadyStateTests, MatchesPipeline) {
+    for (const auto &path : Programs()) {
+        ExpectSame(path, SimConfig{});
+    }
+    // Loops of these programs repeat every cycle of their iterations
+    for (const char *name : {"loop1.dat", "loop2.dat", "loop3.dat", "stride.dat", "bench/memcpy.dat"}) {
+        EXPECT_GT(ExpectSame((data_dir / name).string(), SimConfig{}), 0) << name;
+    }
+}
+
+TEST(SteadyStateTests, MissEvents) {
+    SimConfig static_bp;
+    static_bp.bp.type = BranchPredictor::Type::NOT_TAKEN;
+    SimConfig single_issue;
+    single_issue.issue_width = 1;
+    SimConfig slow_memory;
+    slow_memory.dcache.sets = 4;
+    slow_memory.dcache.miss_latency = 30;
+    SimConfig l2;
+    l2.dcache.sets = 2;
+    l2.dcache.miss_latency = 5;
+    l2.l2.sets = 16;
+    SimConfig atomics;
+    atomics.dcache.sets = 2;
+    atomics.dcache.miss_latency = 3;
+    atomics.atomic_latency = 3;
+    for (const SimConfig *config : {&static_bp, &single_issue, &slow_memory, &l2, &atomics}) {
+        for (const auto &path : Programs()) {
+            ExpectSame(path, *config);
+        }
+    }
+
+    // Misses of the copy repeat every other iteration, one per line
+    EXPECT_GT(ExpectSame((data_dir / "bench/memcpy.dat").string(), slow_memory), 0);
+    EXPECT_GT(ExpectSame((data_dir / "stride.dat").string(), slow_memory), 0);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,6 +1,9 @@
 #include "simulator.h"
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <sstream>
+
 TEST(BlocksTest, NoConflicts) {
     /*
         lw t0, 40(s0)
@@ -145,6 +148,11 @@ TEST(BlocksTest, DataDepends_UpDown) {
     ASSERT_EQ(cpu.decode_.getRegFile().Read({/* t2 */ 7}), std::bitset<32>{/* 8994 */ 0x00002322});
     ASSERT_EQ(cpu.decode_.getRegFile().Read({/* t3 */ 28}), std::bitset<32>{/* 7 */ 0x00000007});
     ASSERT_EQ(cpu.memory_.loadFromDMEM({80}), std::bitset<32>{/* 55 */ 0x00000037});
+
+    // Every slot is accounted in CPI stack
+    ASSERT_EQ(cpu.cpi_.TotalSlots(), CPIStack::issue_width * cpu.write_back_.cycle);
+    ASSERT_EQ(cpu.cpi_.Slots(Bubble::NONE), cpu.csr_.Instret());
+    ASSERT_GT(cpu.cpi_.Slots(Bubble::LOAD_USE), 0);
 }
 
 TEST(BlocksTest, DataDepends_DownUp) {
@@ -255,6 +263,164 @@ TEST(BlocksTest, DataDepends_DownDown) {
     ASSERT_EQ(cpu.memory_.loadFromDMEM({80}), std::bitset<32>{/* 55 */ 0x00000037});
 }
 
+TEST(BlocksTest, Profile) {
+    /*
+        li t0, 0
+        li t2, 3
+        li a1, 0
+        loop:
+        addi t0, t0, 1
+        addi a1, a1, 100
+        blt t0, t2, loop
+        mv a0, t0
+        addi a1, a1, -200
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00000293,
+        0x00300393,
+        0x00000593,
+        0x00128293,
+        0x06458593,
+        0xfe72cce3,
+        0x00028513,
+        0xf3858593
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    cpu.prof_.Enable(cpu.fetch_.getIMEM());
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+
+    uint64_t count = 0, cycles = 0;
+    for (uint32_t i = 0; i < cpu.fetch_.getIMEM().size(); ++i) {
+        count += cpu.prof_.getEntry(PC{i}).count;
+        cycles += cpu.prof_.getEntry(PC{i}).cycles;
+    }
+    ASSERT_EQ(count, cpu.csr_.Instret());
+    // Only the cycles waiting for the final ebreak are not attributed
+    ASSERT_LE(cycles, cpu.write_back_.cycle);
+    ASSERT_GE(cycles + 2, cpu.write_back_.cycle);
+
+    const Profiler::Entry &addi = cpu.prof_.getEntry(PC{3});
+    const Profiler::Entry &blt = cpu.prof_.getEntry(PC{5});
+    ASSERT_EQ(addi.count, 3);
+    ASSERT_EQ(blt.count, 3);
+    // Independent increments of the loop body are issued together
+    ASSERT_EQ(cpu.prof_.getEntry(PC{4}).paired, 3);
+
+    SymbolTable symbols;
+    symbols.Add(Symbol{0, 12, "init"});
+    symbols.Add(Symbol{12, 12, "loop"});
+    symbols.Add(Symbol{24, 8, "fini"});
+    symbols.Sort();
+    std::ostringstream out;
+    cpu.prof_.Print(out, cpu.fetch_.getIMEM(), &symbols);
+
+    std::istringstream in{out.str()};
+    std::string line;
+    std::getline(in, line);
+    ASSERT_EQ(line, "Profile:");
+    std::getline(in, line);
+    // Loop is the hottest function
+    std::getline(in, line);
+    ASSERT_NE(line.find("loop"), std::string::npos) << out.str();
+    ASSERT_NE(out.str().find("init"), std::string::npos);
+    ASSERT_NE(out.str().find("fini"), std::string::npos);
+}
+
+TEST(BlocksTest, InstrMix) {
+    /*
+        li t0, 1
+        addi t1, t0, 1
+        add t2, t0, t1
+        sw t2, 0(zero)
+        lw a0, 0(zero)
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00100293,
+        0x00128313,
+        0x006283b3,
+        0x00702023,
+        0x00002503
+    };
+
+    // Mix is counted by the output observer, only if requested
+    Simulator uncounted = Simulator{std::vector<std::bitset<32>>{imem}};
+    ASSERT_NE(uncounted.Run(), PipelineState::ERR);
+    ASSERT_EQ(uncounted.mix_.Retired(), 0);
+    ASSERT_EQ(uncounted.mix_.IssueCycles(1) + uncounted.mix_.IssueCycles(2), 0);
+
+    Simulator cpu = Simulator{std::move(imem)};
+    cpu.mix_.Enable();
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+
+    ASSERT_EQ(cpu.mix_.Retired(), cpu.csr_.Instret());
+    ASSERT_EQ(cpu.mix_.Retired(Opcode::ADDI), 2);
+    ASSERT_EQ(cpu.mix_.Retired(Opcode::ADD), 1);
+    ASSERT_EQ(cpu.mix_.Retired(Opcode::SW), 1);
+    ASSERT_EQ(cpu.mix_.Retired(Opcode::LW), 1);
+    ASSERT_EQ(cpu.mix_.Retired(RISCVInstr::Format::I), 3);
+    ASSERT_EQ(cpu.mix_.Retired(RISCVInstr::Format::R), 1);
+    ASSERT_EQ(cpu.mix_.Retired(RISCVInstr::Format::S), 1);
+
+    // Every single issue has a reason for the empty down slot, addi waits for li
+    uint64_t down_empty = 0;
+    for (uint8_t i = 0; i < static_cast<uint8_t>(Bubble::COUNT); ++i) {
+        down_empty += cpu.mix_.DownEmpty(static_cast<Bubble>(i));
+    }
+    ASSERT_EQ(down_empty, cpu.mix_.IssueCycles(1));
+    ASSERT_GE(cpu.mix_.DownEmpty(Bubble::DEPENDENCY), 1);
+    ASSERT_GE(cpu.mix_.IssueCycles(1) + 2 * cpu.mix_.IssueCycles(2), cpu.csr_.Instret());
+}
+
+TEST(BlocksTest, StatsSeries) {
+    /*
+        li t0, 0
+        li t2, 20
+        loop:
+        addi t0, t0, 1
+        blt t0, t2, loop
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00000293,
+        0x01400393,
+        0x00128293,
+        0xfe72cee3
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    cpu.RegisterStats();
+    std::string path = testing::TempDir() + "stats_series.csv";
+    ASSERT_TRUE(cpu.stats_.Open(path, StatsRegistry::Period::CYCLES, 10));
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    cpu.stats_.Close();
+
+    std::ifstream in{path};
+    std::string line;
+    std::getline(in, line);
+    ASSERT_EQ(line.rfind("cycle,instructions,ipc,", 0), 0);
+    ASSERT_NE(line.find("bp.updates"), std::string::npos);
+
+    // Rows are increments over the interval, so they sum up to the totals
+    uint64_t rows = 0, instructions = 0, cycle = 0;
+    while (std::getline(in, line)) {
+        std::istringstream row{line};
+        std::string field;
+        std::getline(row, field, ',');
+        ASSERT_GT(std::stoull(field), cycle);
+        cycle = std::stoull(field);
+        std::getline(row, field, ',');
+        instructions += std::stoull(field);
+        ++rows;
+    }
+    ASSERT_EQ(rows, cpu.stats_.Rows());
+    ASSERT_EQ(cycle, cpu.write_back_.cycle);
+    ASSERT_EQ(instructions, cpu.csr_.Instret());
+    ASSERT_GE(rows, cycle / 10);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
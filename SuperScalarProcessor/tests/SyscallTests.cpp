@@ -0,0 +1,125 @@
+#include "simulator.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+TEST(SyscallTests, WriteAndExit) {
+    /*
+        lui t2, 2
+        li t0, 0x6c6c6548
+        sw t0, 0(t2)
+        li t0, 0x0a6f
+        sh t0, 4(t2)
+        li a0, 1
+        mv a1, t2
+        li a2, 6
+        li a7, 64
+        ecall
+        mv s0, a0
+        li a0, 7
+        li a7, 93
+        ecall
+        li s1, 1
+        ebreak
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x000023b7,
+        0x6c6c62b7,
+        0x54828293,
+        0x0053a023,
+        0x000012b7,
+        0xa6f28293,
+        0x00539223,
+        0x00100513,
+        0x00038593,
+        0x00600613,
+        0x04000893,
+        0x00000073,
+        0x00050413,
+        0x00700513,
+        0x05d00893,
+        0x00000073,
+        0x00100493,
+        0x00100073
+    };
+
+    std::string path = testing::TempDir() + "syscall_tests_stdout.txt";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    ASSERT_GE(fd, 0);
+
+    Simulator cpu = Simulator{std::move(imem)};
+    cpu.sys_.setFd(1, fd);
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_TRUE(cpu.sys_.isExited());
+    ASSERT_EQ(cpu.sys_.ExitCode(), 7);
+    ASSERT_EQ(cpu.sys_.Calls(), 2);
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s0 */ 8}), std::bitset<32>{/* 6 */ 0x00000006});
+    // Nothing after exit is executed
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s1 */ 9}), std::bitset<32>{/* 0 */ 0x00000000});
+
+    char buf[16] = {};
+    ASSERT_EQ(pread(fd, buf, sizeof(buf), 0), 6);
+    ASSERT_STREQ(buf, "Hello\n");
+    close(fd);
+    std::remove(path.c_str());
+}
+
+TEST(SyscallTests, BrkAndClock) {
+    /*
+        li a0, 0
+        li a7, 214
+        ecall
+        mv s0, a0
+        addi a0, s0, 1024
+        li a7, 214
+        ecall
+        mv s1, a0
+        lui a1, 3
+        li a0, 1
+        li a7, 113
+        ecall
+        mv s2, a0
+        li a7, 999
+        ecall
+        mv s3, a0
+    */
+
+    std::vector<std::bitset<32>> imem = {
+        0x00000513,
+        0x0d600893,
+        0x00000073,
+        0x00050413,
+        0x40040513,
+        0x0d600893,
+        0x00000073,
+        0x00050493,
+        0x000035b7,
+        0x00100513,
+        0x07100893,
+        0x00000073,
+        0x00050913,
+        0x3e700893,
+        0x00000073,
+        0x00050993
+    };
+
+    Simulator cpu = Simulator{std::move(imem)};
+    cpu.sys_.setBreak(0x3000);
+    ASSERT_NE(cpu.Run(), PipelineState::ERR);
+    ASSERT_FALSE(cpu.sys_.isExited());
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s0 */ 8}), std::bitset<32>{0x3000});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s1 */ 9}), std::bitset<32>{0x3400});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s2 */ 18}), std::bitset<32>{0});
+    ASSERT_EQ(cpu.decode_.getRegFile().Read({/* s3 */ 19}), std::bitset<32>{static_cast<uint32_t>(-ENOSYS)});
+
+    // Monotonic clock of the host is never zero
+    ASSERT_TRUE(cpu.memory_.loadFromDMEM({0x3000}).any() || cpu.memory_.loadFromDMEM({0x3008}).any());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,33 @@
+#ifndef TESTS_TEST_PROGRAMS_H
+#define TESTS_TEST_PROGRAMS_H
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "loader.h"
+
+// Programs the suites run: the ones of tests/data and the ones assembled in the tests
+
+inline const std::filesystem::path data_dir{TEST_DATA_DIR};
+
+// Every .dat program of tests/data in a stable order, a new program is picked up by all the suites
+inline std::vector<std::string> Programs() {
+    std::vector<std::string> programs;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(data_dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".dat") {
+            programs.push_back(entry.path().string());
+        }
+    }
+    std::sort(programs.begin(), programs.end());
+    return programs;
+}
+
+inline Program MakeProgram(std::vector<std::bitset<32>> &&imem) {
+    Program program;
+    program.imem = IMEM{std::move(imem)};
+    return program;
+}
+
+#endif //TESTS_TEST_PROGRAMS_H
@@ -0,0 +1,348 @@
+#include "designspace.h"
+#include "lz_codec.h"
+#include "work_stealing.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+const std::filesystem::path data_dir{TEST_DATA_DIR};
+
+std::vector<std::string> Programs() {
+    std::vector<std::string> programs;
+    for (const char *name : {"loop2.dat", "stride.dat", "bench/crc.dat", "bench/sort.dat"}) {
+        programs.push_back((data_dir / name).string());
+    }
+    return programs;
+}
+
+// Binary trace of the functional simulator, returns the number of records
+uint64_t Record(const std::string &program_path, const std::string &path,
+                uint32_t block_size = TraceWriter::default_block_size) {
+    auto program = LoadProgram(program_path);
+    auto writer = TraceWriter::Open(path, block_size);
+    if (!program || writer == nullptr) {
+        return 0;
+    }
+    FunctionalSimulator functional{std::move(*program)};
+    return RecordTrace(functional, *writer) == PipelineState::OK ? writer->Records() : 0;
+}
+
+std::unique_ptr<Simulator> Replay(const std::string &program_path, InstrSource &source, PipelineState &state,
+                                  const SimConfig &config = {}) {
+    auto program = LoadProgram(program_path);
+    if (!program) {
+        return nullptr;
+    }
+    program->segments.clear();
+    auto cpu = std::make_unique<Simulator>(std::move(*program), config);
+    cpu->source_ = &source;
+    state = cpu->Run();
+    return cpu;
+}
+
+}  // namespace
+
+TEST(TraceTests, ReplayBinaryTrace) {
+    SimConfig config;
+    config.dcache.miss_latency = 20;
+    for (const auto &path : Programs()) {
+        std::string trace = testing::TempDir() + "trace_tests.trace";
+        uint64_t records = Record(path, trace);
+        ASSERT_GT(records, 0) << path;
+
+        auto program = LoadProgram(path);
+        ASSERT_TRUE(program) << path;
+        Simulator reference{std::move(*program), config};
+        ASSERT_NE(reference.Run(), PipelineState::ERR) << path;
+
+        auto reader = TraceReader::Open(trace);
+        ASSERT_NE(reader, nullptr) << path;
+        ASSERT_EQ(reader->getFormat(), TraceReader::Format::BINARY);
+        PipelineState state{PipelineState::OK};
+        auto cpu = Replay(path, *reader, state, config);
+        ASSERT_NE(cpu, nullptr) << path;
+        ASSERT_NE(state, PipelineState::ERR) << path;
+        ASSERT_EQ(reader->Records(), records) << path;
+        ASSERT_EQ(cpu->write_back_.cycle, reference.write_back_.cycle) << path;
+        ASSERT_EQ(cpu->csr_.Instret(), reference.csr_.Instret()) << path;
+        ASSERT_EQ(cpu->memory_.getDCache().Misses(), reference.memory_.getDCache().Misses()) << path;
+        for (uint8_t idx = 0; idx < 32; ++idx) {
+            ASSERT_EQ(cpu->decode_.getRegFile().Read(idx), reference.decode_.getRegFile().Read(idx)) << path;
+        }
+        std::remove(trace.c_str());
+    }
+}
+
+TEST(TraceTests, ReplayCommitLog) {
+    std::string path = (data_dir / "loop2.dat").string();
+    std::string log = testing::TempDir() + "trace_tests.log";
+    auto program = LoadProgram(path);
+    ASSERT_TRUE(program);
+    Simulator reference{std::move(*program)};
+    reference.commit_log_ = CommitLog::Open(log);
+    ASSERT_NE(reference.Run(), PipelineState::ERR);
+    reference.commit_log_.reset();
+
+    auto reader = TraceReader::Open(log);
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(reader->getFormat(), TraceReader::Format::COMMIT_LOG);
+    PipelineState state{PipelineState::OK};
+    auto cpu = Replay(path, *reader, state);
+    ASSERT_NE(state, PipelineState::ERR);
+    // Ebreak isn't logged, the trace ends when it reaches memory stage, as without the trace
+    ASSERT_EQ(reader->Records(), reference.csr_.Instret());
+    ASSERT_EQ(cpu->write_back_.cycle, 345);
+    std::remove(log.c_str());
+}
+
+TEST(TraceTests, ReplayFollowsRecordedPath) {
+    std::string path = (data_dir / "loop2.dat").string();
+    std::string log = testing::TempDir() + "trace_tests_path.log";
+    auto program = LoadProgram(path);
+    ASSERT_TRUE(program);
+    Simulator reference{std::move(*program)};
+    reference.commit_log_ = CommitLog::Open(log);
+    ASSERT_NE(reference.Run(), PipelineState::ERR);
+    reference.commit_log_.reset();
+
+    // Loop condition at 0x34 is recorded as taken in the first iteration, though its registers say otherwise:
+    // the prologue and the exit of the loop, the ones after 0x88
+    std::vector<std::string> lines;
+    {
+        std::ifstream in{log};
+        for (std::string line; std::getline(in, line);) {
+            lines.push_back(line);
+        }
+    }
+    ASSERT_EQ(lines.size(), 355);
+    auto exit = std::find_if(lines.rbegin(), lines.rend(),
+                             [](const std::string &line) { return line.find(" 0x00000088 ") != std::string::npos; });
+    ASSERT_NE(exit, lines.rend());
+    std::vector<std::string> path_lines{lines.begin(), lines.begin() + 14};
+    path_lines.insert(path_lines.end(), std::prev(exit.base()), lines.end());
+    {
+        std::ofstream out{log};
+        for (const auto &line : path_lines) {
+            out << line << "\n";
+        }
+    }
+
+    auto reader = TraceReader::Open(log);
+    ASSERT_NE(reader, nullptr);
+    PipelineState state{PipelineState::ERR};
+    auto cpu = Replay(path, *reader, state);
+    ASSERT_EQ(state, PipelineState::OK);
+    ASSERT_EQ(cpu->csr_.Instret(), path_lines.size());
+    // Jump at 0x28 and the branch aren't predicted yet
+    ASSERT_EQ(cpu->csr_.Events(CSRUnit::Event::MISPREDICT), 2);
+    ASSERT_EQ(cpu->decode_.getRegFile().Read(10), 0x22);
+    std::remove(log.c_str());
+}
+
+TEST(TraceTests, SpikeLogFields) {
+    std::string log = testing::TempDir() + "trace_tests_spike.log";
+    {
+        std::ofstream out{log};
+        out << "core   0: >>>>  main\n"
+               "core   0: 0x80000000 (0x00000297) auipc   t0, 0x0\n"
+               "core   0: 3 0x80000000 (0x00000297) x5  0xffffffff80000000\n"
+               "core   0: 3 0x80000004 (0x3002a073) c768_mstatus 0x0000000000000008\n"
+               "core   0: 3 0x80000008 (0x0002a303) x6  0x0000000000000005 mem 0x0000000080000000\n"
+               "core   0: exception trap_illegal_instruction, epc 0x8000000c\n"
+               "core   0: 3 0x80000010 (0x0062a023) mem 0x0000000080000000 0x00000005\n"
+               "core   0: 3 0x80000014 (0x0a62a52f) x10 0x0000000000000005 mem 0x80000000 mem 0x80000000 0x0000000a";
+    }
+
+    auto reader = TraceReader::Open(log);
+    ASSERT_NE(reader, nullptr);
+    std::vector<DynInstr> records;
+    for (DynInstr instr; reader->Next(instr);) {
+        records.push_back(instr);
+    }
+    ASSERT_EQ(records.size(), 5);
+    ASSERT_EQ(records[0].pc, 0x80000000);
+    ASSERT_EQ(records[0].instr, 0x00000297);
+    ASSERT_EQ(records[0].value, 0x80000000);
+    ASSERT_EQ(records[0].next_pc, 0x80000004);
+    // Csr write isn't a register value
+    ASSERT_EQ(records[1].value, 0);
+    ASSERT_EQ(records[2].addr, 0x80000000);
+    ASSERT_EQ(records[2].value, 5);
+    // Trap skips to the next commit
+    ASSERT_EQ(records[2].next_pc, 0x80000010);
+    ASSERT_EQ(records[3].value, 5);
+    // Atomic keeps the loaded value, the last record falls through
+    ASSERT_EQ(records[4].value, 5);
+    ASSERT_EQ(records[4].next_pc, 0x80000018);
+    std::remove(log.c_str());
+}
+
+TEST(TraceTests, TruncatedAndWrongTrace) {
+    std::string path = (data_dir / "loop2.dat").string();
+    std::string trace = testing::TempDir() + "trace_tests_truncated.trace";
+    ASSERT_EQ(Record(path, trace, 64), 356);
+    // Writer killed in the middle of the fourth block: no index and a part of the block
+    auto reader = TraceReader::Open(trace);
+    ASSERT_EQ(reader->Blocks(), 6);
+    ASSERT_TRUE(reader->Seek(3 * 64));
+    std::filesystem::resize_file(trace, std::filesystem::file_size(trace) / 2);
+
+    // Replay stops where the complete blocks end
+    reader = TraceReader::Open(trace);
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(reader->Size() % 64, 0);
+    ASSERT_GT(reader->Size(), 0);
+    ASSERT_LT(reader->Size(), 356);
+    PipelineState state{PipelineState::ERR};
+    auto cpu = Replay(path, *reader, state);
+    ASSERT_EQ(state, PipelineState::OK);
+    ASSERT_EQ(reader->Records(), reader->Size());
+    ASSERT_LE(cpu->csr_.Instret(), reader->Size());
+    ASSERT_LT(cpu->write_back_.cycle, 345);
+
+    // Trace of another program diverges at once
+    reader = TraceReader::Open(trace);
+    cpu = Replay((data_dir / "stride.dat").string(), *reader, state);
+    ASSERT_EQ(state, PipelineState::ERR);
+    std::remove(trace.c_str());
+}
+
+TEST(TraceTests, CorruptedHeaders) {
+    std::string path = (data_dir / "loop2.dat").string();
+    std::string trace = testing::TempDir() + "trace_tests_corrupted.trace";
+    auto patch = [&trace](size_t offset, uint32_t value) {
+        std::fstream file{trace, std::ios::in | std::ios::out | std::ios::binary};
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+    const size_t block = sizeof(TraceWriter::Header);
+
+    // Sizes of the first block that no block of 64 records has, the other blocks are still read
+    for (size_t field : {offsetof(TraceWriter::BlockHeader, records), offsetof(TraceWriter::BlockHeader, raw_size),
+                         offsetof(TraceWriter::BlockHeader, stored_size)}) {
+        ASSERT_EQ(Record(path, trace, 64), 356);
+        patch(block + field, 0xfffffff0);
+        auto reader = TraceReader::Open(trace);
+        ASSERT_NE(reader, nullptr) << field;
+        DynInstr instr;
+        ASSERT_FALSE(reader->Next(instr)) << field;
+        ASSERT_TRUE(reader->Seek(64)) << field;
+        ASSERT_TRUE(reader->Next(instr)) << field;
+    }
+
+    // Without the index the blocks are found up to the corrupted one
+    ASSERT_EQ(Record(path, trace, 64), 356);
+    std::filesystem::resize_file(trace, std::filesystem::file_size(trace) - sizeof(TraceWriter::Footer));
+    patch(block + offsetof(TraceWriter::BlockHeader, raw_size), 0xfffffff0);
+    auto reader = TraceReader::Open(trace);
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(reader->Blocks(), 0);
+
+    patch(offsetof(TraceWriter::Header, block_size), 0);
+    ASSERT_EQ(TraceReader::Open(trace), nullptr);
+    std::remove(trace.c_str());
+
+    // Failed writes are reported when the trace is closed
+    if (std::filesystem::exists("/dev/full")) {
+        ASSERT_EQ(Record(path, "/dev/full"), 0);
+    }
+}
+
+TEST(TraceTests, Codec) {
+    std::vector<uint8_t> repetitive;
+    for (uint32_t i = 0; i < 10000; ++i) {
+        repetitive.push_back(static_cast<uint8_t>(i % 7 == 0 ? i / 7 % 5 : i % 3));
+    }
+    std::vector<uint8_t> noise;
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        noise.push_back(static_cast<uint8_t>(seed >> 16));
+    }
+
+    for (const auto &data : {repetitive, noise, std::vector<uint8_t>{}, std::vector<uint8_t>(100000, 42)}) {
+        auto compressed = LZCodec::Compress(data.data(), data.size());
+        std::vector<uint8_t> out(data.size());
+        ASSERT_TRUE(LZCodec::Decompress(compressed.data(), compressed.size(), out.data(), out.size()));
+        ASSERT_EQ(out, data);
+        // Wrong size and truncated data are detected
+        if (!data.empty()) {
+            ASSERT_FALSE(LZCodec::Decompress(compressed.data(), compressed.size(), out.data(), out.size() - 1));
+            ASSERT_FALSE(LZCodec::Decompress(compressed.data(), compressed.size() - 1, out.data(), out.size()));
+        }
+    }
+    ASSERT_LT(LZCodec::Compress(repetitive.data(), repetitive.size()).size(), repetitive.size() / 20);
+}
+
+TEST(TraceTests, ColumnsAndSeek) {
+    std::string path = (data_dir / "bench/sort.dat").string();
+    std::string trace = testing::TempDir() + "trace_tests_seek.trace";
+    uint64_t records = Record(path, trace, 1000);
+    ASSERT_GT(records, 16000);
+    // Most records take a byte or two
+    ASSERT_LT(std::filesystem::file_size(trace), records * sizeof(DynInstr) / 8);
+
+    auto reader = TraceReader::Open(trace);
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(reader->Size(), records);
+    ASSERT_EQ(reader->Blocks(), (records + 999) / 1000);
+    std::vector<DynInstr> all;
+    for (DynInstr instr; reader->Next(instr);) {
+        ASSERT_TRUE(all.empty() || all.back().next_pc == instr.pc);
+        all.push_back(instr);
+    }
+    ASSERT_EQ(all.size(), records);
+
+    // Seeking decodes only the block of the record
+    for (uint64_t record : {uint64_t{0}, uint64_t{999}, uint64_t{1000}, uint64_t{12345}, records - 1}) {
+        ASSERT_TRUE(reader->Seek(record));
+        for (uint64_t i = record; i < std::min(record + 1500, records); ++i) {
+            DynInstr instr;
+            ASSERT_TRUE(reader->Next(instr));
+            ASSERT_EQ(std::memcmp(&instr, &all[i], sizeof(instr)), 0) << i;
+        }
+    }
+    DynInstr instr;
+    ASSERT_TRUE(reader->Seek(records));
+    ASSERT_FALSE(reader->Next(instr));
+    ASSERT_FALSE(reader->Seek(records + 1));
+    std::remove(trace.c_str());
+}
+
+TEST(TraceTests, SweepSharesTrace) {
+    DesignSpace space;
+    ASSERT_TRUE(space.AddParameter("bp-key-size", "4,10"));
+    ASSERT_TRUE(space.AddParameter("dcache-miss-latency", "0,20"));
+    auto points = space.Points();
+    std::vector<std::string> programs{(data_dir / "loop2.dat").string(), (data_dir / "stride.dat").string()};
+    std::vector<std::string> traces;
+    for (size_t i = 0; i < programs.size(); ++i) {
+        traces.push_back(testing::TempDir() + "trace_tests_" + std::to_string(i) + ".trace");
+        ASSERT_GT(Record(programs[i], traces.back()), 0);
+    }
+
+    WorkStealingPool pool{4};
+    auto executed = RunSweep(points, programs, pool);
+    auto replayed = RunSweep(points, programs, pool, traces);
+    ASSERT_EQ(replayed.size(), executed.size());
+    for (size_t i = 0; i < executed.size(); ++i) {
+        ASSERT_TRUE(replayed[i].ok);
+        ASSERT_EQ(replayed[i].cycles, executed[i].cycles);
+        ASSERT_EQ(replayed[i].instructions, executed[i].instructions);
+    }
+    for (const auto &trace : traces) {
+        std::remove(trace.c_str());
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
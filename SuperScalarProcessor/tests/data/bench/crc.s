@@ -0,0 +1,28 @@
+# Bitwise CRC-32 of 256 bytes, result in a0
+    li a1, 0x1000
+    li a2, 256
+    li t0, 0
+fill:
+    add t1, a1, t0
+    sb t0, 0(t1)
+    addi t0, t0, 1
+    blt t0, a2, fill
+    li a0, -1
+    li a3, 0xedb88320
+    li t0, 0
+byte:
+    add t1, a1, t0
+    lbu t2, 0(t1)
+    xor a0, a0, t2
+    li t3, 8
+bit:
+    andi t4, a0, 1
+    srli a0, a0, 1
+    beqz t4, skip
+    xor a0, a0, a3
+skip:
+    addi t3, t3, -1
+    bnez t3, bit
+    addi t0, t0, 1
+    blt t0, a2, byte
+    not a0, a0
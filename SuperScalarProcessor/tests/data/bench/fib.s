@@ -0,0 +1,24 @@
+# Recursive fibonacci(14), result in a0
+    li sp, 0x8000
+    li a0, 14
+    jal ra, fib
+    j done
+fib:
+    li t0, 2
+    blt a0, t0, ret
+    addi sp, sp, -12
+    sw ra, 8(sp)
+    sw a0, 4(sp)
+    addi a0, a0, -1
+    jal ra, fib
+    sw a0, 0(sp)
+    lw a0, 4(sp)
+    addi a0, a0, -2
+    jal ra, fib
+    lw t1, 0(sp)
+    add a0, a0, t1
+    lw ra, 8(sp)
+    addi sp, sp, 12
+ret:
+    ret
+done:
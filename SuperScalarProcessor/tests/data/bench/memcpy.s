@@ -0,0 +1,27 @@
+# Copies 1024 words, four per iteration
+    li a0, 0x1000
+    li a1, 0x3000
+    li a2, 256
+fill:
+    sw a2, 0(a0)
+    sw a2, 4(a0)
+    sw a2, 8(a0)
+    sw a2, 12(a0)
+    addi a0, a0, 16
+    addi a2, a2, -1
+    bnez a2, fill
+    li a0, 0x1000
+    li a2, 256
+copy:
+    lw t0, 0(a0)
+    lw t1, 4(a0)
+    lw t2, 8(a0)
+    lw t3, 12(a0)
+    sw t0, 0(a1)
+    sw t1, 4(a1)
+    sw t2, 8(a1)
+    sw t3, 12(a1)
+    addi a0, a0, 16
+    addi a1, a1, 16
+    addi a2, a2, -1
+    bnez a2, copy
@@ -0,0 +1,27 @@
+# Sieve of Eratosthenes up to 2048, number of primes in a0
+    li a1, 0x1000
+    li a2, 2048
+    li t0, 2
+clear:
+    add t1, a1, t0
+    sb zero, 0(t1)
+    addi t0, t0, 1
+    blt t0, a2, clear
+    li a0, 0
+    li t0, 2
+scan:
+    add t1, a1, t0
+    lbu t2, 0(t1)
+    bnez t2, composite
+    addi a0, a0, 1
+    add t3, t0, t0
+    li t5, 1
+mark:
+    bge t3, a2, composite
+    add t4, a1, t3
+    sb t5, 0(t4)
+    add t3, t3, t0
+    j mark
+composite:
+    addi t0, t0, 1
+    blt t0, a2, scan
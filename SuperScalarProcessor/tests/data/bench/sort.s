@@ -0,0 +1,26 @@
+# Bubble sort of 64 words stored in descending order
+    li a0, 0x1000
+    li a1, 64
+    mv t0, a1
+    mv t1, a0
+init:
+    sw t0, 0(t1)
+    addi t1, t1, 4
+    addi t0, t0, -1
+    bnez t0, init
+    addi a2, a1, -1
+outer:
+    mv t1, a0
+    mv t2, a2
+inner:
+    lw t3, 0(t1)
+    lw t4, 4(t1)
+    ble t3, t4, next
+    sw t4, 0(t1)
+    sw t3, 4(t1)
+next:
+    addi t1, t1, 4
+    addi t2, t2, -1
+    bnez t2, inner
+    addi a2, a2, -1
+    bnez a2, outer
@@ -0,0 +1,65 @@
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+
+#include "tracefile.h"
+
+// Prints a range of records of a trace written by cpu --record, decompressing only the blocks of the range
+int main(int argc, char *argv[]) {
+    std::string path;
+    uint64_t from = 0;
+    uint64_t count = UINT64_MAX;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg{argv[i]};
+        if (arg.rfind("--", 0) != 0) {
+            path = arg;
+            continue;
+        }
+
+        auto eq = arg.find('=');
+        std::string name = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        uint64_t *option = name == "from" ? &from : name == "count" ? &count : nullptr;
+        if (option == nullptr) {
+            std::cerr << "Invalid option: " << arg << std::endl;
+            return 1;
+        }
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), *option);
+        if (ec != std::errc{} || ptr != value.data() + value.size()) {
+            std::cerr << "Invalid option: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (path.empty()) {
+        std::cerr << "Usage: tracedump [--from=N] [--count=N] <trace>" << std::endl;
+        return 1;
+    }
+
+    auto reader = TraceReader::Open(path);
+    if (reader == nullptr) {
+        return 1;
+    }
+    if (reader->getFormat() == TraceReader::Format::BINARY) {
+        auto file = MappedFile::Open(path);
+        std::printf("Records: %llu, blocks: %zu, bytes per record: %.2f\n",
+                    static_cast<unsigned long long>(reader->Size()), reader->Blocks(),
+                    static_cast<double>(file->size()) / static_cast<double>(std::max<uint64_t>(reader->Size(), 1)));
+        if (!reader->Seek(std::min(from, reader->Size()))) {
+            return 2;
+        }
+    } else {
+        // Commit log has no index, it is read up to the range
+        DynInstr skipped;
+        for (uint64_t i = 0; i < from && reader->Next(skipped); ++i) {
+        }
+    }
+
+    DynInstr instr;
+    for (uint64_t i = 0; i < count && reader->Next(instr); ++i) {
+        std::string disasm = RISCVInstr{std::bitset<32>{instr.instr}}.ToString();
+        std::printf("%llu 0x%08x (0x%08x) %-24s next 0x%08x addr 0x%08x value 0x%08x\n",
+                    static_cast<unsigned long long>(from + i), instr.pc, instr.instr, disasm.c_str(), instr.next_pc,
+                    instr.addr, instr.value);
+    }
+    return 0;
+}
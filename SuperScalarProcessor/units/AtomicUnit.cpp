@@ -0,0 +1,209 @@
+#include "AtomicUnit.h"
+#include "StatsRegistry.h"
+
+ReservationTable::ReservationTable(uint32_t harts) :
+        harts_(std::max(harts, 1u)), reserved_(new std::atomic<uint32_t>[harts_]) {
+    for (uint32_t hart = 0; hart < harts_; ++hart) {
+        reserved_[hart].store(none, std::memory_order_relaxed);
+    }
+}
+
+uint32_t ReservationTable::Harts() const noexcept {
+    return harts_;
+}
+
+size_t ReservationTable::StripeIdx(uint32_t addr) noexcept {
+    return (addr / 4) % stripes;
+}
+
+std::mutex &ReservationTable::Lock(uint32_t addr) noexcept {
+    return stripes_[StripeIdx(addr)].lock;
+}
+
+void ReservationTable::Reserve(uint32_t hart, uint32_t addr) noexcept {
+    reserved_[hart].store(addr & ~3u, std::memory_order_relaxed);
+}
+
+bool ReservationTable::Release(uint32_t hart, uint32_t addr) noexcept {
+    return reserved_[hart].exchange(none, std::memory_order_relaxed) == (addr & ~3u);
+}
+
+uint32_t ReservationTable::Break(uint32_t hart, uint32_t addr) noexcept {
+    uint32_t broken = 0;
+    for (uint32_t other = 0; other < harts_; ++other) {
+        // The other hart may reserve a word of another stripe meanwhile, hence compare and swap
+        uint32_t word = addr & ~3u;
+        if (other != hart && reserved_[other].compare_exchange_strong(word, none, std::memory_order_relaxed)) {
+            ++broken;
+        }
+    }
+    return broken;
+}
+
+uint32_t ReservationTable::Acquire(uint32_t hart, uint32_t addr) {
+    auto [it, inserted] = stripes_[StripeIdx(addr)].owners.try_emplace(addr & ~3u, hart);
+    uint32_t previous = it->second;
+    it->second = hart;
+    return previous;
+}
+
+void AtomicUnit::setReservations(std::shared_ptr<ReservationTable> reservations, uint32_t hart) {
+    reservations_ = std::move(reservations);
+    hart_ = hart;
+}
+
+std::bitset<32> AtomicUnit::Execute(DMEM &dmem, const RISCVInstr &instr, uint32_t addr, std::bitset<32> rs2) {
+    bool is_shared = reservations_->Harts() > 1;
+    std::unique_lock<std::mutex> lock;
+    if (is_shared) {
+        lock = std::unique_lock{reservations_->Lock(addr)};
+    }
+
+    Contention &word = words_[addr & ~3u];
+    ++word.accesses;
+    if (is_shared && reservations_->Acquire(hart_, addr) != hart_) {
+        ++handoffs_;
+        ++word.handoffs;
+    }
+
+    uint32_t old = dmem.Load(addr).to_ulong();
+    switch (instr.getOpcode()) {
+        case Opcode::LR_W:
+            ++lr_;
+            reservations_->Reserve(hart_, addr);
+            return old;
+        case Opcode::SC_W:
+            ++sc_;
+            if (!reservations_->Release(hart_, addr)) {
+                ++sc_failures_;
+                ++word.sc_failures;
+                return 1;
+            }
+            Break(addr, 4);
+            dmem.Store(rs2, addr);
+            return 0;
+        default:
+            ++amos_;
+            Break(addr, 4);
+            dmem.Store(Apply(instr.getOpcode(), old, rs2.to_ulong()), addr);
+            return old;
+    }
+}
+
+void AtomicUnit::Store(DMEM &dmem, std::bitset<32> WD, std::bitset<32> A, DMEM::Width w_type) {
+    if (reservations_->Harts() == 1) {
+        // Own store doesn't break own reservation
+        dmem.Store(WD, A, w_type);
+        return;
+    }
+
+    uint32_t addr = A.to_ulong();
+    uint32_t size = w_type == DMEM::Width::WORD ? 4 : w_type == DMEM::Width::HALF ? 2 : 1;
+    // Misaligned store of two words is ordered by the stripe of the first one only, atomics are always aligned
+    std::lock_guard lock{reservations_->Lock(addr)};
+    Break(addr, size);
+    dmem.Store(WD, A, w_type);
+}
+
+void AtomicUnit::Break(uint32_t addr, uint32_t size) {
+    uint32_t last = (addr + size - 1) & ~3u;
+    for (uint32_t word = addr & ~3u;; word += 4) {
+        if (uint32_t broken = reservations_->Break(hart_, word); broken > 0) {
+            broken_ += broken;
+            words_[word].broken += broken;
+        }
+        if (word == last) {
+            break;
+        }
+    }
+}
+
+uint32_t AtomicUnit::Apply(Opcode op, uint32_t old, uint32_t operand) noexcept {
+    switch (op) {
+        case Opcode::AMOSWAP_W:
+            return operand;
+        case Opcode::AMOADD_W:
+            return old + operand;
+        case Opcode::AMOXOR_W:
+            return old ^ operand;
+        case Opcode::AMOAND_W:
+            return old & operand;
+        case Opcode::AMOOR_W:
+            return old | operand;
+        case Opcode::AMOMIN_W:
+            return static_cast<int32_t>(old) < static_cast<int32_t>(operand) ? old : operand;
+        case Opcode::AMOMAX_W:
+            return static_cast<int32_t>(old) > static_cast<int32_t>(operand) ? old : operand;
+        case Opcode::AMOMINU_W:
+            return std::min(old, operand);
+        case Opcode::AMOMAXU_W:
+            return std::max(old, operand);
+        default:
+            std::cerr << "Wrong opcode for AMO" << std::endl;
+            return old;
+    }
+}
+
+uint32_t AtomicUnit::Latency() const noexcept {
+    return latency_;
+}
+
+uint64_t AtomicUnit::LoadReserved() const noexcept {
+    return lr_;
+}
+
+uint64_t AtomicUnit::StoreConditional() const noexcept {
+    return sc_;
+}
+
+uint64_t AtomicUnit::StoreConditionalFailures() const noexcept {
+    return sc_failures_;
+}
+
+uint64_t AtomicUnit::AMOs() const noexcept {
+    return amos_;
+}
+
+uint64_t AtomicUnit::Handoffs() const noexcept {
+    return handoffs_;
+}
+
+uint64_t AtomicUnit::BrokenReservations() const noexcept {
+    return broken_;
+}
+
+const std::unordered_map<uint32_t, AtomicUnit::Contention> &AtomicUnit::Words() const noexcept {
+    return words_;
+}
+
+std::vector<std::pair<uint32_t, AtomicUnit::Contention>> AtomicUnit::HotWords(
+        const std::vector<const AtomicUnit *> &units, size_t count) {
+    std::map<uint32_t, Contention> total;
+    for (const AtomicUnit *unit : units) {
+        for (const auto &[addr, word] : unit->words_) {
+            Contention &sum = total[addr];
+            sum.accesses += word.accesses;
+            sum.sc_failures += word.sc_failures;
+            sum.handoffs += word.handoffs;
+            sum.broken += word.broken;
+        }
+    }
+
+    std::vector<std::pair<uint32_t, Contention>> words{total.begin(), total.end()};
+    // Stable sort keeps equally contended words in the order of addresses
+    std::stable_sort(words.begin(), words.end(), [](const auto &lhs, const auto &rhs) {
+        return std::make_pair(lhs.second.Conflicts(), lhs.second.accesses) >
+               std::make_pair(rhs.second.Conflicts(), rhs.second.accesses);
+    });
+    words.resize(std::min(words.size(), count));
+    return words;
+}
+
+void AtomicUnit::RegisterStats(StatsRegistry &stats) const {
+    stats.Register("atomic.lr", lr_);
+    stats.Register("atomic.sc", sc_);
+    stats.Register("atomic.sc_failures", sc_failures_);
+    stats.Register("atomic.amos", amos_);
+    stats.Register("atomic.handoffs", handoffs_);
+    stats.Register("atomic.broken_reservations", broken_);
+}
@@ -1,6 +1,124 @@
 #include "BranchPredictor.h"
+#include "StatsRegistry.h"
+
+#include <algorithm>
+
+BranchPredictor::BranchPredictor(const Config &config) : config_(config) {
+    if (config_.type == Type::NOT_TAKEN) {
+        return;
+    }
+    if (!isSupported(config_)) {
+        std::cerr << "Unsupported branch predictor key size " << static_cast<uint32_t>(config_.key_size)
+                  << ", default one is used\n";
+        config_.key_size = Config{}.key_size;
+    }
+
+    switch (config_.key_size) {
+        case 4:
+            tables_.emplace<Table<4>>();
+            break;
+        case 6:
+            tables_.emplace<Table<6>>();
+            break;
+        case 8:
+            tables_.emplace<Table<8>>();
+            break;
+        case 10:
+            tables_.emplace<Table<10>>();
+            break;
+        case 12:
+            tables_.emplace<Table<12>>();
+            break;
+        case 14:
+            tables_.emplace<Table<14>>();
+            break;
+        case 16:
+            tables_.emplace<Table<16>>();
+            break;
+    }
+}
 
 void BranchPredictor::setPrediction(const PC &cur_pc, const PC &pc_disp, bool comp) {
+    ++updates_;
+    taken_ += static_cast<uint64_t>(comp);
+    Update update = std::visit([&](auto &table) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(table)>, std::monostate>) {
+            return Update::UNCHANGED;
+        } else {
+            return table.setPrediction(cur_pc, pc_disp, comp);
+        }
+    }, tables_);
+    allocations_ += static_cast<uint64_t>(update == Update::ALLOCATION);
+    replacements_ += static_cast<uint64_t>(update == Update::REPLACEMENT);
+    changes_ += static_cast<uint64_t>(update != Update::UNCHANGED);
+}
+
+bool BranchPredictor::getPrediction(const PC &cur_pc) const noexcept {
+    return std::visit([&](const auto &table) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(table)>, std::monostate>) {
+            return false;
+        } else {
+            return table.getPrediction(cur_pc);
+        }
+    }, tables_);
+}
+
+PC BranchPredictor::getTarget(bool pred, const PC &cur_pc) const noexcept {
+    if (!pred) {
+        return cur_pc;
+    }
+    return std::visit([&](const auto &table) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(table)>, std::monostate>) {
+            return cur_pc;
+        } else {
+            return table.getTarget(cur_pc);
+        }
+    }, tables_);
+}
+
+const BranchPredictor::Config &BranchPredictor::getConfig() const noexcept {
+    return config_;
+}
+
+uint64_t BranchPredictor::Changes() const noexcept {
+    return changes_;
+}
+
+bool BranchPredictor::isSupported(const Config &config) noexcept {
+    return config.type == Type::NOT_TAKEN ||
+           std::find(key_sizes.begin(), key_sizes.end(), config.key_size) != key_sizes.end();
+}
+
+uint64_t BranchPredictor::StorageBits(const Config &config) noexcept {
+    if (config.type == Type::NOT_TAKEN) {
+        return 0;
+    }
+    // Two ways of BHT (valid, prediction, tag) and BTB (target, tag) buckets
+    uint64_t bucket_bits = (33 - config.key_size) + (62 - config.key_size);
+    return 2 * (uint64_t{1} << config.key_size) * bucket_bits;
+}
+
+const char *BranchPredictor::Name(Type type) noexcept {
+    switch (type) {
+        case Type::NOT_TAKEN:
+            return "not-taken";
+        case Type::TWO_BIT:
+            return "two-bit";
+        default:
+            return "unknown";
+    }
+}
+
+void BranchPredictor::RegisterStats(StatsRegistry &stats) const {
+    stats.Register("bp.updates", updates_);
+    stats.Register("bp.taken", taken_);
+    stats.Register("bp.allocations", allocations_);
+    stats.Register("bp.replacements", replacements_);
+}
+
+template<uint8_t key_size>
+BranchPredictor::Update BranchPredictor::Table<key_size>::setPrediction(const PC &cur_pc, const PC &pc_disp,
+                                                                        bool comp) {
     std::bitset<32> pc{cur_pc.realVal()};
     std::bitset<32> target{PC{cur_pc + pc_disp}.realVal()};
     // In RV32I all opcodes begins with 11, so hashing them is useless
@@ -12,44 +130,56 @@ void BranchPredictor::setPrediction(const PC &cur_pc, const PC &pc_disp, bool co
     auto tag2 = sub_range<30 - key_size - 1, 0>(bht_bucket2);
 
     if (/* bit valid */ bht_bucket1[bht_bucket_size - 1] && tag1 == tag) {
-        updatePrediction(bht_bucket1, comp);
+        return updatePrediction(bht_bucket1, comp) ? Update::HIT : Update::UNCHANGED;
     } else if (/* bit valid */ bht_bucket2[bht_bucket_size - 1] && tag2 == tag) {
-        updatePrediction(bht_bucket2, comp);
+        return updatePrediction(bht_bucket2, comp) ? Update::HIT : Update::UNCHANGED;
     } else if (/* bit valid */ !bht_bucket1[bht_bucket_size - 1]) {
-        setupBucket(bht_bucket1, btb_[key.to_ulong()].first, key.to_ulong(), comp, target, tag);
+        setupBucket(bht_bucket1, btb_[key.to_ulong()].first, comp, target, tag);
+        return Update::ALLOCATION;
     } else if (/* bit valid */ !bht_bucket2[bht_bucket_size - 1]) {
-        setupBucket(bht_bucket2, btb_[key.to_ulong()].second, key.to_ulong(), comp, target, tag);
+        setupBucket(bht_bucket2, btb_[key.to_ulong()].second, comp, target, tag);
         swapBuckets(key.to_ulong());
+        return Update::ALLOCATION;
     } else {
         // Shift
         updatePrediction(bht_bucket2, comp);
         swapBuckets(key.to_ulong());
+        return Update::REPLACEMENT;
     }
 }
 
-void BranchPredictor::updatePrediction(std::bitset<bht_bucket_size> &bht_bucket, bool comp) {
+template<uint8_t key_size>
+bool BranchPredictor::Table<key_size>::updatePrediction(std::bitset<bht_bucket_size> &bht_bucket, bool comp) {
     auto prediction = calcPrediction(bht_bucket, comp);
+    if (prediction == sub_range<bht_bucket_size - 2, bht_bucket_size - 3>(bht_bucket)) {
+        return false;
+    }
     bht_bucket = assign_sub<bht_bucket_size - 2, bht_bucket_size - 3>(bht_bucket, prediction);
+    return true;
 }
 
-void BranchPredictor::setupBucket(std::bitset<bht_bucket_size> &bht_bucket, std::bitset<btb_bucket_size> &btb_bucket,
-                                  uint32_t key, bool comp, std::bitset<32> target, std::bitset<30 - key_size> tag) {
+template<uint8_t key_size>
+void BranchPredictor::Table<key_size>::setupBucket(std::bitset<bht_bucket_size> &bht_bucket,
+                                                   std::bitset<btb_bucket_size> &btb_bucket, bool comp,
+                                                   std::bitset<32> target, std::bitset<30 - key_size> tag) {
     bht_bucket.set(bht_bucket_size - 1);
     //  For default prediction is weak
     auto prediction = comp ? std::bitset<2>{0b10} : std::bitset<2>{0b01};
     bht_bucket = assign_sub<bht_bucket_size - 2, bht_bucket_size - 3>(bht_bucket, prediction);
-    bht_bucket = assign_sub<30 - key_size - 1, 0>(bht_[key].first, tag);
+    bht_bucket = assign_sub<30 - key_size - 1, 0>(bht_bucket, tag);
 
-    btb_bucket = assign_sub<btb_bucket_size - 1, 30 - key_size>(btb_[key].first, target);
-    btb_bucket = assign_sub<30 - key_size - 1, 0>(btb_[key].first, tag);
+    btb_bucket = assign_sub<btb_bucket_size - 1, 30 - key_size>(btb_bucket, target);
+    btb_bucket = assign_sub<30 - key_size - 1, 0>(btb_bucket, tag);
 }
 
-void BranchPredictor::swapBuckets(uint32_t key) {
+template<uint8_t key_size>
+void BranchPredictor::Table<key_size>::swapBuckets(uint32_t key) {
     std::swap(bht_[key].first, bht_[key].second);
     std::swap(btb_[key].first, btb_[key].second);
 }
 
-std::bitset<2> BranchPredictor::calcPrediction(std::bitset<bht_bucket_size> bht_bucket, bool comp) {
+template<uint8_t key_size>
+std::bitset<2> BranchPredictor::Table<key_size>::calcPrediction(std::bitset<bht_bucket_size> bht_bucket, bool comp) {
     auto pred = sub_range<bht_bucket_size - 2, bht_bucket_size - 3>(bht_bucket);
     switch (pred.to_ulong()) {
         case 0b00:  //  strongly not taken
@@ -65,7 +195,8 @@ std::bitset<2> BranchPredictor::calcPrediction(std::bitset<bht_bucket_size> bht_
     return {};
 }
 
-bool BranchPredictor::getPrediction(const PC &cur_pc) const noexcept {
+template<uint8_t key_size>
+bool BranchPredictor::Table<key_size>::getPrediction(const PC &cur_pc) const noexcept {
     std::bitset<32> pc{cur_pc.realVal()};
     std::bitset<key_size> key = sub_range<key_size + 1, 2>(pc);
     if (bht_.find(key.to_ulong()) == bht_.end()) {
@@ -100,11 +231,8 @@ bool BranchPredictor::getPrediction(const PC &cur_pc) const noexcept {
     return false;
 }
 
-PC BranchPredictor::getTarget(bool pred, const PC &cur_pc) const noexcept {
-    if (!pred) {
-        return cur_pc;
-    }
-
+template<uint8_t key_size>
+PC BranchPredictor::Table<key_size>::getTarget(const PC &cur_pc) const noexcept {
     std::bitset<32> pc{cur_pc.realVal()};
     auto tag = sub_range<31, key_size + 2>(pc);
     std::bitset<key_size> key = sub_range<key_size + 1, 2>(pc);
@@ -125,3 +253,11 @@ PC BranchPredictor::getTarget(bool pred, const PC &cur_pc) const noexcept {
 
     return PC{static_cast<uint32_t>(target.to_ulong() / 4)};
 }
+
+template class BranchPredictor::Table<4>;
+template class BranchPredictor::Table<6>;
+template class BranchPredictor::Table<8>;
+template class BranchPredictor::Table<10>;
+template class BranchPredictor::Table<12>;
+template class BranchPredictor::Table<14>;
+template class BranchPredictor::Table<16>;
@@ -0,0 +1,61 @@
+#include "CPIStack.h"
+
+#include <iomanip>
+
+uint64_t CPIStack::Slots(Bubble bubble) const noexcept {
+    return slots_[static_cast<uint8_t>(bubble)];
+}
+
+uint64_t CPIStack::TotalSlots() const noexcept {
+    return std::accumulate(slots_.begin(), slots_.end(), uint64_t{0});
+}
+
+const char *CPIStack::Name(Bubble bubble) noexcept {
+    switch (bubble) {
+        case Bubble::NONE:
+            return "base";
+        case Bubble::FRONTEND:
+            return "frontend";
+        case Bubble::REDIRECT:
+            return "redirect";
+        case Bubble::LOAD_USE:
+            return "load-use";
+        case Bubble::DEPENDENCY:
+            return "dependency";
+        case Bubble::SERIALIZE:
+            return "serialize";
+        case Bubble::DCACHE_MISS:
+            return "dcache-miss";
+        case Bubble::ISSUE_WIDTH:
+            return "issue-width";
+        case Bubble::ATOMIC:
+            return "atomic";
+        default:
+            return "unknown";
+    }
+}
+
+void CPIStack::Print(std::ostream &out) const {
+    uint64_t instructions = Slots(Bubble::NONE);
+    uint64_t total = TotalSlots();
+    if (instructions == 0) {
+        return;
+    }
+
+    auto flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    out << "Instructions: " << instructions << ", CPI: "
+        << static_cast<double>(total) / issue_width / static_cast<double>(instructions) << std::endl;
+    out << "CPI stack:" << std::endl;
+    for (uint8_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i] == 0) {
+            continue;
+        }
+        out << "  " << std::left << std::setw(12) << Name(static_cast<Bubble>(i)) << std::right
+            << std::setw(8) << static_cast<double>(slots_[i]) / issue_width / static_cast<double>(instructions)
+            << "  (" << std::setprecision(1) << std::setw(5) << 100.0 * static_cast<double>(slots_[i]) /
+                                                                   static_cast<double>(total)
+            << "%)" << std::setprecision(3) << std::endl;
+    }
+    out.flags(flags);
+}
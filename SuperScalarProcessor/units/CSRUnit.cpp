@@ -0,0 +1,58 @@
+#include "CSRUnit.h"
+#include "simulator.h"
+
+#include <iomanip>
+
+PipelineState CSRUnit::Run(Simulator &cpu, const RISCVInstr &instr) {
+    uint16_t addr = instr.getCSR();
+    auto value = Read(addr, cpu.write_back_.cycle);
+    if (!value) {
+        std::cerr << "Unsupported CSR 0x" << std::hex << addr << std::dec << std::endl;
+        return PipelineState::ERR;
+    }
+
+    // Set and clear with x0 (or zero immediate) only read the csr
+    bool is_write = instr.getOpcode() == Opcode::CSRRW || instr.getOpcode() == Opcode::CSRRWI ||
+                    instr.getRs1().any();
+    if (is_write) {
+        std::cerr << "Write to read-only CSR 0x" << std::hex << addr << std::dec << std::endl;
+        return PipelineState::ERR;
+    }
+
+    cpu.decode_.writeToRF(instr.getRd(), std::bitset<32>{*value}, instr.getRd().any());
+    return PipelineState::OK;
+}
+
+std::optional<uint32_t> CSRUnit::Read(uint16_t addr, uint64_t cycle) const noexcept {
+    uint64_t value;
+    bool is_high = addr >= CYCLEH && addr <= HPMCOUNTER31H;
+    switch (is_high ? addr - CYCLEH + CYCLE : addr) {
+        case CYCLE:
+        case TIME:
+            value = cycle;
+            break;
+        case INSTRET:
+            value = instret_;
+            break;
+        case MHARTID:
+            value = hart_id_;
+            break;
+        default:
+            if (addr < HPMCOUNTER3 || addr > HPMCOUNTER31H || (addr > HPMCOUNTER31 && addr < CYCLEH)) {
+                return std::nullopt;
+            }
+            // Counters without event are hardwired to zero
+            uint32_t idx = (is_high ? addr - HPMCOUNTER3H : addr - HPMCOUNTER3);
+            value = idx < events_.size() ? events_[idx] : 0;
+            break;
+    }
+    return static_cast<uint32_t>(is_high ? value >> 32 : value);
+}
+
+const uint64_t &CSRUnit::Instret() const noexcept {
+    return instret_;
+}
+
+uint64_t CSRUnit::Events(Event event) const noexcept {
+    return events_[static_cast<uint8_t>(event)];
+}
@@ -4,8 +4,17 @@ void ControlUnit::setState(const RISCVInstr &instr) {
     reset();
     switch (instr.getFormat()) {
         case RISCVInstr::Format::R:
-            flags.ALU_SRC2 = 0;
             flags.WB_WE = true;
+            if (instr.isAtomic()) {
+                // Loads the word at rs1 like lw, memory stage writes it back
+                flags.ALU_OP = ALU::Op::ADD;
+                flags.ALU_SRC2 = 3;  // const 0
+                flags.MEM_WIDTH = DMEM::Width::WORD;
+                flags.WS = true;
+                flags.ATOMIC = true;
+                break;
+            }
+            flags.ALU_SRC2 = 0;
             SelectALUOp(instr);
             break;
         case RISCVInstr::Format::I:
@@ -15,6 +24,12 @@ void ControlUnit::setState(const RISCVInstr &instr) {
             } else if (instr.getOpcode() == Opcode::EBREAK) {
                 flags.EBREAK = true;
                 return;
+            } else if (instr.getOpcode() == Opcode::ECALL) {
+                flags.ECALL = true;
+                return;
+            } else if (instr.isCSR()) {
+                flags.CSR = true;
+                return;
             }
             flags.WB_WE = true;
             flags.ALU_SRC2 = 1;
@@ -25,6 +40,7 @@ void ControlUnit::setState(const RISCVInstr &instr) {
             flags.WB_WE = false;
             flags.ALU_SRC2 = 1;
             flags.MEM_WE = true;
+            SelectStoreFlags(instr);
             break;
         case RISCVInstr::Format::B:
             flags.WB_WE = false;
@@ -128,6 +144,20 @@ void ControlUnit::SelectCMPOp(const RISCVInstr &instr) {
     }
 }
 
+void ControlUnit::SelectStoreFlags(const RISCVInstr &instr) {
+    switch (instr.getOpcode()) {
+        case Opcode::SB:
+            flags.MEM_WIDTH = DMEM::Width::BYTE;
+            break;
+        case Opcode::SH:
+            flags.MEM_WIDTH = DMEM::Width::HALF;
+            break;
+        default:
+            flags.MEM_WIDTH = DMEM::Width::WORD;
+            return;
+    }
+}
+
 void ControlUnit::SelectLoadFlags(const RISCVInstr &instr) {
     switch (instr.getOpcode()) {
         case Opcode::LB:
@@ -0,0 +1,183 @@
+#include "DataCache.h"
+#include "L2Cache.h"
+#include "StatsRegistry.h"
+
+DataCache::DataCache(const Config &config) : config_(config), miss_latency_(config.miss_latency) {
+    assert(config_.sets > 0 && config_.ways > 0 && config_.line_size > 0 && config_.mshrs > 0);
+    lines_.resize(config_.sets * config_.ways);
+}
+
+void DataCache::setL2(std::shared_ptr<L2Cache> l2, uint32_t hart) {
+    l2_ = std::move(l2);
+    hart_ = hart;
+}
+
+const L2Cache *DataCache::getL2() const noexcept {
+    return l2_.get();
+}
+
+bool DataCache::Access(uint32_t addr, bool is_store, uint64_t now) noexcept {
+    ++stamp_;
+    auto *line = const_cast<Line *>(Find(addr));
+    bool hit = line != nullptr;
+    miss_latency_ = config_.miss_latency;
+    if (l2_) {
+        // The tag may be present while the directory has invalidated the line
+        L2Cache::Outcome outcome = l2_->Access(hart_, addr, is_store, hit);
+        hit = outcome.hit;
+        miss_latency_ = outcome.latency;
+        coherence_misses_ += outcome.coherence_miss;
+        false_sharing_ += outcome.false_sharing;
+        invalidations_ += outcome.invalidations;
+    }
+    if (hit) {
+        line->lru = stamp_;
+        if (line->prefetched) {
+            line->prefetched = false;
+            if (line->ready > now && !is_store) {
+                // Prefetch was issued too late, the load waits for the rest of the fill
+                ++late_prefetches_;
+                ++misses_;
+                miss_latency_ = static_cast<uint32_t>(line->ready - now);
+                return false;
+            }
+            useful_prefetches_ += line->ready <= now;
+        }
+        ++hits_;
+        return true;
+    }
+
+    ++misses_;
+    if (line == nullptr) {
+        line = &Allocate(addr);
+    }
+    *line = Line{Tag(addr), stamp_, now + miss_latency_, true, false};
+    if (FreeMSHR(now)) {
+        fills_.push_back(line->ready);
+    }
+    return false;
+}
+
+bool DataCache::Probe(uint32_t addr) const noexcept {
+    return Find(addr) != nullptr;
+}
+
+bool DataCache::Ready(uint32_t addr, uint64_t now) const noexcept {
+    const Line *line = Find(addr);
+    return line != nullptr && line->ready <= now;
+}
+
+bool DataCache::Prefetch(uint32_t addr, uint64_t now) noexcept {
+    if (Find(addr) != nullptr || !FreeMSHR(now)) {
+        return false;
+    }
+
+    ++stamp_;
+    ++prefetches_;
+    Line &victim = Allocate(addr);
+    uint32_t latency = l2_ ? l2_->Access(hart_, addr, false, false).latency : config_.miss_latency;
+    victim = Line{Tag(addr), stamp_, now + latency, true, true};
+    fills_.push_back(victim.ready);
+    return true;
+}
+
+bool DataCache::FreeMSHR(uint64_t now) {
+    std::erase_if(fills_, [now](uint64_t ready) { return ready <= now; });
+    return fills_.size() < config_.mshrs;
+}
+
+uint32_t DataCache::SetIdx(uint32_t addr) const noexcept {
+    return (addr / config_.line_size) % config_.sets;
+}
+
+uint32_t DataCache::Tag(uint32_t addr) const noexcept {
+    return (addr / config_.line_size) / config_.sets;
+}
+
+const DataCache::Line *DataCache::Find(uint32_t addr) const noexcept {
+    uint32_t tag = Tag(addr);
+    const Line *set = &lines_[SetIdx(addr) * config_.ways];
+    for (uint32_t way = 0; way < config_.ways; ++way) {
+        if (set[way].valid && set[way].tag == tag) {
+            return &set[way];
+        }
+    }
+
+    return nullptr;
+}
+
+DataCache::Line &DataCache::Victim(uint32_t addr) noexcept {
+    Line *set = &lines_[SetIdx(addr) * config_.ways];
+    Line *victim = set;
+    for (uint32_t way = 0; way < config_.ways; ++way) {
+        if (!set[way].valid) {
+            return set[way];
+        }
+        if (set[way].lru < victim->lru) {
+            victim = &set[way];
+        }
+    }
+
+    return *victim;
+}
+
+DataCache::Line &DataCache::Allocate(uint32_t addr) noexcept {
+    Line &victim = Victim(addr);
+    if (l2_ && victim.valid) {
+        auto set = static_cast<uint32_t>(&victim - lines_.data()) / config_.ways;
+        l2_->Evict(hart_, (victim.tag * config_.sets + set) * config_.line_size);
+    }
+    return victim;
+}
+
+const DataCache::Config &DataCache::getConfig() const noexcept {
+    return config_;
+}
+
+uint32_t DataCache::MissLatency() const noexcept {
+    return miss_latency_;
+}
+
+uint64_t DataCache::Hits() const noexcept {
+    return hits_;
+}
+
+uint64_t DataCache::Misses() const noexcept {
+    return misses_;
+}
+
+uint64_t DataCache::Prefetches() const noexcept {
+    return prefetches_;
+}
+
+uint64_t DataCache::UsefulPrefetches() const noexcept {
+    return useful_prefetches_;
+}
+
+uint64_t DataCache::LatePrefetches() const noexcept {
+    return late_prefetches_;
+}
+
+uint64_t DataCache::CoherenceMisses() const noexcept {
+    return coherence_misses_;
+}
+
+uint64_t DataCache::FalseSharingMisses() const noexcept {
+    return false_sharing_;
+}
+
+uint64_t DataCache::Invalidations() const noexcept {
+    return invalidations_;
+}
+
+void DataCache::RegisterStats(StatsRegistry &stats) const {
+    stats.Register("dcache.hits", hits_);
+    stats.Register("dcache.misses", misses_);
+    stats.Register("dcache.prefetches", prefetches_);
+    if (l2_) {
+        stats.Register("dcache.coherence_misses", coherence_misses_);
+        stats.Register("dcache.false_sharing_misses", false_sharing_);
+        stats.Register("dcache.invalidations", invalidations_);
+        l2_->RegisterStats(stats);
+    }
+}
@@ -75,14 +75,14 @@ HazardUnit::HU_RS HazardUnit::HU_RS4() noexcept {
 
 HazardUnit::HU_RS HazardUnit::HU_RS5() noexcept {
     // By pass from memory stage
-    if (wb_we_m_up_ && a5_ex_ == hu_mem_rd_m_up_) {
-        return HU_RS::BP_MEM_Up;
-    }
-
     if (wb_we_m_down_ && a5_ex_ == hu_mem_rd_m_down_) {
         return HU_RS::BP_MEM_Down;
     }
 
+    if (wb_we_m_up_ && a5_ex_ == hu_mem_rd_m_up_) {
+        return HU_RS::BP_MEM_Up;
+    }
+
     // By pass from write back stage
     if ((wb_we_wb_down_ && (a5_ex_ == hu_mem_rd_wb_down_)) || bp_rd_rs5_down_) {
         pl_state = PipelineState::OK;
@@ -109,10 +109,18 @@ std::bitset<32> HazardUnit::BP_RD(Way way) const noexcept {
     return way == Way::UP ? bp_rd_up_ : bp_wb_down_;
 }
 
-void HazardUnit::CheckWaysDataDepends(std::bitset<5> rd_up, bool wb_we,
-                                      std::bitset<5> A4, std::bitset<5> A5, bool is_ebreak) noexcept {
-    if (wb_we && (rd_up == A4 || rd_up == A5) && pl_state != PipelineState::STALL && !is_ebreak) {
+HazardUnit::HazardUnit(const BranchPredictor::Config &bp, uint32_t issue_width) :
+        issue_width_(issue_width), branchPredictor_(bp) {}
+
+void HazardUnit::CheckWaysDataDepends(std::bitset<5> rd_up, bool wb_we, std::bitset<5> A4, std::bitset<5> A5,
+                                      bool is_down_invalid, bool is_serializing, bool is_up_valid) noexcept {
+    bool is_depend = wb_we && (rd_up == A4 || rd_up == A5);
+    // Squashed pair isn't split, down instruction would become valid after the shift
+    bool is_single = issue_width_ < 2 && is_up_valid;
+    if ((is_depend || is_serializing || is_single) && pl_state != PipelineState::STALL && !is_down_invalid) {
         pl_state = PipelineState::STALL_DOWN;
+        split_cause_ = is_serializing ? Bubble::SERIALIZE : is_depend ? Bubble::DEPENDENCY : Bubble::ISSUE_WIDTH;
+        ++(is_serializing ? serialize_splits_ : is_depend ? dependency_splits_ : width_splits_);
         return;
     }
 
@@ -122,24 +130,40 @@ void HazardUnit::CheckWaysDataDepends(std::bitset<5> rd_up, bool wb_we,
 }
 
 bool HazardUnit::CheckForStall(Simulator &cpu) noexcept {
-    bool ws_ex_up = cpu.execute_.WS(Way::UP), ws_ex_down{false};
+    // Load to x0 has no result to wait for
     std::bitset<5> rd_ex_up = cpu.execute_.WB_A(Way::UP), rd_ex_down;
+    bool ws_ex_up = cpu.execute_.WS(Way::UP) && rd_ex_up.any(), ws_ex_down{false};
     std::bitset<5> A1_D = cpu.decode_.getInstr(Way::UP).getRs1();
     std::bitset<5> A2_D = cpu.decode_.getInstr(Way::UP).getRs2();
     std::bitset<5> A4_D, A5_D;
     if (cpu.hu_.pl_state != PipelineState::STALL_DOWN) {
-        ws_ex_down = cpu.execute_.WS(Way::DOWN);
         rd_ex_down = cpu.execute_.WB_A(Way::DOWN);
+        ws_ex_down = cpu.execute_.WS(Way::DOWN) && rd_ex_down.any();
         A4_D = cpu.decode_.getInstr(Way::DOWN).getRs1();
         A5_D = cpu.decode_.getInstr(Way::DOWN).getRs2();
     }
 
-    bool is_conflict = (ws_ex_up && (bp_rd_rs1_up_ = rd_ex_up == A1_D || (bp_rd_rs2_up_ = rd_ex_up == A2_D))) ||
+    // Instructions in decode are squashed on redirect, they have nothing to wait for
+    bool is_conflict = !hu_pc_redirect_ && (
+                  (ws_ex_up && (bp_rd_rs1_up_ = rd_ex_up == A1_D || (bp_rd_rs2_up_ = rd_ex_up == A2_D))) ||
                   (ws_ex_up && (bp_rd_rs4_up_ = rd_ex_up == A4_D || (bp_rd_rs5_up_ = rd_ex_up == A5_D))) ||
                   (ws_ex_down && (bp_rd_rs1_down_ = rd_ex_down == A1_D || (bp_rd_rs2_down_ = rd_ex_down == A2_D))) ||
-                  (ws_ex_down && (bp_rd_rs4_down_ = rd_ex_down == A4_D || (bp_rd_rs5_down_ = rd_ex_down == A5_D)));
+                  (ws_ex_down && (bp_rd_rs4_down_ = rd_ex_down == A4_D || (bp_rd_rs5_down_ = rd_ex_down == A5_D))));
+
+    // System call and csr access are performed in write back, younger instructions read result from register file
+    bool is_system = cpu.execute_.ECALL() || cpu.execute_.CSR() || cpu.write_back_.ECALL() || cpu.write_back_.CSR();
 
     if (is_conflict) {
+        cpu.csr_.Count(CSRUnit::Event::LOAD_USE_STALL);
+        ++load_use_stalls_;
+        stall_cause_ = Bubble::LOAD_USE;
+    } else if (is_system) {
+        cpu.csr_.Count(CSRUnit::Event::SERIALIZE_STALL);
+        ++serialize_stalls_;
+        stall_cause_ = Bubble::SERIALIZE;
+    }
+
+    if (is_conflict || is_system) {
         pc_en_ = false;
         fd_en_ = false;
         pl_state = PipelineState::STALL;
@@ -155,6 +179,14 @@ bool HazardUnit::CheckForStall(Simulator &cpu) noexcept {
     return false;
 }
 
+Bubble HazardUnit::StallCause() const noexcept {
+    return stall_cause_;
+}
+
+Bubble HazardUnit::SplitCause() const noexcept {
+    return split_cause_;
+}
+
 bool HazardUnit::PC_EN() const noexcept {
     return pc_en_;
 }
@@ -215,12 +247,21 @@ void HazardUnit::sendEndOfIMEM() {
 
 void HazardUnit::setHU_PC_REDIECT(bool pc_r) {
     hu_pc_redirect_ = pc_r;
+    redirects_ += static_cast<uint64_t>(pc_r);
 }
 
 void HazardUnit::setBranchPrediction(const PC &cur_pc, const PC &pc_disp, bool comp) {
     branchPredictor_.setPrediction(cur_pc, pc_disp, comp);
 }
 
+uint32_t HazardUnit::IssueWidth() const noexcept {
+    return issue_width_;
+}
+
+const BranchPredictor &HazardUnit::getBranchPredictor() const noexcept {
+    return branchPredictor_;
+}
+
 bool HazardUnit::getPredicton(const PC &pc) const noexcept {
     return branchPredictor_.getPrediction(pc);
 }
@@ -228,3 +269,24 @@ bool HazardUnit::getPredicton(const PC &pc) const noexcept {
 PC HazardUnit::getTarget(bool pred, const PC &pc) const noexcept {
     return branchPredictor_.getTarget(pred, pc);
 }
+
+void HazardUnit::RegisterStats(StatsRegistry &stats) const {
+    stats.Register("hazard.load_use_stalls", load_use_stalls_);
+    stats.Register("hazard.serialize_stalls", serialize_stalls_);
+    stats.Register("hazard.dependency_splits", dependency_splits_);
+    stats.Register("hazard.serialize_splits", serialize_splits_);
+    stats.Register("hazard.width_splits", width_splits_);
+    stats.Register("hazard.redirects", redirects_);
+    branchPredictor_.RegisterStats(stats);
+}
+
+void HazardUnit::SaveTiming(std::vector<uint64_t> &state) const {
+    state.insert(state.end(), {static_cast<uint64_t>(pl_state), static_cast<uint64_t>(exception_state), pc_en_,
+                               fd_en_, static_cast<uint64_t>(stall_cause_), static_cast<uint64_t>(split_cause_),
+                               a1_ex_.to_ulong(), a2_ex_.to_ulong(), a4_ex_.to_ulong(), a5_ex_.to_ulong(),
+                               hu_pc_redirect_, bp_rd_rs1_up_, bp_rd_rs2_up_, bp_rd_rs4_up_, bp_rd_rs5_up_,
+                               bp_rd_rs1_down_, bp_rd_rs2_down_, bp_rd_rs4_down_, bp_rd_rs5_down_, wb_we_m_up_,
+                               wb_we_wb_up_, wb_we_m_down_, wb_we_wb_down_, hu_mem_rd_m_up_.to_ulong(),
+                               hu_mem_rd_wb_up_.to_ulong(), hu_mem_rd_m_down_.to_ulong(),
+                               hu_mem_rd_wb_down_.to_ulong(), branchPredictor_.Changes()});
+}
@@ -0,0 +1,107 @@
+#include "InstrMix.h"
+
+#include <iomanip>
+
+#include "CPIStack.h"
+
+void InstrMix::Enable() noexcept {
+    enabled_ = true;
+}
+
+bool InstrMix::isEnabled() const noexcept {
+    return enabled_;
+}
+
+uint64_t InstrMix::Retired(Opcode opcode) const noexcept {
+    return by_opcode_[static_cast<size_t>(opcode)];
+}
+
+uint64_t InstrMix::Retired(RISCVInstr::Format format) const noexcept {
+    return by_format_[static_cast<size_t>(format)];
+}
+
+uint64_t InstrMix::Retired() const noexcept {
+    return std::accumulate(by_format_.begin(), by_format_.end(), uint64_t{0});
+}
+
+uint64_t InstrMix::IssueCycles(size_t valid) const noexcept {
+    return valid <= issue_width ? issued_[valid] : 0;
+}
+
+uint64_t InstrMix::DownEmpty(Bubble bubble) const noexcept {
+    return down_empty_[static_cast<uint8_t>(bubble)];
+}
+
+const char *InstrMix::Name(RISCVInstr::Format format) noexcept {
+    switch (format) {
+        case RISCVInstr::Format::R:
+            return "R-type";
+        case RISCVInstr::Format::I:
+            return "I-type";
+        case RISCVInstr::Format::S:
+            return "S-type";
+        case RISCVInstr::Format::B:
+            return "B-type";
+        case RISCVInstr::Format::U:
+            return "U-type";
+        case RISCVInstr::Format::J:
+            return "J-type";
+    }
+    return "unknown";
+}
+
+namespace {
+
+double Percent(uint64_t part, uint64_t whole) {
+    return 100.0 * static_cast<double>(part) / static_cast<double>(std::max<uint64_t>(whole, 1));
+}
+
+void PrintRow(std::ostream &out, const std::string &name, uint64_t count, uint64_t whole) {
+    out << "  " << std::left << std::setw(12) << name << std::right << std::setw(10) << count
+        << "  (" << std::setw(5) << Percent(count, whole) << "%)" << std::endl;
+}
+
+}  // namespace
+
+void InstrMix::Print(std::ostream &out) const {
+    uint64_t cycles = std::accumulate(issued_.begin(), issued_.end(), uint64_t{0});
+    uint64_t retired = Retired();
+    if (cycles == 0) {
+        return;
+    }
+
+    auto flags = out.flags();
+    out << std::fixed << std::setprecision(1);
+    out << "Issue width utilization:" << std::endl;
+    for (size_t valid = 0; valid <= issue_width; ++valid) {
+        PrintRow(out, std::to_string(valid) + " issued", issued_[valid], cycles);
+    }
+
+    out << "Empty down slot with upper issued:" << std::endl;
+    uint64_t single = issued_[1];
+    for (uint8_t i = 0; i < down_empty_.size(); ++i) {
+        if (down_empty_[i] != 0) {
+            PrintRow(out, CPIStack::Name(static_cast<Bubble>(i)), down_empty_[i], single);
+        }
+    }
+
+    out << "Retired by format:" << std::endl;
+    for (size_t i = 0; i < by_format_.size(); ++i) {
+        if (by_format_[i] != 0) {
+            PrintRow(out, Name(static_cast<RISCVInstr::Format>(i)), by_format_[i], retired);
+        }
+    }
+
+    std::vector<size_t> order(opcodes);
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::stable_sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+        return by_opcode_[lhs] > by_opcode_[rhs];
+    });
+    out << "Retired by opcode:" << std::endl;
+    for (size_t i : order) {
+        if (by_opcode_[i] != 0) {
+            PrintRow(out, OpcodeToString(static_cast<Opcode>(i)), by_opcode_[i], retired);
+        }
+    }
+    out.flags(flags);
+}
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <bit>
+#include <map>
+
+#include "L2Cache.h"
+#include "StatsRegistry.h"
+
+L2Cache::L2Cache(const Config &config, const DataCache::Config &private_config, uint32_t harts) :
+        config_(config), line_size_(private_config.line_size), memory_latency_(private_config.miss_latency),
+        harts_(std::clamp(harts, 1u, max_harts)) {
+    if (config_.sets > 0) {
+        tags_.emplace(DataCache::Config{config_.sets, config_.ways, line_size_, memory_latency_});
+    }
+}
+
+L2Cache::Stripe &L2Cache::StripeOf(uint32_t line) noexcept {
+    return stripes_[line % stripes];
+}
+
+L2Cache::Outcome L2Cache::Access(uint32_t hart, uint32_t addr, bool is_store, bool present) {
+    uint32_t line = addr / line_size_;
+    uint64_t bit = uint64_t{1} << hart;
+    uint64_t word = uint64_t{1} << (addr % line_size_ / 4 % 64);
+    Stripe &stripe = StripeOf(line);
+    std::lock_guard lock{stripe.lock};
+    Entry &entry = stripe.lines[line];
+
+    Outcome outcome;
+    if (present && (entry.sharers & bit) != 0) {
+        outcome.hit = true;
+        if (is_store) {
+            // Shared -> Modified upgrade invalidates the other copies, Exclusive -> Modified is silent
+            outcome.invalidations = Invalidate(entry, hart);
+            entry.exclusive = entry.dirty = true;
+            Write(entry, hart, word);
+        }
+        return outcome;
+    }
+
+    if ((entry.lost & bit) != 0) {
+        outcome.coherence_miss = true;
+        outcome.false_sharing = (entry.remote_writes[hart] & word) == 0;
+        entry.lost &= ~bit;
+        ++entry.stats.coherence_misses;
+        entry.stats.false_sharing += outcome.false_sharing;
+    }
+
+    // Modified copy of another hart is forwarded, to the reader it's also written back
+    bool transfer = entry.dirty && (entry.sharers & ~bit) != 0;
+    if (is_store) {
+        outcome.invalidations = Invalidate(entry, hart);
+        entry.sharers = bit;
+        entry.exclusive = entry.dirty = true;
+        Write(entry, hart, word);
+    } else {
+        entry.sharers |= bit;
+        entry.exclusive = entry.sharers == bit;
+        entry.dirty = false;
+    }
+
+    std::lock_guard l2_lock{lock_};
+    if (transfer && !is_store) {
+        ++writebacks_;
+        if (tags_) {
+            tags_->Access(line * line_size_);
+        }
+    }
+    outcome.latency = Fill(line, transfer);
+    return outcome;
+}
+
+uint32_t L2Cache::Fill(uint32_t line, bool transfer) {
+    if (transfer) {
+        ++transfers_;
+        return config_.latency;
+    }
+    if (!tags_) {
+        return memory_latency_;
+    }
+    if (tags_->Access(line * line_size_)) {
+        ++hits_;
+        return config_.latency;
+    }
+    ++misses_;
+    return memory_latency_;
+}
+
+void L2Cache::Evict(uint32_t hart, uint32_t addr) {
+    uint32_t line = addr / line_size_;
+    uint64_t bit = uint64_t{1} << hart;
+    Stripe &stripe = StripeOf(line);
+    std::lock_guard lock{stripe.lock};
+    auto it = stripe.lines.find(line);
+    if (it == stripe.lines.end()) {
+        return;
+    }
+
+    // Replaced line is not lost to another hart any more, the next miss is a capacity one
+    Entry &entry = it->second;
+    entry.lost &= ~bit;
+    if ((entry.sharers & bit) == 0) {
+        return;
+    }
+    entry.sharers &= ~bit;
+    if (entry.exclusive) {
+        if (entry.dirty) {
+            std::lock_guard l2_lock{lock_};
+            ++writebacks_;
+            if (tags_) {
+                tags_->Access(line * line_size_);
+            }
+        }
+        entry.exclusive = entry.dirty = false;
+    }
+}
+
+uint32_t L2Cache::Invalidate(Entry &entry, uint32_t hart) {
+    uint64_t others = entry.sharers & ~(uint64_t{1} << hart);
+    if (others == 0) {
+        return 0;
+    }
+
+    if (entry.remote_writes.empty()) {
+        entry.remote_writes.resize(harts_);
+    }
+    for (uint64_t other = others; other != 0; other &= other - 1) {
+        entry.remote_writes[std::countr_zero(other)] = 0;
+    }
+    entry.lost |= others;
+    entry.sharers &= ~others;
+    auto invalidated = static_cast<uint32_t>(std::popcount(others));
+    entry.stats.invalidations += invalidated;
+    return invalidated;
+}
+
+void L2Cache::Write(Entry &entry, uint32_t hart, uint64_t word) noexcept {
+    entry.stats.writers |= uint64_t{1} << hart;
+    for (uint64_t lost = entry.lost; lost != 0; lost &= lost - 1) {
+        entry.remote_writes[std::countr_zero(lost)] |= word;
+    }
+}
+
+const L2Cache::Config &L2Cache::getConfig() const noexcept {
+    return config_;
+}
+
+uint32_t L2Cache::Harts() const noexcept {
+    return harts_;
+}
+
+uint64_t L2Cache::Hits() const noexcept {
+    return hits_;
+}
+
+uint64_t L2Cache::Misses() const noexcept {
+    return misses_;
+}
+
+uint64_t L2Cache::Transfers() const noexcept {
+    return transfers_;
+}
+
+uint64_t L2Cache::Writebacks() const noexcept {
+    return writebacks_;
+}
+
+L2Cache::LineStats L2Cache::Total() const {
+    LineStats total;
+    for (const Stripe &stripe : stripes_) {
+        std::lock_guard lock{stripe.lock};
+        for (const auto &[line, entry] : stripe.lines) {
+            total.invalidations += entry.stats.invalidations;
+            total.coherence_misses += entry.stats.coherence_misses;
+            total.false_sharing += entry.stats.false_sharing;
+            total.writers |= entry.stats.writers;
+        }
+    }
+    return total;
+}
+
+std::vector<std::pair<uint32_t, L2Cache::LineStats>> L2Cache::HotLines(size_t count) const {
+    std::map<uint32_t, LineStats> hot;
+    for (const Stripe &stripe : stripes_) {
+        std::lock_guard lock{stripe.lock};
+        for (const auto &[line, entry] : stripe.lines) {
+            if (entry.stats.invalidations > 0 || entry.stats.coherence_misses > 0) {
+                hot.emplace(line * line_size_, entry.stats);
+            }
+        }
+    }
+
+    std::vector<std::pair<uint32_t, LineStats>> lines{hot.begin(), hot.end()};
+    // Stable sort keeps equally hot lines in the order of addresses
+    std::stable_sort(lines.begin(), lines.end(), [](const auto &lhs, const auto &rhs) {
+        return std::make_pair(lhs.second.coherence_misses, lhs.second.invalidations) >
+               std::make_pair(rhs.second.coherence_misses, rhs.second.invalidations);
+    });
+    lines.resize(std::min(lines.size(), count));
+    return lines;
+}
+
+void L2Cache::RegisterStats(StatsRegistry &stats) const {
+    stats.Register("l2.hits", hits_);
+    stats.Register("l2.misses", misses_);
+    stats.Register("l2.transfers", transfers_);
+    stats.Register("l2.writebacks", writebacks_);
+}
@@ -0,0 +1,127 @@
+#include "Profiler.h"
+
+#include <iomanip>
+
+#include "instruction.h"
+
+void Profiler::Enable(const IMEM &imem) {
+    entries_.assign(imem.size(), Entry{});
+    base_ = imem.getBase();
+    last_retired_ = base_;
+    enabled_ = true;
+}
+
+bool Profiler::isEnabled() const noexcept {
+    return enabled_;
+}
+
+void Profiler::Cycle(const PC &pc_up, Bubble bubble_up, const PC &pc_down, Bubble bubble_down) noexcept {
+    if (bubble_up == Bubble::NONE) {
+        Entry &up = At(pc_up);
+        ++up.count;
+        up.cycles += 1 + pending_;
+        up.stalls += pending_;
+        pending_ = 0;
+        last_retired_ = pc_up;
+
+        if (bubble_down == Bubble::NONE) {
+            Entry &down = At(pc_down);
+            ++down.count;
+            ++down.paired;
+            ++up.paired;
+            last_retired_ = pc_down;
+        }
+    } else if (bubble_up == Bubble::REDIRECT || bubble_up == Bubble::FRONTEND) {
+        // Refill after flush is the cost of the instruction that caused it
+        Entry &last = At(last_retired_);
+        ++last.cycles;
+        ++last.stalls;
+    } else {
+        ++pending_;
+    }
+}
+
+void Profiler::Freeze(uint64_t cycles) noexcept {
+    pending_ += cycles;
+}
+
+const Profiler::Entry &Profiler::getEntry(const PC &pc) const noexcept {
+    return pc.val() - base_.val() < entries_.size() ? entries_[pc.val() - base_.val()] : outside_;
+}
+
+Profiler::Entry &Profiler::At(const PC &pc) noexcept {
+    return pc.val() - base_.val() < entries_.size() ? entries_[pc.val() - base_.val()] : outside_;
+}
+
+namespace {
+
+double Percent(uint64_t part, uint64_t whole) {
+    return 100.0 * static_cast<double>(part) / static_cast<double>(std::max<uint64_t>(whole, 1));
+}
+
+struct Row final {
+    Profiler::Entry entry;
+    uint32_t addr{0};
+    std::string text;
+};
+
+void PrintRows(std::ostream &out, std::vector<Row> &rows, const char *header) {
+    std::stable_sort(rows.begin(), rows.end(), [](const Row &lhs, const Row &rhs) {
+        return lhs.entry.cycles > rhs.entry.cycles;
+    });
+    uint64_t total = 0;
+    for (const auto &row : rows) {
+        total += row.entry.cycles;
+    }
+
+    auto flags = out.flags();
+    out << std::fixed << std::setprecision(1);
+    out << "Profile:" << std::endl;
+    out << std::setw(10) << "cycles" << std::setw(8) << "%" << std::setw(10) << "count" << std::setw(10) << "stalls"
+        << std::setw(8) << "dual%" << "  " << header << std::endl;
+    for (const auto &row : rows) {
+        const Profiler::Entry &entry = row.entry;
+        out << std::setw(10) << entry.cycles
+            << std::setw(7) << Percent(entry.cycles, total)
+            << "%" << std::setw(10) << entry.count << std::setw(10) << entry.stalls
+            << std::setw(7) << Percent(entry.paired, entry.count)
+            << "%  " << row.text << std::endl;
+    }
+    out.flags(flags);
+}
+
+}  // namespace
+
+void Profiler::Print(std::ostream &out, const IMEM &imem, const SymbolTable *symbols) const {
+    std::vector<Row> rows;
+    for (uint32_t i = 0; i < entries_.size(); ++i) {
+        const Entry &entry = entries_[i];
+        if (entry.count == 0 && entry.cycles == 0) {
+            continue;
+        }
+
+        PC pc = base_ + i * 4;
+        const Symbol *symbol = symbols != nullptr ? symbols->Lookup(pc.realVal()) : nullptr;
+        if (symbols != nullptr) {
+            // Instructions of one function are adjacent, so its row is the last one
+            std::string name = symbol != nullptr ? symbol->name : "<unknown>";
+            uint32_t addr = symbol != nullptr ? symbol->addr : 0;
+            if (rows.empty() || rows.back().addr != addr || rows.back().text != name) {
+                rows.push_back(Row{{}, addr, name});
+            }
+            Entry &sum = rows.back().entry;
+            sum.count += entry.count;
+            sum.cycles += entry.cycles;
+            sum.stalls += entry.stalls;
+            sum.paired += entry.paired;
+            continue;
+        }
+
+        std::ostringstream text;
+        text << "0x" << std::hex << std::setw(8) << std::setfill('0') << pc.realVal() << "  "
+             << RISCVInstr{imem.getInstr(pc)}.ToString();
+        rows.push_back(Row{entry, pc.realVal(), text.str()});
+    }
+
+    PrintRows(out, rows, symbols != nullptr ? "function" : "pc          instruction");
+}
@@ -0,0 +1,120 @@
+#include "RunaheadUnit.h"
+#include "simulator.h"
+
+void RunaheadUnit::setEnabled(bool enabled) noexcept {
+    enabled_ = enabled;
+}
+
+bool RunaheadUnit::isEnabled() const noexcept {
+    return enabled_;
+}
+
+void RunaheadUnit::Run(Simulator &cpu, const Checkpoint &checkpoint, uint64_t start, uint32_t cycles) {
+    ++episodes_;
+    // Runahead works on its own copy of the checkpoint, dropping it is the rollback
+    Checkpoint state = checkpoint;
+    const IMEM &imem = cpu.fetch_.getIMEM();
+    const DMEM &dmem = cpu.memory_.getDMEM();
+    DataCache &dcache = cpu.memory_.getDCache();
+    ControlUnit cu;
+
+    auto read = [&state](std::bitset<5> A) {
+        return A.none() ? std::bitset<32>{0} : state.reg_file.Read(A);
+    };
+
+    for (uint32_t slot = 0; slot < cycles * issue_width && !imem.isEndOfIMEM(state.pc); ++slot) {
+        uint64_t now = start + slot / issue_width;
+        RISCVInstr instr{imem.getInstr(state.pc)};
+        cu.setState(instr);
+        // Result of atomic depends on the other harts, it isn't pre-executed
+        if (cu.flags.EBREAK || cu.flags.ECALL || cu.flags.CSR || cu.flags.ATOMIC) {
+            break;
+        }
+        ++instructions_;
+
+        auto rs1 = instr.getRs1(), rs2 = instr.getRs2();
+        bool inv1 = state.inv[rs1.to_ulong()], inv2 = state.inv[rs2.to_ulong()];
+        IMM imm{instr, cu.flags.JALR};
+
+        std::bitset<32> src1, src2;
+        bool inv = false;
+        switch (cu.flags.ALU_SRC1) {
+            case 0:
+                src1 = read(rs1);
+                inv |= inv1;
+                break;
+            case 1:
+                src1 = std::bitset<32>{state.pc.realVal()};
+                break;
+            default:
+                break;
+        }
+        switch (cu.flags.ALU_SRC2) {
+            case 0:
+                src2 = read(rs2);
+                inv |= inv2;
+                break;
+            case 1:
+                src2 = imm.getImm();
+                break;
+            case 2:
+                src2 = std::bitset<32>{4};
+                break;
+            default:
+                break;
+        }
+        std::bitset<32> result = ALU::calc(src1, src2, cu.flags.ALU_OP);
+
+        if (cu.flags.WS) {
+            uint32_t addr = result.to_ulong();
+            // Lines still being filled have no data yet, same as the missing one
+            if (!inv && dcache.Ready(addr, now)) {
+                result = dmem.Load(result, cu.flags.MEM_WIDTH);
+            } else {
+                if (!inv && dcache.Prefetch(addr, now)) {
+                    ++prefetches_;
+                }
+                inv = true;
+            }
+        } else if (cu.flags.MEM_WE && !inv) {
+            // Stores are not performed, but their lines are brought in advance
+            if (dcache.Prefetch(result.to_ulong(), now)) {
+                ++prefetches_;
+            }
+        }
+
+        if (cu.flags.WB_WE && instr.getRd().any()) {
+            state.reg_file.Write(instr.getRd(), result);
+            state.inv[instr.getRd().to_ulong()] = inv;
+        }
+
+        if (cu.flags.BRANCH_COND) {
+            bool taken = (inv1 || inv2) ? cpu.hu_.getPredicton(state.pc) :
+                                          CMP::calc(read(rs1), read(rs2), cu.flags.CMP_OP);
+            state.pc = taken ? state.pc + PC{imm.getImm()} : state.pc + 4;
+        } else if (cu.flags.JMP) {
+            state.pc = state.pc + PC{imm.getImm()};
+        } else if (cu.flags.JALR) {
+            if (inv1) {
+                // Target is unknown, nothing to pre-execute further
+                break;
+            }
+            uint32_t target = read(rs1).to_ulong() + IMM{instr}.getImm().to_ulong();
+            state.pc = PC{target / 4};
+        } else {
+            state.pc += 4;
+        }
+    }
+}
+
+uint64_t RunaheadUnit::Episodes() const noexcept {
+    return episodes_;
+}
+
+uint64_t RunaheadUnit::Instructions() const noexcept {
+    return instructions_;
+}
+
+uint64_t RunaheadUnit::Prefetches() const noexcept {
+    return prefetches_;
+}
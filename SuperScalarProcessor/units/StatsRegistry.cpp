@@ -0,0 +1,111 @@
+#include "StatsRegistry.h"
+
+#include <iomanip>
+
+StatsRegistry::~StatsRegistry() {
+    Close();
+}
+
+void StatsRegistry::setClock(const uint64_t &cycles, const uint64_t &instructions) noexcept {
+    cycles_ = &cycles;
+    instructions_ = &instructions;
+}
+
+void StatsRegistry::Register(const std::string &name, const uint64_t &counter) {
+    counters_.push_back(Counter{name, &counter, counter});
+}
+
+bool StatsRegistry::Open(const std::string &path, Period period, uint64_t interval) {
+    if (cycles_ == nullptr || interval == 0) {
+        return false;
+    }
+    out_.open(path);
+    if (!out_) {
+        std::cerr << "Can't create stats file: " << path << std::endl;
+        return false;
+    }
+
+    format_ = FormatOf(path);
+    period_ = period;
+    interval_ = interval;
+    last_cycles_ = *cycles_;
+    last_instructions_ = *instructions_;
+    for (auto &counter : counters_) {
+        counter.last = *counter.value;
+    }
+    next_ = (Now() / interval_ + 1) * interval_;
+
+    out_ << std::fixed << std::setprecision(3);
+    if (format_ == Format::CSV) {
+        out_ << "cycle,instructions,ipc";
+        for (const auto &counter : counters_) {
+            out_ << ',' << counter.name;
+        }
+        out_ << '\n';
+    } else {
+        out_ << "[";
+    }
+    return true;
+}
+
+bool StatsRegistry::isEnabled() const noexcept {
+    return out_.is_open();
+}
+
+void StatsRegistry::Close() {
+    if (!out_.is_open()) {
+        return;
+    }
+    if (*cycles_ != last_cycles_) {
+        Write();
+    }
+    if (format_ == Format::JSON) {
+        out_ << "\n]\n";
+    }
+    out_.close();
+    next_ = UINT64_MAX;
+}
+
+uint64_t StatsRegistry::Rows() const noexcept {
+    return rows_;
+}
+
+StatsRegistry::Format StatsRegistry::FormatOf(const std::string &path) noexcept {
+    static const std::string json = ".json";
+    bool is_json = path.size() >= json.size() && path.compare(path.size() - json.size(), json.size(), json) == 0;
+    return is_json ? Format::JSON : Format::CSV;
+}
+
+uint64_t StatsRegistry::Now() const noexcept {
+    return period_ == Period::CYCLES ? *cycles_ : *instructions_;
+}
+
+void StatsRegistry::Write() {
+    uint64_t cycles = *cycles_ - last_cycles_;
+    uint64_t instructions = *instructions_ - last_instructions_;
+    double ipc = cycles == 0 ? 0.0 : static_cast<double>(instructions) / static_cast<double>(cycles);
+
+    if (format_ == Format::CSV) {
+        out_ << *cycles_ << ',' << instructions << ',' << ipc;
+        for (auto &counter : counters_) {
+            out_ << ',' << *counter.value - counter.last;
+        }
+        out_ << '\n';
+    } else {
+        out_ << (rows_ == 0 ? "\n" : ",\n") << "  {\"cycle\": " << *cycles_ << ", \"instructions\": " << instructions
+             << ", \"ipc\": " << ipc;
+        for (auto &counter : counters_) {
+            out_ << ", \"" << counter.name << "\": " << *counter.value - counter.last;
+        }
+        out_ << "}";
+    }
+
+    for (auto &counter : counters_) {
+        counter.last = *counter.value;
+    }
+    last_cycles_ = *cycles_;
+    last_instructions_ = *instructions_;
+    // Pipeline freeze can skip several boundaries at once
+    next_ = (Now() / interval_ + 1) * interval_;
+    ++rows_;
+}
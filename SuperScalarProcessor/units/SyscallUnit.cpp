@@ -0,0 +1,231 @@
+#include "SyscallUnit.h"
+#include "simulator.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Registers of the calling convention
+constexpr uint8_t a0 = 10;
+constexpr uint8_t a1 = 11;
+constexpr uint8_t a2 = 12;
+constexpr uint8_t a7 = 17;
+
+// Largest chunk copied between guest and host memory at once
+constexpr uint32_t io_chunk = 64 * 1024;
+
+template<typename T>
+void Put(uint8_t *buf, uint32_t offset, T value) {
+    std::memcpy(buf + offset, &value, sizeof(T));
+}
+
+}  // namespace
+
+PipelineState SyscallUnit::Run(Simulator &cpu) {
+    const RegisterFile &rf = cpu.decode_.getRegFile();
+    uint32_t result = 0;
+    if (Call(cpu.memory_.getDMEM(), rf.Read({a7}).to_ulong(),
+             {static_cast<uint32_t>(rf.Read({a0}).to_ulong()), static_cast<uint32_t>(rf.Read({a1}).to_ulong()),
+              static_cast<uint32_t>(rf.Read({a2}).to_ulong())}, result) == PipelineState::BREAK) {
+        return PipelineState::BREAK;
+    }
+
+    cpu.decode_.writeToRF({a0}, std::bitset<32>{result}, true);
+    return PipelineState::OK;
+}
+
+PipelineState SyscallUnit::Replay(Simulator &cpu, uint32_t result) {
+    ++calls_;
+    const RegisterFile &rf = cpu.decode_.getRegFile();
+    uint32_t number = rf.Read({a7}).to_ulong();
+    if (number == EXIT || number == EXIT_GROUP) {
+        exited_ = true;
+        exit_code_ = static_cast<int32_t>(rf.Read({a0}).to_ulong());
+        return PipelineState::BREAK;
+    }
+
+    cpu.decode_.writeToRF({a0}, std::bitset<32>{result}, true);
+    return PipelineState::OK;
+}
+
+PipelineState SyscallUnit::Call(DMEM &dmem, uint32_t number, const std::array<uint32_t, 3> &args, uint32_t &result) {
+    ++calls_;
+    auto [arg0, arg1, arg2] = args;
+    int32_t value;
+    switch (number) {
+        case EXIT:
+        case EXIT_GROUP:
+            exited_ = true;
+            exit_code_ = static_cast<int32_t>(arg0);
+            return PipelineState::BREAK;
+        case READ:
+            value = Read(dmem, arg0, arg1, arg2);
+            break;
+        case WRITE:
+            value = Write(dmem, arg0, arg1, arg2);
+            break;
+        case CLOSE:
+            // Standard descriptors are the only ones guest can have, closing them is a no-op
+            value = HostFd(arg0) < 0 ? -EBADF : 0;
+            break;
+        case FSTAT:
+            value = Fstat(dmem, arg0, arg1);
+            break;
+        case CLOCK_GETTIME:
+            value = ClockGettime(dmem, arg1);
+            break;
+        case GETTIMEOFDAY:
+            value = Gettimeofday(dmem, arg0);
+            break;
+        case BRK:
+            value = Brk(arg0);
+            break;
+        default:
+            std::cerr << "Unsupported system call " << number << std::endl;
+            value = -ENOSYS;
+            break;
+    }
+
+    result = static_cast<uint32_t>(value);
+    return PipelineState::OK;
+}
+
+void SyscallUnit::setBreak(uint32_t brk) noexcept {
+    brk_ = brk_start_ = brk;
+}
+
+void SyscallUnit::setFd(uint32_t guest_fd, int host_fd) noexcept {
+    assert(guest_fd < fds_.size());
+    fds_[guest_fd] = host_fd;
+}
+
+bool SyscallUnit::isExited() const noexcept {
+    return exited_;
+}
+
+int SyscallUnit::ExitCode() const noexcept {
+    return exit_code_;
+}
+
+uint64_t SyscallUnit::Calls() const noexcept {
+    return calls_;
+}
+
+int SyscallUnit::HostFd(uint32_t guest_fd) const noexcept {
+    return guest_fd < fds_.size() ? fds_[guest_fd] : -1;
+}
+
+int32_t SyscallUnit::Read(DMEM &dmem, uint32_t fd, uint32_t buf, uint32_t count) {
+    int host_fd = HostFd(fd);
+    if (host_fd < 0) {
+        return -EBADF;
+    }
+
+    std::vector<uint8_t> data(std::min(count, io_chunk));
+    uint32_t total = 0;
+    while (total < count) {
+        ssize_t n = ::read(host_fd, data.data(), std::min<uint32_t>(count - total, data.size()));
+        if (n < 0) {
+            return total > 0 ? static_cast<int32_t>(total) : -errno;
+        }
+        if (n == 0) {
+            break;
+        }
+        dmem.WriteBytes(buf + total, data.data(), n);
+        total += n;
+        // Short read means no more data is available right now (e.g. terminal line)
+        if (static_cast<uint32_t>(n) < data.size()) {
+            break;
+        }
+    }
+    return static_cast<int32_t>(total);
+}
+
+int32_t SyscallUnit::Write(const DMEM &dmem, uint32_t fd, uint32_t buf, uint32_t count) {
+    int host_fd = HostFd(fd);
+    if (host_fd < 0) {
+        return -EBADF;
+    }
+
+    std::vector<uint8_t> data(std::min(count, io_chunk));
+    uint32_t total = 0;
+    while (total < count) {
+        uint32_t chunk = std::min<uint32_t>(count - total, data.size());
+        dmem.ReadBytes(buf + total, data.data(), chunk);
+        for (uint32_t written = 0; written < chunk;) {
+            ssize_t n = ::write(host_fd, data.data() + written, chunk - written);
+            if (n < 0) {
+                return total + written > 0 ? static_cast<int32_t>(total + written) : -errno;
+            }
+            written += n;
+        }
+        total += chunk;
+    }
+    return static_cast<int32_t>(total);
+}
+
+int32_t SyscallUnit::Fstat(DMEM &dmem, uint32_t fd, uint32_t buf) {
+    int host_fd = HostFd(fd);
+    struct stat st{};
+    if (host_fd < 0 || fstat(host_fd, &st) != 0) {
+        return -EBADF;
+    }
+
+    // struct kernel_stat of libgloss for rv32
+    uint8_t kst[128] = {};
+    Put<uint64_t>(kst, 0, st.st_dev);
+    Put<uint64_t>(kst, 8, st.st_ino);
+    Put<uint32_t>(kst, 16, st.st_mode);
+    Put<uint32_t>(kst, 20, st.st_nlink);
+    Put<uint32_t>(kst, 24, st.st_uid);
+    Put<uint32_t>(kst, 28, st.st_gid);
+    Put<uint64_t>(kst, 32, st.st_rdev);
+    Put<int64_t>(kst, 48, st.st_size);
+    Put<int32_t>(kst, 56, st.st_blksize);
+    Put<int64_t>(kst, 64, st.st_blocks);
+    Put<int64_t>(kst, 72, st.st_atim.tv_sec);
+    Put<int32_t>(kst, 80, st.st_atim.tv_nsec);
+    Put<int64_t>(kst, 88, st.st_mtim.tv_sec);
+    Put<int32_t>(kst, 96, st.st_mtim.tv_nsec);
+    Put<int64_t>(kst, 104, st.st_ctim.tv_sec);
+    Put<int32_t>(kst, 112, st.st_ctim.tv_nsec);
+    dmem.WriteBytes(buf, kst, sizeof(kst));
+    return 0;
+}
+
+int32_t SyscallUnit::ClockGettime(DMEM &dmem, uint32_t buf) {
+    // Clock id is ignored: every clock is the host monotonic one
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    // struct timespec with 64 bit time_t
+    uint8_t guest_ts[16] = {};
+    Put<int64_t>(guest_ts, 0, ts.tv_sec);
+    Put<int32_t>(guest_ts, 8, static_cast<int32_t>(ts.tv_nsec));
+    dmem.WriteBytes(buf, guest_ts, sizeof(guest_ts));
+    return 0;
+}
+
+int32_t SyscallUnit::Gettimeofday(DMEM &dmem, uint32_t buf) {
+    timespec ts{};
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    // struct timeval with 64 bit time_t
+    uint8_t tv[16] = {};
+    Put<int64_t>(tv, 0, ts.tv_sec);
+    Put<int32_t>(tv, 8, static_cast<int32_t>(ts.tv_nsec / 1000));
+    dmem.WriteBytes(buf, tv, sizeof(tv));
+    return 0;
+}
+
+int32_t SyscallUnit::Brk(uint32_t addr) noexcept {
+    // Memory is allocated on the first touch, so moving the break is only bookkeeping
+    if (addr >= brk_start_) {
+        brk_ = addr;
+    }
+    return static_cast<int32_t>(brk_);
+}
@@ -0,0 +1,112 @@
+#ifndef UNITS_ATOMIC_UNIT_H
+#define UNITS_ATOMIC_UNIT_H
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include "Basics.h"
+
+/*
+ *  Load reservations of all harts sharing one guest memory, the reservation set is the aligned word. A store of
+ *  any hart to a reserved word breaks the reservations of the other harts, so sc.w fails if the word could have
+ *  changed since lr.w. Harts run on different host threads, so the read-modify-write of an atomic and every store
+ *  to the shared memory are done under the lock of the word's stripe, which also orders them for reservations.
+ */
+class ReservationTable final {
+public:
+    explicit ReservationTable(uint32_t harts = 1);
+
+    [[nodiscard]] uint32_t Harts() const noexcept;
+    // Lock of the stripe the word belongs to, everything below is called under it
+    [[nodiscard]] std::mutex &Lock(uint32_t addr) noexcept;
+
+    void Reserve(uint32_t hart, uint32_t addr) noexcept;
+    // Drops the reservation of the hart, returns true if it was the one of the word
+    bool Release(uint32_t hart, uint32_t addr) noexcept;
+    // Store of the hart breaks the reservations of the others, returns how many of them were broken
+    uint32_t Break(uint32_t hart, uint32_t addr) noexcept;
+    // Makes the hart the last one to access the word atomically, returns the previous one or the hart itself
+    uint32_t Acquire(uint32_t hart, uint32_t addr);
+
+private:
+    static constexpr const uint32_t none = 1;  // misaligned address is never reserved
+    static constexpr const size_t stripes = 64;
+
+    struct alignas(64) Stripe final {
+        std::mutex lock;
+        std::unordered_map<uint32_t, uint32_t> owners;  // word -> hart of the last atomic access
+    };
+
+    [[nodiscard]] static size_t StripeIdx(uint32_t addr) noexcept;
+
+    uint32_t harts_;
+    std::unique_ptr<std::atomic<uint32_t>[]> reserved_;  // reserved word of every hart
+    std::array<Stripe, stripes> stripes_;
+};
+
+/*
+ *  RV32A unit of the memory stage of one hart: lr.w, sc.w and amo*.w are performed at once on the shared memory
+ *  and freeze the pipeline for the configured latency. Plain stores go through the unit too, as they break the
+ *  reservations of the other harts. With one hart nothing is locked.
+ *
+ *  Contention is counted per word, so the report shows where guest synchronization limits scaling: failed
+ *  store conditionals, handoffs (atomic access to the word last accessed atomically by another hart, i.e. the
+ *  line has to migrate between cores) and reservations of the other harts broken by stores.
+ */
+class AtomicUnit final {
+public:
+    struct Contention final {
+        uint64_t accesses{0};  // atomics of the hart to the word
+        uint64_t sc_failures{0};
+        uint64_t handoffs{0};
+        uint64_t broken{0};
+
+        [[nodiscard]] uint64_t Conflicts() const noexcept {
+            return sc_failures + handoffs + broken;
+        }
+    };
+
+    explicit AtomicUnit(uint32_t latency = 0) : latency_(latency) {}
+
+    // Shares reservations with the other harts of the memory
+    void setReservations(std::shared_ptr<ReservationTable> reservations, uint32_t hart);
+
+    // Performs atomic at the address with rs2 value as operand, returns the value of rd
+    std::bitset<32> Execute(DMEM &dmem, const RISCVInstr &instr, uint32_t addr, std::bitset<32> rs2);
+    void Store(DMEM &dmem, std::bitset<32> WD, std::bitset<32> A, DMEM::Width w_type);
+
+    [[nodiscard]] uint32_t Latency() const noexcept;  // pipeline freeze of every atomic
+    [[nodiscard]] uint64_t LoadReserved() const noexcept;
+    [[nodiscard]] uint64_t StoreConditional() const noexcept;
+    [[nodiscard]] uint64_t StoreConditionalFailures() const noexcept;
+    [[nodiscard]] uint64_t AMOs() const noexcept;
+    [[nodiscard]] uint64_t Handoffs() const noexcept;
+    [[nodiscard]] uint64_t BrokenReservations() const noexcept;
+    [[nodiscard]] const std::unordered_map<uint32_t, Contention> &Words() const noexcept;
+
+    // Contention of the words summed over the units, the most contended first
+    [[nodiscard]] static std::vector<std::pair<uint32_t, Contention>> HotWords(
+            const std::vector<const AtomicUnit *> &units, size_t count);
+
+    void RegisterStats(StatsRegistry &stats) const;
+
+private:
+    [[nodiscard]] static uint32_t Apply(Opcode op, uint32_t old, uint32_t operand) noexcept;
+    void Break(uint32_t addr, uint32_t size);
+
+    uint32_t latency_;
+    std::shared_ptr<ReservationTable> reservations_{std::make_shared<ReservationTable>()};
+    uint32_t hart_{0};
+
+    uint64_t lr_{0};
+    uint64_t sc_{0};
+    uint64_t sc_failures_{0};
+    uint64_t amos_{0};
+    uint64_t handoffs_{0};
+    uint64_t broken_{0};
+    std::unordered_map<uint32_t, Contention> words_;
+};
+
+#endif // UNITS_ATOMIC_UNIT_H
@@ -10,9 +10,14 @@
 #include <variant>
 #include <numeric>
 #include <algorithm>
+#include <memory>
+#include <array>
+#include <atomic>
+#include <unordered_map>
 #include "instruction.h"
 
 class Simulator;
+class StatsRegistry;
 
 enum class PipelineState {
     OK,
@@ -24,9 +29,23 @@ enum class PipelineState {
 
 enum class Way { UP, DOWN };
 
+// Why an issue slot carries no instruction, the reason travels down the pipeline with the bubble
+enum class Bubble : uint8_t {
+    NONE,  // slot is used by instruction
+    FRONTEND,  // fetch had nothing for the slot, e.g. down way after predicted taken branch
+    REDIRECT,  // wrong path instruction squashed by redirect from execute stage
+    LOAD_USE,  // decode waits for a load result
+    DEPENDENCY,  // down instruction depends on the upper one of the pair
+    SERIALIZE,  // ecall, ebreak or csr access are issued alone and wait for retirement
+    DCACHE_MISS,  // pipeline is frozen by a load miss
+    ISSUE_WIDTH,  // down way isn't used by single issue configuration
+    ATOMIC,  // pipeline is frozen by atomic memory operation
+    COUNT
+};
+
 class Stage {
 public:
-    uint32_t cycle = 0;
+    uint64_t cycle = 0;
     virtual PipelineState Run(Simulator &cpu) = 0;
     virtual ~Stage() = default;
 };
@@ -36,8 +55,13 @@ public:
 template<std::size_t L, std::size_t R, std::size_t N>
 std::bitset<L - R + 1> sub_range(std::bitset<N> b) {
     static_assert(R >= 0 && R <= L && L <= N - 1, "invalid bitrange");
-    std::bitset<L - R + 1> sub_set{b.to_string().substr(N - L - 1, L - R + 1)};
-    return sub_set;
+    if constexpr (N <= 64) {
+        // Bitset of the range truncates the shifted word to its width
+        return std::bitset<L - R + 1>{(b >> R).to_ullong()};
+    } else {
+        std::bitset<L - R + 1> sub_set{b.to_string().substr(N - L - 1, L - R + 1)};
+        return sub_set;
+    }
 }
 
 // Collects one word from several bitsets
@@ -127,32 +151,60 @@ private:
 class IMEM final {
 public:
     IMEM() = default;
-    explicit IMEM(uint32_t instr_count) : imem_(std::vector<std::bitset<32>>(instr_count)) {}
-    explicit IMEM(std::vector<std::bitset<32>> &&imem) : imem_(std::move(imem)) {}
+    explicit IMEM(uint32_t instr_count) : storage_(instr_count) {}
+    explicit IMEM(std::vector<std::bitset<32>> &&imem) : storage_(imem.size()) {
+        std::transform(imem.begin(), imem.end(), storage_.begin(),
+                       [](std::bitset<32> instr) { return static_cast<uint32_t>(instr.to_ulong()); });
+    }
+    explicit IMEM(std::vector<uint32_t> &&words, const PC &base = PC{0}) : storage_(std::move(words)), base_(base) {}
+    // View of little-endian words owned by someone else (e.g. mapped file), nothing is copied
+    explicit IMEM(const uint32_t *words, uint32_t count, const PC &base, std::shared_ptr<const void> owner) :
+             view_(words), view_size_(count), base_(base), owner_(std::move(owner)) {}
 
     [[nodiscard]] bool isEndOfIMEM(const PC &pc) const noexcept {
-        return (pc.val() >= imem_.size());
+        return pc.val() < base_.val() || pc.val() - base_.val() >= size();
     }
 
     void pushBackInstr(std::bitset<32> instr) {
-        imem_.push_back(instr);
+        assert(view_ == nullptr);
+        storage_.push_back(instr.to_ulong());
+    }
+
+    void reserve(uint32_t instr_count) {
+        assert(view_ == nullptr);
+        storage_.reserve(instr_count);
     }
 
     void AssignInstrByPC(const PC &pc, std::bitset<32> instr) {
-        imem_[pc.val()] = instr;
+        assert(view_ == nullptr);
+        storage_[pc.val() - base_.val()] = instr.to_ulong();
     }
 
     [[nodiscard]] std::bitset<32> getInstr(const PC &pc) const noexcept {
-        return imem_.at(pc.val());
+        assert(!isEndOfIMEM(pc));
+        return std::bitset<32>{words()[pc.val() - base_.val()]};
+    }
+
+    // PC of the first instruction
+    [[nodiscard]] PC getBase() const noexcept {
+        return base_;
     }
 
-    [[nodiscard]] std::vector<std::bitset<32>> getRawImem() const noexcept {
-        return imem_;
+    [[nodiscard]] uint32_t size() const noexcept {
+        return view_ != nullptr ? view_size_ : storage_.size();
     }
 
 private:
+    [[nodiscard]] const uint32_t *words() const noexcept {
+        return view_ != nullptr ? view_ : storage_.data();
+    }
+
     // Instructions memory
-    std::vector<std::bitset<32>> imem_;
+    std::vector<uint32_t> storage_;
+    const uint32_t *view_{nullptr};
+    uint32_t view_size_{0};
+    PC base_{0};
+    std::shared_ptr<const void> owner_;
 };
 
 /*======== Decode units ===========*/
@@ -268,12 +320,13 @@ public:
                 return lhs | rhs;
             case Op::AND:
                 return lhs & rhs;
+            // Only the low 5 bits are the shift amount, srai also keeps its funct7 in the immediate
             case Op::SLL:
-                return lhs << rhs.to_ulong();
+                return lhs << (rhs.to_ulong() & 0x1f);
             case Op::SRL:
-                return lhs >> rhs.to_ulong();
+                return lhs >> (rhs.to_ulong() & 0x1f);
             case Op::SRA:
-                return static_cast<int32_t>(lhs.to_ulong()) >> rhs.to_ulong();
+                return static_cast<int32_t>(lhs.to_ulong()) >> (rhs.to_ulong() & 0x1f);
             case Op::SLT:
                 return (static_cast<int32_t>(lhs.to_ulong()) < static_cast<int32_t>(rhs.to_ulong())) ? 1 : 0;
             case Op::SLTU:
@@ -322,8 +375,10 @@ public:
 class WE_GEN final {
 public:
     WE_GEN() = default;
-    explicit WE_GEN(bool mem_we, bool wb_we, bool ebreak, bool v_ex) :
-             mem_we_(mem_we && v_ex), wb_we_(wb_we && v_ex), ebreak_(ebreak && v_ex) {}
+    explicit WE_GEN(bool mem_we, bool wb_we, bool ebreak, bool ecall, bool csr, bool v_ex,
+                    Bubble bubble = Bubble::NONE) :
+             mem_we_(mem_we && v_ex), wb_we_(wb_we && v_ex), ebreak_(ebreak && v_ex), ecall_(ecall && v_ex),
+             csr_(csr && v_ex), valid_(v_ex), bubble_(v_ex ? Bubble::NONE : bubble) {}
 
     [[nodiscard]] bool MEM_WE() const noexcept {
         return mem_we_;
@@ -337,14 +392,36 @@ public:
         return ebreak_;
     }
 
-    void Invalidate() noexcept {
-        mem_we_ = wb_we_ = ebreak_ = false;
+    [[nodiscard]] bool ECALL() const noexcept {
+        return ecall_;
+    }
+
+    [[nodiscard]] bool CSR() const noexcept {
+        return csr_;
+    }
+
+    // Instruction is on the right path and retires at write back
+    [[nodiscard]] bool isValid() const noexcept {
+        return valid_;
+    }
+
+    [[nodiscard]] Bubble getBubble() const noexcept {
+        return bubble_;
+    }
+
+    void Invalidate(Bubble bubble) noexcept {
+        mem_we_ = wb_we_ = ebreak_ = ecall_ = csr_ = valid_ = false;
+        bubble_ = bubble;
     }
 
 private:
     bool mem_we_{false};
     bool wb_we_{false};
     bool ebreak_{false};
+    bool ecall_{false};
+    bool csr_{false};
+    bool valid_{false};
+    Bubble bubble_{Bubble::FRONTEND};
 };
 
 /*======== Memory units ===========*/
@@ -358,53 +435,156 @@ public:
         HALF_U,
         WORD
     };
-    // Data Memory consists of 2^30 word
+    static constexpr const uint32_t page_size = 4096;
+
+    /*
+     *  Byte addressable little-endian memory of 2^32 bytes, pages are allocated on the first write. The memory can
+     *  be shared by the harts running on different host threads: the two-level page table is lock-free (a page is
+     *  published by compare-and-swap, the loser of the race frees its copy) and bytes are accessed atomically, so
+     *  guest data races are not host ones.
+     */
     DMEM() = default;
+    DMEM(DMEM &&) = default;
+    DMEM &operator=(DMEM &&) = default;
 
     void Store(std::bitset<32> WD, std::bitset<32> A, Width w_type = Width::WORD) {
-        uint32_t idx = A.to_ulong();
+        uint32_t data = WD.to_ulong();
         switch (w_type) {
             case Width::BYTE:
             case Width::BYTE_U:
-                dmem_[idx] = concat<32>(std::bitset<24>{}, sub_range<7, 0>(WD));
+                Write(A.to_ulong(), data, 1);
                 break;
             case Width::HALF:
             case Width::HALF_U:
-                dmem_[idx] = concat<32>(std::bitset<16>{}, sub_range<15, 0>(WD));
+                Write(A.to_ulong(), data, 2);
                 break;
             case Width::WORD:
-                dmem_[idx] = WD;
+                Write(A.to_ulong(), data, 4);
                 break;
         }
     }
 
-    std::bitset<32> Load(std::bitset<32> A, Width w_type = Width::WORD) {
-        size_t idx = A.to_ulong();
+    [[nodiscard]] std::bitset<32> Load(std::bitset<32> A, Width w_type = Width::WORD) const {
+        uint32_t addr = A.to_ulong();
         switch (w_type) {
-            case Width::BYTE: {
-                auto byte = sub_range<7, 0>(dmem_[idx]);
-                return concat<32>(SignExt<24>(SignBit(byte)), byte);
+            case Width::BYTE:
+                return static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(Read(addr, 1))));
+            case Width::BYTE_U:
+                return Read(addr, 1);
+            case Width::HALF:
+                return static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(Read(addr, 2))));
+            case Width::HALF_U:
+                return Read(addr, 2);
+            case Width::WORD:
+                return Read(addr, 4);
+        }
+        return {};
+    }
+
+    // Backs [addr, addr + size) with host buffer. Whole pages are used in place without copying,
+    // so the buffer must outlive the memory. Partially covered pages are copied.
+    void Map(uint32_t addr, uint8_t *data, uint32_t size) {
+        while (size > 0) {
+            uint32_t offset = addr % page_size;
+            uint32_t chunk = std::min(size, page_size - offset);
+            if (offset == 0 && chunk == page_size && FindPage(addr) == nullptr) {
+                Slot(addr).store(data, std::memory_order_release);
+            } else {
+                std::copy(data, data + chunk, Page(addr) + offset);
             }
-            case Width::BYTE_U: {
-                auto byte = sub_range<7, 0>(dmem_[idx]);
-                return concat<32>(std::bitset<24>{0}, byte);
+            addr += chunk;
+            data += chunk;
+            size -= chunk;
+        }
+    }
+
+    void WriteBytes(uint32_t addr, const uint8_t *data, uint32_t size) {
+        for (uint32_t i = 0; i < size; ++i) {
+            Store(Page(addr + i) + (addr + i) % page_size, data[i]);
+        }
+    }
+
+    void ReadBytes(uint32_t addr, uint8_t *data, uint32_t size) const {
+        for (uint32_t i = 0; i < size; ++i) {
+            const uint8_t *page = FindPage(addr + i);
+            data[i] = page != nullptr ? Load(page + (addr + i) % page_size) : 0;
+        }
+    }
+
+private:
+    static constexpr const uint32_t leaf_size = 1024;  // pages covered by one leaf of the page table
+    static constexpr const uint32_t root_size = (uint64_t{1} << 32) / page_size / leaf_size;
+
+    struct Leaf final {
+        std::array<std::atomic<uint8_t *>, leaf_size> pages{};
+        std::array<std::unique_ptr<uint8_t[]>, leaf_size> owned;  // written only by the thread that published page
+    };
+
+    struct Root final {
+        ~Root() {
+            for (auto &leaf : leaves) {
+                delete leaf.load(std::memory_order_relaxed);
             }
-            case Width::HALF: {
-                auto half_word = sub_range<15, 0>(dmem_[idx]);
-                return concat<32>(SignExt<16>(SignBit(half_word)), half_word);
+        }
+        std::array<std::atomic<Leaf *>, root_size> leaves{};
+    };
+
+    static void Store(uint8_t *byte, uint8_t value) {
+        std::atomic_ref<uint8_t>{*byte}.store(value, std::memory_order_relaxed);
+    }
+
+    static uint8_t Load(const uint8_t *byte) {
+        return std::atomic_ref<uint8_t>{*const_cast<uint8_t *>(byte)}.load(std::memory_order_relaxed);
+    }
+
+    void Write(uint32_t addr, uint32_t data, uint32_t bytes) {
+        for (uint32_t i = 0; i < bytes; ++i, data >>= 8) {
+            Store(Page(addr + i) + (addr + i) % page_size, static_cast<uint8_t>(data));
+        }
+    }
+
+    [[nodiscard]] uint32_t Read(uint32_t addr, uint32_t bytes) const {
+        uint32_t data = 0;
+        for (uint32_t i = bytes; i > 0; --i) {
+            const uint8_t *page = FindPage(addr + i - 1);
+            data = (data << 8) | (page != nullptr ? Load(page + (addr + i - 1) % page_size) : 0);
+        }
+        return data;
+    }
+
+    [[nodiscard]] const uint8_t *FindPage(uint32_t addr) const {
+        Leaf *leaf = root_->leaves[addr / page_size / leaf_size].load(std::memory_order_acquire);
+        return leaf == nullptr ? nullptr : leaf->pages[addr / page_size % leaf_size].load(std::memory_order_acquire);
+    }
+
+    std::atomic<uint8_t *> &Slot(uint32_t addr) {
+        std::atomic<Leaf *> &root_slot = root_->leaves[addr / page_size / leaf_size];
+        Leaf *leaf = root_slot.load(std::memory_order_acquire);
+        if (leaf == nullptr) {
+            auto fresh = std::make_unique<Leaf>();
+            if (root_slot.compare_exchange_strong(leaf, fresh.get(), std::memory_order_acq_rel)) {
+                leaf = fresh.release();
             }
-            case Width::HALF_U: {
-                auto half_word = sub_range<15, 0>(dmem_[idx]);
-                return concat<32>(std::bitset<16>{0}, half_word);
+        }
+        return leaf->pages[addr / page_size % leaf_size];
+    }
+
+    uint8_t *Page(uint32_t addr) {
+        std::atomic<uint8_t *> &slot = Slot(addr);
+        uint8_t *page = slot.load(std::memory_order_acquire);
+        if (page == nullptr) {
+            auto fresh = std::make_unique<uint8_t[]>(page_size);
+            if (slot.compare_exchange_strong(page, fresh.get(), std::memory_order_acq_rel)) {
+                page = fresh.get();
+                Leaf *leaf = root_->leaves[addr / page_size / leaf_size].load(std::memory_order_relaxed);
+                leaf->owned[addr / page_size % leaf_size] = std::move(fresh);
             }
-            case Width::WORD:
-                return dmem_[idx];
         }
-        return {};
+        return page;
     }
 
-private:
-    std::map<uint32_t, std::bitset<32>> dmem_;
+    // Page table, leaves and pages are either owned or mapped
+    std::unique_ptr<Root> root_{std::make_unique<Root>()};
 };
 
 #endif //SIMULATOR_STAGE_H
@@ -2,12 +2,28 @@
 #define UNITS_BRANCH_PREDICTION_H
 
 #include "Basics.h"
+#include <array>
 #include <map>
 #include <utility>
+#include <variant>
 
 class BranchPredictor final {
 public:
-    explicit BranchPredictor() = default;
+    enum class Type : uint8_t {
+        NOT_TAKEN,  // static, every branch is predicted not taken, no state
+        TWO_BIT  // two-bit counters in 2-way BHT and BTB indexed by key_size bits of pc
+    };
+
+    struct Config final {
+        Type type{Type::TWO_BIT};
+        uint8_t key_size{10};
+    };
+
+    // Table sizes compiled in, the tables of every size are instantiated once in BranchPredictor.cpp
+    static constexpr const std::array<uint8_t, 7> key_sizes{4, 6, 8, 10, 12, 14, 16};
+
+    explicit BranchPredictor() : BranchPredictor(Config{}) {}
+    explicit BranchPredictor(const Config &config);
 
     void setPrediction(const PC &cur_pc, const PC &pc_disp, bool comp);
 
@@ -15,45 +31,87 @@ public:
 
     [[nodiscard]] PC getTarget(bool pred, const PC &cur_pc) const noexcept;
 
+    [[nodiscard]] const Config &getConfig() const noexcept;
+    // Updates that changed the tables, predictions are the same as long as it doesn't grow
+    [[nodiscard]] uint64_t Changes() const noexcept;
+
+    void RegisterStats(StatsRegistry &stats) const;
+
+    [[nodiscard]] static bool isSupported(const Config &config) noexcept;
+    // Bits of BHT and BTB of both ways
+    [[nodiscard]] static uint64_t StorageBits(const Config &config) noexcept;
+    [[nodiscard]] static const char *Name(Type type) noexcept;
+
 private:
-    /*
-     *  RV32I instruction hashing:
-     *  |<--------------------- 30 - key_size ------------------------->|<------ key_size ------>|<-- 2 -->|
-     *  [                           tag                                 |           key          |   0b11  ]
-     */
-    static constexpr const uint8_t key_size = 10;  // pc = tag + key_size + 2 bits (that are the same in RV32I)
-    /*
-     *  BHT bucket bits ordering:
-     *  |<-- 1 -->|<------- 2 -------->|<--------------------- 30 - key_size ----------------------------->|
-     *  [bit_valid|    prediction      |                           tag                                     ]
-     */
-    static constexpr const uint8_t bht_bucket_size = 33 - key_size;  // = 1 bit validation + 2 bits prediction + tag
-    /*
-     *  BTB bucket bits ordering:
-     *  |<------------------------ 32 ------------------------>|<------------- 30 - key_size ------------->|
-     *  [                       target pc                      |                   tag                     ]
-     */
-    static constexpr const uint8_t btb_bucket_size = 62 - key_size;  // = target pc + tag
-
-    /* Two-bit dynamic branch predictor:
-     *    STRONGLY_NOT_TAKEN = 00,
-     *    WEAKLY_NOT_TAKEN = 01,
-     *    WEAKLY_TAKEN = 10,
-     *    STRONGLY_TAKEN = 11
-     */
-    static std::bitset<2> calcPrediction(std::bitset<bht_bucket_size> bht_bucket, bool comp);
-
-    void updatePrediction(std::bitset<bht_bucket_size> &bht_bucket, bool comp);
-
-    void setupBucket(std::bitset<bht_bucket_size> &bht_bucket, std::bitset<btb_bucket_size> &btb_bucket,
-                     uint32_t key, bool comp, std::bitset<32> target, std::bitset<30 - key_size> tag);
-
-    void swapBuckets(uint32_t key);
-
-    // Branch history table with 2-way associative cache
-    std::map<uint32_t, std::pair<std::bitset<bht_bucket_size>, std::bitset<bht_bucket_size>>> bht_;
-    // Branch target buffer with 2-way associative cache
-    std::map<uint32_t, std::pair<std::bitset<btb_bucket_size>, std::bitset<btb_bucket_size>>> btb_;
+    enum class Update : uint8_t {
+        HIT,
+        UNCHANGED,  // hit that left the counter as it was
+        ALLOCATION,  // first time seen branch
+        REPLACEMENT  // branch evicted another one from the set
+    };
+
+    template<uint8_t key_size>
+    class Table final {
+    public:
+        Update setPrediction(const PC &cur_pc, const PC &pc_disp, bool comp);
+
+        [[nodiscard]] bool getPrediction(const PC &cur_pc) const noexcept;
+
+        [[nodiscard]] PC getTarget(const PC &cur_pc) const noexcept;
+
+        /*
+         *  RV32I instruction hashing:
+         *  |<--------------------- 30 - key_size ------------------------->|<------ key_size ------>|<-- 2 -->|
+         *  [                           tag                                 |           key          |   0b11  ]
+         */
+        /*
+         *  BHT bucket bits ordering:
+         *  |<-- 1 -->|<------- 2 -------->|<--------------------- 30 - key_size ----------------------------->|
+         *  [bit_valid|    prediction      |                           tag                                     ]
+         */
+        static constexpr const uint8_t bht_bucket_size = 33 - key_size;  // = 1 bit validation + 2 bits prediction + tag
+        /*
+         *  BTB bucket bits ordering:
+         *  |<------------------------ 32 ------------------------>|<------------- 30 - key_size ------------->|
+         *  [                       target pc                      |                   tag                     ]
+         */
+        static constexpr const uint8_t btb_bucket_size = 62 - key_size;  // = target pc + tag
+
+    private:
+        /* Two-bit dynamic branch predictor:
+         *    STRONGLY_NOT_TAKEN = 00,
+         *    WEAKLY_NOT_TAKEN = 01,
+         *    WEAKLY_TAKEN = 10,
+         *    STRONGLY_TAKEN = 11
+         */
+        static std::bitset<2> calcPrediction(std::bitset<bht_bucket_size> bht_bucket, bool comp);
+
+        // Returns false if the counter is saturated in the direction
+        bool updatePrediction(std::bitset<bht_bucket_size> &bht_bucket, bool comp);
+
+        void setupBucket(std::bitset<bht_bucket_size> &bht_bucket, std::bitset<btb_bucket_size> &btb_bucket,
+                         bool comp, std::bitset<32> target, std::bitset<30 - key_size> tag);
+
+        void swapBuckets(uint32_t key);
+
+        // Branch history table with 2-way associative cache
+        std::map<uint32_t, std::pair<std::bitset<bht_bucket_size>, std::bitset<bht_bucket_size>>> bht_;
+        // Branch target buffer with 2-way associative cache
+        std::map<uint32_t, std::pair<std::bitset<btb_bucket_size>, std::bitset<btb_bucket_size>>> btb_;
+    };
+
+    // std::monostate is the static predictor
+    using Tables = std::variant<std::monostate, Table<4>, Table<6>, Table<8>, Table<10>, Table<12>, Table<14>,
+                                Table<16>>;
+
+    Config config_;
+    Tables tables_;
+
+    uint64_t updates_{0};  // resolved branches and jumps
+    uint64_t taken_{0};
+    uint64_t allocations_{0};  // first time seen branches
+    uint64_t replacements_{0};  // branches that evicted another one from the set
+    uint64_t changes_{0};
 };
 
 #endif // UNITS_BRANCH_PREDICTION_H
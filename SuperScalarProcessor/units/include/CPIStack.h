@@ -0,0 +1,32 @@
+#ifndef UNITS_CPI_STACK_H
+#define UNITS_CPI_STACK_H
+
+#include <array>
+
+#include "Basics.h"
+
+/*
+ *  Top-down accounting of issue slots. Every cycle write back accounts both ways: slot with retired instruction
+ *  is the base, empty one is charged to the reason of its bubble. Cycles of frozen pipeline are charged as a whole.
+ *  So the slots always sum up to issue_width * total cycles and the stack is exact.
+ */
+class CPIStack final {
+public:
+    static constexpr const uint32_t issue_width = 2;
+
+    void Account(Bubble bubble, uint64_t slots = 1) noexcept {
+        slots_[static_cast<uint8_t>(bubble)] += slots;
+    }
+
+    [[nodiscard]] uint64_t Slots(Bubble bubble) const noexcept;
+    [[nodiscard]] uint64_t TotalSlots() const noexcept;
+    [[nodiscard]] static const char *Name(Bubble bubble) noexcept;
+
+    // Prints CPI of each component, they sum up to the total CPI
+    void Print(std::ostream &out) const;
+
+private:
+    std::array<uint64_t, static_cast<uint8_t>(Bubble::COUNT)> slots_{};
+};
+
+#endif // UNITS_CPI_STACK_H
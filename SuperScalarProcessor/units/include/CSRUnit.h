@@ -0,0 +1,65 @@
+#ifndef UNITS_CSR_UNIT_H
+#define UNITS_CSR_UNIT_H
+
+#include <array>
+#include <optional>
+
+#include "Basics.h"
+
+/*
+ *  Control and status registers of Zicsr available to user programs: cycle, time and instret counters and
+ *  hpmcounters that count microarchitectural events. Counters are read-only, the access is performed at write back,
+ *  when all older instructions are retired. Time ticks once per cycle. mhartid is the index of the hart in
+ *  multi-hart simulation.
+ */
+class CSRUnit final {
+public:
+    enum Address : uint16_t {
+        CYCLE = 0xc00,
+        TIME = 0xc01,
+        INSTRET = 0xc02,
+        HPMCOUNTER3 = 0xc03,
+        HPMCOUNTER31 = 0xc1f,
+        CYCLEH = 0xc80,
+        TIMEH = 0xc81,
+        INSTRETH = 0xc82,
+        HPMCOUNTER3H = 0xc83,
+        HPMCOUNTER31H = 0xc9f,
+        MHARTID = 0xf14
+    };
+
+    // Events counted by hpmcounter3 and the following ones, in the same order
+    enum class Event : uint8_t {
+        MISPREDICT,  // fetch redirected from execute stage
+        LOAD_USE_STALL,  // cycles decode waits for a load result
+        SPLIT_ISSUE,  // down instruction of the pair is issued in the next cycle
+        DCACHE_MISS,
+        SERIALIZE_STALL,  // cycles decode waits for ecall or csr access to retire
+        COUNT
+    };
+
+    // Executes csr instruction, returns ERR on access to unknown csr or write to read-only one
+    PipelineState Run(Simulator &cpu, const RISCVInstr &instr);
+
+    void Count(Event event, uint64_t times = 1) noexcept {
+        events_[static_cast<uint8_t>(event)] += times;
+    }
+    void setHartId(uint32_t hart_id) noexcept {
+        hart_id_ = hart_id;
+    }
+    void Retire(uint64_t instructions) noexcept {
+        instret_ += instructions;
+    }
+
+    // Value of 32 bit csr, cycle is the current value of the cycle counter
+    [[nodiscard]] std::optional<uint32_t> Read(uint16_t addr, uint64_t cycle) const noexcept;
+    [[nodiscard]] const uint64_t &Instret() const noexcept;
+    [[nodiscard]] uint64_t Events(Event event) const noexcept;
+
+private:
+    uint64_t instret_{0};
+    uint32_t hart_id_{0};
+    std::array<uint64_t, static_cast<uint8_t>(Event::COUNT)> events_{};
+};
+
+#endif // UNITS_CSR_UNIT_H
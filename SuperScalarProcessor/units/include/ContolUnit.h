@@ -19,6 +19,9 @@ public:
         bool JMP{false};
         bool JALR{false};
         bool EBREAK{false};
+        bool ECALL{false};
+        bool CSR{false};  // Zicsr access, performed at write back
+        bool ATOMIC{false};  // RV32A read-modify-write, performed at memory stage
     } flags;
 
     void setState(const RISCVInstr &instr);
@@ -28,6 +31,7 @@ private:
     void SelectALUOp(const RISCVInstr &instr);
     void SelectCMPOp(const RISCVInstr &instr);
     void SelectLoadFlags(const RISCVInstr &instr);
+    void SelectStoreFlags(const RISCVInstr &instr);
 };
 
 #endif //SIMULATOR_CONTOLUNIT_H
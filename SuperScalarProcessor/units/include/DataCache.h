@@ -0,0 +1,90 @@
+#ifndef UNITS_DATA_CACHE_H
+#define UNITS_DATA_CACHE_H
+
+#include <memory>
+
+#include "Basics.h"
+
+class L2Cache;
+
+// Tag-only model of a set-associative data cache with LRU replacement.
+// Data itself always lives in DMEM, the cache only decides how long an access takes.
+// Behind it may be L2 shared with the caches of the other harts, which also keeps them coherent, see L2Cache.
+class DataCache final {
+public:
+    struct Config final {
+        uint32_t sets{64};
+        uint32_t ways{2};
+        uint32_t line_size{32};  // bytes
+        uint32_t miss_latency{0};  // extra cycles of blocking load miss, 0 = ideal memory
+        uint32_t mshrs{8};  // misses in flight at once: the blocking one and prefetches
+    };
+
+    explicit DataCache() : DataCache(Config{}) {}
+    explicit DataCache(const Config &config);
+
+    // The cache becomes the private one of the hart in front of L2
+    void setL2(std::shared_ptr<L2Cache> l2, uint32_t hart);
+    [[nodiscard]] const L2Cache *getL2() const noexcept;
+
+    // Demand access at cycle `now`: updates LRU and allocates line on miss, returns true on hit.
+    // Load of prefetched line which is still being filled misses for the rest of its fill
+    bool Access(uint32_t addr, bool is_store = false, uint64_t now = 0) noexcept;
+    // Lookup without any side effects
+    [[nodiscard]] bool Probe(uint32_t addr) const noexcept;
+    // Same, but the line must also be filled by the cycle
+    [[nodiscard]] bool Ready(uint32_t addr, uint64_t now) const noexcept;
+    // Starts fill of the line at cycle `now`, it completes after latency of the miss. Returns false if line is
+    // already present or all MSHRs are busy
+    bool Prefetch(uint32_t addr, uint64_t now) noexcept;
+
+    [[nodiscard]] const Config &getConfig() const noexcept;
+    [[nodiscard]] uint32_t MissLatency() const noexcept;  // of the last miss
+    [[nodiscard]] uint64_t Hits() const noexcept;
+    [[nodiscard]] uint64_t Misses() const noexcept;
+    [[nodiscard]] uint64_t Prefetches() const noexcept;
+    [[nodiscard]] uint64_t UsefulPrefetches() const noexcept;  // prefetched lines filled before demand access
+    [[nodiscard]] uint64_t LatePrefetches() const noexcept;  // demand load waited for the rest of the fill
+    [[nodiscard]] uint64_t CoherenceMisses() const noexcept;
+    [[nodiscard]] uint64_t FalseSharingMisses() const noexcept;
+    [[nodiscard]] uint64_t Invalidations() const noexcept;  // copies of the other harts invalidated by writes
+
+    void RegisterStats(StatsRegistry &stats) const;
+
+private:
+    struct Line final {
+        uint32_t tag{0};
+        uint64_t lru{0};
+        uint64_t ready{0};  // cycle the fill completes
+        bool valid{false};
+        bool prefetched{false};
+    };
+
+    [[nodiscard]] uint32_t SetIdx(uint32_t addr) const noexcept;
+    [[nodiscard]] uint32_t Tag(uint32_t addr) const noexcept;
+    [[nodiscard]] const Line *Find(uint32_t addr) const noexcept;
+    Line &Victim(uint32_t addr) noexcept;
+    // Victim line for the address, L2 is told about the replaced one
+    Line &Allocate(uint32_t addr) noexcept;
+    // Retires fills completed by the cycle, returns true if an MSHR is free for another one
+    bool FreeMSHR(uint64_t now);
+
+    Config config_;
+    std::vector<Line> lines_;  // sets * ways, ways of one set are adjacent
+    uint64_t stamp_{0};
+    std::shared_ptr<L2Cache> l2_;
+    uint32_t hart_{0};
+    uint32_t miss_latency_;
+    std::vector<uint64_t> fills_;  // completion cycles of misses in flight
+
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    uint64_t prefetches_{0};
+    uint64_t useful_prefetches_{0};
+    uint64_t late_prefetches_{0};
+    uint64_t coherence_misses_{0};
+    uint64_t false_sharing_{0};
+    uint64_t invalidations_{0};
+};
+
+#endif // UNITS_DATA_CACHE_H
@@ -17,9 +17,14 @@ public:
         BP_WB_Down
     };
 
+    explicit HazardUnit() = default;
+    // Single issue splits every pair in decode, so the down way is never used
+    explicit HazardUnit(const BranchPredictor::Config &bp, uint32_t issue_width);
+
     bool CheckForStall(Simulator &cpu) noexcept;
-    void CheckWaysDataDepends(std::bitset<5> rd_up, bool wb_we,
-                              std::bitset<5> A4, std::bitset<5> A5, bool is_ebreak) noexcept;  // For decode stage
+    // For decode stage, serializing instructions (ebreak, ecall, csr access) are always issued alone
+    void CheckWaysDataDepends(std::bitset<5> rd_up, bool wb_we, std::bitset<5> A4, std::bitset<5> A5,
+                              bool is_down_invalid, bool is_serializing = false, bool is_up_valid = true) noexcept;
 
     [[nodiscard]] HU_RS HU_RS1() noexcept;
     [[nodiscard]] HU_RS HU_RS2() noexcept;
@@ -32,6 +37,10 @@ public:
     [[nodiscard]] bool PC_EN() const noexcept;
     [[nodiscard]] bool getPredicton(const PC &pc) const noexcept;
     [[nodiscard]] PC getTarget(bool pred, const PC &pc) const noexcept;
+    [[nodiscard]] Bubble StallCause() const noexcept;  // reason of the last STALL
+    [[nodiscard]] Bubble SplitCause() const noexcept;  // reason of the last STALL_DOWN
+    [[nodiscard]] uint32_t IssueWidth() const noexcept;
+    [[nodiscard]] const BranchPredictor &getBranchPredictor() const noexcept;
 
     void setBP_MEM(std::bitset<32> wb_d, Way way);
     void setBP_WB(std::bitset<32> wb_d, Way way);
@@ -43,6 +52,10 @@ public:
     void setBranchPrediction(const PC &cur_pc, const PC &pc_disp, bool comp);
     void sendEndOfIMEM();
 
+    void RegisterStats(StatsRegistry &stats) const;
+    // Appends the state that decides the timing of the next cycles, the predictor is represented by its changes
+    void SaveTiming(std::vector<uint64_t> &state) const;
+
     PipelineState pl_state{PipelineState::OK};
     PipelineState exception_state{PipelineState::OK};
 private:
@@ -54,6 +67,9 @@ private:
     //  isStall
     bool pc_en_{true};
     bool fd_en_{true};
+    Bubble stall_cause_{Bubble::NONE};
+    Bubble split_cause_{Bubble::NONE};
+    uint32_t issue_width_{2};
     // Prediction
     // Target
     /*===============*/
@@ -95,6 +111,13 @@ private:
     /*==== Units ====*/
     BranchPredictor branchPredictor_;
     /*===============*/
+
+    uint64_t load_use_stalls_{0};
+    uint64_t serialize_stalls_{0};  // cycles decode waits for ecall or csr access to retire
+    uint64_t dependency_splits_{0};  // pairs split because down instruction depends on the upper one
+    uint64_t serialize_splits_{0};
+    uint64_t width_splits_{0};  // pairs split because of single issue
+    uint64_t redirects_{0};
 };
 
 #endif //SIMULATOR_HAZARDUNIT_H
@@ -0,0 +1,53 @@
+#ifndef UNITS_INSTR_MIX_H
+#define UNITS_INSTR_MIX_H
+
+#include <array>
+
+#include "Basics.h"
+
+/*
+ *  Dynamic instruction mix and utilization of the two issue ways. The output observer of the simulator reports how
+ *  many valid instructions leave execute every cycle and, when only the upper one does, why the down slot is empty,
+ *  and every retired instruction, which is counted by opcode and by base format. Nothing is counted unless enabled.
+ */
+class InstrMix final {
+public:
+    static constexpr const size_t opcodes = static_cast<size_t>(Opcode::AMOMAXU_W) + 1;  // amomaxu.w is the last one
+    static constexpr const size_t formats = static_cast<size_t>(RISCVInstr::Format::J) + 1;
+    static constexpr const size_t issue_width = 2;
+
+    void Enable() noexcept;
+    [[nodiscard]] bool isEnabled() const noexcept;
+
+    void Issue(const WE_GEN &up, const WE_GEN &down) noexcept {
+        ++issued_[static_cast<size_t>(up.isValid()) + static_cast<size_t>(down.isValid())];
+        if (up.isValid() && !down.isValid()) {
+            ++down_empty_[static_cast<uint8_t>(down.getBubble())];
+        }
+    }
+
+    void Retire(const RISCVInstr &instr) noexcept {
+        ++by_opcode_[static_cast<size_t>(instr.getOpcode())];
+        ++by_format_[static_cast<size_t>(instr.getFormat())];
+    }
+
+    [[nodiscard]] uint64_t Retired(Opcode opcode) const noexcept;
+    [[nodiscard]] uint64_t Retired(RISCVInstr::Format format) const noexcept;
+    [[nodiscard]] uint64_t Retired() const noexcept;
+    // Cycles execute passed given number of valid instructions to memory stage
+    [[nodiscard]] uint64_t IssueCycles(size_t valid) const noexcept;
+    // Cycles with valid upper instruction and empty down slot for the given reason
+    [[nodiscard]] uint64_t DownEmpty(Bubble bubble) const noexcept;
+    [[nodiscard]] static const char *Name(RISCVInstr::Format format) noexcept;
+
+    void Print(std::ostream &out) const;
+
+private:
+    std::array<uint64_t, opcodes> by_opcode_{};
+    std::array<uint64_t, formats> by_format_{};
+    std::array<uint64_t, issue_width + 1> issued_{};
+    std::array<uint64_t, static_cast<uint8_t>(Bubble::COUNT)> down_empty_{};
+    bool enabled_{false};
+};
+
+#endif // UNITS_INSTR_MIX_H
@@ -0,0 +1,111 @@
+#ifndef UNITS_L2_CACHE_H
+#define UNITS_L2_CACHE_H
+
+#include <array>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "DataCache.h"
+
+/*
+ *  Shared L2 with the MESI directory of the private data caches of the harts. Every access of a private cache is
+ *  checked against the directory: the line is valid in the private cache only while the directory lists the hart
+ *  as its sharer, so a write invalidates the copies of the other harts without touching their caches, which belong
+ *  to other host threads. The only sharer holds the line Exclusive, or Modified after a write, two and more hold it
+ *  Shared. A read of the line Modified elsewhere writes it back and leaves both copies Shared.
+ *
+ *  Miss of a private cache is served by the private cache holding the line Modified or by L2 in the L2 latency,
+ *  L2 miss goes to memory in the miss latency of the private cache. Without L2 sets only the directory is kept and
+ *  every private miss goes to memory.
+ *
+ *  Miss on the line the hart has lost to a write of another hart is a coherence miss. It is a false sharing miss
+ *  if the words written by the others since then don't include the accessed one: the harts share the line but not
+ *  the data, padding would remove the miss. Invalidations and coherence misses are counted per line, so the hot
+ *  lines show which data layout to fix.
+ */
+class L2Cache final {
+public:
+    struct Config final {
+        uint32_t sets{0};  // 0 = no L2, only the directory
+        uint32_t ways{8};
+        uint32_t latency{0};  // cycles of private miss served by L2 or by another private cache
+    };
+
+    // Result of one access of a private cache
+    struct Outcome final {
+        bool hit{false};
+        bool coherence_miss{false};
+        bool false_sharing{false};
+        uint32_t invalidations{0};  // copies of the other harts invalidated by the access
+        uint32_t latency{0};  // cycles of the miss
+    };
+
+    struct LineStats final {
+        uint64_t invalidations{0};
+        uint64_t coherence_misses{0};
+        uint64_t false_sharing{0};  // coherence misses on words no other hart has written
+        uint64_t writers{0};  // mask of harts that have written the line
+    };
+
+    static constexpr const uint32_t max_harts = 64;
+
+    explicit L2Cache(const Config &config, const DataCache::Config &private_config, uint32_t harts = 1);
+
+    // Access of the hart, present is true if its private cache has the tag of the line
+    Outcome Access(uint32_t hart, uint32_t addr, bool is_store, bool present);
+    // Private cache of the hart replaces the line
+    void Evict(uint32_t hart, uint32_t addr);
+
+    [[nodiscard]] const Config &getConfig() const noexcept;
+    [[nodiscard]] uint32_t Harts() const noexcept;
+    [[nodiscard]] uint64_t Hits() const noexcept;
+    [[nodiscard]] uint64_t Misses() const noexcept;
+    [[nodiscard]] uint64_t Transfers() const noexcept;  // private misses served by another private cache
+    [[nodiscard]] uint64_t Writebacks() const noexcept;  // Modified lines written back to L2
+    [[nodiscard]] LineStats Total() const;
+    // Lines with the most coherence misses and invalidations first
+    [[nodiscard]] std::vector<std::pair<uint32_t, LineStats>> HotLines(size_t count) const;
+
+    void RegisterStats(StatsRegistry &stats) const;
+
+private:
+    static constexpr const size_t stripes = 64;
+
+    struct Entry final {
+        uint64_t sharers{0};  // harts with a valid copy
+        uint64_t lost{0};  // harts whose copy was invalidated by a write of another hart
+        bool exclusive{false};  // the only sharer holds the line Exclusive or Modified
+        bool dirty{false};  // ... Modified
+        std::vector<uint64_t> remote_writes;  // per hart: words written by the others since it lost the line
+        LineStats stats;
+    };
+
+    struct alignas(64) Stripe final {
+        mutable std::mutex lock;
+        std::unordered_map<uint32_t, Entry> lines;
+    };
+
+    [[nodiscard]] Stripe &StripeOf(uint32_t line) noexcept;
+    // Invalidates the copies of the other harts, returns how many of them were invalidated
+    uint32_t Invalidate(Entry &entry, uint32_t hart);
+    // Word written by the hart is remote to the harts which have lost the line
+    static void Write(Entry &entry, uint32_t hart, uint64_t word) noexcept;
+    // Private miss of the line, called under the L2 lock
+    uint32_t Fill(uint32_t line, bool transfer);
+
+    Config config_;
+    uint32_t line_size_;
+    uint32_t memory_latency_;
+    uint32_t harts_;
+    std::array<Stripe, stripes> stripes_;
+
+    std::mutex lock_;  // of the tags and the counters below, taken after the lock of the stripe
+    std::optional<DataCache> tags_;
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    uint64_t transfers_{0};
+    uint64_t writebacks_{0};
+};
+
+#endif // UNITS_L2_CACHE_H
@@ -0,0 +1,49 @@
+#ifndef UNITS_PROFILER_H
+#define UNITS_PROFILER_H
+
+#include <vector>
+
+#include "Basics.h"
+#include "loader.h"
+
+/*
+ *  Hot spot profile of static instructions. Each cycle of write back is given to the oldest instruction in
+ *  the pipeline: cycles without retirement are stalls of the instruction that retires next, except the ones after
+ *  a flush, that go to the last retired instruction (the branch or jump that redirected fetch).
+ *  Counters are kept in a flat array indexed by PC, the work per cycle is a couple of increments.
+ */
+class Profiler final {
+public:
+    struct Entry final {
+        uint64_t count{0};  // retired instructions
+        uint64_t cycles{0};  // cycles as the oldest instruction, including stalls
+        uint64_t stalls{0};  // cycles without retirement attributed to the instruction
+        uint64_t paired{0};  // retired together with another instruction
+    };
+
+    // Allocates counters for every instruction of imem
+    void Enable(const IMEM &imem);
+    [[nodiscard]] bool isEnabled() const noexcept;
+
+    // Called by write back every cycle with the instructions it retires or the bubbles in their place
+    void Cycle(const PC &pc_up, Bubble bubble_up, const PC &pc_down, Bubble bubble_down) noexcept;
+    // Pipeline is frozen for cycles while the oldest instruction is waiting
+    void Freeze(uint64_t cycles) noexcept;
+
+    [[nodiscard]] const Entry &getEntry(const PC &pc) const noexcept;
+
+    // Instructions sorted by cycles or, if symbols are given, functions with the sum of their instructions
+    void Print(std::ostream &out, const IMEM &imem, const SymbolTable *symbols = nullptr) const;
+
+private:
+    [[nodiscard]] Entry &At(const PC &pc) noexcept;
+
+    std::vector<Entry> entries_;
+    Entry outside_;  // instructions outside of imem, never printed
+    PC base_{0};
+    bool enabled_{false};
+    uint64_t pending_{0};  // stall cycles of the next instruction to retire
+    PC last_retired_{0};
+};
+
+#endif // UNITS_PROFILER_H
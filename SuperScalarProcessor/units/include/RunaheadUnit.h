@@ -0,0 +1,41 @@
+#ifndef UNITS_RUNAHEAD_UNIT_H
+#define UNITS_RUNAHEAD_UNIT_H
+
+#include "Basics.h"
+
+/*
+ *  Runahead execution on blocking load misses.
+ *  While the miss is served the architectural state is checkpointed and instructions after the load
+ *  are pre-executed to find independent loads and prefetch them. Results depending on the missing load
+ *  are marked invalid (INV) and never produce prefetches. When the miss returns the checkpoint is
+ *  restored, so runahead never changes architectural state.
+ */
+class RunaheadUnit final {
+public:
+    struct Checkpoint final {
+        RegisterFile reg_file;
+        std::bitset<32> inv{0};  // INV bit for each register
+        PC pc;
+    };
+
+    void setEnabled(bool enabled) noexcept;
+    [[nodiscard]] bool isEnabled() const noexcept;
+
+    // Pre-executes instructions starting from checkpoint.pc for `cycles` cycles of the miss, which starts at
+    // cycle `start`. Prefetches are issued at the cycles of their instructions and take the whole miss latency
+    void Run(Simulator &cpu, const Checkpoint &checkpoint, uint64_t start, uint32_t cycles);
+
+    [[nodiscard]] uint64_t Episodes() const noexcept;
+    [[nodiscard]] uint64_t Instructions() const noexcept;
+    [[nodiscard]] uint64_t Prefetches() const noexcept;
+
+private:
+    static constexpr const uint32_t issue_width = 2;
+
+    bool enabled_{false};
+    uint64_t episodes_{0};
+    uint64_t instructions_{0};
+    uint64_t prefetches_{0};
+};
+
+#endif // UNITS_RUNAHEAD_UNIT_H
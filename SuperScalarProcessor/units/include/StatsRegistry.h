@@ -0,0 +1,73 @@
+#ifndef UNITS_STATS_REGISTRY_H
+#define UNITS_STATS_REGISTRY_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Basics.h"
+
+/*
+ *  Time series of event counters. Units register their counters by name, the registry keeps pointers to them and
+ *  at the end of every interval of cycles or retired instructions writes a row with the counter increments over
+ *  the interval, so IPC, mispredicts and stalls can be plotted against time. Counters must outlive the registry,
+ *  so registration is done when the simulator is in its final place.
+ */
+class StatsRegistry final {
+public:
+    enum class Format : uint8_t { CSV, JSON };
+    enum class Period : uint8_t { CYCLES, INSTRUCTIONS };
+
+    StatsRegistry() = default;
+    ~StatsRegistry();
+
+    StatsRegistry(const StatsRegistry &) = delete;
+    StatsRegistry &operator=(const StatsRegistry &) = delete;
+    StatsRegistry(StatsRegistry &&) = default;
+    StatsRegistry &operator=(StatsRegistry &&) = default;
+
+    // Counters the intervals are measured with, they are always the first two columns
+    void setClock(const uint64_t &cycles, const uint64_t &instructions) noexcept;
+    void Register(const std::string &name, const uint64_t &counter);
+
+    // Starts the series, the format is JSON for .json files and CSV otherwise
+    bool Open(const std::string &path, Period period, uint64_t interval);
+    [[nodiscard]] bool isEnabled() const noexcept;
+
+    // Called every cycle, writes a row when the interval is over
+    void Sample() {
+        if (Now() >= next_) {
+            Write();
+        }
+    }
+    // Writes the last partial interval and closes the file
+    void Close();
+
+    [[nodiscard]] uint64_t Rows() const noexcept;
+    [[nodiscard]] static Format FormatOf(const std::string &path) noexcept;
+
+private:
+    struct Counter final {
+        std::string name;
+        const uint64_t *value;
+        uint64_t last;
+    };
+
+    [[nodiscard]] uint64_t Now() const noexcept;
+    void Write();
+
+    const uint64_t *cycles_{nullptr};
+    const uint64_t *instructions_{nullptr};
+    uint64_t last_cycles_{0};
+    uint64_t last_instructions_{0};
+    std::vector<Counter> counters_;
+
+    std::ofstream out_;
+    Format format_{Format::CSV};
+    Period period_{Period::CYCLES};
+    uint64_t interval_{0};
+    uint64_t next_{UINT64_MAX};  // no samples until opened
+    uint64_t rows_{0};
+};
+
+#endif // UNITS_STATS_REGISTRY_H
@@ -0,0 +1,62 @@
+#ifndef UNITS_SYSCALL_UNIT_H
+#define UNITS_SYSCALL_UNIT_H
+
+#include <array>
+
+#include "Basics.h"
+
+/*
+ *  Emulation of the proxy kernel system calls made with ECALL.
+ *  The call is performed at retirement: number is taken from a7, arguments from a0-a2 and the result
+ *  (or -errno) is written to a0. Numbers and structure layouts follow newlib (libgloss) and riscv-pk,
+ *  so statically linked newlib binaries run without modifications.
+ */
+class SyscallUnit final {
+public:
+    enum Number : uint32_t {
+        CLOSE = 57,
+        READ = 63,
+        WRITE = 64,
+        FSTAT = 80,
+        EXIT = 93,
+        EXIT_GROUP = 94,
+        CLOCK_GETTIME = 113,
+        GETTIMEOFDAY = 169,
+        BRK = 214
+    };
+
+    // Returns BREAK when the program exits
+    PipelineState Run(Simulator &cpu);
+    // Call made by the functional simulator with a7 as number and a0-a2 as arguments, result is the new a0
+    PipelineState Call(DMEM &dmem, uint32_t number, const std::array<uint32_t, 3> &args, uint32_t &result);
+    // Call already performed by the functional simulator, only its result is written to a0
+    PipelineState Replay(Simulator &cpu, uint32_t result);
+
+    // Initial program break, usually the end of loaded segments
+    void setBreak(uint32_t brk) noexcept;
+    // Maps one of the standard guest descriptors (0, 1, 2) to host descriptor
+    void setFd(uint32_t guest_fd, int host_fd) noexcept;
+
+    [[nodiscard]] bool isExited() const noexcept;
+    [[nodiscard]] int ExitCode() const noexcept;
+    [[nodiscard]] uint64_t Calls() const noexcept;
+
+private:
+    [[nodiscard]] int HostFd(uint32_t guest_fd) const noexcept;
+
+    int32_t Read(DMEM &dmem, uint32_t fd, uint32_t buf, uint32_t count);
+    int32_t Write(const DMEM &dmem, uint32_t fd, uint32_t buf, uint32_t count);
+    int32_t Fstat(DMEM &dmem, uint32_t fd, uint32_t buf);
+    int32_t ClockGettime(DMEM &dmem, uint32_t buf);
+    int32_t Gettimeofday(DMEM &dmem, uint32_t buf);
+    int32_t Brk(uint32_t addr) noexcept;
+
+    std::array<int, 3> fds_{0, 1, 2};
+    uint32_t brk_{0};
+    uint32_t brk_start_{0};
+    bool exited_{false};
+    int exit_code_{0};
+    uint64_t calls_{0};
+};
+
+#endif // UNITS_SYSCALL_UNIT_H